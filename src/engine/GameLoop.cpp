@@ -1,54 +1,338 @@
 #include "GameLoop.h"
+#include "profiling/Profiler.h"
+
+#include <typeinfo>
 
 size_t Time::GetTicksCount()
 {
-    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    auto now = Clock::now().time_since_epoch();
     return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
 }
 
 
-GameLoop::GameLoop()
-    : m_lastTime(0.0)
-    , m_lag(0.0)
-{ }
+GameLoop::GameLoop(int tickRate, int maxFixedSteps)
+    : m_tickRate(0)
+    , m_maxFixedSteps(0)
+    , m_step(0)
+    , m_lastTime()
+    , m_lag(0)
+    , m_tickIndex(0)
+    , m_nextPhase(0)
+    , m_frameBudget(0)
+    , m_overBudgetFrames(0)
+    , m_stepOrigin()
+    , m_renderStop(false)
+{
+    SetTickRate(tickRate);
+    SetMaxFixedSteps(maxFixedSteps);
+}
     
 GameLoop::~GameLoop()
 {
+    StopRenderThread();
+    
     m_fixedUpdatables.clear();
     m_updatables.clear();
     m_renderables.clear();
 }
 
+void GameLoop::SetTickRate(int tickRate)
+{
+    assert(tickRate > 0);
+    m_tickRate = tickRate;
+    m_step = std::chrono::duration_cast<Time::Clock::duration>(std::chrono::duration<double>(1.0 / tickRate));
+}
+
+void GameLoop::SetMaxFixedSteps(int maxFixedSteps)
+{
+    assert(maxFixedSteps > 0);
+    m_maxFixedSteps = maxFixedSteps;
+}
+
 void GameLoop::Start()
 {
-    m_lastTime = Time::GetTicksCount();
-    m_lag = 0.0;
+    m_lastTime = Time::Now();
+    m_lag = Time::Clock::duration::zero();
+    m_tickIndex = 0;
+    m_frameStats = FrameStats();
+    m_stepOrigin = m_lastTime;
 }
 
 void GameLoop::Tick()
 {
-    double current = Time::GetTicksCount();
-    double elapsed = current - m_lastTime;
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    
+    if (!IsRenderThreaded())
+        PROFILE_BEGIN_FRAME();
+    
+    m_dispatchQueue.Drain();
+
+    Time::Clock::time_point current = Time::Now();
+    Time::Clock::duration elapsed = current - m_lastTime;
     
     m_lastTime = current;
     m_lag += elapsed;
     
-    float realElapsedSec = elapsed / 1000.0;
-    m_updatables.for_each([realElapsedSec](std::shared_ptr<IUpdatable> f) { f->Update(realElapsedSec); });
+    FrameStats stats;
+    
+    float realElapsedSec = std::chrono::duration<float>(elapsed).count();
+    m_updatables.for_each([realElapsedSec](IUpdatable* f, NoData&) { f->Update(realElapsedSec); });
+    
+    Time::Clock::time_point updated = Time::Now();
+    stats.updateTime = duration_cast<microseconds>(updated - current);
+    
+    const float fixedDeltaTime = GetFixedDeltaTime();
+    const Time::Clock::time_point deadline = m_frameBudget > Time::Clock::duration::zero()
+        ? current + m_frameBudget
+        : Time::Clock::time_point::max();
     
     int loops = 0;
-    while (m_lag >= MS_PER_UPDATE && loops < SKIP_FRAMES_MAX)
+    while (m_lag >= m_step && loops < m_maxFixedSteps)
     {
-        float fixedDeltaTime = MS_PER_UPDATE / 1000.0;
-        m_fixedUpdatables.for_each([fixedDeltaTime](std::shared_ptr<IFixedUpdatable> f) { f->FixedUpdate(fixedDeltaTime); });
+        if (m_stepGate && !m_stepGate(m_tickIndex))
+            break;
         
-        m_lag -= MS_PER_UPDATE;
+        stats.deferredUpdates += RunFixedStep(fixedDeltaTime, deadline);
         
-        //std::cout << elapsed << " " << fixedDeltaTime << "  " << m_lag << "  " << loops << std::endl;
+        m_lag -= m_step;
         loops++;
     }
+    stats.fixedSteps = loops;
+    
+    if (m_lag >= m_step)
+    {
+        if (m_stepGate)
+            stats.owedSteps = static_cast<int>(m_lag / m_step); // kept, lockstep must simulate every tick
+        else
+        {
+            stats.droppedSteps = static_cast<int>(m_lag / m_step);
+            m_lag = m_lag % m_step; // overloaded, drop the whole steps which were not simulated
+        }
+    }
+    
+    m_stepOrigin = current - m_lag;
+    
+    Time::Clock::time_point simulated = Time::Now();
+    stats.fixedUpdateTime = duration_cast<microseconds>(simulated - updated);
+    
+    if (IsRenderThreaded())
+        PublishFrame();
+    else
+    {
+        float interpolation = GetInterpolation(simulated, m_stepOrigin);
+        m_renderables.for_each([interpolation](IRenderable* f, NoData&)
+        {
+            PROFILE_SCOPE(typeid(*f).name());
+            f->Capture();
+            f->Render(interpolation);
+        });
+    }
+    
+    Time::Clock::time_point finished = Time::Now();
+    stats.renderTime = duration_cast<microseconds>(finished - simulated);
+    stats.frameTime = duration_cast<microseconds>(finished - current);
+    
+    FinishFrame(stats);
+    
+    if (!IsRenderThreaded())
+        PROFILE_END_FRAME();
+}
+
+void GameLoop::Step()
+{
+    if (!IsRenderThreaded())
+        PROFILE_BEGIN_FRAME();
+    
+    m_dispatchQueue.Drain();
+    
+    const float fixedDeltaTime = GetFixedDeltaTime();
+    
+    m_updatables.for_each([fixedDeltaTime](IUpdatable* f, NoData&) { f->Update(fixedDeltaTime); });
+    
+    if (m_stepGate && !m_stepGate(m_tickIndex))
+    {
+        if (!IsRenderThreaded())
+            PROFILE_END_FRAME();
+        return;
+    }
+    
+    RunFixedStep(fixedDeltaTime, Time::Clock::time_point::max());
+    
+    m_lastTime = Time::Now();
+    m_lag = Time::Clock::duration::zero();
+    m_stepOrigin = m_lastTime;
+    
+    if (IsRenderThreaded())
+    {
+        PublishFrame();
+        return;
+    }
+    
+    m_renderables.for_each([](IRenderable* f, NoData&)
+    {
+        PROFILE_SCOPE(typeid(*f).name());
+        f->Capture();
+        f->Render(0.0f);
+    });
+    
+    PROFILE_END_FRAME();
+}
+
+void GameLoop::SetSchedule(IFixedUpdatable* item, UpdateSchedule schedule)
+{
+    assert(schedule.period > 0);
+    
+    ScheduleState* state = m_fixedUpdatables.data(item);
+    assert(state);
+    if (!state)
+        return;
+    
+    if (!state->scheduled)
+        state->phase = m_nextPhase++; // spread the updatables with the same period over the steps
+    
+    state->scheduled = true;
+    state->schedule = schedule;
+    state->phase %= schedule.period;
+}
+
+int GameLoop::RunFixedStep(float fixedDeltaTime, Time::Clock::time_point deadline)
+{
+    int deferred = 0;
+    
+    m_fixedUpdatables.for_each([&](IFixedUpdatable* f, ScheduleState& state)
+    {
+        if (!state.scheduled)
+        {
+            f->FixedUpdate(fixedDeltaTime);
+            return;
+        }
+        
+        state.pendingTime += fixedDeltaTime;
+        
+        if (!state.overdue && (m_tickIndex + state.phase) % state.schedule.period != 0)
+            return;
+        
+        // postponed at most once in a row, so it doesn't starve when every frame is over budget
+        if (state.schedule.deferrable && !state.overdue && Time::Now() >= deadline)
+        {
+            state.overdue = true; // runs on the next step with the time it missed
+            ++deferred;
+            return;
+        }
+        
+        f->FixedUpdate(state.pendingTime);
+        state.pendingTime = 0.0f;
+        state.overdue = false;
+    });
+    
+    if (m_stepListener)
+        m_stepListener(m_tickIndex);
+    
+    ++m_tickIndex;
+    
+    return deferred;
+}
+
+void GameLoop::FinishFrame(const FrameStats& stats)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    
+    m_frameStats = stats;
+    
+    // in the order of Subsystem, the reported time is added to the measured one
+    microseconds* times[] = { &m_frameStats.fixedUpdateTime, &m_frameStats.renderTime, &m_frameStats.uploadTime };
+    static_assert(sizeof(times) / sizeof(times[0]) == static_cast<size_t>(Subsystem::Count), "");
+    
+    for (size_t i = 0; i < static_cast<size_t>(Subsystem::Count); ++i)
+    {
+        SubsystemBudget& budget = m_budgets[i];
+        const Time::Clock::duration time = *times[i] + Time::Clock::duration(budget.reported.exchange(0));
+        *times[i] = duration_cast<microseconds>(time);
+        
+        if (budget.budget > Time::Clock::duration::zero() && time > budget.budget)
+        {
+            m_frameStats.overBudgetSubsystems |= 1u << i;
+            ++budget.overruns;
+        }
+    }
+    
+    m_frameStats.overBudget = m_frameStats.overBudgetSubsystems != 0 || (m_frameBudget > Time::Clock::duration::zero()
+        && (stats.frameTime > m_frameBudget || stats.deferredUpdates > 0 || stats.droppedSteps > 0));
+    
+    if (!m_frameStats.overBudget)
+        return;
+    
+    ++m_overBudgetFrames;
+    if (m_overBudgetListener)
+        m_overBudgetListener(m_frameStats);
+}
+
+Time::Clock::duration GameLoop::GetTimeToNextStep() const
+{
+    const Time::Clock::duration left = m_step - m_lag - (Time::Now() - m_lastTime);
+    return std::max(left, Time::Clock::duration::zero());
+}
+
+float GameLoop::GetInterpolation(Time::Clock::time_point now, Time::Clock::time_point stepOrigin) const
+{
+    const float interpolation = std::chrono::duration<float>(now - stepOrigin) / std::chrono::duration<float>(m_step);
+    return std::max(0.0f, std::min(1.0f, interpolation));
+}
+
+void GameLoop::StartRenderThread(std::function<void()> onStart, std::function<void()> onFrame)
+{
+    assert(!IsRenderThreaded());
     
-    float interpolation = m_lag / MS_PER_UPDATE;
+    m_renderStop = false;
+    m_renderFrames = std::make_unique<SnapshotBuffer<RenderFrame>>();
+    PublishFrame();
+    m_renderThread = std::thread(&GameLoop::RenderThreadLoop, this, std::move(onStart), std::move(onFrame));
+}
+
+void GameLoop::StopRenderThread()
+{
+    if (!IsRenderThreaded())
+        return;
     
-    m_renderables.for_each([interpolation](std::shared_ptr<IRenderable> f) { f->Render(interpolation); });
+    m_renderStop = true;
+    m_renderThread.join();
+    m_renderFrames.reset();
+}
+
+void GameLoop::PublishFrame()
+{
+    m_renderables.for_each([](IRenderable* f, NoData&) { f->Capture(); });
+    
+    RenderFrame& frame = m_renderFrames->GetWriteSlot();
+    m_renderables.copy_owners(frame.renderables); // releases the renderables of an old frame here
+    frame.stepOrigin = m_stepOrigin;
+    m_renderFrames->Publish();
+}
+
+void GameLoop::RenderThreadLoop(std::function<void()> onStart, std::function<void()> onFrame)
+{
+    if (onStart)
+        onStart();
+    
+    while (!m_renderStop)
+    {
+        PROFILE_BEGIN_FRAME();
+        
+        m_renderFrames->Acquire();
+        const RenderFrame& frame = m_renderFrames->GetCurrent();
+        
+        const float interpolation = GetInterpolation(Time::Now(), frame.stepOrigin);
+        for (const auto& f : frame.renderables)
+        {
+            PROFILE_SCOPE(typeid(*f).name());
+            f->Render(interpolation);
+        }
+        
+        if (onFrame)
+            onFrame();
+        
+        PROFILE_END_FRAME();
+    }
 }
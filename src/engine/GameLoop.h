@@ -3,9 +3,18 @@
 #include <cassert>
 #include <chrono>
 #include <algorithm>
-#include <set>
+#include <vector>
+#include <iterator>
 #include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <functional>
 #include <type_traits>
+#include <unordered_map>
+
+#include "threading/DispatchQueue.h"
+#include "threading/SnapshotBuffer.h"
 
 struct IUpdatable
 {
@@ -22,71 +31,388 @@ struct IFixedUpdatable
 struct IRenderable
 {
     virtual void Render(float interpolation) = 0;
+    // Called on the loop thread after the updates, before the frame is rendered. Copy the state
+    // Render draws here (e.g. into a SnapshotBuffer): with a render thread Render runs while the
+    // next updates change the objects, so it must read only the copy.
+    virtual void Capture() {}
     virtual ~IRenderable() = default;
 };
 
 struct Time
 {
+    using Clock = std::chrono::steady_clock;
+    
+    static Clock::time_point Now() { return Clock::now(); }
     static size_t GetTicksCount();
 };
 
+// How often a fixed updatable runs. Updatables with the same period are staggered over
+// the steps, so 300 AI objects with period 3 run 100 per step instead of 300 every 3rd step.
+struct UpdateSchedule
+{
+    uint32_t period = 1;        // runs every period-th fixed step with period * fixed delta time
+    bool deferrable = false;    // may be postponed by one step when the frame is over budget
+};
+
+// The same staggering for a single updatable which iterates many entities itself:
+// process only the entities that are due in the current step.
+struct StaggeredBuckets
+{
+    static bool IsDue(uint64_t tick, size_t entityIndex, uint32_t bucketsCount)
+    {
+        return (tick + entityIndex) % bucketsCount == 0;
+    }
+};
+
+// the parts of a frame with a time budget of their own, see GameLoop::SetBudget
+enum class Subsystem
+{
+    Simulation,     // the fixed steps of a Tick
+    Render,         // the renderables rendered by Tick, only their Capture with a render thread
+    Uploads,        // reported by the render, e.g. the time of TextureManager::ProcessUploads
+    Count
+};
+
+struct FrameStats
+{
+    std::chrono::microseconds frameTime { 0 };
+    std::chrono::microseconds updateTime { 0 };
+    std::chrono::microseconds fixedUpdateTime { 0 };
+    std::chrono::microseconds renderTime { 0 };
+    std::chrono::microseconds uploadTime { 0 };
+    
+    int fixedSteps = 0;
+    int deferredUpdates = 0;    // deferrable updates postponed to the next step
+    int droppedSteps = 0;       // steps not simulated at all because of the step cap
+    int owedSteps = 0;          // steps a step gate or the step cap held back, run by the next Ticks
+    bool overBudget = false;
+    uint32_t overBudgetSubsystems = 0;  // bit 1 << Subsystem of each subsystem over its own budget
+};
+
 class GameLoop
 {
-    template<typename T>
+    struct NoData {};
+    
+    struct ScheduleState
+    {
+        bool scheduled = false;
+        UpdateSchedule schedule;
+        uint32_t phase = 0;
+        float pendingTime = 0.0f;
+        bool overdue = false;
+    };
+    
+    // Dense list of loop items ordered by priority and then by insertion. Dispatch walks raw
+    // pointers in a contiguous array, the owning shared_ptrs are only touched on add and remove.
+    // Adding, removing and changing a priority only record the change in O(1); the changes are
+    // applied together before the next iteration, so spawning or despawning many objects costs
+    // one pass over the list. Removed items are skipped at once, even by a running iteration,
+    // and released when the changes are applied.
+    template<typename T, typename Data = NoData>
     class GameLoopSet
     {
     public:
-        void insert(std::shared_ptr<T> item)
+        void insert(std::shared_ptr<T> item, int priority = 0)
         {
-            std::pair <typename std::set<std::shared_ptr<T>>::iterator, bool> pair = m_targets.insert(item);
-            assert(pair.second);
+            assert(item && m_index.count(item.get()) == 0);
+            m_index.emplace(item.get(), PENDING | m_pending.size());
+            m_pending.push_back(Entry{ Key{ priority, m_sequence++ }, item.get(), Data(), std::move(item) });
         }
         
         bool erase(T* item)
         {
-            auto it = m_targets.begin();
-            for (; it != m_targets.end();)
+            auto found = m_index.find(item);
+            if (found == m_index.end())
+                return false;
+            
+            if (found->second & PENDING)
+                m_pending[found->second & ~PENDING].item = nullptr;
+            else
+                m_items[found->second] = nullptr; // skipped by a running iteration
+            m_index.erase(found);
+            m_changed = true;
+            return true;
+        }
+        
+        void set_priority(T* item, int priority)
+        {
+            auto found = m_index.find(item);
+            assert(found != m_index.end());
+            if (found == m_index.end())
+                return;
+            
+            if (found->second & PENDING)
             {
-                if ((*it).get() == item)
-                    it = m_targets.erase(it);
-                else
-                    ++it;
+                m_pending[found->second & ~PENDING].key.priority = priority;
+            }
+            else
+            {
+                // moved to its new place when the changes are applied, an iteration still visits it
+                m_keys[found->second].priority = priority;
+                m_moved.push_back(item);
+                m_changed = true;
             }
-            return it != m_targets.end();
         }
         
+        Data* data(T* item)
+        {
+            auto found = m_index.find(item);
+            if (found == m_index.end())
+                return nullptr;
+            if (found->second & PENDING)
+                return &m_pending[found->second & ~PENDING].data;
+            return &m_data[found->second];
+        }
+        
+        // f(T* item, Data& data)
         template<typename F>
         void for_each(F&& f)
         {
-            std::for_each(m_targets.begin(), m_targets.end(), f);
+            assert(!m_iterating);
+            apply();
+            
+            m_iterating = true;
+            
+            const size_t count = m_items.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (T* item = m_items[i])
+                    f(item, m_data[i]);
+            }
+            
+            m_iterating = false;
+        }
+        
+        // the owners of the items in iteration order, e.g. to keep them alive on another thread
+        void copy_owners(std::vector<std::shared_ptr<T>>& owners)
+        {
+            assert(!m_iterating);
+            apply();
+            
+            owners.clear();
+            for (size_t i = 0; i < m_items.size(); ++i)
+            {
+                if (m_items[i])
+                    owners.push_back(m_owners[i]);
+            }
         }
         
         void clear()
         {
-            m_targets.clear();
+            assert(!m_iterating);
+            m_items.clear();
+            m_data.clear();
+            m_keys.clear();
+            m_owners.clear();
+            m_pending.clear();
+            m_moved.clear();
+            m_index.clear();
+            m_changed = false;
         }
         
         ~GameLoopSet()
         {
-            assert(m_targets.size() == 0);
+            assert(m_index.size() == 0);
         }
         
     private:
-        std::set<std::shared_ptr<T>> m_targets;
+        // the index of an item not applied yet is its position in m_pending with this bit set
+        enum : size_t { PENDING = ~(size_t(-1) >> 1) };
+        
+        struct Key
+        {
+            int priority;
+            uint64_t sequence;
+            
+            bool operator<(const Key& other) const
+            {
+                return priority != other.priority ? priority < other.priority : sequence < other.sequence;
+            }
+        };
+        
+        struct Entry
+        {
+            Key key;
+            T* item;
+            Data data;
+            std::shared_ptr<T> owner;
+        };
+        
+        void apply()
+        {
+            if (!m_changed && m_pending.empty())
+                return;
+            
+            // the items with a new priority leave their place and are merged back like new ones
+            for (T* item : m_moved)
+            {
+                auto found = m_index.find(item);
+                if (found == m_index.end() || (found->second & PENDING))
+                    continue; // removed or already moved
+                
+                const size_t i = found->second;
+                found->second = PENDING | m_pending.size();
+                m_pending.push_back(Entry{ m_keys[i], item, std::move(m_data[i]), std::move(m_owners[i]) });
+                m_items[i] = nullptr;
+            }
+            m_moved.clear();
+            
+            // close the gaps, the remaining items keep their order
+            size_t live = 0;
+            for (size_t i = 0; i < m_items.size(); ++i)
+            {
+                if (!m_items[i])
+                {
+                    if (m_owners[i])
+                        m_released.push_back(std::move(m_owners[i]));
+                    continue;
+                }
+                if (live != i)
+                {
+                    m_items[live] = m_items[i];
+                    m_data[live] = std::move(m_data[i]);
+                    m_keys[live] = m_keys[i];
+                    m_owners[live] = std::move(m_owners[i]);
+                    m_index[m_items[live]] = live;
+                }
+                ++live;
+            }
+            
+            for (Entry& entry : m_pending)
+            {
+                if (!entry.item)
+                    m_released.push_back(std::move(entry.owner));
+            }
+            m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), [](const Entry& e) { return !e.item; }), m_pending.end());
+            std::sort(m_pending.begin(), m_pending.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+            
+            // merge the sorted new items in from the back, the items before the first one stay put
+            const size_t count = live + m_pending.size();
+            m_items.resize(count);
+            m_data.resize(count);
+            m_keys.resize(count);
+            m_owners.resize(count);
+            
+            size_t next = live;
+            for (size_t write = count, pending = m_pending.size(); pending > 0; )
+            {
+                --write;
+                if (next > 0 && m_pending[pending - 1].key < m_keys[next - 1])
+                {
+                    --next;
+                    m_items[write] = m_items[next];
+                    m_data[write] = std::move(m_data[next]);
+                    m_keys[write] = m_keys[next];
+                    m_owners[write] = std::move(m_owners[next]);
+                }
+                else
+                {
+                    Entry& entry = m_pending[--pending];
+                    m_items[write] = entry.item;
+                    m_data[write] = std::move(entry.data);
+                    m_keys[write] = entry.key;
+                    m_owners[write] = std::move(entry.owner);
+                }
+                m_index[m_items[write]] = write;
+            }
+            m_pending.clear();
+            m_changed = false;
+            
+            // last, a destructor may remove other items
+            m_released.clear();
+        }
+        
+        // parallel arrays, the hot loop reads only m_items and m_data
+        std::vector<T*> m_items;
+        std::vector<Data> m_data;
+        std::vector<Key> m_keys;
+        std::vector<std::shared_ptr<T>> m_owners;
+        
+        std::vector<Entry> m_pending;
+        std::vector<T*> m_moved;
+        std::vector<std::shared_ptr<T>> m_released;
+        std::unordered_map<T*, size_t> m_index;
+        uint64_t m_sequence = 0;
+        bool m_iterating = false;
+        bool m_changed = false;
     };
     
-    const int FPS = 30;
-    const double MS_PER_UPDATE = 1000.0 / FPS;
-    const int SKIP_FRAMES_MAX = 5;
-    
 public:
-    GameLoop();
+    static const int DEFAULT_TICK_RATE = 30;
+    static const int DEFAULT_MAX_FIXED_STEPS = 5;
+    
+    explicit GameLoop(int tickRate = DEFAULT_TICK_RATE, int maxFixedSteps = DEFAULT_MAX_FIXED_STEPS);
     
     ~GameLoop();
     
     void Start();
     
     void Tick();
+    
+    // Advances by exactly one fixed step whatever the wall clock says, used to run
+    // the simulation as fast as possible when nobody watches it.
+    void Step();
+    
+    // time left until Tick has a whole fixed step to simulate
+    Time::Clock::duration GetTimeToNextStep() const;
+    
+    // fixed updates per second, e.g. 60 or 120 for a server tick
+    void SetTickRate(int tickRate);
+    int GetTickRate() const { return m_tickRate; }
+    float GetFixedDeltaTime() const { return 1.0f / m_tickRate; }
+    
+    // fixed steps run by one Tick at most, the rest of the lag is dropped unless a step gate is set
+    void SetMaxFixedSteps(int maxFixedSteps);
+    
+    // index of the next fixed step, fixed updatables use it to consume tick-indexed input
+    uint64_t GetTickIndex() const { return m_tickIndex; }
+    
+    // Lockstep: a fixed step runs only when the gate allows its tick index (e.g. the inputs
+    // of every peer for that tick arrived). Held back steps are not dropped: the lag keeps them
+    // all and the next Ticks catch up at most max fixed steps at a time, see FrameStats::owedSteps.
+    void SetStepGate(std::function<bool(uint64_t tick)> gate) { m_stepGate = std::move(gate); }
+    
+    template<typename T, std::enable_if_t<std::is_base_of<IFixedUpdatable, T>::value, bool> = true>
+    void SetSchedule(std::weak_ptr<T> item, UpdateSchedule schedule)
+    {
+        auto locked = item.lock();
+        assert(locked && schedule.period > 0);
+        if (locked)
+            SetSchedule(static_cast<IFixedUpdatable*>(locked.get()), schedule);
+    }
+    
+    // Time a Tick may take. When the fixed steps exceed it, the deferrable updatables wait for
+    // the next step and the frame is reported as over budget. Zero disables the budget.
+    void SetFrameBudget(Time::Clock::duration budget) { m_frameBudget = budget; }
+    
+    // Time the part of a frame may take, zero (the default) disables it. A subsystem over its
+    // budget counts an overrun of its own and makes the frame over budget, whatever the others.
+    void SetBudget(Subsystem subsystem, Time::Clock::duration budget) { m_budgets[static_cast<size_t>(subsystem)].budget = budget; }
+    uint64_t GetOverBudgetFrames(Subsystem subsystem) const { return m_budgets[static_cast<size_t>(subsystem)].overruns; }
+    
+    // Time spent on the subsystem outside of the loop's own measure, added to the current frame,
+    // e.g. the uploads of the render. Thread safe.
+    void ReportTime(Subsystem subsystem, Time::Clock::duration time) { m_budgets[static_cast<size_t>(subsystem)].reported += time.count(); }
+    
+    const FrameStats& GetFrameStats() const { return m_frameStats; }
+    uint64_t GetOverBudgetFrames() const { return m_overBudgetFrames; }
+    void SetOverBudgetListener(std::function<void(const FrameStats&)> listener) { m_overBudgetListener = std::move(listener); }
+    
+    // called after every fixed step with its index, e.g. to checksum the world
+    void SetStepListener(std::function<void(uint64_t tick)> listener) { m_stepListener = std::move(listener); }
+    
+    // Renders on a dedicated thread instead of at the end of Tick. onStart runs first on the
+    // render thread (make the GL context current there), onFrame after every rendered frame
+    // (swap buffers). Tick and Step end by capturing the renderables and publishing the frame;
+    // the render thread draws the last published frame, never waiting for a running update,
+    // with the interpolation computed at the moment it renders. Renderables are still added
+    // and removed on the loop thread only, a removed one lives until no frame refers to it.
+    void StartRenderThread(std::function<void()> onStart, std::function<void()> onFrame);
+    void StopRenderThread();
+    bool IsRenderThreaded() const { return m_renderThread.joinable(); }
+
+    // tasks posted here from worker threads are executed on the loop thread at the beginning of Tick
+    DispatchQueue& GetDispatchQueue() { return m_dispatchQueue; }
 
     template<typename T, typename ... Args, std::enable_if_t<std::is_base_of<IFixedUpdatable, T>::value, bool> = true>
     std::weak_ptr<T> Add(Args&& ... args)
@@ -115,6 +441,34 @@ public:
         return item;
     }
 
+    // Lower priorities run first, equal ones in the order they were added. The default is 0.
+    template<typename T, std::enable_if_t<std::is_base_of<IFixedUpdatable, T>::value, bool> = true>
+    void SetPriority(std::weak_ptr<T> item, int priority)
+    {
+        auto locked = item.lock();
+        assert(locked);
+        if (locked)
+            m_fixedUpdatables.set_priority(locked.get(), priority);
+    }
+    
+    template<typename T, std::enable_if_t<std::is_base_of<IUpdatable, T>::value, bool> = true>
+    void SetPriority(std::weak_ptr<T> item, int priority)
+    {
+        auto locked = item.lock();
+        assert(locked);
+        if (locked)
+            m_updatables.set_priority(locked.get(), priority);
+    }
+    
+    template<typename T, std::enable_if_t<std::is_base_of<IRenderable, T>::value, bool> = true>
+    void SetPriority(std::weak_ptr<T> item, int priority)
+    {
+        auto locked = item.lock();
+        assert(locked);
+        if (locked)
+            m_renderables.set_priority(locked.get(), priority);
+    }
+    
     template<typename T, std::enable_if_t<std::is_base_of<IFixedUpdatable, T>::value, bool> = true>
     void Remove(T* item)
     {
@@ -127,7 +481,7 @@ public:
         auto locked = item.lock();
         assert(locked);
         if (locked)
-            m_fixedUpdatables.erase(locked.get());
+            Remove(locked.get());
     }
     
     template<typename T, std::enable_if_t<std::is_base_of<IUpdatable, T>::value, bool> = true>
@@ -157,14 +511,60 @@ public:
         auto locked = item.lock();
         assert(locked);
         if (locked)
-            m_renderables.erase(locked.get());
+            Remove(locked.get());
     }
     
 private:
-	double m_lastTime;
-	double m_lag;
+    void SetSchedule(IFixedUpdatable* item, UpdateSchedule schedule);
+    int RunFixedStep(float fixedDeltaTime, Time::Clock::time_point deadline);
+    void FinishFrame(const FrameStats& stats);
+    void PublishFrame();
+    void RenderThreadLoop(std::function<void()> onStart, std::function<void()> onFrame);
+    float GetInterpolation(Time::Clock::time_point now, Time::Clock::time_point stepOrigin) const;
+    
+    int m_tickRate;
+    int m_maxFixedSteps;
+    Time::Clock::duration m_step;
+    
+    Time::Clock::time_point m_lastTime;
+    Time::Clock::duration m_lag;
+    
+    uint64_t m_tickIndex;
+    std::function<bool(uint64_t)> m_stepGate;
+    std::function<void(uint64_t)> m_stepListener;
+    
+    uint32_t m_nextPhase;
+    
+    Time::Clock::duration m_frameBudget;
+    FrameStats m_frameStats;
+    uint64_t m_overBudgetFrames;
+    std::function<void(const FrameStats&)> m_overBudgetListener;
+    
+    struct SubsystemBudget
+    {
+        Time::Clock::duration budget { 0 };
+        std::atomic<Time::Clock::rep> reported { 0 };
+        uint64_t overruns = 0;
+    };
+    SubsystemBudget m_budgets[static_cast<size_t>(Subsystem::Count)];
+    
+    // the moment the lag was zero, the renderables interpolate from it
+    Time::Clock::time_point m_stepOrigin;
+    
+    // what the render thread draws, published by Tick and Step
+    struct RenderFrame
+    {
+        std::vector<std::shared_ptr<IRenderable>> renderables;
+        Time::Clock::time_point stepOrigin;
+    };
+    
+    std::thread m_renderThread;
+    std::atomic<bool> m_renderStop;
+    std::unique_ptr<SnapshotBuffer<RenderFrame>> m_renderFrames;
+
+	DispatchQueue m_dispatchQueue;
 
 	GameLoopSet<IUpdatable> m_updatables;
 	GameLoopSet<IRenderable> m_renderables;
-	GameLoopSet<IFixedUpdatable> m_fixedUpdatables;
+	GameLoopSet<IFixedUpdatable, ScheduleState> m_fixedUpdatables;
 };
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Components take part in the world checksum (lockstep, replays) when they describe how they are
+// hashed, the checksum never falls back to their raw bytes: padding bytes are indeterminate and
+// heap data is behind pointers. Components which don't are left out of it, which suits caches and
+// render state but not the simulated state. Most components list their fields once:
+//
+//     struct Position
+//     {
+//         float x, y;
+//         ECS_DECLARE_TYPE;
+//         ECS_DECLARE_CHECKSUM(Position, x, y);
+//     };
+//
+// The name is hashed in with the fields, so equal values in different component types do not
+// cancel out; it must be unique among the components and the same on every peer. Components
+// with other needs define 'static const char* GetChecksumName()' and 'uint64_t Checksum() const'
+// themselves, hashing their fields with Internal::ChecksumValue.
+#define ECS_DECLARE_CHECKSUM(TypeName, ...) \
+	static const char* GetChecksumName() { return #TypeName; } \
+	uint64_t Checksum() const { return Internal::ChecksumFields(Internal::ChecksumSeed, __VA_ARGS__); }
+
+namespace Internal
+{
+	const uint64_t ChecksumSeed = 14695981039346656037ull;
+
+	// FNV-1a, stable across platforms as long as the hashed bytes are
+	inline uint64_t ChecksumBytes(const void* data, size_t size, uint64_t hash = ChecksumSeed)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// only the types whose every byte is part of the value are hashed as bytes
+	template<typename T, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value, bool> = true>
+	uint64_t ChecksumValue(const T& value, uint64_t hash = ChecksumSeed)
+	{
+		return ChecksumBytes(&value, sizeof(T), hash);
+	}
+
+	template<typename T>
+	auto ChecksumValue(const T& value, uint64_t hash = ChecksumSeed) -> decltype(static_cast<uint64_t>(value.Checksum()))
+	{
+		return ChecksumValue(value.Checksum(), hash);
+	}
+
+	inline uint64_t ChecksumValue(const std::string& value, uint64_t hash = ChecksumSeed)
+	{
+		hash = ChecksumValue(static_cast<uint64_t>(value.size()), hash);
+		return ChecksumBytes(value.data(), value.size(), hash);
+	}
+
+	template<typename T, size_t N>
+	uint64_t ChecksumValue(const T (&values)[N], uint64_t hash = ChecksumSeed)
+	{
+		for (const T& value : values)
+			hash = ChecksumValue(value, hash);
+		return hash;
+	}
+
+	template<typename T, typename A>
+	uint64_t ChecksumValue(const std::vector<T, A>& values, uint64_t hash = ChecksumSeed)
+	{
+		hash = ChecksumValue(static_cast<uint64_t>(values.size()), hash);
+		for (const T& value : values)
+			hash = ChecksumValue(value, hash);
+		return hash;
+	}
+
+	inline uint64_t ChecksumFields(uint64_t hash)
+	{
+		return hash;
+	}
+
+	template<typename T, typename ... Rest>
+	uint64_t ChecksumFields(uint64_t hash, const T& field, const Rest& ... rest)
+	{
+		return ChecksumFields(ChecksumValue(field, hash), rest...);
+	}
+
+	template<typename T, typename = void>
+	struct HasComponentChecksum : std::false_type {};
+
+	template<typename T>
+	struct HasComponentChecksum<T, decltype(static_cast<void>(static_cast<uint64_t>(std::declval<const T&>().Checksum())), static_cast<void>(T::GetChecksumName()))>
+		: std::true_type {};
+
+	template<typename T, std::enable_if_t<HasComponentChecksum<T>::value, bool> = true>
+	uint64_t ComponentChecksum(const T& component)
+	{
+		// the name is hashed once, the type addresses the components are keyed by differ between builds
+		static const uint64_t typeHash = ChecksumBytes(T::GetChecksumName(), std::char_traits<char>::length(T::GetChecksumName()));
+		return ChecksumValue(component.Checksum(), typeHash);
+	}
+
+	// never called, see ComponentContainerInternalBase::IsChecksummed
+	template<typename T, std::enable_if_t<!HasComponentChecksum<T>::value, bool> = true>
+	uint64_t ComponentChecksum(const T&)
+	{
+		return 0;
+	}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Events.h"
+#include "Checksum.h"
 #include <memory>
 
 namespace Internal
@@ -15,6 +16,10 @@ namespace Internal
 
 		// This will be called by the entity itself
 		virtual void Removed(TEntity* ent) = 0;
+
+		// Used by the world checksum to detect desyncs, only when the component type has one
+		virtual bool IsChecksummed() const = 0;
+		virtual uint64_t Checksum() const = 0;
 	};
 
 	template<typename TComponent, typename TWorld, typename TEntity>
@@ -26,6 +31,16 @@ namespace Internal
 
 		TComponent data;
 
+		bool IsChecksummed() const override
+		{
+			return HasComponentChecksum<TComponent>::value;
+		}
+
+		uint64_t Checksum() const override
+		{
+			return ComponentChecksum(data);
+		}
+
 	protected:
 		void Destroy(TWorld* world) override
 		{
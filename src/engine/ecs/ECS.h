@@ -19,6 +19,8 @@
 #include "EntityIterator.h"
 #include "EntityView.h"
 
+#include "math/Random.h"
+
 
 class ECSWorld;
 class Entity;
@@ -103,9 +105,12 @@ public:
 
 	void Reset();
 
-	EntitySystem* RegisterSystem(EntitySystem* system)
+	// Systems tick in ascending order, the ones with equal order tick in registration order.
+	// The order survives disabling and enabling, so every run ticks them the same way.
+	EntitySystem* RegisterSystem(EntitySystem* system, int order = 0)
 	{
-		m_systems.push_back(system);
+		m_systemOrder[system] = { order, m_systemSequence++ };
+		InsertSystem(system);
 		system->Configure(this);
 
 		return system;
@@ -114,6 +119,8 @@ public:
 	void UnregisterSystem(EntitySystem* system)
 	{
 		m_systems.erase(std::remove(m_systems.begin(), m_systems.end(), system), m_systems.end());
+		m_disabledSystems.erase(std::remove(m_disabledSystems.begin(), m_disabledSystems.end(), system), m_disabledSystems.end());
+		m_systemOrder.erase(system);
 		system->Unconfigure(this);
 	}
 
@@ -123,7 +130,7 @@ public:
 		if (it != m_disabledSystems.end())
 		{
 			m_disabledSystems.erase(it);
-			m_systems.push_back(system);
+			InsertSystem(system);
 		}
 	}
 
@@ -242,7 +249,31 @@ public:
 		return m_entAlloc;
 	}
 
+	// Per-world generator, simulation code must use it instead of the global one
+	// so that two worlds seeded alike produce identical ticks.
+	Random& GetRandom()
+	{
+		return m_random;
+	}
+
+	void Seed(uint64 seed)
+	{
+		m_random.Seed(seed);
+	}
+
+	// Hash of the entities, their checksummed components and the generator state.
+	// Compare it between peers or against a replay after every tick to detect desyncs.
+	uint64_t Checksum() const;
+
 private:
+	void InsertSystem(EntitySystem* system)
+	{
+		const auto less = [this](EntitySystem* a, EntitySystem* b) {
+			return m_systemOrder.at(a) < m_systemOrder.at(b);
+		};
+		m_systems.insert(std::upper_bound(m_systems.begin(), m_systems.end(), system, less), system);
+	}
+
 	EntityAllocator m_entAlloc;
 	SystemAllocator m_systemAlloc;
 
@@ -258,6 +289,12 @@ private:
 		, SubscriberPairAllocator
 	> m_subscribers;
 
+	// (order, registration sequence) of every registered system
+	std::unordered_map<EntitySystem*, std::pair<int, size_t>> m_systemOrder;
+	size_t m_systemSequence = 0;
+
+	Random m_random;
+
 	size_t m_lastEntityId = 0;
 };
 
@@ -444,6 +481,30 @@ inline void ECSWorld::Reset()
 	m_lastEntityId = 0;
 }
 
+inline uint64_t ECSWorld::Checksum() const
+{
+	uint64_t hash = Internal::ChecksumValue(static_cast<uint64_t>(m_lastEntityId));
+
+	for (const Entity* ent : m_entities)
+	{
+		hash = Internal::ChecksumValue(static_cast<uint64_t>(ent->GetEntityId()), hash);
+		hash = Internal::ChecksumValue(ent->IsPendingDestroy(), hash);
+
+		// the components map is keyed by type addresses, so combine them independently of its order
+		uint64_t components = 0;
+		for (const auto& pair : ent->m_components)
+		{
+			if (pair.second->IsChecksummed())
+				components += Internal::ChecksumValue(pair.second->Checksum());
+		}
+
+		hash = Internal::ChecksumValue(components, hash);
+	}
+
+	const Random::State& random = m_random.GetState();
+	return Internal::ChecksumFields(hash, random.s, random.hasGaussian, random.hasGaussian ? random.gaussian : 0.0);
+}
+
 inline void ECSWorld::All(std::function<void(Entity*)> viewFunc, bool bIncludePendingDestroy)
 {
 	for (auto* ent : All(bIncludePendingDestroy))
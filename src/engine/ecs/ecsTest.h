@@ -17,6 +17,7 @@ struct Position
 	float y;
 
 	ECS_DECLARE_TYPE;
+	ECS_DECLARE_CHECKSUM(Position, x, y);
 };
 
 ECS_DEFINE_TYPE(Position);
@@ -28,10 +29,21 @@ struct Rotation
 	float angle;
 
 	ECS_DECLARE_TYPE;
+	ECS_DECLARE_CHECKSUM(Rotation, angle);
 };
 
 ECS_DEFINE_TYPE(Rotation);
 
+// render state, left out of the world checksum
+struct Sprite
+{
+	int frame = 0;
+
+	ECS_DECLARE_TYPE;
+};
+
+ECS_DEFINE_TYPE(Sprite);
+
 struct MyEvent
 {
 	int foo;
@@ -142,4 +154,29 @@ void ECSTest()
     assert(!ent->Has<Rotation>());
 
 	world->DestroyWorld();
+
+	// worlds with the same state hash alike, the same value in another component type does not
+	ECSWorld* first = ECSWorld::CreateWorld();
+	ECSWorld* second = ECSWorld::CreateWorld();
+	first->Create()->Assign<Rotation>(1.f);
+	second->Create()->Assign<Rotation>(1.f);
+	assert(first->Checksum() == second->Checksum());
+
+	first->All([](Entity* ent) { ent->Assign<Sprite>(); });
+	assert(first->Checksum() == second->Checksum());
+
+	// the generator state includes the cached second gaussian
+	first->GetRandom().Gaussian();
+	second->GetRandom().Gaussian();
+	assert(first->Checksum() == second->Checksum());
+	Random restored;
+	restored.SetState(first->GetRandom().GetState());
+	assert(restored.Gaussian() == first->GetRandom().Gaussian());
+
+	first->Create()->Assign<Position>(2.f, 0.f);
+	second->Create()->Assign<Rotation>(2.f);
+	assert(first->Checksum() != second->Checksum());
+
+	first->DestroyWorld();
+	second->DestroyWorld();
 }
@@ -0,0 +1,63 @@
+#include "HeadlessDriver.h"
+
+#include "GameLoop.h"
+#include "base/IWindow.h"
+
+#include <thread>
+
+constexpr std::chrono::seconds HeadlessDriver::DEFAULT_STALL_TIMEOUT;
+
+HeadlessDriver::HeadlessDriver(GameLoop& loop, IWindow& window, Pacing pacing)
+    : m_loop(loop)
+    , m_window(window)
+    , m_pacing(pacing)
+    , m_stallTimeout(DEFAULT_STALL_TIMEOUT)
+{
+}
+
+HeadlessDriver::Stats HeadlessDriver::Run(uint64 maxSteps)
+{
+    const auto start = Time::Now();
+
+    m_loop.Start();
+
+    // a Tick runs as many fixed steps as the clock asks for, zero or several, and a gated
+    // Step none; the tick index counts the steps actually simulated
+    const uint64 firstTick = m_loop.GetTickIndex();
+    uint64 steps = 0;
+    auto lastStep = start;
+    bool stalled = false;
+
+    while (!m_window.ShouldClose() && (maxSteps == 0 || steps < maxSteps))
+    {
+        if (m_pacing == Pacing::Unpaced)
+        {
+            m_loop.Step();
+        }
+        else
+        {
+            std::this_thread::sleep_for(m_loop.GetTimeToNextStep());
+            m_loop.Tick();
+        }
+
+        const uint64 simulated = m_loop.GetTickIndex() - firstTick;
+        const auto now = Time::Now();
+        if (simulated != steps)
+        {
+            steps = simulated;
+            lastStep = now;
+            continue;
+        }
+
+        if (m_stallTimeout > Time::Clock::duration::zero() && now - lastStep >= m_stallTimeout)
+        {
+            stalled = true;
+            break;
+        }
+
+        if (m_pacing == Pacing::Unpaced)
+            std::this_thread::yield(); // held back, let the threads which release the step run
+    }
+
+    return Stats{ steps, std::chrono::duration<double>(Time::Now() - start).count(), stalled };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "common/Types.h"
+
+#include <chrono>
+#include <functional>
+
+class GameLoop;
+struct IWindow;
+
+// Drives a GameLoop without a window: either as fast as the CPU allows (simulation
+// throughput benchmarks on CI) or paced to the wall clock (dedicated servers).
+class HeadlessDriver
+{
+public:
+    enum class Pacing
+    {
+        Unpaced,
+        WallClock,
+    };
+
+    struct Stats
+    {
+        uint64 steps;
+        double seconds;
+        bool stalled;   // stopped because no step was simulated for the stall timeout
+
+        double GetStepsPerSecond() const { return seconds > 0 ? steps / seconds : 0; }
+    };
+
+    static constexpr std::chrono::seconds DEFAULT_STALL_TIMEOUT { 10 };
+
+    HeadlessDriver(GameLoop& loop, IWindow& window, Pacing pacing);
+
+    // Run gives up when the loop simulates no step for this long, e.g. a step gate holding
+    // every step back. Zero waits forever, for a server waiting for its peers.
+    void SetStallTimeout(std::chrono::steady_clock::duration timeout) { m_stallTimeout = timeout; }
+
+    // runs until maxSteps fixed steps were simulated (0 means no limit), the window is closed
+    // or the loop stalls
+    Stats Run(uint64 maxSteps);
+
+private:
+    GameLoop& m_loop;
+    IWindow& m_window;
+    Pacing m_pacing;
+    std::chrono::steady_clock::duration m_stallTimeout;
+};
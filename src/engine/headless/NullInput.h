@@ -0,0 +1,32 @@
+#pragma once
+
+#include "base/IInput.h"
+#include "base/IClipboard.h"
+
+// Input without any device attached: no keys are ever pressed.
+class NullInput final : public IInput
+{
+public:
+    void Read() override { }
+    void Clear() override { }
+
+    void AddListener(IInputListener *listener) override { }
+    void RemoveListener(IInputListener *listener) override { }
+
+    bool GetKey(UI::Key key) const override { return false; }
+    bool GetMouseButton(MouseButton button) const override { return false; }
+    const Vec2F& GetMousePosition() const override { return m_mousePosition; }
+
+private:
+    Vec2F m_mousePosition;
+};
+
+class NullClipboard final : public IClipboard
+{
+public:
+    std::string GetText() override { return m_text; }
+    void SetText(const std::string& text) override { m_text = text; }
+
+private:
+    std::string m_text;
+};
@@ -0,0 +1,27 @@
+#include "NullWindow.h"
+
+#include <cassert>
+
+NullWindow::NullWindow(const char* name, int width, int height)
+    : m_name(name)
+    , m_width(width)
+    , m_height(height)
+    , m_shouldClose(false)
+{
+    assert(width > 0 && height > 0);
+}
+
+void NullWindow::AddListener(IWindowListener* listener)
+{
+    m_listeners.insert(listener);
+}
+
+void NullWindow::RemoveListener(IWindowListener* listener)
+{
+    m_listeners.erase(listener);
+}
+
+void NullWindow::Close()
+{
+    m_shouldClose = true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "base/IWindow.h"
+
+#include <atomic>
+#include <set>
+
+// Window stand-in for dedicated servers and soak tests, nothing is shown on screen.
+class NullWindow final : public IWindow
+{
+public:
+    NullWindow(const char* name, int width, int height);
+
+    void AddListener(IWindowListener* listener) override;
+    void RemoveListener(IWindowListener* listener) override;
+
+    int GetPixelWidth() const override { return m_width; }
+    int GetPixelHeight() const override { return m_height; }
+    float GetLayoutScale() const override { return 1.0f; }
+    float GetAspectRatio() const override { return (float)m_width / (float)m_height; }
+
+    bool ShouldClose() const override { return m_shouldClose; }
+    void SwapBuffers() override { }
+    void PollEvents() override { }
+
+    const std::string& GetName() const override { return m_name; }
+    bool IsFocused() const override { return false; }
+
+    Vec2F GetCursorPosInPixels() const override { return Vec2F{}; }
+    Vec2F GetCursorPosInPixels(double xoffset, double yoffset) const override { return Vec2F{ (float)xoffset, (float)yoffset }; }
+    Vec2F GetPixelSize() const override { return Vec2F{ (float)m_width, (float)m_height }; }
+
+    // may be called from any thread, e.g. a signal handler or an admin command
+    void Close();
+
+private:
+    std::string m_name;
+    int m_width;
+    int m_height;
+    std::atomic<bool> m_shouldClose;
+    std::set<IWindowListener*> m_listeners;
+};
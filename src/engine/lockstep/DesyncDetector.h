@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// Remembers the local world checksum of the recent ticks and compares them with the ones
+// reported by a peer or stored in a replay. Returns the first tick that diverged.
+class DesyncDetector
+{
+public:
+    static const uint64_t NoDesync = ~0ull;
+
+    explicit DesyncDetector(size_t historySize = 256)
+        : m_historySize(historySize)
+        , m_firstDesync(NoDesync)
+    {
+    }
+
+    void RecordLocal(uint64_t tick, uint64_t checksum)
+    {
+        m_history.emplace_back(tick, checksum);
+        if (m_history.size() > m_historySize)
+            m_history.pop_front();
+    }
+
+    // returns false when the remote checksum does not match the local one of the same tick
+    bool CheckRemote(uint64_t tick, uint64_t checksum)
+    {
+        for (const auto& entry : m_history)
+        {
+            if (entry.first != tick)
+                continue;
+
+            if (entry.second == checksum)
+                return true;
+
+            if (m_firstDesync == NoDesync || tick < m_firstDesync)
+                m_firstDesync = tick;
+            return false;
+        }
+
+        return true; // too old or not simulated yet, nothing to compare with
+    }
+
+    bool HasDesync() const { return m_firstDesync != NoDesync; }
+    uint64_t GetFirstDesyncTick() const { return m_firstDesync; }
+
+private:
+    size_t m_historySize;
+    uint64_t m_firstDesync;
+    std::deque<std::pair<uint64_t, uint64_t>> m_history;
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Inputs of every player keyed by the tick they must be applied at. Lockstep peers submit
+// their commands for a future tick, the simulation consumes a tick only once all of them arrived,
+// so the applied input never depends on when a packet or a key press happened in wall-clock time.
+template<typename TCommand>
+class TickInputBuffer
+{
+public:
+    explicit TickInputBuffer(uint32_t playersCount)
+        : m_playersCount(playersCount)
+    {
+        assert(playersCount > 0);
+    }
+
+    void Submit(uint64_t tick, uint32_t player, const TCommand& command)
+    {
+        assert(player < m_playersCount);
+
+        Frame& frame = m_frames[tick];
+        if (frame.commands.empty())
+        {
+            frame.commands.resize(m_playersCount);
+            frame.received.resize(m_playersCount, false);
+        }
+
+        if (!frame.received[player])
+        {
+            frame.received[player] = true;
+            ++frame.receivedCount;
+        }
+        frame.commands[player] = command;
+    }
+
+    // use it as GameLoop::SetStepGate
+    bool IsComplete(uint64_t tick) const
+    {
+        auto it = m_frames.find(tick);
+        return it != m_frames.end() && it->second.receivedCount == m_playersCount;
+    }
+
+    // commands ordered by player index; the tick and all older ones are forgotten
+    std::vector<TCommand> Consume(uint64_t tick)
+    {
+        assert(IsComplete(tick));
+
+        std::vector<TCommand> commands = std::move(m_frames[tick].commands);
+        m_frames.erase(m_frames.begin(), m_frames.upper_bound(tick));
+        return commands;
+    }
+
+private:
+    struct Frame
+    {
+        std::vector<TCommand> commands;
+        std::vector<bool> received;
+        uint32_t receivedCount = 0;
+    };
+
+    uint32_t m_playersCount;
+    std::map<uint64_t, Frame> m_frames;
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+
+#include "common/Types.h"
+
+// xoshiro128** generator. Unlike rand() it produces the same sequence on every
+// platform and standard library, so simulations seeded alike stay bit-identical.
+class Random
+{
+public:
+    // everything the next numbers depend on, including the second gaussian of the last pair
+    struct State
+    {
+        uint32 s[4];
+        double gaussian;
+        bool hasGaussian;
+    };
+
+    explicit Random(uint64 seed = 0x2545F4914F6CDD1Dull)
+    {
+        Seed(seed);
+    }
+
+    void Seed(uint64 seed)
+    {
+        // splitmix64 spreads the seed over the whole state, which must not be all zeros
+        for (int i = 0; i < 4; i += 2)
+        {
+            uint64 z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            m_state.s[i] = (uint32)z;
+            m_state.s[i + 1] = (uint32)(z >> 32);
+        }
+        m_state.gaussian = 0.0;
+        m_state.hasGaussian = false;
+    }
+
+    const State& GetState() const { return m_state; }
+    void SetState(const State& state) { m_state = state; }
+
+    uint32 Next()
+    {
+        const uint32 result = Rotl(m_state.s[1] * 5, 7) * 9;
+        const uint32 t = m_state.s[1] << 9;
+
+        m_state.s[2] ^= m_state.s[0];
+        m_state.s[3] ^= m_state.s[1];
+        m_state.s[1] ^= m_state.s[2];
+        m_state.s[0] ^= m_state.s[3];
+        m_state.s[2] ^= t;
+        m_state.s[3] = Rotl(m_state.s[3], 11);
+
+        return result;
+    }
+
+    //returns a random integer between x and y
+    int Int(int x, int y)
+    {
+        assert(y >= x && "<Random::Int>: y is less than x");
+        const uint64 range = (uint64)((int64)y - x) + 1;
+        return (int)((int64)x + (int64)(((uint64)Next() * range) >> 32));
+    }
+
+    //returns a random double in [0, 1)
+    double Float()
+    {
+        return Next() * (1.0 / 4294967296.0);
+    }
+
+    double InRange(double x, double y)
+    {
+        return x + Float() * (y - x);
+    }
+
+    bool Bool()
+    {
+        return (Next() & 1) != 0;
+    }
+
+    //returns a random double in the range -1 < n < 1
+    double Clamped()
+    {
+        return Float() - Float();
+    }
+
+    //returns a random number with a normal distribution (polar method)
+    double Gaussian(double mean = 0.0, double standardDeviation = 1.0)
+    {
+        if (m_state.hasGaussian)
+        {
+            m_state.hasGaussian = false;
+            return mean + m_state.gaussian * standardDeviation;
+        }
+
+        double x1, x2, w;
+        do
+        {
+            x1 = 2.0 * Float() - 1.0;
+            x2 = 2.0 * Float() - 1.0;
+            w = x1 * x1 + x2 * x2;
+        }
+        while (w >= 1.0 || w == 0.0);
+
+        w = std::sqrt((-2.0 * std::log(w)) / w);
+        m_state.gaussian = x2 * w;
+        m_state.hasGaussian = true;
+
+        return mean + x1 * w * standardDeviation;
+    }
+
+    // generator used by the free Rand* helpers when no world generator is passed, one per
+    // thread so the helpers never race; its sequence depends on the thread, not for simulation
+    static Random& Global()
+    {
+        static thread_local Random instance;
+        return instance;
+    }
+
+private:
+    static uint32 Rotl(uint32 x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    State m_state;
+};
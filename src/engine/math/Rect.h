@@ -55,6 +55,12 @@ inline bool PtOnFRect(const RectFloat &rect, const Vec2F &pt)
         rect.top <= pt.y && pt.y <= rect.bottom;
 }
 
+inline bool FRectsIntersect(const RectFloat &a, const RectFloat &b)
+{
+    return a.left < b.right && b.left < a.right &&
+        a.top < b.bottom && b.top < a.bottom;
+}
+
 inline bool PtInRect(const RectInt &rect, int x, int y)
 {
     return rect.left <= x && x < rect.right &&
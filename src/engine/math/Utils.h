@@ -10,6 +10,7 @@
 #include <float.h>
 
 #include "Constants.h"
+#include "Random.h"
 
 //a few useful constants
 constexpr int     MaxInt    = (std::numeric_limits<int>::max)();
@@ -65,63 +66,38 @@ T Maximum(const T& v1, const T& v2)
 //  some random number functions.
 //----------------------------------------------------------------------------
 
+//all of them take the generator explicitly so the simulation can pass its own
+//seeded one (see ECSWorld::GetRandom); the defaults use Random::Global()
+
 //returns a random integer between x and y
-inline int RandInt(int x,int y)
+inline int RandInt(int x, int y, Random& random = Random::Global())
 {
-    assert(y>=x && "<RandInt>: y is less than x");
-    return rand()%(y-x+1)+x;
+    return random.Int(x, y);
 }
 
 //returns a random double between zero and 1
-inline double RandFloat()      {return ((rand())/(RAND_MAX+1.0));}
+inline double RandFloat(Random& random = Random::Global()) {return random.Float();}
 
-inline double RandInRange(double x, double y)
+inline double RandInRange(double x, double y, Random& random = Random::Global())
 {
-    return x + RandFloat()*(y-x);
+    return random.InRange(x, y);
 }
 
 //returns a random bool
-inline bool   RandBool()
+inline bool   RandBool(Random& random = Random::Global())
 {
-    if (RandFloat() > 0.5) return true;
-    
-    else return false;
+    return random.Bool();
 }
 
 //returns a random double in the range -1 < n < 1
-inline double RandomClamped()    {return RandFloat() - RandFloat();}
+inline double RandomClamped(Random& random = Random::Global())    {return random.Clamped();}
 
 
 //returns a random number with a normal distribution. See method at
 //http://www.taygeta.com/random/gaussian.html
-inline double RandGaussian(double mean = 0.0, double standard_deviation = 1.0)
+inline double RandGaussian(double mean = 0.0, double standard_deviation = 1.0, Random& random = Random::Global())
 {
-    double x1, x2, w, y1;
-    static double y2;
-    static int use_last = 0;
-    
-    if (use_last)                /* use value from previous call */
-    {
-        y1 = y2;
-        use_last = 0;
-    }
-    else
-    {
-        do
-        {
-            x1 = 2.0 * RandFloat() - 1.0;
-            x2 = 2.0 * RandFloat() - 1.0;
-            w = x1 * x1 + x2 * x2;
-        }
-        while ( w >= 1.0 );
-        
-        w = sqrt( (-2.0 * log( w ) ) / w );
-        y1 = x1 * w;
-        y2 = x2 * w;
-        use_last = 1;
-    }
-    
-    return( mean + y1 * standard_deviation );
+    return random.Gaussian(mean, standard_deviation);
 }
 
 
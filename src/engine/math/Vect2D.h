@@ -6,6 +6,7 @@
 #include <cstdlib>
 
 #include "Constants.h"
+#include "Random.h"
 #include "common/Types.h"
 
 template <typename T>
@@ -235,9 +236,9 @@ inline Vec2D<T> Vec2dMulY(const Vec2D<T>& v, float m)
 }
 
 // generates a pseudo random number in range [0, max)
-inline float frand(float max)
+inline float frand(float max, Random& random = Random::Global())
 {
-    return (float) rand() / RAND_MAX * max;
+    return (float) random.Float() * max;
 }
 
 template<typename T>
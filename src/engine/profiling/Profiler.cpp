@@ -0,0 +1,175 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <ostream>
+
+static const char* const FRAME_NAME = "frame";
+
+float Profiler::Entry::GetAverage() const
+{
+    const uint32_t samples = GetSamples();
+    if (!samples)
+        return 0.0f;
+
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < samples; ++i)
+        sum += history[i];
+    return sum / samples;
+}
+
+float Profiler::Entry::GetMax() const
+{
+    const uint32_t samples = GetSamples();
+    return samples ? *std::max_element(history, history + samples) : 0.0f;
+}
+
+float Profiler::Entry::GetPercentile(float fraction) const
+{
+    const uint32_t samples = GetSamples();
+    if (!samples)
+        return 0.0f;
+
+    float sorted[HISTORY_SIZE];
+    std::copy(history, history + samples, sorted);
+    const uint32_t rank = std::min(samples - 1, (uint32_t)(fraction * samples));
+    std::nth_element(sorted, sorted + rank, sorted + samples);
+    return sorted[rank];
+}
+
+Profiler& Profiler::Get()
+{
+    static Profiler instance;
+    return instance;
+}
+
+Profiler::Profiler()
+    : m_inFrame(false)
+    , m_frames(0)
+    , m_gpuTimerAvailable(false)
+    , m_dumpFrames(HISTORY_SIZE)
+{
+    FindEntry(Key{ FRAME_NAME, -1, CPU }, 0);
+}
+
+std::size_t Profiler::FindEntry(const Key& key, int depth)
+{
+    auto found = m_index.find(key);
+    if (found != m_index.end())
+        return found->second;
+
+    Entry entry = {};
+    entry.name = key.name;
+    entry.index = key.index;
+    entry.kind = key.kind;
+    entry.depth = depth;
+
+    m_entries.push_back(entry);
+    m_index.emplace(key, m_entries.size() - 1);
+    return m_entries.size() - 1;
+}
+
+void Profiler::BeginFrame()
+{
+    assert(!m_inFrame);
+
+    m_thread = std::this_thread::get_id();
+    m_stack.clear();
+    m_inFrame = true;
+    m_frameStart = Clock::now();
+}
+
+void Profiler::EndFrame()
+{
+    if (!m_inFrame)
+        return;
+
+    assert(m_stack.empty());
+    m_entries[0].current = std::chrono::duration<float, std::milli>(Clock::now() - m_frameStart).count();
+    m_entries[0].currentCalls = 1;
+
+    for (Entry& entry : m_entries)
+    {
+        entry.history[entry.frames % HISTORY_SIZE] = entry.current;
+        entry.calls = entry.currentCalls;
+        entry.current = 0.0f;
+        entry.currentCalls = 0;
+        ++entry.frames;
+    }
+
+    m_inFrame = false;
+    ++m_frames;
+
+    if (!m_dumpPath.empty() && !m_gpuTimerAvailable && m_frames % m_dumpFrames == 0)
+        Dump(m_dumpPath);
+}
+
+bool Profiler::BeginScope(const char* name, int index)
+{
+    if (!m_inFrame || std::this_thread::get_id() != m_thread)
+        return false;
+
+    const std::size_t entry = FindEntry(Key{ name, index, CPU }, (int)m_stack.size() + 1);
+    m_stack.push_back(OpenScope{ entry, Clock::now() });
+    return true;
+}
+
+void Profiler::EndScope()
+{
+    assert(!m_stack.empty());
+
+    const OpenScope& scope = m_stack.back();
+    Entry& entry = m_entries[scope.entry];
+    entry.current += std::chrono::duration<float, std::milli>(Clock::now() - scope.start).count();
+    ++entry.currentCalls;
+    m_stack.pop_back();
+}
+
+void Profiler::AddGpuTime(const char* name, float milliseconds)
+{
+    Entry& entry = m_entries[FindEntry(Key{ name, -1, GPU }, 0)];
+    entry.current += milliseconds;
+    ++entry.currentCalls;
+}
+
+void Profiler::SetDumpFile(std::string path, uint32_t frames)
+{
+    assert(frames > 0);
+
+    m_dumpPath = std::move(path);
+    m_dumpFrames = frames;
+}
+
+bool Profiler::Dump(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out)
+        return false;
+
+    Dump(out);
+    return (bool)out;
+}
+
+void Profiler::Dump(std::ostream& out) const
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%llu frames, ms over the last %d\n", (unsigned long long)m_frames, HISTORY_SIZE);
+    out << line;
+    snprintf(line, sizeof(line), "%-36s %8s %8s %8s %8s %6s\n", "scope", "average", "median", "95%", "max", "calls");
+    out << line;
+
+    for (const Entry& entry : m_entries)
+    {
+        char name[64];
+        if (entry.index >= 0)
+            snprintf(name, sizeof(name), "%*s%s %d", entry.depth * 2, "", entry.name, entry.index);
+        else
+            snprintf(name, sizeof(name), "%*s%s", entry.depth * 2, "", entry.name);
+
+        snprintf(line, sizeof(line), "%-32s %3s %8.3f %8.3f %8.3f %8.3f %6u\n", name, entry.kind == GPU ? "gpu" : "cpu",
+                 entry.GetAverage(), entry.GetPercentile(0.5f), entry.GetPercentile(0.95f), entry.GetMax(), entry.calls);
+        out << line;
+    }
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Times of named CPU scopes and GPU sections per frame, kept for the last HISTORY_SIZE frames.
+// The CPU scopes are recorded on the thread which runs the frames, the one calling BeginFrame,
+// scopes entered on other threads are ignored. The code is instrumented through the PROFILE_
+// macros below, which compile to nothing without ENGINE_PROFILER.
+class Profiler
+{
+public:
+    enum { HISTORY_SIZE = 128 };
+
+    enum Kind
+    {
+        CPU,
+        GPU,
+    };
+
+    struct Entry
+    {
+        const char* name;
+        int index;                              // -1 when the name has no index
+        Kind kind;
+        int depth;                              // nesting of the scope when it first ran
+        float history[HISTORY_SIZE];            // milliseconds of the last frames, a ring
+        uint64_t frames;                        // recorded, the next goes to frames % HISTORY_SIZE
+        float current;                          // milliseconds of the frame being recorded
+        uint32_t currentCalls;
+        uint32_t calls;                         // in the last frame
+
+        uint32_t GetSamples() const { return frames < HISTORY_SIZE ? (uint32_t)frames : (uint32_t)HISTORY_SIZE; }
+        // i frames before the last one
+        float GetSample(uint32_t i) const { return history[(frames - 1 - i) % HISTORY_SIZE]; }
+        float GetAverage() const;
+        float GetMax() const;
+        // the time the 'fraction' of the frames took at most, 0.5 is the median
+        float GetPercentile(float fraction) const;
+    };
+
+    static Profiler& Get();
+
+    void BeginFrame();
+    void EndFrame();
+
+    // the name is kept by the pointer, a string literal or another one living as long
+    bool BeginScope(const char* name, int index = -1);
+    void EndScope();
+
+    // GPU results arrive frames late, they go to the frame being recorded
+    void AddGpuTime(const char* name, float milliseconds);
+    void SetGpuTimerAvailable(bool available) { m_gpuTimerAvailable = available; }
+    bool IsGpuTimerAvailable() const { return m_gpuTimerAvailable; }
+
+    // Without a GPU timer to show the overlay with, e.g. headless or with the software render,
+    // the summary is written to the file every 'frames' frames. An empty path stops it.
+    void SetDumpFile(std::string path, uint32_t frames = HISTORY_SIZE);
+    bool Dump(const std::string& path) const;
+    void Dump(std::ostream& out) const;
+
+    // the first entry is the whole frame
+    const std::vector<Entry>& GetEntries() const { return m_entries; }
+    uint64_t GetFrames() const { return m_frames; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Key
+    {
+        const char* name;
+        int index;
+        Kind kind;
+
+        bool operator==(const Key& other) const { return name == other.name && index == other.index && kind == other.kind; }
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            return std::hash<const void*>()(key.name) ^ ((std::size_t)key.index * 31 + key.kind);
+        }
+    };
+
+    struct OpenScope
+    {
+        std::size_t entry;
+        Clock::time_point start;
+    };
+
+    Profiler();
+
+    std::size_t FindEntry(const Key& key, int depth);
+
+    std::vector<Entry> m_entries;
+    std::unordered_map<Key, std::size_t, KeyHash> m_index;
+    std::vector<OpenScope> m_stack;
+    std::thread::id m_thread;
+
+    Clock::time_point m_frameStart;
+    bool m_inFrame;
+    uint64_t m_frames;
+
+    bool m_gpuTimerAvailable;
+    std::string m_dumpPath;
+    uint32_t m_dumpFrames;
+};
+
+class ProfileScope
+{
+public:
+    explicit ProfileScope(const char* name, int index = -1)
+        : m_active(Profiler::Get().BeginScope(name, index))
+    {
+    }
+
+    ~ProfileScope()
+    {
+        if (m_active)
+            Profiler::Get().EndScope();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    bool m_active;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef ENGINE_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_SCOPE_INDEXED(name, index) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, index)
+#define PROFILE_BEGIN_FRAME() Profiler::Get().BeginFrame()
+#define PROFILE_END_FRAME() Profiler::Get().EndFrame()
+// a statement only the profiling builds have, e.g. the GPU timer calls
+#define PROFILE_ONLY(statement) statement
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_SCOPE_INDEXED(name, index) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#define PROFILE_ONLY(statement) ((void)0)
+#endif
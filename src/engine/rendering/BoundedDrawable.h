@@ -0,0 +1,55 @@
+#pragma once
+
+#include "base/IDrawable.h"
+#include "RenderScheme.h"
+
+#include <cassert>
+
+// A drawable with bounds of its own, e.g. a sprite, a text label or a tile: it keeps the
+// scheme it is registered with and tells it whenever SetBounds moves it, so the culling grid
+// never misses a moved drawable. When Draw interpolates between two positions, the bounds
+// must cover both.
+class BoundedDrawable : public IDrawable
+{
+public:
+	BoundedDrawable() = default;
+	explicit BoundedDrawable(const RectFloat& bounds) : m_bounds(bounds) {}
+
+	BoundedDrawable(const BoundedDrawable&) = delete;
+	BoundedDrawable& operator=(const BoundedDrawable&) = delete;
+
+	// unregister first, the scheme calls GetOrder which is gone in this destructor
+	~BoundedDrawable() override { assert(!m_scheme); }
+
+	void Register(RenderScheme& scheme)
+	{
+		assert(!m_scheme);
+		m_scheme = &scheme;
+		scheme.RegisterDrawable(this);
+	}
+
+	void Unregister()
+	{
+		if (!m_scheme)
+			return;
+		m_scheme->UnegisterDrawable(this);
+		m_scheme = nullptr;
+	}
+
+	void SetBounds(const RectFloat& bounds)
+	{
+		m_bounds = bounds;
+		if (m_scheme)
+			m_scheme->UpdateBounds(this);
+	}
+
+	bool GetBounds(RectFloat& bounds) const override
+	{
+		bounds = m_bounds;
+		return true;
+	}
+
+private:
+	RectFloat m_bounds {};
+	RenderScheme* m_scheme = nullptr;
+};
@@ -0,0 +1,250 @@
+#include "CookedPackage.h"
+#include "KtxImage.h"
+#include "filesystem/FileSystem.h"
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace
+{
+    const uint32 COOKED_MAGIC = 0x4b504354; // "TCPK"
+    const uint32 COOKED_VERSION = 2;
+    const uint32 RAW_PIXELS_VERSION = 1;
+    const uint32 PIXELS_ALIGNMENT = 16;
+
+    struct Header
+    {
+        uint32 magic;
+        uint32 version;
+        uint32 imagesCount;
+        uint32 texturesCount;
+        uint32 framesCount;
+        uint32 namesSize;
+    };
+
+    struct ImageRecord
+    {
+        uint32 width;
+        uint32 height;
+        uint32 bitsPerPixel;    // the size of the KTX container since version 2
+        uint32 pixelsOffset;    // from the beginning of the package
+    };
+
+    struct TextureRecord
+    {
+        uint32 imageIndex;
+        uint32 nameOffset;      // in the names block
+        uint32 nameLength;
+        uint32 firstFrame;
+        uint32 framesCount;
+        float32 uvPivotX;
+        float32 uvPivotY;
+        float32 pxFrameWidth;
+        float32 pxFrameHeight;
+        float32 pxBorderSize;
+        uint8 magFilter;
+        uint8 wrap;
+        uint8 reserved[2];
+    };
+
+    struct FrameRecord
+    {
+        float32 left;
+        float32 top;
+        float32 right;
+        float32 bottom;
+    };
+
+    static_assert(sizeof(Header) == 24 && sizeof(ImageRecord) == 16 && sizeof(TextureRecord) == 44 && sizeof(FrameRecord) == 16,
+        "cooked package records must have no padding");
+
+    template <class T>
+    void Append(std::vector<uint8>& out, const T& record)
+    {
+        const size_t offset = out.size();
+        out.resize(offset + sizeof(T));
+        memcpy(&out[offset], &record, sizeof(T));
+    }
+
+    template <class T>
+    const T* Table(const char* data, size_t size, size_t& offset, size_t count)
+    {
+        if (count > (size - offset) / sizeof(T))
+            throw std::runtime_error("cooked package is truncated");
+
+        const T* table = reinterpret_cast<const T*>(data + offset);
+        offset += count * sizeof(T);
+        return table;
+    }
+
+    // pixels of an image stored in a version 1 package
+    class CookedImage : public IImage
+    {
+    public:
+        CookedImage(std::shared_ptr<FileSystem::Memory> file, const ImageRecord& record)
+            : m_file(std::move(file))
+            , m_record(record)
+        {
+        }
+
+        // Image methods
+        const uint8* GetData() const override { return reinterpret_cast<const uint8*>(m_file->GetData()) + m_record.pixelsOffset; }
+        uint8 GetBitsPerPixel() const override { return (uint8)m_record.bitsPerPixel; }
+        uint32 GetWidth() const override { return m_record.width; }
+        uint32 GetHeight() const override { return m_record.height; }
+
+    private:
+        std::shared_ptr<FileSystem::Memory> m_file;
+        ImageRecord m_record;
+    };
+}
+
+std::vector<uint8> CookPackage(const TextureDefinitions& definitions)
+{
+    std::vector<const IImage*> images;
+    std::map<const IImage*, uint32> imageIndices;
+    std::vector<TextureRecord> textures;
+    std::vector<FrameRecord> frames;
+    std::string names;
+
+    for (auto& item : definitions)
+    {
+        const IImage* image = std::get<0>(item).get();
+        const std::string& name = std::get<1>(item);
+        const TextureManager::LogicalTexture& tex = std::get<2>(item);
+
+        auto emplaced = imageIndices.emplace(image, (uint32)images.size());
+        if (emplaced.second)
+            images.push_back(image);
+
+        TextureRecord record = {};
+        record.imageIndex = emplaced.first->second;
+        record.nameOffset = (uint32)names.size();
+        record.nameLength = (uint32)name.size();
+        record.firstFrame = (uint32)frames.size();
+        record.framesCount = (uint32)tex.uvFrames.size();
+        record.uvPivotX = tex.uvPivot.x;
+        record.uvPivotY = tex.uvPivot.y;
+        record.pxFrameWidth = tex.pxFrameWidth;
+        record.pxFrameHeight = tex.pxFrameHeight;
+        record.pxBorderSize = tex.pxBorderSize;
+        record.magFilter = tex.magFilter;
+        record.wrap = tex.wrap;
+        textures.push_back(record);
+
+        for (const RectFloat& frame : tex.uvFrames)
+            frames.push_back(FrameRecord{ frame.left, frame.top, frame.right, frame.bottom });
+
+        names += name;
+    }
+
+    const size_t tablesSize = sizeof(Header) + images.size() * sizeof(ImageRecord)
+        + textures.size() * sizeof(TextureRecord) + frames.size() * sizeof(FrameRecord) + names.size();
+
+    // the containers go after the tables, each one aligned
+    std::vector<std::vector<uint8>> containers;
+    std::vector<ImageRecord> imageRecords;
+    size_t pixelsOffset = tablesSize;
+    for (const IImage* image : images)
+    {
+        containers.push_back(WriteKtx(*image));
+        pixelsOffset = (pixelsOffset + PIXELS_ALIGNMENT - 1) & ~(size_t)(PIXELS_ALIGNMENT - 1);
+        imageRecords.push_back(ImageRecord{ image->GetWidth(), image->GetHeight(), (uint32)containers.back().size(), (uint32)pixelsOffset });
+        pixelsOffset += containers.back().size();
+    }
+
+    std::vector<uint8> out;
+    out.reserve(pixelsOffset);
+
+    Append(out, Header{ COOKED_MAGIC, COOKED_VERSION, (uint32)images.size(), (uint32)textures.size(), (uint32)frames.size(), (uint32)names.size() });
+    for (const ImageRecord& record : imageRecords)
+        Append(out, record);
+    for (const TextureRecord& record : textures)
+        Append(out, record);
+    for (const FrameRecord& record : frames)
+        Append(out, record);
+    out.insert(out.end(), names.begin(), names.end());
+
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        out.resize(imageRecords[i].pixelsOffset);
+        out.insert(out.end(), containers[i].begin(), containers[i].end());
+    }
+
+    return out;
+}
+
+TextureDefinitions ParseCookedPackage(std::shared_ptr<FileSystem::Memory> file)
+{
+    const char* data = file->GetData();
+    const size_t size = file->GetSize();
+    size_t offset = 0;
+
+    Header header;
+    memcpy(&header, Table<Header>(data, size, offset, 1), sizeof(Header));
+    if (header.magic != COOKED_MAGIC || (header.version != COOKED_VERSION && header.version != RAW_PIXELS_VERSION))
+        throw std::runtime_error("not a cooked texture package or unsupported version");
+
+    const ImageRecord* imageRecords = Table<ImageRecord>(data, size, offset, header.imagesCount);
+    const TextureRecord* textureRecords = Table<TextureRecord>(data, size, offset, header.texturesCount);
+    const FrameRecord* frameRecords = Table<FrameRecord>(data, size, offset, header.framesCount);
+    const char* names = Table<char>(data, size, offset, header.namesSize);
+
+    std::vector<std::shared_ptr<IImage>> images;
+    images.reserve(header.imagesCount);
+    for (uint32 i = 0; i < header.imagesCount; ++i)
+    {
+        ImageRecord record;
+        memcpy(&record, &imageRecords[i], sizeof(record));
+
+        if (header.version == COOKED_VERSION)
+        {
+            auto image = std::make_shared<KtxImage>(file, record.pixelsOffset, record.bitsPerPixel);
+            if (image->GetWidth() != record.width || image->GetHeight() != record.height)
+                throw std::runtime_error("cooked package is corrupted");
+            images.push_back(std::move(image));
+            continue;
+        }
+
+        const size_t pixelsSize = (size_t)record.width * record.height * (record.bitsPerPixel / 8);
+        if (record.pixelsOffset > size || pixelsSize > size - record.pixelsOffset)
+            throw std::runtime_error("cooked package is truncated");
+
+        images.push_back(std::make_shared<CookedImage>(file, record));
+    }
+
+    TextureDefinitions result;
+    result.reserve(header.texturesCount);
+    for (uint32 i = 0; i < header.texturesCount; ++i)
+    {
+        TextureRecord record;
+        memcpy(&record, &textureRecords[i], sizeof(record));
+
+        if (record.imageIndex >= header.imagesCount
+            || record.nameOffset > header.namesSize || record.nameLength > header.namesSize - record.nameOffset
+            || record.firstFrame > header.framesCount || record.framesCount > header.framesCount - record.firstFrame)
+        {
+            throw std::runtime_error("cooked package is corrupted");
+        }
+
+        TextureManager::LogicalTexture tex;
+        tex.uvPivot = { record.uvPivotX, record.uvPivotY };
+        tex.pxFrameWidth = record.pxFrameWidth;
+        tex.pxFrameHeight = record.pxFrameHeight;
+        tex.pxBorderSize = record.pxBorderSize;
+        tex.magFilter = record.magFilter != 0;
+        tex.wrap = record.wrap != 0;
+        tex.uvFrames.reserve(record.framesCount);
+        for (uint32 frame = 0; frame < record.framesCount; ++frame)
+        {
+            FrameRecord rect;
+            memcpy(&rect, &frameRecords[record.firstFrame + frame], sizeof(rect));
+            tex.uvFrames.push_back(RectFloat{ rect.left, rect.top, rect.right, rect.bottom });
+        }
+
+        result.emplace_back(images[record.imageIndex], std::string(names + record.nameOffset, record.nameLength), std::move(tex));
+    }
+
+    return result;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "TextureAtlas.h"
+
+#include <memory>
+#include <vector>
+
+namespace FileSystem
+{
+    class Memory;
+}
+
+// Binary texture package written by the texcook tool. The layout is
+//
+//   header | images | textures | frames | names | image data
+//
+// where the first four are flat tables of fixed size records and every image is a KTX
+// container with its format and mipmaps as they go to the render. All values are little
+// endian. Version 1 packages, which stored the raw pixels instead, are still read.
+std::vector<uint8> CookPackage(const TextureDefinitions& definitions);
+
+// Reads the definitions back without a Lua state and without decoding; the images reference
+// the data in 'file' directly and keep it alive. Throws std::runtime_error on a bad package.
+TextureDefinitions ParseCookedPackage(std::shared_ptr<FileSystem::Memory> file);
@@ -0,0 +1,96 @@
+#include "DrawCommandQueue.h"
+
+#include <cassert>
+
+void DrawCommandQueue::SetLayer(int layer, bool orderIndependent)
+{
+    assert(layer - LAYER_BIAS >= 0 && layer - LAYER_BIAS <= 0xffff);
+    m_layerKey = (uint64_t)(layer - LAYER_BIAS) << 48;
+    m_orderIndependent = orderIndependent;
+}
+
+Vertex* DrawCommandQueue::AddQuad(uint32_t texture)
+{
+    return Add(PROGRAM_TEXTURED, texture, 4);
+}
+
+Vertex* DrawCommandQueue::AddQuads(uint32_t texture, uint32_t count)
+{
+    return Add(PROGRAM_TEXTURED, texture, count * 4);
+}
+
+Vertex* DrawCommandQueue::AddFan(unsigned int nEdges)
+{
+    return Add(PROGRAM_FAN, 0, nEdges + 1);
+}
+
+void DrawCommandQueue::AddSprites(uint32_t texture, const SpriteInstance* sprites, uint32_t count)
+{
+    m_commands.push_back(Command{ MakeKey(PROGRAM_SPRITES, texture), texture, (uint32_t)m_sprites.size(), count });
+    m_sprites.insert(m_sprites.end(), sprites, sprites + count);
+}
+
+uint64_t DrawCommandQueue::MakeKey(Program program, uint32_t texture)
+{
+    uint64_t sequence = 0;
+    if (!m_orderIndependent)
+    {
+        assert(m_sequence < (1u << 24));
+        sequence = m_sequence++;
+    }
+    return m_layerKey | (sequence << 24) | ((uint64_t)program << 16) | (texture & 0xffff);
+}
+
+Vertex* DrawCommandQueue::Add(Program program, uint32_t texture, uint32_t vertexCount)
+{
+    const uint32_t firstVertex = (uint32_t)m_vertices.size();
+
+    m_commands.push_back(Command{ MakeKey(program, texture), texture, firstVertex, vertexCount });
+    m_vertices.resize(firstVertex + vertexCount);
+
+    return &m_vertices[firstVertex];
+}
+
+const std::vector<DrawCommandQueue::Command>& DrawCommandQueue::Sort()
+{
+    // LSD radix sort, a byte per pass; the passes where every key has the same byte are skipped,
+    // which leaves a few passes for a typical frame with a few layers and textures
+    const size_t count = m_commands.size();
+    if (count < 2)
+        return m_commands;
+
+    m_sortBuffer.resize(count);
+
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        size_t offsets[256] = { };
+        for (const Command& command : m_commands)
+            ++offsets[(command.key >> shift) & 0xff];
+
+        if (offsets[(m_commands.front().key >> shift) & 0xff] == count)
+            continue;
+
+        size_t sum = 0;
+        for (size_t& offset : offsets)
+        {
+            const size_t bucket = offset;
+            offset = sum;
+            sum += bucket;
+        }
+
+        for (const Command& command : m_commands)
+            m_sortBuffer[offsets[(command.key >> shift) & 0xff]++] = command;
+
+        m_commands.swap(m_sortBuffer);
+    }
+
+    return m_commands;
+}
+
+void DrawCommandQueue::Clear()
+{
+    m_commands.clear();
+    m_vertices.clear();
+    m_sprites.clear();
+    m_sequence = 0;
+}
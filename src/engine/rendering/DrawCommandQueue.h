@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Vertex.h"
+#include "SpriteInstance.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Deferred geometry of a render batch. Every command gets a 64-bit sort key
+//
+//   | layer 16 | sequence 24 | program 8 | texture 16 |
+//
+// and the queue is radix sorted before replay. Inside a layer the commands are drawn in the
+// order they were submitted, the sequence grows with every command: translucent geometry
+// overlaps and must keep the painter's order. Only in an order independent layer (opaque or
+// never overlapping geometry) the sequence stays 0, and the commands sharing a program and a
+// texture end up next to each other regardless of the submission order. The key holds the
+// low bits of the texture only to group by it, the command keeps the whole name. The sort is
+// stable, commands with equal keys keep the submission order.
+class DrawCommandQueue
+{
+public:
+    enum Program : uint32_t
+    {
+        PROGRAM_FAN = 0,
+        PROGRAM_TEXTURED = 1,
+        PROGRAM_SPRITES = 2,
+    };
+
+    struct Command
+    {
+        uint64_t key;
+        uint32_t texture;
+        uint32_t firstVertex;   // the first sprite and the sprite count for PROGRAM_SPRITES
+        uint32_t vertexCount;   // a multiple of 4 for PROGRAM_TEXTURED
+
+        int GetLayer() const { return (int)((key >> 48) & 0xffff) + LAYER_BIAS; }
+        Program GetProgram() const { return (Program)((key >> 16) & 0xff); }
+        uint32_t GetTexture() const { return texture; }
+    };
+
+    void SetLayer(int layer, bool orderIndependent);
+
+    // the returned vertices stay valid until the next Add
+    Vertex* AddQuad(uint32_t texture);
+    Vertex* AddQuads(uint32_t texture, uint32_t count);
+    Vertex* AddFan(unsigned int nEdges);
+    void AddSprites(uint32_t texture, const SpriteInstance* sprites, uint32_t count);
+
+    bool IsEmpty() const { return m_commands.empty(); }
+
+    const std::vector<Command>& Sort();
+    const Vertex* GetVertices(const Command& command) const { return &m_vertices[command.firstVertex]; }
+    const SpriteInstance* GetSprites(const Command& command) const { return &m_sprites[command.firstVertex]; }
+
+    void Clear();
+
+private:
+    enum { LAYER_BIAS = -32768 };
+
+    uint64_t MakeKey(Program program, uint32_t texture);
+    Vertex* Add(Program program, uint32_t texture, uint32_t vertexCount);
+
+    uint64_t m_layerKey = (uint64_t)(0 - LAYER_BIAS) << 48;
+    bool m_orderIndependent = false;
+    uint32_t m_sequence = 0;
+
+    std::vector<Command> m_commands;
+    std::vector<Command> m_sortBuffer;
+    std::vector<Vertex> m_vertices;
+    std::vector<SpriteInstance> m_sprites;
+};
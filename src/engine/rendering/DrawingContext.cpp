@@ -1,16 +1,23 @@
 #include "DrawingContext.h"
 #include "TextureManager.h"
+#include "RenderCommandBuffer.h"
 
 #include "Color.h"
 #include "Vertex.h"
+#include "LightInstance.h"
+#include "SpriteInstance.h"
+#include "VertexSimd.h"
 
 #include <algorithm>
 
 
-DrawingContext::DrawingContext(const TextureManager &tm, IRender* render, unsigned int width, unsigned int height)
+DrawingContext::DrawingContext(const TextureManager &tm, IRender* render, unsigned int width, unsigned int height, GlyphRunCache &glyphRuns)
     : _tm(tm)
     , _render(render)
     , _mode(UNDEFINED)
+    , _cameraRegion()
+    , _hasCamera(false)
+    , _glyphRuns(&glyphRuns)
 {
     _transformStack.push({ Vec2F{}, 255 });
     _viewport.left = 0;
@@ -20,6 +27,30 @@ DrawingContext::DrawingContext(const TextureManager &tm, IRender* render, unsign
     _render->OnResizeWnd(width, height);
 }
 
+DrawingContext::DrawingContext(const DrawingContext &other, IRender* render, GlyphRunCache &glyphRuns)
+    : _tm(other._tm)
+    , _render(render)
+    , _clipStack(other._clipStack)
+    , _transformStack(other._transformStack)
+    , _viewport(other._viewport)
+    , _mode(other._mode)
+    , _cameraRegion(other._cameraRegion)
+    , _hasCamera(other._hasCamera)
+    , _glyphRuns(&glyphRuns)
+{
+}
+
+void DrawingContext::ResetState(const DrawingContext &other)
+{
+    assert(&_tm == &other._tm);
+    _clipStack = other._clipStack;
+    _transformStack = other._transformStack;
+    _viewport = other._viewport;
+    _mode = other._mode;
+    _cameraRegion = other._cameraRegion;
+    _hasCamera = other._hasCamera;
+}
+
 void DrawingContext::PushClippingRect(RectInt rect)
 {
     rect.left += (int) _transformStack.top().offset.x;
@@ -81,6 +112,17 @@ RectInt DrawingContext::GetVisibleRegion() const
     return visibleRegion;
 }
 
+bool DrawingContext::GetCameraRegion(RectFloat &region) const
+{
+    region = _cameraRegion;
+    return _hasCamera;
+}
+
+unsigned int DrawingContext::GetTextureGeneration() const
+{
+    return _tm.GetGeneration();
+}
+
 static Color ApplyOpacity(Color color, uint8_t opacity)
 {
     auto colorAG = (((color.color & 0xff00ff00) >> 8) * opacity) & 0xff00ff00;
@@ -108,29 +150,7 @@ void DrawingContext::DrawSprite(RectFloat dst, size_t sprite, Color color, unsig
         dst.bottom += _transformStack.top().offset.y;
     }
 
-    v[0].color = color;
-    v[0].u = rt.left;
-    v[0].v = rt.top;
-    v[0].x = dst.left;
-    v[0].y = dst.top;
-
-    v[1].color = color;
-    v[1].u = rt.right;
-    v[1].v = rt.top;
-    v[1].x = dst.right;
-    v[1].y = dst.top;
-
-    v[2].color = color;
-    v[2].u = rt.right;
-    v[2].v = rt.bottom;
-    v[2].x = dst.right;
-    v[2].y = dst.bottom;
-
-    v[3].color = color;
-    v[3].u = rt.left;
-    v[3].v = rt.bottom;
-    v[3].x = dst.left;
-    v[3].y = dst.bottom;
+    VertexSimd::WriteRectQuad(v, dst, rt, color);
 }
 
 void DrawingContext::DrawBorder(const RectFloat &dst, size_t sprite, Color color, unsigned int frame)
@@ -155,240 +175,69 @@ void DrawingContext::DrawBorder(const RectFloat &dst, size_t sprite, Color color
     const float right = dst.right + _transformStack.top().offset.x;
     const float bottom = dst.bottom + _transformStack.top().offset.y;
 
-    Vertex *v;
-    IRender &render = *_render;
-
-    // left edge
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.left - uvBorderWidth;
-    v[0].v = uvFrame.top;
-    v[0].x = left;
-    v[0].y = top + lt.pxBorderSize;
-    v[1].color = color;
-    v[1].u = uvFrame.left;
-    v[1].v = uvFrame.top;
-    v[1].x = left + lt.pxBorderSize;
-    v[1].y = top + lt.pxBorderSize;
-    v[2].color = color;
-    v[2].u = uvFrame.left;
-    v[2].v = uvFrame.bottom;
-    v[2].x = left + lt.pxBorderSize;
-    v[2].y = bottom - lt.pxBorderSize;
-    v[3].color = color;
-    v[3].u = uvFrame.left - uvBorderWidth;
-    v[3].v = uvFrame.bottom;
-    v[3].x = left;
-    v[3].y = bottom - lt.pxBorderSize;
-
-    // right edge
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.right;
-    v[0].v = uvFrame.top;
-    v[0].x = right - lt.pxBorderSize;
-    v[0].y = top + lt.pxBorderSize;
-    v[1].color = color;
-    v[1].u = uvFrame.right + uvBorderWidth;
-    v[1].v = uvFrame.top;
-    v[1].x = right;
-    v[1].y = top + lt.pxBorderSize;
-    v[2].color = color;
-    v[2].u = uvFrame.right + uvBorderWidth;
-    v[2].v = uvFrame.bottom;
-    v[2].x = right;
-    v[2].y = bottom - lt.pxBorderSize;
-    v[3].color = color;
-    v[3].u = uvFrame.right;
-    v[3].v = uvFrame.bottom;
-    v[3].x = right - lt.pxBorderSize;
-    v[3].y = bottom - lt.pxBorderSize;
-
-    // top edge
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.left;
-    v[0].v = uvFrame.top - uvBorderHeight;
-    v[0].x = left + lt.pxBorderSize;
-    v[0].y = top;
-    v[1].color = color;
-    v[1].u = uvFrame.right;
-    v[1].v = uvFrame.top - uvBorderHeight;
-    v[1].x = right - lt.pxBorderSize;
-    v[1].y = top;
-    v[2].color = color;
-    v[2].u = uvFrame.right;
-    v[2].v = uvFrame.top;
-    v[2].x = right - lt.pxBorderSize;
-    v[2].y = top + lt.pxBorderSize;
-    v[3].color = color;
-    v[3].u = uvFrame.left;
-    v[3].v = uvFrame.top;
-    v[3].x = left + lt.pxBorderSize;
-    v[3].y = top + lt.pxBorderSize;
-
-    // bottom edge
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.left;
-    v[0].v = uvFrame.bottom;
-    v[0].x = left + lt.pxBorderSize;
-    v[0].y = bottom - lt.pxBorderSize;
-    v[1].color = color;
-    v[1].u = uvFrame.right;
-    v[1].v = uvFrame.bottom;
-    v[1].x = right - lt.pxBorderSize;
-    v[1].y = bottom - lt.pxBorderSize;
-    v[2].color = color;
-    v[2].u = uvFrame.right;
-    v[2].v = uvFrame.bottom + uvBorderHeight;
-    v[2].x = right - lt.pxBorderSize;
-    v[2].y = bottom;
-    v[3].color = color;
-    v[3].u = uvFrame.left;
-    v[3].v = uvFrame.bottom + uvBorderHeight;
-    v[3].x = left + lt.pxBorderSize;
-    v[3].y = bottom;
-
-    // left top corner
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.left - uvBorderWidth;
-    v[0].v = uvFrame.top - uvBorderHeight;
-    v[0].x = left;
-    v[0].y = top;
-    v[1].color = color;
-    v[1].u = uvFrame.left;
-    v[1].v = uvFrame.top - uvBorderHeight;
-    v[1].x = left + lt.pxBorderSize;
-    v[1].y = top;
-    v[2].color = color;
-    v[2].u = uvFrame.left;
-    v[2].v = uvFrame.top;
-    v[2].x = left + lt.pxBorderSize;
-    v[2].y = top + lt.pxBorderSize;
-    v[3].color = color;
-    v[3].u = uvFrame.left - uvBorderWidth;
-    v[3].v = uvFrame.top;
-    v[3].x = left;
-    v[3].y = top + lt.pxBorderSize;
-
-    // right top corner
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.right;
-    v[0].v = uvFrame.top - uvBorderHeight;
-    v[0].x = right - lt.pxBorderSize;
-    v[0].y = top;
-    v[1].color = color;
-    v[1].u = uvFrame.right + uvBorderWidth;
-    v[1].v = uvFrame.top - uvBorderHeight;
-    v[1].x = right;
-    v[1].y = top;
-    v[2].color = color;
-    v[2].u = uvFrame.right + uvBorderWidth;
-    v[2].v = uvFrame.top;
-    v[2].x = right;
-    v[2].y = top + lt.pxBorderSize;
-    v[3].color = color;
-    v[3].u = uvFrame.right;
-    v[3].v = uvFrame.top;
-    v[3].x = right - lt.pxBorderSize;
-    v[3].y = top + lt.pxBorderSize;
-
-    // right bottom corner
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.right;
-    v[0].v = uvFrame.bottom;
-    v[0].x = right - lt.pxBorderSize;
-    v[0].y = bottom - lt.pxBorderSize;
-    v[1].color = color;
-    v[1].u = uvFrame.right + uvBorderWidth;
-    v[1].v = uvFrame.bottom;
-    v[1].x = right;
-    v[1].y = bottom - lt.pxBorderSize;
-    v[2].color = color;
-    v[2].u = uvFrame.right + uvBorderWidth;
-    v[2].v = uvFrame.bottom + uvBorderHeight;
-    v[2].x = right;
-    v[2].y = bottom;
-    v[3].color = color;
-    v[3].u = uvFrame.right;
-    v[3].v = uvFrame.bottom + uvBorderHeight;
-    v[3].x = right - lt.pxBorderSize;
-    v[3].y = bottom;
-
-    // left bottom corner
-    v = render.DrawQuad(devtex);
-    v[0].color = color;
-    v[0].u = uvFrame.left - uvBorderWidth;
-    v[0].v = uvFrame.bottom;
-    v[0].x = left;
-    v[0].y = bottom - lt.pxBorderSize;
-    v[1].color = color;
-    v[1].u = uvFrame.left;
-    v[1].v = uvFrame.bottom;
-    v[1].x = left + lt.pxBorderSize;
-    v[1].y = bottom - lt.pxBorderSize;
-    v[2].color = color;
-    v[2].u = uvFrame.left;
-    v[2].v = uvFrame.bottom + uvBorderHeight;
-    v[2].x = left + lt.pxBorderSize;
-    v[2].y = bottom;
-    v[3].color = color;
-    v[3].u = uvFrame.left - uvBorderWidth;
-    v[3].v = uvFrame.bottom + uvBorderHeight;
-    v[3].x = left;
-    v[3].y = bottom;
+    const float border = lt.pxBorderSize;
+    const float uvLeft = uvFrame.left - uvBorderWidth;
+    const float uvTop = uvFrame.top - uvBorderHeight;
+    const float uvRight = uvFrame.right + uvBorderWidth;
+    const float uvBottom = uvFrame.bottom + uvBorderHeight;
+
+    // the edges and the corners around the frame in one reservation
+    Vertex *v = _render->DrawQuads(devtex, 8);
+    VertexSimd::WriteRectQuad(v, RectFloat{ left, top + border, left + border, bottom - border },
+                              RectFloat{ uvLeft, uvFrame.top, uvFrame.left, uvFrame.bottom }, color);
+    VertexSimd::WriteRectQuad(v + 4, RectFloat{ right - border, top + border, right, bottom - border },
+                              RectFloat{ uvFrame.right, uvFrame.top, uvRight, uvFrame.bottom }, color);
+    VertexSimd::WriteRectQuad(v + 8, RectFloat{ left + border, top, right - border, top + border },
+                              RectFloat{ uvFrame.left, uvTop, uvFrame.right, uvFrame.top }, color);
+    VertexSimd::WriteRectQuad(v + 12, RectFloat{ left + border, bottom - border, right - border, bottom },
+                              RectFloat{ uvFrame.left, uvFrame.bottom, uvFrame.right, uvBottom }, color);
+    VertexSimd::WriteRectQuad(v + 16, RectFloat{ left, top, left + border, top + border },
+                              RectFloat{ uvLeft, uvTop, uvFrame.left, uvFrame.top }, color);
+    VertexSimd::WriteRectQuad(v + 20, RectFloat{ right - border, top, right, top + border },
+                              RectFloat{ uvFrame.right, uvTop, uvRight, uvFrame.top }, color);
+    VertexSimd::WriteRectQuad(v + 24, RectFloat{ right - border, bottom - border, right, bottom },
+                              RectFloat{ uvFrame.right, uvFrame.bottom, uvRight, uvBottom }, color);
+    VertexSimd::WriteRectQuad(v + 28, RectFloat{ left, bottom - border, left + border, bottom },
+                              RectFloat{ uvLeft, uvFrame.bottom, uvFrame.left, uvBottom }, color);
 }
 
-void DrawingContext::DrawBitmapText(Vec2F origin, float scale, size_t tex, Color color, const std::string &str, AlignTextKind align)
+// the glyph quads of a string drawn at (0, 0), without the color
+static std::vector<Vertex> LayoutBitmapText(const TextureManager::LogicalTexture &lt, float scale, const std::string &str, AlignTextKind align)
 {
-    color = ApplyOpacity(color, _transformStack.top().opacity);
-
-    if (color.a == 0)
-        return;
-
     // grep enum enumAlignText LT CT RT LC CC RC LB CB RB
     static const float dx[] = { 0, 1, 2, 0, 1, 2, 0, 1, 2 };
     static const float dy[] = { 0, 0, 0, 1, 1, 1, 2, 2, 2 };
 
-    std::vector<size_t> lines;
+    size_t lines = 0;
     size_t maxline = 0;
-    if( align )
+    size_t glyphs = 0;
+    size_t count = 0;
+    for( const std::string::value_type *tmp = str.c_str(); *tmp; )
     {
-        size_t count = 0;
-        for( const std::string::value_type *tmp = str.c_str(); *tmp; )
+        if( (unsigned char) *tmp >= 32 )
+            ++glyphs;
+        ++count;
+        ++tmp;
+        if( '\n' == *tmp || '\0' == *tmp )
         {
-            ++count;
-            ++tmp;
-            if( '\n' == *tmp || '\0' == *tmp )
-            {
-                if( maxline < count )
-                    maxline = count;
-                lines.push_back(count);
-                count = 0;
-            }
+            if( maxline < count )
+                maxline = count;
+            ++lines;
+            count = 0;
         }
     }
 
-    if (_mode == INTERFACE)
-    {
-        origin += _transformStack.top().offset;
-    }
-
-    const TextureManager::LogicalTexture &lt = _tm.GetSpriteInfo(tex);
-    IRender &render = *_render;
+    std::vector<Vertex> quads(glyphs * 4);
+    Vertex *v = quads.data();
 
-    size_t count = 0;
+    count = 0;
     size_t line  = 0;
 
     Vec2F pxCharSize = Vec2dFloor(Vec2F{ lt.pxFrameWidth, lt.pxFrameHeight } * scale);
     float pxAdvance = std::floor((lt.pxFrameWidth - 1) * scale);
 
-    float x0 = origin.x - std::floor(dx[align] * pxAdvance * (float) maxline / 2);
-    float y0 = origin.y - std::floor(dy[align] * pxCharSize.y * (float) lines.size() / 2);
+    float x0 = -std::floor(dx[align] * pxAdvance * (float) maxline / 2);
+    float y0 = -std::floor(dy[align] * pxCharSize.y * (float) lines / 2);
 
     for( const std::string::value_type *tmp = str.c_str(); *tmp; ++tmp )
     {
@@ -407,31 +256,38 @@ void DrawingContext::DrawBitmapText(Vec2F origin, float scale, size_t tex, Color
         float x = x0 + (float) ((count++) * pxAdvance);
         float y = y0 + (float) (line * pxCharSize.y);
 
-        Vertex *v = render.DrawQuad(_tm.GetDeviceTexture(tex));
-
-        v[0].color = color;
-        v[0].u = rt.left;
-        v[0].v = rt.top;
-        v[0].x = x;
-        v[0].y = y;
-
-        v[1].color = color;
-        v[1].u = rt.left + WIDTH(rt);
-        v[1].v = rt.top;
-        v[1].x = x + pxCharSize.x;
-        v[1].y = y;
-
-        v[2].color = color;
-        v[2].u = rt.left + WIDTH(rt);
-        v[2].v = rt.bottom;
-        v[2].x = x + pxCharSize.x;
-        v[2].y = y + pxCharSize.y;
-
-        v[3].color = color;
-        v[3].u = rt.left;
-        v[3].v = rt.bottom;
-        v[3].x = x;
-        v[3].y = y + pxCharSize.y;
+        const RectFloat uv = { rt.left, rt.top, rt.left + WIDTH(rt), rt.bottom };
+        VertexSimd::WriteRectQuad(v, RectFloat{ x, y, x + pxCharSize.x, y + pxCharSize.y }, uv, 0);
+        v += 4;
+    }
+
+    return quads;
+}
+
+void DrawingContext::DrawBitmapText(Vec2F origin, float scale, size_t tex, Color color, const std::string &str, AlignTextKind align)
+{
+    color = ApplyOpacity(color, _transformStack.top().opacity);
+
+    if (color.a == 0)
+        return;
+
+    if (_mode == INTERFACE)
+    {
+        origin += _transformStack.top().offset;
+    }
+
+    // most of the text is the same frame to frame, only the layout of new strings is built
+    _glyphRuns->SetGeneration(_tm.GetGeneration());
+    const std::vector<Vertex> *run = _glyphRuns->Find(str, tex, scale, align);
+    if (!run)
+        run = &_glyphRuns->Insert(str, tex, scale, align, LayoutBitmapText(_tm.GetSpriteInfo(tex), scale, str, align));
+
+    const GlTexture &devtex = _tm.GetDeviceTexture(tex);
+    const size_t quads = run->size() / 4;
+    for (size_t first = 0; first < quads; first += IRender::MAX_QUADS)
+    {
+        const unsigned int count = (unsigned int) std::min<size_t>(quads - first, IRender::MAX_QUADS);
+        VertexSimd::CopyQuads(_render->DrawQuads(devtex, count), run->data() + first * 4, count, origin.x, origin.y, color);
     }
 }
 
@@ -455,35 +311,9 @@ void DrawingContext::DrawSprite(size_t tex, unsigned int frame, Color color, flo
         y += _transformStack.top().offset.y;
     }
 
-    float width = lt.pxFrameWidth;
-    float height = lt.pxFrameHeight;
-
-    float px = lt.uvPivot.x * width;
-    float py = lt.uvPivot.y * height;
-
-    v[0].color = color;
-    v[0].u = rt.left;
-    v[0].v = rt.top;
-    v[0].x = x - px * dir.x + py * dir.y;
-    v[0].y = y - px * dir.y - py * dir.x;
-
-    v[1].color = color;
-    v[1].u = rt.right;
-    v[1].v = rt.top;
-    v[1].x = x + (width - px) * dir.x + py * dir.y;
-    v[1].y = y + (width - px) * dir.y - py * dir.x;
-
-    v[2].color = color;
-    v[2].u = rt.right;
-    v[2].v = rt.bottom;
-    v[2].x = x + (width - px) * dir.x - (height - py) * dir.y;
-    v[2].y = y + (width - px) * dir.y + (height - py) * dir.x;
-
-    v[3].color = color;
-    v[3].u = rt.left;
-    v[3].v = rt.bottom;
-    v[3].x = x - px * dir.x - (height - py) * dir.y;
-    v[3].y = y - px * dir.y + (height - py) * dir.x;
+    const float width = lt.pxFrameWidth;
+    const float height = lt.pxFrameHeight;
+    VertexSimd::WriteSpriteQuad(v, rt, color, x, y, lt.uvPivot.x * width, lt.uvPivot.y * height, width, height, dir.x, dir.y);
 }
 
 void DrawingContext::DrawSprite(size_t tex, unsigned int frame, Color color, float x, float y, float width, float height, Vec2F dir)
@@ -504,32 +334,32 @@ void DrawingContext::DrawSprite(size_t tex, unsigned int frame, Color color, flo
         y += _transformStack.top().offset.y;
     }
 
-    float px = lt.uvPivot.x * width;
-    float py = lt.uvPivot.y * height;
+    VertexSimd::WriteSpriteQuad(v, rt, color, x, y, lt.uvPivot.x * width, lt.uvPivot.y * height, width, height, dir.x, dir.y);
+}
 
-    v[0].color = color;
-    v[0].u = rt.left;
-    v[0].v = rt.top;
-    v[0].x = x - px * dir.x + py * dir.y;
-    v[0].y = y - px * dir.y - py * dir.x;
-
-    v[1].color = color;
-    v[1].u = rt.right;
-    v[1].v = rt.top;
-    v[1].x = x + (width - px) * dir.x + py * dir.y;
-    v[1].y = y + (width - px) * dir.y - py * dir.x;
-
-    v[2].color = color;
-    v[2].u = rt.right;
-    v[2].v = rt.bottom;
-    v[2].x = x + (width - px) * dir.x - (height - py) * dir.y;
-    v[2].y = y + (width - px) * dir.y + (height - py) * dir.x;
-
-    v[3].color = color;
-    v[3].u = rt.left;
-    v[3].v = rt.bottom;
-    v[3].x = x - px * dir.x - (height - py) * dir.y;
-    v[3].y = y - px * dir.y + (height - py) * dir.x;
+void DrawingContext::DrawSprites(size_t tex, const SpriteInstance *sprites, size_t count)
+{
+    const Transform &transform = _transformStack.top();
+    const Vec2F offset = _mode == INTERFACE ? transform.offset : Vec2F{};
+    const unsigned int firstFrame = _tm.GetSpriteFrame(tex, 0);
+
+    _sprites.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        SpriteInstance sprite = sprites[i];
+        sprite.color = ApplyOpacity(sprite.color, transform.opacity);
+        if (sprite.color.a == 0)
+            continue;
+
+        assert(sprite.frame < _tm.GetFrameCount(tex));
+        sprite.frame += firstFrame;
+        sprite.x += offset.x;
+        sprite.y += offset.y;
+        _sprites.push_back(sprite);
+    }
+
+    if (!_sprites.empty())
+        _render->DrawSprites(_tm.GetDeviceTexture(tex), _sprites.data(), _sprites.size());
 }
 
 void DrawingContext::DrawIndicator(size_t tex, float x, float y, float value)
@@ -545,29 +375,11 @@ void DrawingContext::DrawIndicator(size_t tex, float x, float y, float value)
 
     Vertex *v = render.DrawQuad(_tm.GetDeviceTexture(tex));
 
-    v[0].color = color;
-    v[0].u = rt.left;
-    v[0].v = rt.top;
-    v[0].x = x - px;
-    v[0].y = y - py;
-
-    v[1].color = color;
-    v[1].u = rt.left + WIDTH(rt) * value;
-    v[1].v = rt.top;
-    v[1].x = x - px + lt.pxFrameWidth * value;
-    v[1].y = y - py;
-
-    v[2].color = color;
-    v[2].u = rt.left + WIDTH(rt) * value;
-    v[2].v = rt.bottom;
-    v[2].x = x - px + lt.pxFrameWidth * value;
-    v[2].y = y - py + lt.pxFrameHeight;
-
-    v[3].color = color;
-    v[3].u = rt.left;
-    v[3].v = rt.bottom;
-    v[3].x = x - px;
-    v[3].y = y - py + lt.pxFrameHeight;
+    // the left 'value' part of the frame
+    VertexSimd::WriteRectQuad(v,
+        RectFloat{ x - px, y - py, x - px + lt.pxFrameWidth * value, y - py + lt.pxFrameHeight },
+        RectFloat{ rt.left, rt.top, rt.left + WIDTH(rt) * value, rt.bottom },
+        color);
 }
 
 void DrawingContext::DrawLine(size_t tex, Color color, float x0, float y0, float x1, float y1, float phase)
@@ -578,6 +390,8 @@ void DrawingContext::DrawLine(size_t tex, Color color, float x0, float y0, float
         return;
 
     const TextureManager::LogicalTexture &lt = _tm.GetSpriteInfo(tex);
+    if (!lt.wrap)
+        _tm.RequestWrap(tex); // tiled, wrong while it is in an atlas
     IRender &render = *_render;
 
     Vertex *v = render.DrawQuad(_tm.GetDeviceTexture(tex));
@@ -588,29 +402,8 @@ void DrawingContext::DrawLine(size_t tex, Color color, float x0, float y0, float
     float s = (y1-y0) / len;
     float py = lt.pxFrameHeight / 2;
 
-    v[0].color = color;
-    v[0].u = phase;
-    v[0].v = 0;
-    v[0].x = x0 + py * s;
-    v[0].y = y0 - py * c;
-
-    v[1].color = color;
-    v[1].u = phase1;
-    v[1].v = 0;
-    v[1].x = x0 + len * c + py * s;
-    v[1].y = y0 + len * s - py * c;
-
-    v[2].color = color;
-    v[2].u = phase1;
-    v[2].v = 1;
-    v[2].x = x0 + len * c - py * s;
-    v[2].y = y0 + len * s + py * c;
-
-    v[3].color = color;
-    v[3].u = phase;
-    v[3].v = 1;
-    v[3].x = x0 - py * s;
-    v[3].y = y0 + py * c;
+    // a len long sprite pivoted at the middle of its left edge, turned to the end point
+    VertexSimd::WriteSpriteQuad(v, RectFloat{ phase, 0, phase1, 1 }, color, x0, y0, 0, py, len, lt.pxFrameHeight, c, s);
 }
 
 void DrawingContext::DrawBackground(size_t tex, RectFloat bounds) const
@@ -618,82 +411,51 @@ void DrawingContext::DrawBackground(size_t tex, RectFloat bounds) const
     Color color = ApplyOpacity(0xffffffff, _transformStack.top().opacity);
 
     const TextureManager::LogicalTexture &lt = _tm.GetSpriteInfo(tex);
+    if (!lt.wrap)
+        _tm.RequestWrap(tex);
     IRender &render = *_render;
     Vertex *v = render.DrawQuad(_tm.GetDeviceTexture(tex));
-    v[0].color = color;
-    v[0].u = bounds.left / lt.pxFrameWidth;
-    v[0].v = bounds.top / lt.pxFrameHeight;
-    v[0].x = bounds.left;
-    v[0].y = bounds.top;
-    v[1].color = color;
-    v[1].u = bounds.right / lt.pxFrameWidth;
-    v[1].v = bounds.top / lt.pxFrameHeight;
-    v[1].x = bounds.right;
-    v[1].y = bounds.top;
-    v[2].color = color;
-    v[2].u = bounds.right / lt.pxFrameWidth;
-    v[2].v = bounds.bottom / lt.pxFrameHeight;
-    v[2].x = bounds.right;
-    v[2].y = bounds.bottom;
-    v[3].color = color;
-    v[3].u = bounds.left / lt.pxFrameWidth;
-    v[3].v = bounds.bottom / lt.pxFrameHeight;
-    v[3].x = bounds.left;
-    v[3].y = bounds.bottom;
-}
-
-static const int SINTABLE_SIZE = 32;
-static const int SINTABLE_MASK = 0x1f;
-
-static float sintable[SINTABLE_SIZE] = {
-     0.000000f, 0.195090f, 0.382683f, 0.555570f,
-     0.707106f, 0.831469f, 0.923879f, 0.980785f,
-     1.000000f, 0.980785f, 0.923879f, 0.831469f,
-     0.707106f, 0.555570f, 0.382683f, 0.195090f,
-    -0.000000f,-0.195090f,-0.382683f,-0.555570f,
-    -0.707106f,-0.831469f,-0.923879f,-0.980785f,
-    -1.000000f,-0.980785f,-0.923879f,-0.831469f,
-    -0.707106f,-0.555570f,-0.382683f,-0.195090f,
-};
+
+    // one texture repeat per frame size, anchored at the world origin
+    VertexSimd::WriteRectQuad(v, bounds,
+        RectFloat{ bounds.left / lt.pxFrameWidth, bounds.top / lt.pxFrameHeight, bounds.right / lt.pxFrameWidth, bounds.bottom / lt.pxFrameHeight },
+        color);
+}
+
+static const int SINTABLE_SIZE = LIGHT_RING_SIZE;
+static const int SINTABLE_MASK = LIGHT_RING_SIZE - 1;
+static const float *const sintable = LightSinTable;
 
 void DrawingContext::DrawPointLight(float intensity, float radius, Vec2F pos)
 {
-    Color color;
-    color.color = 0x00000000;
-    color.a = (unsigned char) std::max(0, std::min(255, int(255.0f * intensity)));
-
-    IRender &render = *_render;
-    Vertex *v = render.DrawFan(SINTABLE_SIZE>>1);
-    v[0].color = color;
-    v[0].x = pos.x;
-    v[0].y = pos.y;
-    for( int i = 0; i < SINTABLE_SIZE>>1; i++ )
-    {
-        v[i+1].x = pos.x + radius * sintable[(i<<1)+(SINTABLE_SIZE>>2) & SINTABLE_MASK];
-        v[i+1].y = pos.y + radius * sintable[i<<1];
-        v[i+1].color.color = 0x00000000;
-    }
+    LightInstance light;
+    light.x = pos.x;
+    light.y = pos.y;
+    light.dirX = 1;
+    light.dirY = 0;
+    light.radius = radius;
+    light.aspect = 1;
+    light.offset = 0;
+    light.edges = SINTABLE_SIZE>>1;
+    light.color.color = 0x00000000;
+    light.color.a = (unsigned char) std::max(0, std::min(255, int(255.0f * intensity)));
+    _render->DrawLights(&light, 1);
 }
 
 void DrawingContext::DrawSpotLight(float intensity, float radius, Vec2F pos, Vec2F dir, float offset, float aspect)
 {
-    Color color;
-    color.color = 0x00000000;
-    color.a = (unsigned char) std::max(0, std::min(255, int(255.0f * intensity)));
-
-    IRender &render = *_render;
-    Vertex *v = render.DrawFan(SINTABLE_SIZE);
-    v[0].color = color;
-    v[0].x = pos.x;
-    v[0].y = pos.y;
-    for( int i = 0; i < SINTABLE_SIZE; i++ )
-    {
-        float x = offset + radius * sintable[i+(SINTABLE_SIZE>>2) & SINTABLE_MASK];
-        float y =          radius * sintable[i] * aspect;
-        v[i+1].x = pos.x + x*dir.x - y*dir.y;
-        v[i+1].y = pos.y + y*dir.x + x*dir.y;
-        v[i+1].color.color = 0x00000000;
-    }
+    LightInstance light;
+    light.x = pos.x;
+    light.y = pos.y;
+    light.dirX = dir.x;
+    light.dirY = dir.y;
+    light.radius = radius;
+    light.aspect = aspect;
+    light.offset = offset;
+    light.edges = SINTABLE_SIZE;
+    light.color.color = 0x00000000;
+    light.color.a = (unsigned char) std::max(0, std::min(255, int(255.0f * intensity)));
+    _render->DrawLights(&light, 1);
 }
 
 void DrawingContext::DrawDirectLight(float intensity, float radius, Vec2F pos, Vec2F dir, float length)
@@ -710,7 +472,7 @@ void DrawingContext::DrawDirectLight(float intensity, float radius, Vec2F pos, V
     for( int i = 0; i <= SINTABLE_SIZE>>2; i++ )
     {
         float x = radius * sintable[i<<1];
-        float y = radius * sintable[(i<<1)+(SINTABLE_SIZE>>2) & SINTABLE_MASK];
+        float y = radius * sintable[((i<<1)+(SINTABLE_SIZE>>2)) & SINTABLE_MASK];
         v[i+1].x = pos.x - x*dir.x - y*dir.y;
         v[i+1].y = pos.y - x*dir.y + y*dir.x;
         v[i+1].color.color = 0x00000000;
@@ -735,7 +497,7 @@ void DrawingContext::DrawDirectLight(float intensity, float radius, Vec2F pos, V
     for( int i = 0; i <= SINTABLE_SIZE>>2; i++ )
     {
         float x = radius * sintable[i<<1] + length;
-        float y = radius * sintable[(i<<1)+(SINTABLE_SIZE>>2) & SINTABLE_MASK];
+        float y = radius * sintable[((i<<1)+(SINTABLE_SIZE>>2)) & SINTABLE_MASK];
         v[i+1].x = pos.x + x*dir.x - y*dir.y;
         v[i+1].y = pos.y + x*dir.y + y*dir.x;
         v[i+1].color.color = 0x00000000;
@@ -749,6 +511,12 @@ void DrawingContext::Camera(RectInt viewport, float x, float y, float scale)
     viewport.right += (int) _transformStack.top().offset.x;
     viewport.bottom += (int) _transformStack.top().offset.y;
     _render->Camera(&viewport, x, y, scale);
+
+    // the render puts (x, y) into the viewport center
+    const float halfWidth = (float)(WIDTH(viewport) / 2) / scale;
+    const float halfHeight = (float)(HEIGHT(viewport) / 2) / scale;
+    _cameraRegion = RectFloat{ x - halfWidth, y - halfHeight, x + (float)WIDTH(viewport) / scale - halfWidth, y + (float)HEIGHT(viewport) / scale - halfHeight };
+    _hasCamera = true;
 }
 
 void DrawingContext::SetAmbient(float ambient)
@@ -762,6 +530,44 @@ void DrawingContext::SetMode(RenderMode mode)
     {
         _render->SetMode(mode);
         _mode = mode;
+
+        // the renders reset the camera for the interface only, the other modes keep culling with it
+        if (mode == INTERFACE)
+            _hasCamera = false;
     }
 }
 
+void DrawingContext::SetSortLayer(int layer, bool orderIndependent)
+{
+    _render->SetSortLayer(layer, orderIndependent);
+}
+
+unsigned int DrawingContext::CreateStaticBatch()
+{
+    return _render->CreateStaticBatch();
+}
+
+void DrawingContext::BeginStaticBatch(unsigned int batch)
+{
+    _render->BeginStaticBatch(batch);
+}
+
+void DrawingContext::EndStaticBatch()
+{
+    _render->EndStaticBatch();
+}
+
+void DrawingContext::DrawStaticBatch(unsigned int batch)
+{
+    _render->DrawStaticBatch(batch);
+}
+
+void DrawingContext::FreeStaticBatch(unsigned int batch)
+{
+    _render->FreeStaticBatch(batch);
+}
+
+void DrawingContext::DrawCommands(const RenderCommandBuffer &buffer)
+{
+    buffer.Replay(*_render);
+}
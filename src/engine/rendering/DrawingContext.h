@@ -2,12 +2,15 @@
 
 #include <stack>
 #include <string>
+#include <vector>
 
 #include "math/Rect.h"
 #include "base/IRender.h"
+#include "GlyphRunCache.h"
+#include "SpriteInstance.h"
 
-struct Color;
 class TextureManager;
+class RenderCommandBuffer;
 
 
 enum AlignTextKind
@@ -26,7 +29,17 @@ enum AlignTextKind
 class DrawingContext
 {
 public:
-    DrawingContext(const TextureManager &tm, IRender* render, unsigned int width, unsigned int height);
+    // The glyph run cache outlives the context, which is made anew every frame. The cache is
+    // not synchronized, the contexts sharing it draw on the same thread.
+    DrawingContext(const TextureManager &tm, IRender* render, unsigned int width, unsigned int height, GlyphRunCache &glyphRuns);
+
+    // the same state drawing to another render, e.g. a RenderCommandBuffer of a worker thread,
+    // with a glyph run cache of that thread
+    DrawingContext(const DrawingContext &other, IRender* render, GlyphRunCache &glyphRuns);
+
+    // takes the state of another context and keeps its own render and cache, so a worker
+    // context is reused frame after frame
+    void ResetState(const DrawingContext &other);
 
     void PushClippingRect(RectInt rect);
     void PopClippingRect();
@@ -36,11 +49,19 @@ public:
 
     RectInt GetVisibleRegion() const;
 
+    // world rectangle seen through the last Camera call, false without a camera
+    bool GetCameraRegion(RectFloat &region) const;
+
+    // see TextureManager::GetGeneration
+    unsigned int GetTextureGeneration() const;
+
     void DrawSprite(const RectFloat dst, size_t sprite, Color color, unsigned int frame);
     void DrawBorder(const RectFloat &dst, size_t sprite, Color color, unsigned int frame);
+    // the layout of the strings is cached, see GetGlyphRunCache
     void DrawBitmapText(Vec2F origin, float scale, size_t tex, Color color, const std::string &str, AlignTextKind align = alignTextLT);
     void DrawSprite(size_t tex, unsigned int frame, Color color, float x, float y, Vec2F dir);
     void DrawSprite(size_t tex, unsigned int frame, Color color, float x, float y, float width, float height, Vec2F dir);
+    void DrawSprites(size_t tex, const SpriteInstance *sprites, size_t count); // frames are of 'tex'
     void DrawIndicator(size_t tex, float x, float y, float value);
     void DrawLine(size_t tex, Color color, float x0, float y0, float x1, float y1, float phase);
     void DrawBackground(size_t tex, RectFloat bounds) const;
@@ -52,6 +73,19 @@ public:
     void Camera(RectInt viewport, float x, float y, float scale);
     void SetAmbient(float ambient);
     void SetMode(const RenderMode mode);
+    void SetSortLayer(int layer, bool orderIndependent = false);
+
+    // see IRender, 0 when the render keeps no static geometry
+    unsigned int CreateStaticBatch();
+    void BeginStaticBatch(unsigned int batch);
+    void EndStaticBatch();
+    void DrawStaticBatch(unsigned int batch);
+    void FreeStaticBatch(unsigned int batch);
+
+    const GlyphRunCache& GetGlyphRunCache() const { return *_glyphRuns; }
+
+    // replays geometry recorded through another context into this one's render
+    void DrawCommands(const RenderCommandBuffer &buffer);
 
 private:
     struct Transform
@@ -65,4 +99,8 @@ private:
     std::stack<Transform> _transformStack;
     RectInt _viewport;
     RenderMode _mode;
+    RectFloat _cameraRegion;
+    bool _hasCamera;
+    std::vector<SpriteInstance> _sprites; // DrawSprites scratch
+    GlyphRunCache *_glyphRuns;
 };
@@ -0,0 +1,67 @@
+#include "EncodedImage.h"
+
+#include "filesystem/FileSystem.h"
+
+#if defined(SOIL_ENABLED)
+#include "SoilImage.h"
+#include "stb_image_aug.h"
+#else
+#include "TGAImage.h"
+#endif
+
+#include <cassert>
+#include <stdexcept>
+
+EncodedImage::EncodedImage(std::shared_ptr<FileSystem::Memory> file)
+    : m_file(std::move(file))
+{
+    const unsigned char *data = (const unsigned char *)m_file->GetData();
+    const unsigned long size = m_file->GetSize();
+
+#if defined(SOIL_ENABLED)
+    int width;
+    int height;
+    int channels;
+    if (!stbi_info_from_memory(data, (int)size, &width, &height, &channels))
+        throw std::runtime_error(stbi_failure_reason());
+
+    m_width = width;
+    m_height = height;
+    m_bpp = channels == 4 ? 32 : 24;
+#else
+    // the size and the depth of TgaImage, bytes 12 to 16 of the header
+    if (size < 18)
+        throw std::runtime_error("corrupted TGA image");
+
+    m_width = data[13] * 256 + data[12];
+    m_height = data[15] * 256 + data[14];
+    m_bpp = data[16];
+
+    if (m_width == 0 || m_height == 0 || (m_bpp != 24 && m_bpp != 32))
+        throw std::runtime_error("unsupported size or bpp");
+#endif
+}
+
+EncodedImage::~EncodedImage() = default;
+
+const uint8* EncodedImage::GetData() const
+{
+    std::call_once(m_decodeOnce, &EncodedImage::Decode, this);
+    return m_decoded->GetData();
+}
+
+void EncodedImage::Decode() const
+{
+#if defined(SOIL_ENABLED)
+    m_decoded.reset(new SoilImage(m_file->GetData(), m_file->GetSize()));
+#else
+    m_decoded.reset(new TgaImage(m_file->GetData(), m_file->GetSize()));
+#endif
+
+    assert(m_decoded->GetWidth() == m_width && m_decoded->GetHeight() == m_height);
+    if (m_decoded->GetBitsPerPixel() != m_bpp)
+        throw std::runtime_error("the image does not match its header");
+
+    // the pixels are all that is needed from now on
+    m_file.reset();
+}
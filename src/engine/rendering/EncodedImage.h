@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+
+#include "base/IImage.h"
+
+namespace FileSystem
+{
+    class Memory;
+}
+
+// An image file which is decoded only when its pixels are first needed. The size and the bits
+// per pixel come from the file header right away, so the package can be laid out before any
+// decoding. The decoding may run on any thread, GetData waits for one already in progress.
+// Throws std::runtime_error from the constructor on a bad header and from GetData on bad data.
+class EncodedImage : public IImage
+{
+public:
+    explicit EncodedImage(std::shared_ptr<FileSystem::Memory> file);
+    ~EncodedImage();
+
+    // Image methods
+    const uint8* GetData() const override;
+    uint8 GetBitsPerPixel() const override { return m_bpp; }
+    uint32 GetWidth() const override { return m_width; }
+    uint32 GetHeight() const override { return m_height; }
+
+private:
+    void Decode() const;
+
+    mutable std::shared_ptr<FileSystem::Memory> m_file; // released once decoded
+    uint32 m_width;
+    uint32 m_height;
+    uint8 m_bpp;
+
+    mutable std::once_flag m_decodeOnce;
+    mutable std::unique_ptr<IImage> m_decoded;
+};
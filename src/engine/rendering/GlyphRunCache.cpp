@@ -0,0 +1,91 @@
+#include "GlyphRunCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+
+GlyphRunCache::GlyphRunCache(size_t maxRuns, size_t maxQuads)
+    : m_maxRuns(maxRuns)
+    , m_maxQuads(maxQuads)
+    , m_quads(0)
+    , m_generation(0)
+    , m_stats()
+{
+}
+
+size_t GlyphRunCache::Hash(const std::string &str, size_t tex, float scale, int align)
+{
+    uint32_t scaleBits;
+    memcpy(&scaleBits, &scale, sizeof(scaleBits));
+
+    size_t hash = std::hash<std::string>()(str);
+    for (size_t value : { tex, (size_t)scaleBits, (size_t)align })
+        hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+const std::vector<Vertex>* GlyphRunCache::Find(const std::string &str, size_t tex, float scale, int align)
+{
+    const size_t hash = Hash(str, tex, scale, align);
+    auto range = m_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        Run &run = *it->second;
+        if (run.tex == tex && run.scale == scale && run.align == align && run.str == str)
+        {
+            m_runs.splice(m_runs.begin(), m_runs, it->second);
+            ++m_stats.hits;
+            return &run.quads;
+        }
+    }
+
+    ++m_stats.misses;
+    return nullptr;
+}
+
+const std::vector<Vertex>& GlyphRunCache::Insert(const std::string &str, size_t tex, float scale, int align, std::vector<Vertex> quads)
+{
+    const size_t hash = Hash(str, tex, scale, align);
+    m_quads += quads.size() / 4;
+    m_runs.push_front(Run{ hash, str, tex, scale, align, std::move(quads) });
+    m_index.emplace(hash, m_runs.begin());
+    Evict();
+    return m_runs.front().quads;
+}
+
+void GlyphRunCache::Evict()
+{
+    // the run just inserted stays even when it alone is over the limit
+    while (m_runs.size() > 1 && (m_runs.size() > m_maxRuns || m_quads > m_maxQuads))
+    {
+        const Run &run = m_runs.back();
+        auto range = m_index.equal_range(run.hash);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (&*it->second == &run)
+            {
+                m_index.erase(it);
+                break;
+            }
+        }
+        m_quads -= run.quads.size() / 4;
+        m_runs.pop_back();
+        ++m_stats.evictions;
+    }
+}
+
+void GlyphRunCache::SetGeneration(unsigned int generation)
+{
+    if (m_generation != generation)
+    {
+        Clear();
+        m_generation = generation;
+    }
+}
+
+void GlyphRunCache::Clear()
+{
+    m_runs.clear();
+    m_index.clear();
+    m_quads = 0;
+}
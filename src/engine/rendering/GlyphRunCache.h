@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Laid out strings of DrawingContext::DrawBitmapText: the glyph quads of a string, relative to
+// its origin and without the color, by the string, the font texture, the scale and the align.
+// The least recently used runs are evicted when the runs or their quads exceed the limits.
+class GlyphRunCache
+{
+public:
+    struct Stats
+    {
+        size_t hits;
+        size_t misses;
+        size_t evictions;
+    };
+
+    explicit GlyphRunCache(size_t maxRuns = 512, size_t maxQuads = 16384);
+
+    // nullptr when the run is not cached, otherwise it becomes the most recently used
+    const std::vector<Vertex>* Find(const std::string &str, size_t tex, float scale, int align);
+    const std::vector<Vertex>& Insert(const std::string &str, size_t tex, float scale, int align, std::vector<Vertex> quads);
+
+    // the runs depend on the frames of the font textures, they are dropped when the generation
+    // of the texture manager changes
+    void SetGeneration(unsigned int generation);
+    void Clear();
+
+    size_t GetRunsCount() const { return m_runs.size(); }
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    struct Run
+    {
+        size_t hash;
+        std::string str;
+        size_t tex;
+        float scale;
+        int align;
+        std::vector<Vertex> quads;      // 4 vertices each
+    };
+
+    static size_t Hash(const std::string &str, size_t tex, float scale, int align);
+    void Evict();
+
+    std::list<Run> m_runs;                                          // the most recently used first
+    std::unordered_multimap<size_t, std::list<Run>::iterator> m_index;  // by the hash
+    size_t m_maxRuns;
+    size_t m_maxQuads;
+    size_t m_quads;
+    unsigned int m_generation;
+    Stats m_stats;
+};
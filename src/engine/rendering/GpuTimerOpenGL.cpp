@@ -0,0 +1,88 @@
+#include "GpuTimerOpenGL.h"
+#include "profiling/Profiler.h"
+
+GpuTimerOpenGL::GpuTimerOpenGL()
+    : m_frames()
+    , m_current(0)
+    , m_running(false)
+    , m_supported(GLEW_VERSION_3_3 || GLEW_ARB_timer_query)
+    , m_dropped(0)
+{
+    if (m_supported)
+    {
+        for (Frame& frame : m_frames)
+            glGenQueries(MAX_SECTIONS, frame.queries);
+    }
+
+    Profiler::Get().SetGpuTimerAvailable(m_supported);
+}
+
+GpuTimerOpenGL::~GpuTimerOpenGL()
+{
+    if (m_running)
+        glEndQuery(GL_TIME_ELAPSED);
+
+    if (m_supported)
+    {
+        for (Frame& frame : m_frames)
+            glDeleteQueries(MAX_SECTIONS, frame.queries);
+    }
+
+    Profiler::Get().SetGpuTimerAvailable(false);
+}
+
+void GpuTimerOpenGL::Section(const char* name)
+{
+    if (!m_supported)
+        return;
+
+    if (m_running)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_running = false;
+    }
+
+    Frame& frame = m_frames[m_current];
+    if (frame.count == MAX_SECTIONS)
+        return;
+
+    frame.names[frame.count] = name;
+    glBeginQuery(GL_TIME_ELAPSED, frame.queries[frame.count]);
+    ++frame.count;
+    m_running = true;
+}
+
+void GpuTimerOpenGL::EndFrame()
+{
+    if (!m_supported)
+        return;
+
+    if (m_running)
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        m_running = false;
+    }
+
+    // the next frame reuses the queries of the oldest one
+    m_current = (m_current + 1) % FRAMES_IN_FLIGHT;
+    Collect(m_frames[m_current]);
+}
+
+void GpuTimerOpenGL::Collect(Frame& frame)
+{
+    for (unsigned int i = 0; i < frame.count; ++i)
+    {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(frame.queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            ++m_dropped;
+            continue;
+        }
+
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &nanoseconds);
+        Profiler::Get().AddGpuTime(frame.names[i], (float)(nanoseconds / 1e6));
+    }
+    frame.count = 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "OpenGL.h"
+
+#include <cstdint>
+
+// GPU time of consecutive sections of the frames from GL_TIME_ELAPSED queries, reported to the
+// Profiler. The elapsed time queries cannot nest, so a section ends where the next one begins.
+// Every frame in flight has its own queries, a frame is read when its queries come round again
+// and a result which is not available by then is dropped rather than waited for.
+class GpuTimerOpenGL
+{
+public:
+    enum
+    {
+        FRAMES_IN_FLIGHT = 4,
+        MAX_SECTIONS = 16,      // per frame, the later ones are not timed
+    };
+
+    GpuTimerOpenGL();
+    ~GpuTimerOpenGL();
+
+    GpuTimerOpenGL(const GpuTimerOpenGL&) = delete;
+    GpuTimerOpenGL& operator=(const GpuTimerOpenGL&) = delete;
+
+    bool IsSupported() const { return m_supported; }
+
+    // ends the running section and starts the next, the name is kept by the pointer
+    void Section(const char* name);
+    // ends the running section and reads the oldest frame in flight
+    void EndFrame();
+
+    // results not available in time
+    uint32_t GetDropped() const { return m_dropped; }
+
+private:
+    struct Frame
+    {
+        GLuint queries[MAX_SECTIONS];
+        const char* names[MAX_SECTIONS];
+        unsigned int count;
+    };
+
+    void Collect(Frame& frame);
+
+    Frame m_frames[FRAMES_IN_FLIGHT];
+    unsigned int m_current;
+    bool m_running;
+    bool m_supported;
+    uint32_t m_dropped;
+};
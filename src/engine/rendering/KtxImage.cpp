@@ -0,0 +1,306 @@
+#include "KtxImage.h"
+#include "filesystem/FileSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    const uint8 KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const uint32 KTX_ENDIANNESS = 0x04030201;
+
+    // the GL enums of the header, without the GL headers
+    const uint32 KTX_UNSIGNED_BYTE = 0x1401;
+    const uint32 KTX_RGB = 0x1907;
+    const uint32 KTX_RGBA = 0x1908;
+    const uint32 KTX_RGB8 = 0x8051;
+    const uint32 KTX_RGBA8 = 0x8058;
+    const uint32 KTX_COMPRESSED_RGB8_ETC2 = 0x9274;
+    const uint32 KTX_COMPRESSED_RGBA8_ETC2_EAC = 0x9278;
+    const uint32 KTX_COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
+    const uint32 KTX_COMPRESSED_RGBA_S3TC_DXT5 = 0x83F3;
+
+    const char ORIENTATION_KEY[] = "KTXorientation";
+    const char ORIENTATION_VALUE[] = "S=r,T=d"; // the first row is the top one
+
+    struct Header
+    {
+        uint8 identifier[12];
+        uint32 endianness;
+        uint32 glType;
+        uint32 glTypeSize;
+        uint32 glFormat;
+        uint32 glInternalFormat;
+        uint32 glBaseInternalFormat;
+        uint32 pixelWidth;
+        uint32 pixelHeight;
+        uint32 pixelDepth;
+        uint32 numberOfArrayElements;
+        uint32 numberOfFaces;
+        uint32 numberOfMipmapLevels;
+        uint32 bytesOfKeyValueData;
+    };
+
+    static_assert(sizeof(Header) == 64, "KTX header must have no padding");
+
+    size_t Align4(size_t size)
+    {
+        return (size + 3) & ~(size_t)3;
+    }
+
+    template <class T>
+    void Append(std::vector<uint8>& out, const T& value)
+    {
+        const size_t offset = out.size();
+        out.resize(offset + sizeof(T));
+        memcpy(&out[offset], &value, sizeof(T));
+    }
+
+    // an RGB image as RGBA, the KTX rows of RGB would need padding to 4 bytes
+    class ExpandedImage : public IImage
+    {
+    public:
+        explicit ExpandedImage(const IImage& image)
+            : m_width(image.GetWidth())
+            , m_height(image.GetHeight())
+        {
+            for (uint32 level = 0; level < image.GetLevelsCount(); ++level)
+            {
+                const size_t pixels = GetImageLevelSize(image, level) / 3;
+                const uint8* src = image.GetLevelData(level);
+
+                std::vector<uint8> data(pixels * 4);
+                for (size_t i = 0; i < pixels; ++i)
+                {
+                    memcpy(&data[i * 4], &src[i * 3], 3);
+                    data[i * 4 + 3] = 255;
+                }
+                m_levels.push_back(std::move(data));
+            }
+        }
+
+        // Image methods
+        const uint8* GetData() const override { return m_levels[0].data(); }
+        uint8 GetBitsPerPixel() const override { return 32; }
+        uint32 GetWidth() const override { return m_width; }
+        uint32 GetHeight() const override { return m_height; }
+        uint32 GetLevelsCount() const override { return (uint32)m_levels.size(); }
+        const uint8* GetLevelData(uint32 level) const override { return m_levels[level].data(); }
+
+    private:
+        uint32 m_width;
+        uint32 m_height;
+        std::vector<std::vector<uint8>> m_levels;
+    };
+}
+
+KtxImage::KtxImage(std::shared_ptr<FileSystem::Memory> file)
+    : m_file(std::move(file))
+{
+    Parse(reinterpret_cast<const uint8*>(m_file->GetData()), m_file->GetSize());
+}
+
+KtxImage::KtxImage(std::shared_ptr<FileSystem::Memory> file, size_t offset, size_t size)
+    : m_file(std::move(file))
+{
+    if (offset > m_file->GetSize() || size > m_file->GetSize() - offset)
+        throw std::runtime_error("KTX container is truncated");
+
+    Parse(reinterpret_cast<const uint8*>(m_file->GetData()) + offset, size);
+}
+
+void KtxImage::Parse(const uint8 *data, size_t size)
+{
+    Header header;
+    if (size < sizeof(header))
+        throw std::runtime_error("KTX container is truncated");
+    memcpy(&header, data, sizeof(header));
+
+    if (memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) || header.endianness != KTX_ENDIANNESS)
+        throw std::runtime_error("not a KTX container or of another endianness");
+
+    if (header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1
+        || header.numberOfArrayElements > 1 || header.numberOfFaces != 1)
+    {
+        throw std::runtime_error("KTX container is not of a single 2D texture");
+    }
+
+    switch (header.glInternalFormat)
+    {
+    case KTX_RGB8:
+    case KTX_RGB:
+        m_format = IMAGE_FORMAT_RAW;
+        m_bpp = 24;
+        break;
+    case KTX_RGBA8:
+    case KTX_RGBA:
+        m_format = IMAGE_FORMAT_RAW;
+        m_bpp = 32;
+        break;
+    case KTX_COMPRESSED_RGB8_ETC2:
+        m_format = IMAGE_FORMAT_ETC2_RGB8;
+        m_bpp = 4;
+        break;
+    case KTX_COMPRESSED_RGBA8_ETC2_EAC:
+        m_format = IMAGE_FORMAT_ETC2_RGBA8;
+        m_bpp = 8;
+        break;
+    case KTX_COMPRESSED_RGB_S3TC_DXT1:
+        m_format = IMAGE_FORMAT_BC1;
+        m_bpp = 4;
+        break;
+    case KTX_COMPRESSED_RGBA_S3TC_DXT5:
+        m_format = IMAGE_FORMAT_BC3;
+        m_bpp = 8;
+        break;
+    default:
+        throw std::runtime_error("unsupported KTX internal format");
+    }
+
+    if (m_format == IMAGE_FORMAT_RAW && header.glType != KTX_UNSIGNED_BYTE)
+        throw std::runtime_error("unsupported KTX pixel type");
+
+    m_width = header.pixelWidth;
+    m_height = header.pixelHeight;
+
+    // a level after the one of 1x1 pixels would be shifted out of the dimensions
+    uint32 maxLevels = 1;
+    for (uint32 dimension = std::max(m_width, m_height); dimension > 1; dimension >>= 1)
+        ++maxLevels;
+    if (header.numberOfMipmapLevels > maxLevels)
+        throw std::runtime_error("KTX container has more levels than its dimensions");
+
+    size_t offset = sizeof(header);
+    if (header.bytesOfKeyValueData > size - offset)
+        throw std::runtime_error("KTX container is truncated");
+    ParseKeyValueData(data + offset, header.bytesOfKeyValueData);
+    offset += header.bytesOfKeyValueData;
+
+    const uint32 levels = std::max<uint32>(header.numberOfMipmapLevels, 1);
+    for (uint32 level = 0; level < levels; ++level)
+    {
+        uint32 imageSize;
+        if (size - offset < sizeof(imageSize))
+            throw std::runtime_error("KTX container is truncated");
+        memcpy(&imageSize, data + offset, sizeof(imageSize));
+        offset += sizeof(imageSize);
+
+        // the rows of KTX are padded to 4 bytes, only the RGB ones of some widths actually are
+        const size_t levelSize = GetImageLevelSize(*this, level);
+        const size_t rowSize = m_format == IMAGE_FORMAT_RAW ? GetLevelDimension(m_width, level) * (m_bpp / 8) : 0;
+        const size_t rows = GetLevelDimension(m_height, level);
+        const bool padded = rowSize != 0 && imageSize != levelSize && imageSize == Align4(rowSize) * rows;
+        if (imageSize != levelSize && !padded)
+            throw std::runtime_error("KTX level size does not match its format");
+        if (imageSize > size - offset)
+            throw std::runtime_error("KTX container is truncated");
+
+        if (padded)
+        {
+            // the images have tight rows, the level is copied without the padding
+            std::vector<uint8> tight(levelSize);
+            for (size_t row = 0; row < rows; ++row)
+                memcpy(&tight[row * rowSize], data + offset + row * Align4(rowSize), rowSize);
+            m_unpadded.push_back(std::move(tight));
+            m_levels.push_back(m_unpadded.back().data());
+        }
+        else
+        {
+            m_levels.push_back(data + offset);
+        }
+        offset = std::min(size, offset + Align4(imageSize));
+    }
+}
+
+void KtxImage::ParseKeyValueData(const uint8 *data, size_t size)
+{
+    size_t offset = 0;
+    while (size - offset >= sizeof(uint32))
+    {
+        uint32 keyValueSize;
+        memcpy(&keyValueSize, data + offset, sizeof(keyValueSize));
+        offset += sizeof(keyValueSize);
+        if (keyValueSize > size - offset)
+            throw std::runtime_error("KTX key and value data is truncated");
+
+        // the key ends with a zero, the value may end with one too
+        const char* pair = reinterpret_cast<const char*>(data + offset);
+        const char* end = pair + keyValueSize;
+        const char* keyEnd = std::find(pair, end, '\0');
+        if (keyEnd != end && std::string(pair, keyEnd) == ORIENTATION_KEY)
+        {
+            const char* valueEnd = std::find(keyEnd + 1, end, '\0');
+            // the levels are used as they are stored, the rows of the other orientations are not flipped
+            if (std::string(keyEnd + 1, valueEnd) != ORIENTATION_VALUE)
+                throw std::runtime_error("KTX container is not of rows from the top down");
+        }
+
+        offset = std::min(size, offset + Align4(keyValueSize));
+    }
+}
+
+std::vector<uint8> WriteKtx(const IImage &image)
+{
+    if (!IsCompressedFormat(image.GetFormat()) && image.GetBitsPerPixel() == 24)
+        return WriteKtx(ExpandedImage(image));
+
+    Header header = {};
+    memcpy(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;
+    switch (image.GetFormat())
+    {
+    case IMAGE_FORMAT_RAW:
+        if (image.GetBitsPerPixel() != 32)
+            throw std::runtime_error("unsupported bits per pixel");
+        header.glType = KTX_UNSIGNED_BYTE;
+        header.glFormat = KTX_RGBA;
+        header.glInternalFormat = KTX_RGBA8;
+        header.glBaseInternalFormat = KTX_RGBA;
+        break;
+    case IMAGE_FORMAT_ETC2_RGB8:
+        header.glInternalFormat = KTX_COMPRESSED_RGB8_ETC2;
+        header.glBaseInternalFormat = KTX_RGB;
+        break;
+    case IMAGE_FORMAT_ETC2_RGBA8:
+        header.glInternalFormat = KTX_COMPRESSED_RGBA8_ETC2_EAC;
+        header.glBaseInternalFormat = KTX_RGBA;
+        break;
+    case IMAGE_FORMAT_BC1:
+        header.glInternalFormat = KTX_COMPRESSED_RGB_S3TC_DXT1;
+        header.glBaseInternalFormat = KTX_RGB;
+        break;
+    case IMAGE_FORMAT_BC3:
+        header.glInternalFormat = KTX_COMPRESSED_RGBA_S3TC_DXT5;
+        header.glBaseInternalFormat = KTX_RGBA;
+        break;
+    }
+    header.pixelWidth = image.GetWidth();
+    header.pixelHeight = image.GetHeight();
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = image.GetLevelsCount();
+
+    const uint32 keyValueSize = (uint32)(sizeof(ORIENTATION_KEY) + sizeof(ORIENTATION_VALUE));
+    header.bytesOfKeyValueData = (uint32)Align4(sizeof(uint32) + keyValueSize);
+
+    std::vector<uint8> out;
+    Append(out, header);
+
+    // the key and the value with their terminating zeros
+    Append(out, keyValueSize);
+    out.insert(out.end(), ORIENTATION_KEY, ORIENTATION_KEY + sizeof(ORIENTATION_KEY));
+    out.insert(out.end(), ORIENTATION_VALUE, ORIENTATION_VALUE + sizeof(ORIENTATION_VALUE));
+    out.resize(Align4(out.size()));
+
+    for (uint32 level = 0; level < image.GetLevelsCount(); ++level)
+    {
+        const size_t levelSize = GetImageLevelSize(image, level);
+        Append(out, (uint32)levelSize);
+        out.insert(out.end(), image.GetLevelData(level), image.GetLevelData(level) + levelSize);
+        out.resize(Align4(out.size()));
+    }
+
+    return out;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "base/IImage.h"
+
+#include <list>
+#include <memory>
+#include <vector>
+
+namespace FileSystem
+{
+    class Memory;
+}
+
+// A KTX 1.1 container of one 2D texture with its mipmaps, RGB8, RGBA8, ETC2 or BC1/BC3. The
+// levels reference the container data in 'file' directly and keep it alive, but for the RGB
+// levels with rows padded to 4 bytes, which are copied without the padding. The rows go from
+// the top down, the way the other images store them; a container whose KTXorientation says
+// otherwise is not read. Throws std::runtime_error on a container of another kind.
+class KtxImage : public IImage
+{
+public:
+    explicit KtxImage(std::shared_ptr<FileSystem::Memory> file);
+    // a container at 'offset' in a bigger file
+    KtxImage(std::shared_ptr<FileSystem::Memory> file, size_t offset, size_t size);
+
+    // Image methods
+    const uint8* GetData() const override { return m_levels[0]; }
+    uint8 GetBitsPerPixel() const override { return m_bpp; }
+    uint32 GetWidth() const override { return m_width; }
+    uint32 GetHeight() const override { return m_height; }
+    ImageFormat GetFormat() const override { return m_format; }
+    uint32 GetLevelsCount() const override { return (uint32)m_levels.size(); }
+    const uint8* GetLevelData(uint32 level) const override { return m_levels[level]; }
+
+private:
+    void Parse(const uint8 *data, size_t size);
+    void ParseKeyValueData(const uint8 *data, size_t size);
+
+    std::shared_ptr<FileSystem::Memory> m_file;
+    uint32 m_width;
+    uint32 m_height;
+    uint8 m_bpp;
+    ImageFormat m_format;
+    std::vector<const uint8*> m_levels;
+    std::list<std::vector<uint8>> m_unpadded; // the levels copied from padded RGB rows
+};
+
+// the image with all its levels in a KTX container KtxImage reads back
+std::vector<uint8> WriteKtx(const IImage &image);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Color.h"
+#include "Vertex.h"
+
+#include <cassert>
+
+enum { LIGHT_RING_SIZE = 32 };
+
+// sin(2 * pi * i / LIGHT_RING_SIZE), the cos is at (i + LIGHT_RING_SIZE / 4) % LIGHT_RING_SIZE
+static const float LightSinTable[LIGHT_RING_SIZE] = {
+     0.000000f, 0.195090f, 0.382683f, 0.555570f,
+     0.707106f, 0.831469f, 0.923879f, 0.980785f,
+     1.000000f, 0.980785f, 0.923879f, 0.831469f,
+     0.707106f, 0.555570f, 0.382683f, 0.195090f,
+    -0.000000f,-0.195090f,-0.382683f,-0.555570f,
+    -0.707106f,-0.831469f,-0.923879f,-0.980785f,
+    -1.000000f,-0.980785f,-0.923879f,-0.831469f,
+    -0.707106f,-0.555570f,-0.382683f,-0.195090f,
+};
+
+// A point or spot light of a batch: a fan from the center to a ring of 'edges' vertices, an
+// ellipse stretched by 'aspect' across the direction and moved by 'offset' along it.
+struct LightInstance
+{                       // offset  size
+    float x, y;         //   0       8   center
+    float dirX, dirY;   //   8       8   (1, 0) for the point lights
+    float radius;       //  16       4
+    float aspect;       //  20       4
+    float offset;       //  24       4
+    uint32 edges;       //  28       4   divides LIGHT_RING_SIZE
+    Color color;        //  32       4   of the center, the ring is transparent black
+};
+
+// the edges + 1 vertices of the fan DrawingContext used to draw
+inline void ExpandLight(Vertex *v, const LightInstance &light)
+{
+    assert(light.edges && LIGHT_RING_SIZE % light.edges == 0);
+
+    v[0].color = light.color;
+    v[0].x = light.x;
+    v[0].y = light.y;
+
+    const unsigned int step = LIGHT_RING_SIZE / light.edges;
+    for (unsigned int i = 0; i < light.edges; ++i)
+    {
+        const unsigned int j = i * step;
+        float x = light.offset + light.radius * LightSinTable[(j + LIGHT_RING_SIZE / 4) % LIGHT_RING_SIZE];
+        float y = light.radius * LightSinTable[j] * light.aspect;
+        v[i + 1].x = light.x + x * light.dirX - y * light.dirY;
+        v[i + 1].y = light.y + y * light.dirX + x * light.dirY;
+        v[i + 1].color.color = 0x00000000;
+    }
+}
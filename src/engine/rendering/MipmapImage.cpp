@@ -0,0 +1,121 @@
+#include "MipmapImage.h"
+
+extern "C"
+{
+    #include "image_DXT.h"
+}
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+MipmapImage::MipmapImage(ImageFormat format, uint32 width, uint32 height, uint8 bitsPerPixel, std::vector<std::vector<uint8>> levels)
+    : m_format(format)
+    , m_width(width)
+    , m_height(height)
+    , m_bpp(bitsPerPixel)
+    , m_levels(std::move(levels))
+{
+    if (m_levels.empty())
+        throw std::invalid_argument("an image needs at least one level");
+}
+
+static std::vector<uint8> Downsample(const uint8 *src, uint32 width, uint32 height, uint32 channels)
+{
+    const uint32 dstWidth = GetLevelDimension(width, 1);
+    const uint32 dstHeight = GetLevelDimension(height, 1);
+
+    std::vector<uint8> dst((size_t)dstWidth * dstHeight * channels);
+    for (uint32 y = 0; y < dstHeight; ++y)
+    {
+        // an odd last row or column is sampled twice
+        const uint32 y0 = std::min(y * 2, height - 1);
+        const uint32 y1 = std::min(y * 2 + 1, height - 1);
+        for (uint32 x = 0; x < dstWidth; ++x)
+        {
+            const uint32 x0 = std::min(x * 2, width - 1);
+            const uint32 x1 = std::min(x * 2 + 1, width - 1);
+            const uint8 *texels[4] = {
+                src + ((size_t)y0 * width + x0) * channels,
+                src + ((size_t)y0 * width + x1) * channels,
+                src + ((size_t)y1 * width + x0) * channels,
+                src + ((size_t)y1 * width + x1) * channels,
+            };
+
+            uint8 *out = &dst[((size_t)y * dstWidth + x) * channels];
+            uint32 alphaSum = 0;
+            for (const uint8 *texel : texels)
+                alphaSum += channels == 4 ? texel[3] : 255;
+
+            for (uint32 c = 0; c < 3; ++c)
+            {
+                uint32 sum = 0;
+                if (alphaSum)
+                {
+                    for (const uint8 *texel : texels)
+                        sum += texel[c] * (channels == 4 ? texel[3] : 255);
+                    out[c] = (uint8)((sum + alphaSum / 2) / alphaSum);
+                }
+                else
+                {
+                    for (const uint8 *texel : texels)
+                        sum += texel[c];
+                    out[c] = (uint8)((sum + 2) / 4);
+                }
+            }
+            if (channels == 4)
+                out[3] = (uint8)((alphaSum + 2) / 4);
+        }
+    }
+    return dst;
+}
+
+std::shared_ptr<IImage> GenerateMipmaps(const IImage &image)
+{
+    if (IsCompressedFormat(image.GetFormat()) || (image.GetBitsPerPixel() != 24 && image.GetBitsPerPixel() != 32))
+        throw std::invalid_argument("mipmaps are generated for 24 and 32 bpp images only");
+
+    const uint32 channels = image.GetBitsPerPixel() / 8;
+    std::vector<std::vector<uint8>> levels;
+    levels.emplace_back(image.GetData(), image.GetData() + GetImageLevelSize(image, 0));
+
+    uint32 width = image.GetWidth();
+    uint32 height = image.GetHeight();
+    while (width > 1 || height > 1)
+    {
+        levels.push_back(Downsample(levels.back().data(), width, height, channels));
+        width = GetLevelDimension(width, 1);
+        height = GetLevelDimension(height, 1);
+    }
+
+    return std::make_shared<MipmapImage>(IMAGE_FORMAT_RAW, image.GetWidth(), image.GetHeight(), image.GetBitsPerPixel(), std::move(levels));
+}
+
+std::shared_ptr<IImage> CompressBC(const IImage &image)
+{
+    if (IsCompressedFormat(image.GetFormat()) || (image.GetBitsPerPixel() != 24 && image.GetBitsPerPixel() != 32))
+        throw std::invalid_argument("only 24 and 32 bpp images are compressed");
+
+    const int channels = image.GetBitsPerPixel() / 8;
+    const bool alpha = channels == 4;
+
+    std::vector<std::vector<uint8>> levels;
+    for (uint32 level = 0; level < image.GetLevelsCount(); ++level)
+    {
+        const int width = (int)GetLevelDimension(image.GetWidth(), level);
+        const int height = (int)GetLevelDimension(image.GetHeight(), level);
+
+        int size = 0;
+        unsigned char *blocks = alpha
+            ? convert_image_to_DXT5(image.GetLevelData(level), width, height, channels, &size)
+            : convert_image_to_DXT1(image.GetLevelData(level), width, height, channels, &size);
+        if (!blocks)
+            throw std::runtime_error("BC compression failed");
+
+        levels.emplace_back(blocks, blocks + size);
+        free(blocks);
+    }
+
+    return std::make_shared<MipmapImage>(alpha ? IMAGE_FORMAT_BC3 : IMAGE_FORMAT_BC1, image.GetWidth(), image.GetHeight(),
+                                         alpha ? 8 : 4, std::move(levels));
+}
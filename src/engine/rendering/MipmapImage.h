@@ -0,0 +1,38 @@
+#pragma once
+
+#include "base/IImage.h"
+
+#include <memory>
+#include <vector>
+
+// An image holding its levels in memory, what the texture cooker makes of the package images
+class MipmapImage : public IImage
+{
+public:
+    MipmapImage(ImageFormat format, uint32 width, uint32 height, uint8 bitsPerPixel, std::vector<std::vector<uint8>> levels);
+
+    // Image methods
+    const uint8* GetData() const override { return m_levels[0].data(); }
+    uint8 GetBitsPerPixel() const override { return m_bpp; }
+    uint32 GetWidth() const override { return m_width; }
+    uint32 GetHeight() const override { return m_height; }
+    ImageFormat GetFormat() const override { return m_format; }
+    uint32 GetLevelsCount() const override { return (uint32)m_levels.size(); }
+    const uint8* GetLevelData(uint32 level) const override { return m_levels[level].data(); }
+
+private:
+    ImageFormat m_format;
+    uint32 m_width;
+    uint32 m_height;
+    uint8 m_bpp;
+    std::vector<std::vector<uint8>> m_levels;
+};
+
+// The first level of a raw image and the mipmaps down to 1x1, each pixel the average of the 2x2
+// pixels above it; the colors are weighted by the alpha, so the transparent pixels around the
+// sprites do not darken their edges.
+std::shared_ptr<IImage> GenerateMipmaps(const IImage &image);
+
+// Compresses all the levels of a raw image to BC1, or to BC3 when it has alpha. There is no
+// ETC2 encoder here, such images are to come as KTX files from one.
+std::shared_ptr<IImage> CompressBC(const IImage &image);
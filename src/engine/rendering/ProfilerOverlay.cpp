@@ -0,0 +1,70 @@
+#include "ProfilerOverlay.h"
+#include "DrawingContext.h"
+#include "Color.h"
+#include "profiling/Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+static const Color BACKGROUND_COLOR(0, 0, 0, 160);
+static const Color TEXT_COLOR(255, 255, 255, 255);
+static const Color CPU_COLOR(64, 200, 64, 255);
+static const Color GPU_COLOR(255, 160, 32, 255);
+static const Color OVER_COLOR(230, 40, 40, 255);
+
+static void DrawBar(DrawingContext &dc, const ProfilerOverlayStyle &style, RectFloat bounds, float ms, Color color)
+{
+    const float fraction = ms / style.msScale;
+    if (fraction > 1.0f)
+        color = OVER_COLOR;
+
+    bounds.right = bounds.left + (bounds.right - bounds.left) * std::min(fraction, 1.0f);
+    dc.DrawSprite(bounds, style.solid, color, 0);
+}
+
+void DrawProfilerOverlay(DrawingContext &dc, const Profiler &profiler, Vec2F origin, const ProfilerOverlayStyle &style)
+{
+    const std::vector<Profiler::Entry> &entries = profiler.GetEntries();
+    const float rows = (float)entries.size() + 1;
+    const float numbersX = origin.x + style.width * 0.45f;
+    const float barX = origin.x + style.width * 0.75f;
+
+    dc.DrawSprite(RectFloat{ origin.x, origin.y, origin.x + style.width, origin.y + rows * style.rowHeight + style.graphHeight },
+                  style.solid, BACKGROUND_COLOR, 0);
+
+    dc.DrawBitmapText(Vec2F(numbersX, origin.y), style.textScale, style.font, TEXT_COLOR, "  avg   max");
+
+    char text[64];
+    float y = origin.y + style.rowHeight;
+    for (const Profiler::Entry &entry : entries)
+    {
+        if (entry.index >= 0)
+            snprintf(text, sizeof(text), "%*s%s %d", entry.depth * 2, "", entry.name, entry.index);
+        else
+            snprintf(text, sizeof(text), "%*s%s", entry.depth * 2, "", entry.name);
+        dc.DrawBitmapText(Vec2F(origin.x, y), style.textScale, style.font, TEXT_COLOR, text);
+
+        const float average = entry.GetAverage();
+        snprintf(text, sizeof(text), "%5.1f %5.1f", average, entry.GetMax());
+        dc.DrawBitmapText(Vec2F(numbersX, y), style.textScale, style.font, TEXT_COLOR, text);
+
+        DrawBar(dc, style, RectFloat{ barX, y + 2, origin.x + style.width, y + style.rowHeight - 2 },
+                average, entry.kind == Profiler::GPU ? GPU_COLOR : CPU_COLOR);
+
+        y += style.rowHeight;
+    }
+
+    // the frame times, the latest on the right
+    const Profiler::Entry &frame = entries.front();
+    const uint32_t samples = frame.GetSamples();
+    const float barWidth = style.width / Profiler::HISTORY_SIZE;
+    const float bottom = y + style.graphHeight;
+    for (uint32_t i = 0; i < samples; ++i)
+    {
+        const float ms = frame.GetSample(i);
+        const float right = origin.x + style.width - i * barWidth;
+        const float top = bottom - style.graphHeight * std::min(ms / style.msScale, 1.0f);
+        dc.DrawSprite(RectFloat{ right - barWidth, top, right, bottom }, style.solid, ms > style.msScale ? OVER_COLOR : CPU_COLOR, 0);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "math/Rect.h"
+
+#include <cstddef>
+
+class DrawingContext;
+class Profiler;
+
+struct ProfilerOverlayStyle
+{
+    size_t font;                // texture of DrawBitmapText
+    size_t solid;               // a sprite whose first frame is solid, for the bars
+    float textScale = 1.0f;
+    float rowHeight = 14.0f;
+    float width = 480.0f;
+    float graphHeight = 64.0f;
+    float msScale = 33.3f;      // milliseconds of a full bar, longer ones are red
+};
+
+// Draws the entries of the profiler at 'origin' in the interface mode: a row per entry with the
+// average and the maximum of the last frames and a bar of the average, green for the CPU and
+// orange for the GPU, then a graph of the frame times. The times are shown with 0.1 ms so that
+// the rows change rarely and their glyph runs stay cached.
+void DrawProfilerOverlay(DrawingContext &dc, const Profiler &profiler, Vec2F origin, const ProfilerOverlayStyle &style);
@@ -0,0 +1,211 @@
+#include "ProgramCacheOpenGL.h"
+#include "StateCacheOpenGL.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+static const uint32_t BINARY_MAGIC = 0x42504c47; // "GLPB"
+
+static uint64_t sHash(const char* data, std::size_t size, uint64_t hash = 14695981039346656037ULL)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void sPrintLog(GLuint object)
+{
+    GLint log_length = 0;
+    if (glIsShader(object))
+        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &log_length);
+    else if (glIsProgram(object))
+        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &log_length);
+    else
+    {
+        fprintf(stderr, "printlog: Not a shader or a program\n");
+        return;
+    }
+
+    char* log = (char*)malloc(log_length);
+
+    if (glIsShader(object))
+        glGetShaderInfoLog(object, log_length, NULL, log);
+    else if (glIsProgram(object))
+        glGetProgramInfoLog(object, log_length, NULL, log);
+
+    fprintf(stderr, "%s", log);
+    free(log);
+}
+
+static GLuint sCreateShaderFromString(const char* source, GLenum type)
+{
+    GLuint res = glCreateShader(type);
+    const char* sources[] = { source };
+    glShaderSource(res, 1, sources, NULL);
+    glCompileShader(res);
+    GLint compile_ok = GL_FALSE;
+    glGetShaderiv(res, GL_COMPILE_STATUS, &compile_ok);
+    if (compile_ok == GL_FALSE)
+    {
+        fprintf(stderr, "Error compiling shader of type %d!\n", type);
+        sPrintLog(res);
+        glDeleteShader(res);
+        return 0;
+    }
+
+    return res;
+}
+
+static GLuint sCreateShaderProgram(const char* vs, const char* fs, bool retrievable)
+{
+    GLuint vsId = sCreateShaderFromString(vs, GL_VERTEX_SHADER);
+    GLuint fsId = sCreateShaderFromString(fs, GL_FRAGMENT_SHADER);
+    assert(vsId != 0 && fsId != 0);
+
+    GLuint programId = glCreateProgram();
+    glAttachShader(programId, vsId);
+    glAttachShader(programId, fsId);
+    glBindFragDataLocation(programId, 0, "color");
+    if (retrievable)
+        glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(programId);
+
+    glDeleteShader(vsId);
+    glDeleteShader(fsId);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    assert(status != GL_FALSE);
+
+    return programId;
+}
+
+ProgramCacheOpenGL::ProgramCacheOpenGL(std::string directory)
+    : m_directory(std::move(directory))
+    , m_binariesSupported(false)
+{
+    if (!m_directory.empty())
+    {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        m_binariesSupported = GLEW_ARB_get_program_binary && formats > 0;
+    }
+
+    // a driver update makes the binaries of the old one useless
+    for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+    {
+        const GLubyte* value = glGetString(name);
+        m_driver += value ? (const char*)value : "";
+        m_driver += '\n';
+    }
+}
+
+ProgramCacheOpenGL::~ProgramCacheOpenGL()
+{
+    for (auto& program : m_programs)
+        glDeleteProgram(program.second);
+}
+
+GLuint ProgramCacheOpenGL::GetProgram(const char* vs, const char* fs)
+{
+    uint64_t key = sHash(m_driver.data(), m_driver.size());
+    key = sHash(vs, strlen(vs) + 1, key);
+    key = sHash(fs, strlen(fs) + 1, key);
+
+    auto it = m_programs.find(key);
+    if (it != m_programs.end())
+    {
+        ++m_stats.shared;
+        return it->second;
+    }
+
+    GLuint program = m_binariesSupported ? LoadBinary(key) : 0;
+    if (program)
+    {
+        ++m_stats.loaded;
+    }
+    else
+    {
+        program = sCreateShaderProgram(vs, fs, m_binariesSupported);
+        ++m_stats.compiled;
+        if (m_binariesSupported)
+            SaveBinary(key, program);
+    }
+
+    const GLuint matrices = glGetUniformBlockIndex(program, "Matrices");
+    if (matrices != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, matrices, StateCacheOpenGL::MATRICES_BINDING);
+
+    m_programs.emplace(key, program);
+    return program;
+}
+
+std::string ProgramCacheOpenGL::GetBinaryPath(uint64_t key) const
+{
+    char name[24];
+    snprintf(name, sizeof(name), "%016llx.glbin", (unsigned long long)key);
+    return m_directory + "/" + name;
+}
+
+// the file is the magic, the key, the binary format and the binary
+GLuint ProgramCacheOpenGL::LoadBinary(uint64_t key) const
+{
+    std::ifstream in(GetBinaryPath(key), std::ios::in | std::ios::binary);
+    if (!in)
+        return 0;
+
+    uint32_t magic = 0;
+    uint64_t fileKey = 0;
+    uint32_t format = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+    in.read(reinterpret_cast<char*>(&format), sizeof(format));
+    if (!in || magic != BINARY_MAGIC || fileKey != key)
+        return 0;
+
+    std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (binary.empty())
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, (GLenum)format, binary.data(), (GLsizei)binary.size());
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+void ProgramCacheOpenGL::SaveBinary(uint64_t key, GLuint program) const
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    // a directory which cannot be written only costs the compilation next time
+    std::ofstream out(GetBinaryPath(key), std::ios::out | std::ios::binary | std::ios::trunc);
+    const uint32_t fileFormat = format;
+    out.write(reinterpret_cast<const char*>(&BINARY_MAGIC), sizeof(BINARY_MAGIC));
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    out.write(reinterpret_cast<const char*>(&fileFormat), sizeof(fileFormat));
+    out.write(binary.data(), length);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "OpenGL.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Linked shader programs by their sources, owned by the cache. With a directory the binaries
+// of the programs are saved there and the next runs load them with glProgramBinary instead of
+// compiling. A binary of another driver or one the driver rejects is compiled again and replaced.
+// Programs with a Matrices uniform block get it bound to StateCacheOpenGL::MATRICES_BINDING.
+class ProgramCacheOpenGL
+{
+public:
+    struct Stats
+    {
+        uint32_t compiled = 0;
+        uint32_t loaded = 0;        // from a binary
+        uint32_t shared = 0;        // requested again with the same sources
+    };
+
+    // an empty directory keeps the programs in memory only
+    explicit ProgramCacheOpenGL(std::string directory = std::string());
+    ~ProgramCacheOpenGL();
+
+    ProgramCacheOpenGL(const ProgramCacheOpenGL&) = delete;
+    ProgramCacheOpenGL& operator=(const ProgramCacheOpenGL&) = delete;
+
+    GLuint GetProgram(const char* vs, const char* fs);
+
+    const Stats& GetStats() const { return m_stats; }
+
+private:
+    std::string GetBinaryPath(uint64_t key) const;
+    GLuint LoadBinary(uint64_t key) const;
+    void SaveBinary(uint64_t key, GLuint program) const;
+
+    std::string m_directory;
+    bool m_binariesSupported;
+    std::string m_driver;           // vendor, renderer and version, a part of the keys
+
+    std::unordered_map<uint64_t, GLuint> m_programs;
+    Stats m_stats;
+};
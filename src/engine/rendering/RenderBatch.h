@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// why a batch was drawn
+enum FlushReason
+{
+    FLUSH_FULL,         // it reached the limit of its capacity
+    FLUSH_TEXTURE,
+    FLUSH_MODE,
+    FLUSH_SCISSOR,      // the scissor, the viewport or the camera
+    FLUSH_ORDER,        // another program or layer has to draw in between
+    FLUSH_FRAME_END,
+    FLUSH_OTHER,        // explicit flushes, immediate draws, static batches
+    FLUSH_REASON_COUNT
+};
+
+inline const char* GetFlushReasonName(FlushReason reason)
+{
+    static const char* const names[FLUSH_REASON_COUNT] = {
+        "full", "texture", "mode", "scissor", "order", "frame end", "other"
+    };
+    return names[reason];
+}
+
+struct BatchStats
+{
+    uint32_t flushes[FLUSH_REASON_COUNT] = {};  // batches drawn, by the reason
+    uint32_t grows = 0;                         // times the storage of a batch grew
+    uint32_t largest = 0;                       // elements of the largest batch drawn
+
+    uint32_t GetFlushes() const
+    {
+        uint32_t total = 0;
+        for (uint32_t count : flushes)
+            total += count;
+        return total;
+    }
+
+    void Add(const BatchStats& other)
+    {
+        for (int reason = 0; reason < FLUSH_REASON_COUNT; ++reason)
+            flushes[reason] += other.flushes[reason];
+        grows += other.grows;
+        largest = std::max(largest, other.largest);
+    }
+};
+
+// Capacity of a batch in elements, vertices or instances. It starts at the initial capacity and
+// doubles when a batch needs more, up to the limit; only a batch at the limit is flushed as full.
+// The limit never goes below the initial capacity, which the callers may rely on for the
+// largest single primitive, nor above the most elements the storage a batch is drawn from holds.
+class RenderBatch
+{
+public:
+    enum { DEFAULT_LIMIT = 64 * 1024 };
+
+    explicit RenderBatch(std::size_t initialCapacity, std::size_t limit = DEFAULT_LIMIT, std::size_t maxLimit = SIZE_MAX)
+        : m_initialCapacity(initialCapacity)
+        , m_capacity(initialCapacity)
+        , m_maxLimit(std::max(maxLimit, initialCapacity))
+        , m_limit(ClampLimit(limit))
+    {
+    }
+
+    // takes effect on the next batch which does not fit, the storage is not shrunk
+    void SetBatchLimit(std::size_t limit)
+    {
+        m_limit = ClampLimit(limit);
+        m_capacity = std::min(m_capacity, m_limit);
+    }
+
+    std::size_t GetBatchCapacity() const { return m_capacity; }
+    std::size_t GetBatchLimit() const { return m_limit; }
+    std::size_t GetBatchMaxLimit() const { return m_maxLimit; }
+
+    // the batches drawn since the last reset
+    const BatchStats& GetBatchStats() const { return m_batchStats; }
+    void ResetBatchStats() { m_batchStats = BatchStats(); }
+
+    // raises the capacity to hold 'count' elements, false when they are over the limit
+    bool GrowBatch(std::size_t count)
+    {
+        if (count <= m_capacity)
+            return true;
+        if (count > m_limit)
+            return false;
+
+        std::size_t capacity = std::max<std::size_t>(m_capacity, 1);
+        while (capacity < count)
+            capacity *= 2;
+        m_capacity = std::min(capacity, m_limit);
+        ++m_batchStats.grows;
+        return true;
+    }
+
+    void CountFlush(FlushReason reason, std::size_t elements)
+    {
+        ++m_batchStats.flushes[reason];
+        m_batchStats.largest = std::max(m_batchStats.largest, (uint32_t)elements);
+    }
+
+private:
+    std::size_t ClampLimit(std::size_t limit) const
+    {
+        return std::min(std::max(limit, m_initialCapacity), m_maxLimit);
+    }
+
+    std::size_t m_initialCapacity;
+    std::size_t m_capacity;
+    std::size_t m_maxLimit;
+    std::size_t m_limit;
+    BatchStats m_batchStats;
+};
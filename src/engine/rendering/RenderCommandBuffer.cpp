@@ -0,0 +1,250 @@
+#include "RenderCommandBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+
+RenderCommandBuffer::Command& RenderCommandBuffer::Add(CommandType type)
+{
+    m_commands.emplace_back();
+    Command &command = m_commands.back();
+    command = Command{};
+    command.type = type;
+    return command;
+}
+
+RenderCommandBuffer::Command& RenderCommandBuffer::AddRect(CommandType type, const RectInt *rect)
+{
+    Command &command = Add(type);
+    command.hasRect = rect != nullptr;
+    if (rect)
+        command.rect = *rect;
+    return command;
+}
+
+void RenderCommandBuffer::SetScissor(const RectInt *rect)
+{
+    AddRect(CMD_SCISSOR, rect);
+}
+
+void RenderCommandBuffer::SetViewport(const RectInt *rect)
+{
+    AddRect(CMD_VIEWPORT, rect);
+}
+
+void RenderCommandBuffer::Camera(const RectInt *vp, float x, float y, float scale)
+{
+    Command &command = AddRect(CMD_CAMERA, vp);
+    command.x = x;
+    command.y = y;
+    command.scale = scale;
+}
+
+void RenderCommandBuffer::SetAmbient(float ambient)
+{
+    Add(CMD_AMBIENT).x = ambient;
+}
+
+void RenderCommandBuffer::SetMode(const RenderMode mode)
+{
+    Add(CMD_MODE).value = mode;
+}
+
+void RenderCommandBuffer::Begin()
+{
+    assert(!"the frame is begun and ended on the render the buffer is replayed to");
+}
+
+void RenderCommandBuffer::End()
+{
+    assert(!"the frame is begun and ended on the render the buffer is replayed to");
+}
+
+void RenderCommandBuffer::SetSortLayer(int layer, bool orderIndependent)
+{
+    Command& command = Add(CMD_SORT_LAYER);
+    command.value = layer;
+    command.orderIndependent = orderIndependent;
+}
+
+bool RenderCommandBuffer::TexCreate(GlTexture &tex, const IImage &img, bool magFilter)
+{
+    assert(!"textures cannot be created while recording");
+    return false;
+}
+
+void RenderCommandBuffer::TexFree(GlTexture tex)
+{
+    assert(!"textures cannot be freed while recording");
+}
+
+Vertex* RenderCommandBuffer::DrawQuad(GlTexture tex)
+{
+    return DrawQuads(tex, 1);
+}
+
+Vertex* RenderCommandBuffer::DrawQuads(GlTexture tex, unsigned int count)
+{
+    assert(count > 0 && count <= MAX_QUADS);
+    Command &command = Add(CMD_QUAD);
+    command.texture = tex;
+    command.first = (uint32_t)m_vertices.size();
+    command.count = count * 4;
+    m_vertices.resize(m_vertices.size() + command.count);
+    return &m_vertices[command.first];
+}
+
+Vertex* RenderCommandBuffer::DrawFan(unsigned int nEdges)
+{
+    Command &command = Add(CMD_FAN);
+    command.value = (int)nEdges;
+    command.first = (uint32_t)m_vertices.size();
+    command.count = nEdges + 1;
+    m_vertices.resize(m_vertices.size() + command.count);
+    return &m_vertices[command.first];
+}
+
+void RenderCommandBuffer::BeginStaticBatch(unsigned int batch)
+{
+    Add(CMD_BEGIN_STATIC_BATCH).value = (int)batch;
+}
+
+void RenderCommandBuffer::EndStaticBatch()
+{
+    Add(CMD_END_STATIC_BATCH);
+}
+
+void RenderCommandBuffer::DrawStaticBatch(unsigned int batch)
+{
+    Add(CMD_DRAW_STATIC_BATCH).value = (int)batch;
+}
+
+void RenderCommandBuffer::SetSpriteFrames(const SpriteFrame *frames, size_t count)
+{
+    Command &command = Add(CMD_SPRITE_FRAMES);
+    command.first = (uint32_t)m_spriteFrames.size();
+    command.count = (uint32_t)count;
+    m_spriteFrames.insert(m_spriteFrames.end(), frames, frames + count);
+}
+
+void RenderCommandBuffer::DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count)
+{
+    if (!count)
+        return;
+
+    Command &command = Add(CMD_SPRITES);
+    command.texture = tex;
+    command.first = (uint32_t)m_sprites.size();
+    command.count = (uint32_t)count;
+    m_sprites.insert(m_sprites.end(), sprites, sprites + count);
+}
+
+void RenderCommandBuffer::DrawLights(const LightInstance *lights, size_t count)
+{
+    if (!count)
+        return;
+
+    Command &command = Add(CMD_LIGHTS);
+    command.first = (uint32_t)m_lights.size();
+    command.count = (uint32_t)count;
+    m_lights.insert(m_lights.end(), lights, lights + count);
+}
+
+void RenderCommandBuffer::DrawTriangles(const ColoredVertex* vertices, std::size_t count)
+{
+    Command &command = Add(CMD_TRIANGLES);
+    command.first = (uint32_t)m_coloredVertices.size();
+    command.count = (uint32_t)count;
+    m_coloredVertices.insert(m_coloredVertices.end(), vertices, vertices + count);
+}
+
+void RenderCommandBuffer::DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize)
+{
+    Command &command = Add(CMD_POINTS);
+    command.first = (uint32_t)m_coloredVertices.size();
+    command.count = (uint32_t)count;
+    command.x = pointSize;
+    m_coloredVertices.insert(m_coloredVertices.end(), points, points + count);
+}
+
+void RenderCommandBuffer::DrawLines(const Line *lines, size_t count)
+{
+    Command &command = Add(CMD_LINES);
+    command.first = (uint32_t)m_lines.size();
+    command.count = (uint32_t)count;
+    m_lines.insert(m_lines.end(), lines, lines + count);
+}
+
+void RenderCommandBuffer::Replay(IRender &render) const
+{
+    for (const Command &command : m_commands)
+    {
+        const RectInt *rect = command.hasRect ? &command.rect : nullptr;
+
+        switch (command.type)
+        {
+        case CMD_SCISSOR:
+            render.SetScissor(rect);
+            break;
+        case CMD_VIEWPORT:
+            render.SetViewport(rect);
+            break;
+        case CMD_CAMERA:
+            render.Camera(rect, command.x, command.y, command.scale);
+            break;
+        case CMD_AMBIENT:
+            render.SetAmbient(command.x);
+            break;
+        case CMD_MODE:
+            render.SetMode((RenderMode)command.value);
+            break;
+        case CMD_SORT_LAYER:
+            render.SetSortLayer(command.value, command.orderIndependent);
+            break;
+        case CMD_QUAD:
+            std::copy_n(&m_vertices[command.first], command.count, render.DrawQuads(command.texture, command.count / 4));
+            break;
+        case CMD_FAN:
+            std::copy_n(&m_vertices[command.first], command.count, render.DrawFan((unsigned int)command.value));
+            break;
+        case CMD_BEGIN_STATIC_BATCH:
+            render.BeginStaticBatch((unsigned int)command.value);
+            break;
+        case CMD_END_STATIC_BATCH:
+            render.EndStaticBatch();
+            break;
+        case CMD_DRAW_STATIC_BATCH:
+            render.DrawStaticBatch((unsigned int)command.value);
+            break;
+        case CMD_SPRITE_FRAMES:
+            render.SetSpriteFrames(m_spriteFrames.data() + command.first, command.count);
+            break;
+        case CMD_SPRITES:
+            render.DrawSprites(command.texture, &m_sprites[command.first], command.count);
+            break;
+        case CMD_TRIANGLES:
+            render.DrawTriangles(m_coloredVertices.data() + command.first, command.count);
+            break;
+        case CMD_POINTS:
+            render.DrawPoints(m_coloredVertices.data() + command.first, command.count, command.x);
+            break;
+        case CMD_LINES:
+            render.DrawLines(m_lines.data() + command.first, command.count);
+            break;
+        case CMD_LIGHTS:
+            render.DrawLights(m_lights.data() + command.first, command.count);
+            break;
+        }
+    }
+}
+
+void RenderCommandBuffer::Clear()
+{
+    // keeps the capacity, a buffer is refilled every frame
+    m_commands.clear();
+    m_vertices.clear();
+    m_sprites.clear();
+    m_spriteFrames.clear();
+    m_coloredVertices.clear();
+    m_lines.clear();
+    m_lights.clear();
+}
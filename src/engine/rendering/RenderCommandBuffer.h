@@ -0,0 +1,109 @@
+#pragma once
+
+#include "base/IRender.h"
+#include "ColoredVertex.h"
+#include "GlTexture.h"
+#include "LightInstance.h"
+#include "Line.h"
+#include "SpriteInstance.h"
+#include "Vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+// Render that only records. Lets several threads generate geometry at once, each into its own
+// buffer, which the thread owning the real render then replays in order. Texture management
+// is not available while recording and CreateStaticBatch returns 0.
+class RenderCommandBuffer : public IRender
+{
+public:
+    // re-issues the recorded calls, the buffer stays intact until Clear
+    void Replay(IRender &render) const;
+    void Clear();
+
+    bool IsEmpty() const { return m_commands.empty(); }
+
+    // IRender
+    bool Init() override { return true; }
+    void OnResizeWnd(unsigned int width, unsigned int height) override { }
+
+    void SetScissor(const RectInt *rect) override;
+    void SetViewport(const RectInt *rect) override;
+    void Camera(const RectInt *vp, float x, float y, float scale) override;
+
+    void SetAmbient(float ambient) override;
+    void SetMode(const RenderMode mode) override;
+
+    void Begin() override;
+    void End() override;
+
+    void SetSortLayer(int layer, bool orderIndependent) override;
+
+    bool TexCreate(GlTexture &tex, const IImage &img, bool magFilter) override;
+    void TexFree(GlTexture tex) override;
+
+    // the returned vertices stay valid until the next call
+    Vertex* DrawQuad(GlTexture tex) override;
+    Vertex* DrawQuads(GlTexture tex, unsigned int count) override;
+    Vertex* DrawFan(unsigned int nEdges) override;
+
+    void BeginStaticBatch(unsigned int batch) override;
+    void EndStaticBatch() override;
+    void DrawStaticBatch(unsigned int batch) override;
+
+    void SetSpriteFrames(const SpriteFrame *frames, size_t count) override;
+    void DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count) override;
+    void DrawLights(const LightInstance *lights, size_t count) override;
+
+    void DrawTriangles(const ColoredVertex* vertices, std::size_t count) override;
+    void DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize) override;
+    void DrawLines(const Line *lines, size_t count) override;
+
+private:
+    enum CommandType : uint8_t
+    {
+        CMD_SCISSOR,
+        CMD_VIEWPORT,
+        CMD_CAMERA,
+        CMD_AMBIENT,
+        CMD_MODE,
+        CMD_SORT_LAYER,
+        CMD_QUAD,
+        CMD_FAN,
+        CMD_BEGIN_STATIC_BATCH,
+        CMD_END_STATIC_BATCH,
+        CMD_DRAW_STATIC_BATCH,
+        CMD_SPRITE_FRAMES,
+        CMD_SPRITES,
+        CMD_TRIANGLES,
+        CMD_POINTS,
+        CMD_LINES,
+        CMD_LIGHTS,
+    };
+
+    struct Command
+    {
+        CommandType type;
+        bool hasRect;           // a null rectangle was passed otherwise
+        bool orderIndependent;  // of a sort layer
+        int value;              // mode, layer, batch or fan edges
+        GlTexture texture;
+        uint32_t first;         // in the array of the command type
+        uint32_t count;
+        RectInt rect;
+        float x;                // camera position, ambient, point size
+        float y;
+        float scale;
+    };
+
+    Command& Add(CommandType type);
+    Command& AddRect(CommandType type, const RectInt *rect);
+
+    std::vector<Command> m_commands;
+    std::vector<Vertex> m_vertices;
+    std::vector<SpriteInstance> m_sprites;
+    std::vector<SpriteFrame> m_spriteFrames;
+    std::vector<ColoredVertex> m_coloredVertices;
+    std::vector<Line> m_lines;
+    std::vector<LightInstance> m_lights;
+};
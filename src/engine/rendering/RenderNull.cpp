@@ -0,0 +1,103 @@
+#include "RenderNull.h"
+#include "GlTexture.h"
+
+RenderNull::RenderNull()
+    : m_vertices(4)
+    , m_lastTexture(0)
+{
+}
+
+RenderNull::~RenderNull() = default;
+
+bool RenderNull::Init()
+{
+    return true;
+}
+
+void RenderNull::OnResizeWnd(unsigned int width, unsigned int height)
+{
+}
+
+void RenderNull::SetScissor(const RectInt *rect)
+{
+}
+
+void RenderNull::SetViewport(const RectInt *rect)
+{
+}
+
+void RenderNull::Camera(const RectInt *vp, float x, float y, float scale)
+{
+}
+
+void RenderNull::SetAmbient(float ambient)
+{
+}
+
+void RenderNull::SetMode(const RenderMode mode)
+{
+}
+
+void RenderNull::Begin()
+{
+}
+
+void RenderNull::End()
+{
+}
+
+bool RenderNull::TexCreate(GlTexture &tex, const IImage &img, bool magFilter)
+{
+    tex.ptr = nullptr;
+    tex.index = ++m_lastTexture;
+    return true;
+}
+
+void RenderNull::TexFree(GlTexture tex)
+{
+}
+
+Vertex* RenderNull::DrawQuad(GlTexture tex)
+{
+    return m_vertices.data();
+}
+
+Vertex* RenderNull::DrawQuads(GlTexture tex, unsigned int count)
+{
+    if (m_vertices.size() < count * 4)
+        m_vertices.resize(count * 4);
+
+    return m_vertices.data();
+}
+
+Vertex* RenderNull::DrawFan(unsigned int nEdges)
+{
+    if (m_vertices.size() < nEdges + 1)
+        m_vertices.resize(nEdges + 1);
+
+    return m_vertices.data();
+}
+
+void RenderNull::SetSpriteFrames(const SpriteFrame *frames, size_t count)
+{
+}
+
+void RenderNull::DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count)
+{
+}
+
+void RenderNull::DrawLights(const LightInstance *lights, size_t count)
+{
+}
+
+void RenderNull::DrawTriangles(const ColoredVertex* vertices, std::size_t count)
+{
+}
+
+void RenderNull::DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize)
+{
+}
+
+void RenderNull::DrawLines(const Line *lines, size_t count)
+{
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "base/IRender.h"
+#include "Vertex.h"
+
+#include <vector>
+
+// Renderer for headless runs: accepts every call and draws nothing, so the game code
+// which fills vertices keeps working without a window or a GPU.
+class RenderNull : public IRender
+{
+public:
+    RenderNull();
+    ~RenderNull() override;
+
+    bool Init() override;
+    void OnResizeWnd(unsigned int width, unsigned int height) override;
+
+    void SetScissor(const RectInt *rect) override;
+    void SetViewport(const RectInt *rect) override;
+    void Camera(const RectInt *vp, float x, float y, float scale) override;
+
+    void SetAmbient(float ambient) override;
+    void SetMode(const RenderMode mode) override;
+
+    void Begin() override;
+    void End() override;
+
+    bool TexCreate(GlTexture &tex, const IImage &img, bool magFilter) override;
+    void TexFree(GlTexture tex) override;
+
+    Vertex* DrawQuad(GlTexture tex) override;
+    Vertex* DrawQuads(GlTexture tex, unsigned int count) override;
+    Vertex* DrawFan(unsigned int nEdges) override;
+
+    void SetSpriteFrames(const SpriteFrame *frames, size_t count) override;
+    void DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count) override;
+    void DrawLights(const LightInstance *lights, size_t count) override;
+
+    void DrawTriangles(const ColoredVertex* vertices, std::size_t count) override;
+    void DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize) override;
+    void DrawLines(const Line *lines, size_t count) override;
+
+private:
+    // scratch memory handed out to the callers, overwritten by the next draw call
+    std::vector<Vertex> m_vertices;
+    unsigned int m_lastTexture;
+};
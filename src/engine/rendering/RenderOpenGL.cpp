@@ -4,18 +4,22 @@
 #include "Line.h"
 #include "Point.h"
 #include "ColoredVertex.h"
+#include "profiling/Profiler.h"
+
+#include <algorithm>
 
 RenderOpenGL::RenderOpenGL()
 	: m_windowWidth(0)
 	, m_windowHeight(0)
 	, m_curtex(-1)
 	, m_ambient(0)
+	, m_batch(INITIAL_VERTICES, MAX_VERTICES, MAX_VERTICES)
+	, m_indexArray(INITIAL_VERTICES * 2)
+	, m_vertexArray(INITIAL_VERTICES)
 	, m_vaSize(0)
 	, m_iaSize(0)
 	, m_mode()
 {
-	memset(m_indexArray, 0, sizeof(GLushort) * INDEX_ARRAY_SIZE);
-	memset(m_vertexArray, 0, sizeof(Vertex) * VERTEX_ARRAY_SIZE);
 }
 
 RenderOpenGL::~RenderOpenGL() = default;
@@ -35,7 +39,7 @@ void RenderOpenGL::OnResizeWnd(unsigned int width, unsigned int height)
 
 void RenderOpenGL::SetScissor(const RectInt* rect)
 {
-	Flush();
+	Flush(FLUSH_SCISSOR);
 	if (rect)
 	{
 		glScissor(rect->left, m_windowHeight - rect->bottom, rect->right - rect->left, rect->bottom - rect->top);
@@ -49,7 +53,7 @@ void RenderOpenGL::SetScissor(const RectInt* rect)
 
 void RenderOpenGL::SetViewport(const RectInt *rect)
 {
-	Flush();
+	Flush(FLUSH_SCISSOR);
 
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
@@ -94,10 +98,6 @@ void RenderOpenGL::Begin()
 {
 	glEnable(GL_BLEND);
 
-	glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertexArray->u);
-	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &m_vertexArray->color);
-	glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertexArray->x);
-
 	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
 	glEnableClientState(GL_COLOR_ARRAY);
 	glEnableClientState(GL_VERTEX_ARRAY);
@@ -109,12 +109,15 @@ void RenderOpenGL::Begin()
 
 void RenderOpenGL::End()
 {
-	Flush();
+	Flush(FLUSH_FRAME_END);
+
+	m_batchStats = m_batch.GetBatchStats();
+	m_batch.ResetBatchStats();
 }
 
 void RenderOpenGL::SetMode(RenderMode mode)
 {
-	Flush();
+	Flush(FLUSH_MODE);
 
 	switch (mode)
 	{
@@ -150,6 +153,10 @@ void RenderOpenGL::SetMode(RenderMode mode)
 
 bool RenderOpenGL::TexCreate(GlTexture &tex, const IImage &img, bool magFilter)
 {
+	// no compressed formats and no mipmaps here, only the first level is used
+	if (IsCompressedFormat(img.GetFormat()))
+		return false;
+
 	glGenTextures(1, &tex.index);
 	glBindTexture(GL_TEXTURE_2D, tex.index);
 
@@ -179,52 +186,115 @@ void RenderOpenGL::TexFree(GlTexture tex)
 	glDeleteTextures(1, &tex.index);
 }
 
-void RenderOpenGL::Flush()
+void RenderOpenGL::Flush(FlushReason reason)
 {
+	PROFILE_SCOPE("flush");
+
 	if (m_iaSize)
 	{
-		glDrawElements(GL_TRIANGLES, m_iaSize, GL_UNSIGNED_SHORT, m_indexArray);
+		m_batch.CountFlush(reason, m_vaSize);
+
+		// the arrays move when they grow
+		glTexCoordPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertexArray[0].u);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &m_vertexArray[0].color);
+		glVertexPointer(2, GL_FLOAT, sizeof(Vertex), &m_vertexArray[0].x);
+
+		glDrawElements(GL_TRIANGLES, m_iaSize, GL_UNSIGNED_SHORT, m_indexArray.data());
 		m_vaSize = m_iaSize = 0;
 	}
 }
 
+void RenderOpenGL::SetBatchLimit(std::size_t limit)
+{
+	Flush();
+	m_batch.SetBatchLimit(limit);
+}
+
+bool RenderOpenGL::Grow(std::size_t count)
+{
+	if (!m_batch.GrowBatch(count))
+		return false;
+
+	m_vertexArray.resize(m_batch.GetBatchCapacity());
+	m_indexArray.resize(m_batch.GetBatchCapacity() * 2);
+	return true;
+}
+
 Vertex* RenderOpenGL::DrawQuad(GlTexture tex)
 {
+	return DrawQuads(tex, 1);
+}
+
+Vertex* RenderOpenGL::DrawQuads(GlTexture tex, unsigned int count)
+{
+	static_assert(MAX_QUADS * 4 <= INITIAL_VERTICES, "MAX_QUADS does not fit the arrays");
+	assert(count > 0 && count <= MAX_QUADS);
+
 	GLuint& index = reinterpret_cast<GLuint&>(tex.index);
 	if (m_curtex != index)
 	{
-		Flush();
+		Flush(FLUSH_TEXTURE);
 		m_curtex = index;
 		glBindTexture(GL_TEXTURE_2D, m_curtex);
 	}
-	if (m_vaSize > VERTEX_ARRAY_SIZE - 4 || m_iaSize > INDEX_ARRAY_SIZE - 6)
+	const std::size_t vertices = std::max(m_vaSize + count * 4, (m_iaSize + count * 6 + 1) / 2);
+	if (vertices > m_batch.GetBatchCapacity() && !Grow(vertices))
 	{
-		Flush();
+		Flush(FLUSH_FULL);
 	}
 
 	Vertex *result = &m_vertexArray[m_vaSize];
 
-	m_indexArray[m_iaSize] = m_vaSize;
-	m_indexArray[m_iaSize + 1] = m_vaSize + 1;
-	m_indexArray[m_iaSize + 2] = m_vaSize + 2;
-	m_indexArray[m_iaSize + 3] = m_vaSize;
-	m_indexArray[m_iaSize + 4] = m_vaSize + 2;
-	m_indexArray[m_iaSize + 5] = m_vaSize + 3;
-
-	m_iaSize += 6;
-	m_vaSize += 4;
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		m_indexArray[m_iaSize] = m_vaSize;
+		m_indexArray[m_iaSize + 1] = m_vaSize + 1;
+		m_indexArray[m_iaSize + 2] = m_vaSize + 2;
+		m_indexArray[m_iaSize + 3] = m_vaSize;
+		m_indexArray[m_iaSize + 4] = m_vaSize + 2;
+		m_indexArray[m_iaSize + 5] = m_vaSize + 3;
+
+		m_iaSize += 6;
+		m_vaSize += 4;
+	}
 
 	return result;
 }
 
+void RenderOpenGL::SetSpriteFrames(const SpriteFrame* frames, size_t count)
+{
+	m_spriteFrames.assign(frames, frames + count);
+}
+
+void RenderOpenGL::DrawSprites(GlTexture tex, const SpriteInstance* sprites, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		assert(sprites[i].frame < m_spriteFrames.size());
+
+	while (count)
+	{
+		const unsigned int chunk = (unsigned int)std::min<size_t>(count, MAX_QUADS);
+		ExpandSprites(DrawQuads(tex, chunk), m_spriteFrames.data(), sprites, chunk);
+		sprites += chunk;
+		count -= chunk;
+	}
+}
+
+void RenderOpenGL::DrawLights(const LightInstance* lights, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		ExpandLight(DrawFan(lights[i].edges), lights[i]);
+}
+
 Vertex* RenderOpenGL::DrawFan(unsigned int nEdges)
 {
-	assert(nEdges * 3 < INDEX_ARRAY_SIZE);
+	assert(nEdges * 3 < INITIAL_VERTICES * 2);
 
-	if (m_vaSize + nEdges + 1 > VERTEX_ARRAY_SIZE ||
-		m_iaSize + nEdges * 3 > INDEX_ARRAY_SIZE)
+	// the fans have more indices per vertex than the quads, either may run out
+	const std::size_t vertices = std::max(m_vaSize + nEdges + 1, (m_iaSize + nEdges * 3 + 1) / 2);
+	if (vertices > m_batch.GetBatchCapacity() && !Grow(vertices))
 	{
-		Flush();
+		Flush(FLUSH_FULL);
 	}
 
 	Vertex *result = &m_vertexArray[m_vaSize];
@@ -2,9 +2,14 @@
 
 #include "base/IRender.h"
 #include "Vertex.h"
+#include "SpriteInstance.h"
+#include "LightInstance.h"
+#include "RenderBatch.h"
 
 #include "OpenGL.h"
 
+#include <vector>
+
 class IImage;
 struct Line;
 struct GlTexture;
@@ -15,7 +20,12 @@ public:
 	RenderOpenGL();
 	~RenderOpenGL() override;
 
-	void Flush();
+	void Flush(FlushReason reason = FLUSH_OTHER);
+
+	// the batch grows up to limit vertices before it is drawn, 64k at most with the 16 bit indices
+	void SetBatchLimit(std::size_t limit);
+	// batches drawn during the last frame
+	const BatchStats& GetBatchStats() const { return m_batchStats; }
 
     bool Init() override;
 	void OnResizeWnd(unsigned int width, unsigned int height) override;
@@ -34,13 +44,21 @@ public:
 	void TexFree(GlTexture tex) override;
 
 	Vertex* DrawQuad(GlTexture tex) override;
+	Vertex* DrawQuads(GlTexture tex, unsigned int count) override;
 	Vertex* DrawFan(unsigned int nEdges) override;
 
+	void SetSpriteFrames(const SpriteFrame* frames, size_t count) override;
+	void DrawSprites(GlTexture tex, const SpriteInstance* sprites, size_t count) override;
+	void DrawLights(const LightInstance* lights, size_t count) override;
+
     void DrawTriangles(const ColoredVertex* vertices, std::size_t count) override;
     void DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize) override;
 	void DrawLines(const Line* lines, size_t count) override;
 
 private:
+	// resizes the arrays to a capacity grown for 'count' vertices, false at the limit
+	bool Grow(std::size_t count);
+
 	int m_windowWidth;
 	int m_windowHeight;
 	RectInt   m_rtViewport;
@@ -48,16 +66,20 @@ private:
 	GLuint m_curtex;
 	float  m_ambient;
 
-	static const int VERTEX_ARRAY_SIZE = 1024;
-	static const int INDEX_ARRAY_SIZE = 2048;
+	static const int INITIAL_VERTICES = 1024;
+	static const int MAX_VERTICES = 64 * 1024;
 
-	GLushort m_indexArray[INDEX_ARRAY_SIZE];
-	Vertex m_vertexArray[VERTEX_ARRAY_SIZE];
+	RenderBatch m_batch;
+	BatchStats m_batchStats;
+	std::vector<GLushort> m_indexArray;     // 2 for every vertex, a fan has less
+	std::vector<Vertex> m_vertexArray;
 
 	unsigned int m_vaSize;      // number of filled elements in _VertexArray
 	unsigned int m_iaSize;      // number of filled elements in _IndexArray
 
 	RenderMode  m_mode;
+
+	std::vector<SpriteFrame> m_spriteFrames; // no instancing here, sprites are expanded into quads
 };
 
 // end of file
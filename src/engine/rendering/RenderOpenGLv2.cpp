@@ -7,9 +7,20 @@
 #include "glm/ext/matrix_transform.hpp" // glm::translate, glm::rotate, glm::scale
 
 #include "OpenGL.h"
+#include "profiling/Profiler.h"
 
-RenderOpenGLv2::RenderOpenGLv2()
-	: m_windowWidth(0)
+#include <algorithm>
+#include <cstring>
+
+// per frame in flight, a frame which does not fit reallocates the buffer storage
+static const std::size_t VERTEX_STREAM_FRAME_SIZE = 4 * 1024 * 1024;
+static const std::size_t INDEX_STREAM_FRAME_SIZE = 2 * 1024 * 1024;
+static const std::size_t PIXEL_STREAM_FRAME_SIZE = 4 * 1024 * 1024;
+static const int STREAM_FRAMES_IN_FLIGHT = 3;
+
+RenderOpenGLv2::RenderOpenGLv2(std::string programCacheDirectory)
+    : m_programCacheDirectory(std::move(programCacheDirectory))
+	, m_windowWidth(0)
 	, m_windowHeight(0)
 	, m_ambient(0)
 {
@@ -29,11 +40,25 @@ bool RenderOpenGLv2::Init()
 		return false;
 	}
 
-    m_renderPoints = std::make_unique<RenderPointsOpenGL>(GL_TRUE);
-    m_renderLines = std::make_unique<RenderLinesOpenGL>(GL_TRUE);
-    m_renderSolidTriangles = std::make_unique<RenderSolidTrianglesOpenGL>(GL_TRUE);
-    m_renderTexturedTriangles = std::make_unique<RenderTexturedTrianglesOpenGL>();
-    m_renderFan = std::make_unique<RenderFanOpenGL>();
+    m_vertexStream = std::make_unique<StreamBufferOpenGL>(GL_ARRAY_BUFFER, VERTEX_STREAM_FRAME_SIZE, STREAM_FRAMES_IN_FLIGHT);
+    m_indexStream = std::make_unique<StreamBufferOpenGL>(GL_ELEMENT_ARRAY_BUFFER, INDEX_STREAM_FRAME_SIZE, STREAM_FRAMES_IN_FLIGHT);
+    m_pixelStream = std::make_unique<StreamBufferOpenGL>(GL_PIXEL_UNPACK_BUFFER, PIXEL_STREAM_FRAME_SIZE, STREAM_FRAMES_IN_FLIGHT);
+
+    m_state = std::make_unique<StateCacheOpenGL>();
+    m_programs = std::make_unique<ProgramCacheOpenGL>(m_programCacheDirectory);
+    StateCacheOpenGL& state = *m_state;
+    ProgramCacheOpenGL& programs = *m_programs;
+
+    m_renderPoints = std::make_unique<RenderPointsOpenGL>(state, programs, GL_TRUE, *m_vertexStream);
+    m_renderLines = std::make_unique<RenderLinesOpenGL>(state, programs, GL_TRUE, *m_vertexStream);
+    m_renderSolidTriangles = std::make_unique<RenderSolidTrianglesOpenGL>(state, programs, GL_TRUE, *m_vertexStream);
+    m_renderTexturedTriangles = std::make_unique<RenderTexturedTrianglesOpenGL>(state, programs, *m_vertexStream, *m_indexStream);
+    m_renderFan = std::make_unique<RenderFanOpenGL>(state, programs, *m_vertexStream, *m_indexStream);
+    m_renderSprites = std::make_unique<RenderSpritesOpenGL>(state, programs, *m_vertexStream);
+    m_renderLights = std::make_unique<RenderLightsOpenGL>(state, programs, *m_vertexStream);
+    m_lightTarget = std::make_unique<LightTargetOpenGL>(state, programs);
+
+    PROFILE_ONLY(m_gpuTimer = std::make_unique<GpuTimerOpenGL>());
 
 	return true;
 }
@@ -42,50 +67,104 @@ void RenderOpenGLv2::OnResizeWnd(unsigned int width, unsigned int height)
 {
 	m_windowWidth = (int)width;
 	m_windowHeight = (int)height;
+	m_lightTarget->Resize(m_windowWidth, m_windowHeight, (int)m_lightDivisor);
 	SetViewport(nullptr);
 	SetScissor(nullptr);
 }
 
+void RenderOpenGLv2::SetLightResolution(unsigned int divisor)
+{
+    assert(divisor == 1 || divisor == 2 || divisor == 4);
+    assert(!m_lightTargetActive);
+    
+    m_lightDivisor = divisor;
+    if (m_lightTarget)
+        m_lightTarget->Resize(m_windowWidth, m_windowHeight, (int)divisor);
+}
+
 void RenderOpenGLv2::SetScissor(const RectInt* rect)
 {
-	Flush();
+	Flush(FLUSH_SCISSOR);
+	m_scissorEnabled = rect != nullptr;
 	if (rect)
-	{
-		glScissor(rect->left, m_windowHeight - rect->bottom, rect->right - rect->left, rect->bottom - rect->top);
-		glEnable(GL_SCISSOR_TEST);
-	}
-	else
-	{
-		glDisable(GL_SCISSOR_TEST);
-	}
+		m_scissor = *rect;
+	ApplyScissor();
 }
 
 void RenderOpenGLv2::SetViewport(const RectInt *rect)
 {
-	Flush();
+	Flush(FLUSH_SCISSOR);
 
 	if (rect)
 	{
-        m_projectionMatrix = glm::ortho<float>(0, (GLfloat)(rect->right - rect->left), (GLfloat)(rect->bottom - rect->top), 0, -1, 1);
-        
-		glViewport(
-			rect->left,                       // X
-			m_windowHeight - rect->bottom,     // Y
-			rect->right - rect->left,         // width
-			rect->bottom - rect->top          // height
-		);
 		m_rtViewport = *rect;
 	}
 	else
 	{
-        m_projectionMatrix = glm::ortho<float>(0, (GLfloat)m_windowWidth, (GLfloat)m_windowHeight, 0, -1, 1);
-        
-		glViewport(0, 0, m_windowWidth, m_windowHeight);
 		m_rtViewport.left = 0;
 		m_rtViewport.top = 0;
 		m_rtViewport.right = m_windowWidth;
 		m_rtViewport.bottom = m_windowHeight;
 	}
+	ApplyViewport();
+}
+
+void RenderOpenGLv2::ApplyViewport()
+{
+    const RectInt& vp = m_rtViewport;
+    if (m_lightTargetActive)
+    {
+        // the whole target with the viewport's origin moved, the scissor clips to the viewport
+        const int divisor = m_lightTarget->GetDivisor();
+        m_projectionMatrix = glm::ortho<float>((GLfloat)-vp.left, (GLfloat)(m_lightTarget->GetWidth() * divisor - vp.left),
+                                               (GLfloat)(m_lightTarget->GetHeight() * divisor - vp.top), (GLfloat)-vp.top, -1, 1);
+        glViewport(0, 0, m_lightTarget->GetWidth(), m_lightTarget->GetHeight());
+        return;
+    }
+    
+    m_projectionMatrix = glm::ortho<float>(0, (GLfloat)(vp.right - vp.left), (GLfloat)(vp.bottom - vp.top), 0, -1, 1);
+    
+	glViewport(
+		vp.left,                          // X
+		m_windowHeight - vp.bottom,       // Y
+		vp.right - vp.left,               // width
+		vp.bottom - vp.top                // height
+	);
+}
+
+void RenderOpenGLv2::ApplyScissor()
+{
+    if (m_lightTargetActive)
+    {
+        RectInt rect = m_rtViewport;
+        if (m_scissorEnabled)
+        {
+            rect.left = std::max(rect.left, m_scissor.left);
+            rect.top = std::max(rect.top, m_scissor.top);
+            rect.right = std::min(rect.right, m_scissor.right);
+            rect.bottom = std::min(rect.bottom, m_scissor.bottom);
+        }
+        
+        // every texel the rectangle touches
+        const int divisor = m_lightTarget->GetDivisor();
+        const int left = std::max(0, rect.left) / divisor;
+        const int top = std::max(0, rect.top) / divisor;
+        const int right = (rect.right + divisor - 1) / divisor;
+        const int bottom = (rect.bottom + divisor - 1) / divisor;
+        glScissor(left, m_lightTarget->GetHeight() - bottom, std::max(0, right - left), std::max(0, bottom - top));
+        glEnable(GL_SCISSOR_TEST);
+        return;
+    }
+    
+	if (m_scissorEnabled)
+	{
+		glScissor(m_scissor.left, m_windowHeight - m_scissor.bottom, m_scissor.right - m_scissor.left, m_scissor.bottom - m_scissor.top);
+		glEnable(GL_SCISSOR_TEST);
+	}
+	else
+	{
+		glDisable(GL_SCISSOR_TEST);
+	}
 }
 
 void RenderOpenGLv2::Camera(const RectInt* vp, float x, float y, float scale)
@@ -106,22 +185,68 @@ void RenderOpenGLv2::Camera(const RectInt* vp, float x, float y, float scale)
 void RenderOpenGLv2::Begin()
 {
 	glClearColor(0, 0, 0, m_ambient);
-	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    m_state->ColorMask(true, true, true, true);
 	glClear(GL_COLOR_BUFFER_BIT);
+
+    PROFILE_ONLY(m_gpuTimer->Section("begin"));
 }
 
 void RenderOpenGLv2::End()
 {
-	Flush();
+	Flush(FLUSH_FRAME_END);
+    
+    if (m_lightTargetActive)
+        EndLightPass();
+
+    m_vertexStream->EndFrame();
+    m_indexStream->EndFrame();
+    m_pixelStream->EndFrame();
+    m_state->EndFrame();
+    PROFILE_ONLY(m_gpuTimer->EndFrame());
+    
+    m_batchStats = BatchStats();
+    for (RenderBatch* batch : GetBatches())
+    {
+        m_batchStats.Add(batch->GetBatchStats());
+        batch->ResetBatchStats();
+    }
+}
+
+StreamBufferOpenGL::Stats RenderOpenGLv2::GetStreamStats() const
+{
+    StreamBufferOpenGL::Stats stats;
+    if (!m_vertexStream)
+        return stats;
+
+    for (const StreamBufferOpenGL* stream : { m_vertexStream.get(), m_indexStream.get(), m_pixelStream.get() })
+    {
+        const StreamBufferOpenGL::Stats& streamStats = stream->GetStats();
+        stats.bytesStreamed += streamStats.bytesStreamed;
+        stats.uploads += streamStats.uploads;
+        stats.syncStalls += streamStats.syncStalls;
+        stats.orphans += streamStats.orphans;
+    }
+    return stats;
+}
+
+StateCacheOpenGL::Stats RenderOpenGLv2::GetStateStats() const
+{
+    return m_state ? m_state->GetStats() : StateCacheOpenGL::Stats();
 }
 
 void RenderOpenGLv2::SetMode(RenderMode mode)
 {
-	Flush();
+	Flush(FLUSH_MODE);
+    
+    if (m_lightTargetActive && mode != LIGHT)
+        EndLightPass();
     
     if (mode == LIGHT)
     {
         glClearColor(0, 0, 0, m_ambient);
+        
+        if (m_lightDivisor > 1 && !m_lightTargetActive && m_lightTarget->GetWidth() && m_lightTarget->GetHeight())
+            BeginLightPass();
     }
     
     if (mode == INTERFACE)
@@ -133,59 +258,353 @@ void RenderOpenGLv2::SetMode(RenderMode mode)
     m_renderTexturedTriangles->SetMode(mode);
 
     m_renderFan->SetMode(mode);
+    m_renderSprites->SetMode(mode);
     m_renderPoints->SetMode(mode);
     m_renderLines->SetMode(mode);
     m_renderSolidTriangles->SetMode(mode);
+
+    PROFILE_ONLY(m_gpuTimer->Section(mode == LIGHT ? "light" : mode == WORLD ? "world" : "interface"));
+}
+
+void RenderOpenGLv2::BeginLightPass()
+{
+    m_lightTarget->Bind(m_ambient);
+    m_lightTargetActive = true;
+    ApplyViewport();
+    ApplyScissor();
+}
+
+void RenderOpenGLv2::EndLightPass()
+{
+    assert(m_lightTargetActive);
+    
+    Flush(FLUSH_MODE);
+    m_lightTarget->Composite(m_windowWidth, m_windowHeight);
+    m_lightTargetActive = false;
+    ApplyViewport();
+    ApplyScissor();
+}
+
+// the internal format of a compressed image, 0 when the driver cannot take it
+static GLenum GetCompressedFormat(ImageFormat format)
+{
+    const bool etc2 = GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+    const bool s3tc = GLEW_EXT_texture_compression_s3tc;
+
+    switch (format)
+    {
+    case IMAGE_FORMAT_ETC2_RGB8: return etc2 ? GL_COMPRESSED_RGB8_ETC2 : 0;
+    case IMAGE_FORMAT_ETC2_RGBA8: return etc2 ? GL_COMPRESSED_RGBA8_ETC2_EAC : 0;
+    case IMAGE_FORMAT_BC1: return s3tc ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : 0;
+    case IMAGE_FORMAT_BC3: return s3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+    default: return 0;
+    }
 }
 
 bool RenderOpenGLv2::TexCreate(GlTexture &tex, const IImage &img, bool magFilter)
 {
-	glGenTextures(1, &tex.index);
-	glBindTexture(GL_TEXTURE_2D, tex.index);
-
-	glTexImage2D(
-		GL_TEXTURE_2D,                      // target
-		0,                                  // level
-		GL_RGBA,                            // internalformat
-		img.GetWidth(),                    // width
-		img.GetHeight(),                   // height
-		0,                                  // border
-		(24 == img.GetBitsPerPixel()) ? GL_RGB : GL_RGBA, // format
-		GL_UNSIGNED_BYTE,                   // type
-		img.GetData()                      // pixels
-	);
+    const bool compressed = IsCompressedFormat(img.GetFormat());
+    const GLenum compressedFormat = compressed ? GetCompressedFormat(img.GetFormat()) : 0;
+    if (compressed && !compressedFormat)
+    {
+        fprintf(stderr, "Compressed texture format %d is not supported\n", (int)img.GetFormat());
+        return false;
+    }
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER,  magFilter ? GL_LINEAR : GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, /*GL_NEAREST*/ GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glGenTextures(1, &tex.index);
+    m_state->BindTexture(GL_TEXTURE_2D, tex.index);
 
-	return true;
+    // the rows of the raw levels are tightly packed
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const GLint levels = (GLint)img.GetLevelsCount();
+    for (GLint level = 0; level < levels; ++level)
+    {
+        const GLsizei width = GetLevelDimension(img.GetWidth(), level);
+        const GLsizei height = GetLevelDimension(img.GetHeight(), level);
+        if (compressed)
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, compressedFormat, width, height, 0,
+                                   (GLsizei)GetImageLevelSize(img, level), img.GetLevelData(level));
+        }
+        else
+        {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0,
+                         (24 == img.GetBitsPerPixel()) ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, img.GetLevelData(level));
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    const bool generate = levels == 1 && !compressed && m_generateMipmaps;
+    if (generate)
+        glGenerateMipmap(GL_TEXTURE_2D);
+    else
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (levels > 1 || generate) ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    return true;
+}
+
+bool RenderOpenGLv2::TexAllocate(GlTexture &tex, const IImage &img, bool magFilter)
+{
+    // the rows of the compressed images and of the levels do not split into bands
+    if (IsCompressedFormat(img.GetFormat()) || img.GetLevelsCount() > 1)
+        return false;
+
+    glGenTextures(1, &tex.index);
+    m_state->BindTexture(GL_TEXTURE_2D, tex.index);
+
+    // no pixels, the storage is filled by TexUploadRows
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, img.GetWidth(), img.GetHeight(), 0,
+                 (24 == img.GetBitsPerPixel()) ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter ? GL_LINEAR : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    return true;
+}
+
+void RenderOpenGLv2::TexUploadRows(GlTexture tex, const IImage &img, unsigned int firstRow, unsigned int rows)
+{
+    assert(firstRow + rows <= img.GetHeight());
+
+    const GLenum format = (24 == img.GetBitsPerPixel()) ? GL_RGB : GL_RGBA;
+    const std::size_t rowSize = (std::size_t)img.GetWidth() * (img.GetBitsPerPixel() / 8);
+    const unsigned int bandRows = std::max<unsigned int>(1, (unsigned int)(PIXEL_STREAM_FRAME_SIZE / rowSize));
+    assert(rowSize <= PIXEL_STREAM_FRAME_SIZE);
+
+    m_state->BindTexture(GL_TEXTURE_2D, tex.index);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // the copy into the pixel buffer returns at once, the GPU reads it when it gets there
+    for (unsigned int row = firstRow; row < firstRow + rows; row += bandRows)
+    {
+        const unsigned int count = std::min(bandRows, firstRow + rows - row);
+        const std::size_t offset = m_pixelStream->Upload(img.GetData() + row * rowSize, count * rowSize, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, img.GetWidth(), count, format, GL_UNSIGNED_BYTE, (const void*)offset);
+    }
+
+    // with the buffer bound the pixel pointers of TexCreate would be read as offsets in it
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (m_generateMipmaps && firstRow + rows == img.GetHeight())
+    {
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
 }
 
 void RenderOpenGLv2::TexFree(GlTexture tex)
 {
 	assert(glIsTexture(tex.index));
+    m_state->ForgetTexture(tex.index);
 	glDeleteTextures(1, &tex.index);
 }
 
-void RenderOpenGLv2::Flush()
+void RenderOpenGLv2::SetSortLayer(int layer, bool orderIndependent)
+{
+    m_commands.SetLayer(layer, orderIndependent);
+    m_staticCommands.SetLayer(layer, orderIndependent);
+}
+
+void RenderOpenGLv2::FlushCommands()
+{
+    if (m_commands.IsEmpty())
+        return;
+    
+    const DrawCommandQueue::Command* previous = nullptr;
+    for (const DrawCommandQueue::Command& command : m_commands.Sort())
+    {
+        const DrawCommandQueue::Program program = command.GetProgram();
+        
+        // the parts draw independently, keep the layers and the programs inside a layer in order
+        if (previous && (previous->GetLayer() != command.GetLayer() || previous->GetProgram() != program))
+            FlushPart(previous->GetProgram(), FLUSH_ORDER);
+        previous = &command;
+        
+        if (program == DrawCommandQueue::PROGRAM_SPRITES)
+        {
+            GlTexture texture;
+            texture.ptr = nullptr;
+            texture.index = command.GetTexture();
+            m_renderSprites->Draw(texture, m_commands.GetSprites(command), command.vertexCount, m_modelViewMatrix, m_projectionMatrix);
+            continue;
+        }
+        
+        if (program == DrawCommandQueue::PROGRAM_FAN)
+        {
+            Vertex* vertices = m_renderFan->GetVertices(command.vertexCount - 1, m_modelViewMatrix, m_projectionMatrix);
+            memcpy(vertices, m_commands.GetVertices(command), command.vertexCount * sizeof(Vertex));
+        }
+        else
+        {
+            GlTexture texture;
+            texture.ptr = nullptr;
+            texture.index = command.GetTexture();
+            const Vertex* source = m_commands.GetVertices(command);
+            for (uint32_t quad = 0; quad < command.vertexCount; quad += 4)
+            {
+                Vertex* vertices = m_renderTexturedTriangles->GetVertices(texture, m_modelViewMatrix, m_projectionMatrix);
+                memcpy(vertices, source + quad, 4 * sizeof(Vertex));
+            }
+        }
+    }
+    
+    m_commands.Clear();
+}
+
+void RenderOpenGLv2::FlushPart(DrawCommandQueue::Program program, FlushReason reason)
 {
-    m_renderFan->Flush(m_modelViewMatrix, m_projectionMatrix);
-    m_renderTexturedTriangles->Flush(m_modelViewMatrix, m_projectionMatrix);
-    m_renderPoints->Flush(m_modelViewMatrix, m_projectionMatrix);
-    m_renderLines->Flush(m_modelViewMatrix, m_projectionMatrix);
-    m_renderSolidTriangles->Flush(m_modelViewMatrix, m_projectionMatrix);
+    switch (program)
+    {
+    case DrawCommandQueue::PROGRAM_FAN:
+        m_renderFan->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+        break;
+    case DrawCommandQueue::PROGRAM_TEXTURED:
+        m_renderTexturedTriangles->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+        break;
+    case DrawCommandQueue::PROGRAM_SPRITES:
+        m_renderSprites->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+        break;
+    }
+}
+
+void RenderOpenGLv2::Flush(FlushReason reason)
+{
+    PROFILE_SCOPE("flush");
+
+    FlushCommands();
+    
+    m_renderLights->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+    m_renderFan->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+    m_renderTexturedTriangles->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+    m_renderSprites->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+    m_renderPoints->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+    m_renderLines->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+    m_renderSolidTriangles->Flush(m_modelViewMatrix, m_projectionMatrix, reason);
+}
+
+void RenderOpenGLv2::SetBatchLimit(std::size_t limit)
+{
+    Flush();
+    for (RenderBatch* batch : GetBatches())
+        batch->SetBatchLimit(limit);
+}
+
+std::array<RenderBatch*, 7> RenderOpenGLv2::GetBatches() const
+{
+    return {{ m_renderPoints.get(), m_renderLines.get(), m_renderSolidTriangles.get(), m_renderTexturedTriangles.get(),
+              m_renderFan.get(), m_renderSprites.get(), m_renderLights.get() }};
 }
 
 Vertex* RenderOpenGLv2::DrawQuad(GlTexture tex)
 {
-	return m_renderTexturedTriangles->GetVertices(tex, m_modelViewMatrix, m_projectionMatrix);
+	return (m_recordingBatch ? m_staticCommands : m_commands).AddQuad(tex.index);
+}
+
+Vertex* RenderOpenGLv2::DrawQuads(GlTexture tex, unsigned int count)
+{
+    assert(count > 0 && count <= MAX_QUADS);
+    return (m_recordingBatch ? m_staticCommands : m_commands).AddQuads(tex.index, count);
 }
 
 Vertex* RenderOpenGLv2::DrawFan(unsigned int nEdges)
 {
-	return m_renderFan->GetVertices(nEdges, m_modelViewMatrix, m_projectionMatrix);
+	return (m_recordingBatch ? m_staticCommands : m_commands).AddFan(nEdges);
+}
+
+void RenderOpenGLv2::SetSpriteFrames(const SpriteFrame* frames, size_t count)
+{
+    Flush();
+    m_renderSprites->SetFrames(frames, count);
+    m_spriteFrames.assign(frames, frames + count);
+}
+
+void RenderOpenGLv2::DrawSprites(GlTexture tex, const SpriteInstance* sprites, size_t count)
+{
+    if (m_recordingBatch && count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            assert(sprites[i].frame < m_spriteFrames.size());
+        ExpandSprites(m_staticCommands.AddQuads(tex.index, (uint32_t)count), m_spriteFrames.data(), sprites, count);
+    }
+    else if (count)
+    {
+        m_commands.AddSprites(tex.index, sprites, (uint32_t)count);
+    }
+}
+
+void RenderOpenGLv2::DrawLights(const LightInstance* lights, size_t count)
+{
+    if (m_recordingBatch)
+    {
+        // static batches keep fans only
+        for (size_t i = 0; i < count; ++i)
+            ExpandLight(m_staticCommands.AddFan(lights[i].edges), lights[i]);
+    }
+    else if (count)
+    {
+        m_renderLights->Draw(lights, count, m_modelViewMatrix, m_projectionMatrix);
+    }
+}
+
+unsigned int RenderOpenGLv2::CreateStaticBatch()
+{
+    size_t slot = 0;
+    while (slot < m_staticBatches.size() && m_staticBatches[slot])
+        ++slot;
+    
+    if (slot == m_staticBatches.size())
+        m_staticBatches.emplace_back();
+    
+    m_staticBatches[slot] = std::make_unique<StaticBatchOpenGL>(*m_state);
+    return (unsigned int)slot + 1;
+}
+
+void RenderOpenGLv2::FreeStaticBatch(unsigned int batch)
+{
+    assert(batch && batch <= m_staticBatches.size() && batch != m_recordingBatch);
+    m_staticBatches[batch - 1].reset();
+}
+
+void RenderOpenGLv2::BeginStaticBatch(unsigned int batch)
+{
+    assert(batch && batch <= m_staticBatches.size() && m_staticBatches[batch - 1]);
+    assert(!m_recordingBatch);
+    
+    m_recordingBatch = batch;
+    m_staticCommands.Clear();
+}
+
+void RenderOpenGLv2::EndStaticBatch()
+{
+    assert(m_recordingBatch);
+    
+    m_staticBatches[m_recordingBatch - 1]->Build(m_staticCommands);
+    m_recordingBatch = 0;
+}
+
+void RenderOpenGLv2::DrawStaticBatch(unsigned int batch)
+{
+    assert(batch && batch <= m_staticBatches.size() && m_staticBatches[batch - 1]);
+    
+    // whatever was drawn before the batch goes first
+    Flush(FLUSH_ORDER);
+    
+    const StaticBatchOpenGL& staticBatch = *m_staticBatches[batch - 1];
+    for (const StaticBatchOpenGL::Range& range : staticBatch.GetRanges())
+    {
+        if (range.program == DrawCommandQueue::PROGRAM_FAN)
+            m_renderFan->DrawElements(staticBatch.GetVertexArray(), range.firstIndex, range.indexCount, m_modelViewMatrix, m_projectionMatrix);
+        else
+            m_renderTexturedTriangles->DrawElements(staticBatch.GetVertexArray(), range.texture, range.firstIndex, range.indexCount, m_modelViewMatrix, m_projectionMatrix);
+    }
 }
 
 void RenderOpenGLv2::DrawTriangles(const ColoredVertex* vertices, std::size_t count)
@@ -8,7 +8,16 @@
 #endif
 
 #include "RenderPartsOpenGL.h"
+#include "StreamBufferOpenGL.h"
+#include "DrawCommandQueue.h"
+#include "StaticBatchOpenGL.h"
+#include "StateCacheOpenGL.h"
+#include "ProgramCacheOpenGL.h"
+#include "GpuTimerOpenGL.h"
+#include <string>
+#include <array>
 #include <memory>
+#include <vector>
 #include "glm/mat4x4.hpp"
 
 class IImage;
@@ -19,10 +28,25 @@ struct ColoredVertex;
 class RenderOpenGLv2 : public IRender
 {
 public:
-	RenderOpenGLv2();
+    // the binaries of the linked programs are kept in programCacheDirectory when it is given
+    explicit RenderOpenGLv2(std::string programCacheDirectory = std::string());
 	~RenderOpenGLv2();
 
-	void Flush();
+	void Flush(FlushReason reason = FLUSH_OTHER);
+    
+    // the batches of the parts grow up to limit vertices or instances before they are drawn, at
+    // most what a region of the stream buffers they are uploaded to holds
+    void SetBatchLimit(std::size_t limit);
+    
+    // the LIGHT mode draws to a buffer of 1/divisor the window size when it is 2 or 4, 1 draws
+    // to the window; the lights are smooth enough for the half size default, not to be changed
+    // in the LIGHT mode
+    enum { DEFAULT_LIGHT_DIVISOR = 2 };
+    void SetLightResolution(unsigned int divisor);
+    
+    // mipmaps of the raw textures created with a single level, the levels of the images are
+    // always used; for the textures created afterwards
+    void SetGenerateMipmaps(bool generate) { m_generateMipmaps = generate; }
     
     bool Init() override;
 	void OnResizeWnd(unsigned int width, unsigned int height) override;
@@ -33,21 +57,71 @@ public:
 
 	void Begin() override;
 	void End() override;
+	void SetSortLayer(int layer, bool orderIndependent) override;
 	void SetMode(RenderMode mode) override;
 
 	void SetAmbient(float ambient) override;
 
 	bool TexCreate(GlTexture& tex, const IImage& img, bool magFilter) override;
+    bool TexAllocate(GlTexture& tex, const IImage& img, bool magFilter) override;
+    void TexUploadRows(GlTexture tex, const IImage& img, unsigned int firstRow, unsigned int rows) override;
 	void TexFree(GlTexture tex) override;
 
 	Vertex* DrawQuad(GlTexture tex) override;
+	Vertex* DrawQuads(GlTexture tex, unsigned int count) override;
 	Vertex* DrawFan(unsigned int nEdges) override;
 
+	void SetSpriteFrames(const SpriteFrame* frames, size_t count) override;
+	void DrawSprites(GlTexture tex, const SpriteInstance* sprites, size_t count) override;
+	void DrawLights(const LightInstance* lights, size_t count) override;
+
+	unsigned int CreateStaticBatch() override;
+	void FreeStaticBatch(unsigned int batch) override;
+	void BeginStaticBatch(unsigned int batch) override;
+	void EndStaticBatch() override;
+	void DrawStaticBatch(unsigned int batch) override;
+
     void DrawTriangles(const ColoredVertex* vertices, std::size_t count) override;
     void DrawPoints(const ColoredVertex* point, std::size_t count, float pointSize) override;
 	void DrawLines(const Line* lines, size_t count) override;
 
+    // streamed during the last frame, vertices, indices and the pixels of TexUploadRows together
+    StreamBufferOpenGL::Stats GetStreamStats() const;
+    // state changes made and skipped during the last frame
+    StateCacheOpenGL::Stats GetStateStats() const;
+    const ProgramCacheOpenGL::Stats& GetProgramStats() const { return m_programs->GetStats(); }
+    // batches of all the parts drawn during the last frame
+    const BatchStats& GetBatchStats() const { return m_batchStats; }
+
 private:
+    void FlushCommands();
+    void FlushPart(DrawCommandQueue::Program program, FlushReason reason);
+    std::array<RenderBatch*, 7> GetBatches() const;
+    
+    // the viewport and the scissor of the window or of the light target
+    void ApplyViewport();
+    void ApplyScissor();
+    void BeginLightPass();
+    void EndLightPass();
+    
+    // before everything using them, they are destroyed last
+    std::string m_programCacheDirectory;
+    std::unique_ptr<StateCacheOpenGL> m_state;
+    std::unique_ptr<ProgramCacheOpenGL> m_programs;
+    
+    // quads and fans wait here until a state change and reach the parts sorted
+    DrawCommandQueue m_commands;
+    
+    // recording of a static batch takes the quads and fans instead of m_commands
+    DrawCommandQueue m_staticCommands;
+    std::vector<std::unique_ptr<StaticBatchOpenGL>> m_staticBatches; // batch id is the index + 1
+    unsigned int m_recordingBatch = 0;
+    std::vector<SpriteFrame> m_spriteFrames; // sprites of static batches are expanded into quads
+    
+    std::unique_ptr<StreamBufferOpenGL> m_vertexStream;
+    std::unique_ptr<StreamBufferOpenGL> m_indexStream;
+    std::unique_ptr<StreamBufferOpenGL> m_pixelStream; // GL_PIXEL_UNPACK_BUFFER of TexUploadRows
+    
     glm::mat4 m_projectionMatrix;
     glm::mat4 m_modelViewMatrix;
     
@@ -56,10 +130,23 @@ private:
     std::unique_ptr<RenderSolidTrianglesOpenGL> m_renderSolidTriangles;
     std::unique_ptr<RenderTexturedTrianglesOpenGL> m_renderTexturedTriangles;
     std::unique_ptr<RenderFanOpenGL> m_renderFan;
+    std::unique_ptr<RenderSpritesOpenGL> m_renderSprites;
+    std::unique_ptr<RenderLightsOpenGL> m_renderLights;
+    
+    std::unique_ptr<LightTargetOpenGL> m_lightTarget;
+    unsigned int m_lightDivisor = DEFAULT_LIGHT_DIVISOR;
+    bool m_generateMipmaps = false;
+    bool m_lightTargetActive = false;
+    
+    std::unique_ptr<GpuTimerOpenGL> m_gpuTimer; // only with ENGINE_PROFILER
+    
+    BatchStats m_batchStats;
     
 	int m_windowWidth;
 	int m_windowHeight;
 	RectInt m_rtViewport;
+	RectInt m_scissor;
+	bool m_scissorEnabled = false;
 
 	float m_ambient;
 	RenderMode m_mode;
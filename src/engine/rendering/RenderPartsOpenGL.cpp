@@ -7,6 +7,10 @@
 #include <stdio.h>
 #include <stdarg.h>
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #if WIN32
 //#include <wincon.h>
 //
@@ -76,71 +80,6 @@ static void sCheckGLError()
     }
 }
 
-static void sPrintLog(GLuint object)
-{
-    GLint log_length = 0;
-    if (glIsShader(object))
-        glGetShaderiv(object, GL_INFO_LOG_LENGTH, &log_length);
-    else if (glIsProgram(object))
-        glGetProgramiv(object, GL_INFO_LOG_LENGTH, &log_length);
-    else
-    {
-        fprintf(stderr, "printlog: Not a shader or a program\n");
-        return;
-    }
-
-    char* log = (char*)malloc(log_length);
-
-    if (glIsShader(object))
-        glGetShaderInfoLog(object, log_length, NULL, log);
-    else if (glIsProgram(object))
-        glGetProgramInfoLog(object, log_length, NULL, log);
-
-    fprintf(stderr, "%s", log);
-    free(log);
-}
-
-static GLuint sCreateShaderFromString(const char* source, GLenum type)
-{
-    GLuint res = glCreateShader(type);
-    const char* sources[] = { source };
-    glShaderSource(res, 1, sources, NULL);
-    glCompileShader(res);
-    GLint compile_ok = GL_FALSE;
-    glGetShaderiv(res, GL_COMPILE_STATUS, &compile_ok);
-    if (compile_ok == GL_FALSE)
-    {
-        fprintf(stderr, "Error compiling shader of type %d!\n", type);
-        sPrintLog(res);
-        glDeleteShader(res);
-        return 0;
-    }
-
-    return res;
-}
-
-static GLuint sCreateShaderProgram(const char* vs, const char* fs)
-{
-    GLuint vsId = sCreateShaderFromString(vs, GL_VERTEX_SHADER);
-    GLuint fsId = sCreateShaderFromString(fs, GL_FRAGMENT_SHADER);
-    assert(vsId != 0 && fsId != 0);
-
-    GLuint programId = glCreateProgram();
-    glAttachShader(programId, vsId);
-    glAttachShader(programId, fsId);
-    glBindFragDataLocation(programId, 0, "color");
-    glLinkProgram(programId);
-
-    glDeleteShader(vsId);
-    glDeleteShader(fsId);
-
-    GLint status = GL_FALSE;
-    glGetProgramiv(programId, GL_LINK_STATUS, &status);
-    assert(status != GL_FALSE);
-    
-    return programId;
-}
-
 #define BUFFER_OFFSET(x)  ((const void*) (x))
 
 template <typename T1, typename T2>
@@ -151,14 +90,23 @@ inline constexpr std::size_t OffsetOf(T1 T2::*member)
 
 //------------------------------------------------------------------------------------------------
 
-RenderPointsOpenGL::RenderPointsOpenGL(bool colorNormalized)
-    : m_colorNormalized(colorNormalized)
+RenderPointsOpenGL::RenderPointsOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, bool colorNormalized, StreamBufferOpenGL& vertexStream)
+    : RenderBatch(initialVertices, DEFAULT_LIMIT, vertexStream.GetRegionSize() / sizeof(Vec2F))
+    , m_vertices(initialVertices)
+    , m_colors(initialVertices)
+    , m_sizes(initialVertices)
+    , m_state(state)
+    , m_vertexStream(vertexStream)
+    , m_colorNormalized(colorNormalized)
 {
     const char* vs = R"-(
         #version 330
     
-        uniform mat4 projectionMatrix;
-        uniform mat4 modelViewMatrix;
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
     
         layout(location = 0) in vec2 v_position;
         layout(location = 1) in vec4 v_color;
@@ -186,42 +134,25 @@ RenderPointsOpenGL::RenderPointsOpenGL(bool colorNormalized)
         }
     )-";
     
-    m_programId = sCreateShaderProgram(vs, fs);
-    m_projectionUniform = glGetUniformLocation(m_programId, "projectionMatrix");
-    m_modelViewUniform = glGetUniformLocation(m_programId, "modelViewMatrix");
+    m_programId = programs.GetProgram(vs, fs);
     m_vertexAttribute = 0;
     m_colorAttribute = 1;
     m_sizeAttribute = 2;
     
     // Generate
     glGenVertexArrays(1, &m_vaoId);
-    glGenBuffers(3, m_vboIds);
     
-    glBindVertexArray(m_vaoId);
+    // attribute pointers are set on every flush, the data lives in the shared stream buffer
+    m_state.BindVertexArray(m_vaoId);
     glEnableVertexAttribArray(m_vertexAttribute);
     glEnableVertexAttribArray(m_colorAttribute);
     glEnableVertexAttribArray(m_sizeAttribute);
     
-    // Vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices), m_vertices, GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[1]);
-    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, m_colorNormalized, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_colors), m_colors, GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[2]);
-    glVertexAttribPointer(m_sizeAttribute, 1, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_sizes), m_sizes, GL_DYNAMIC_DRAW);
+    // only the points program writes gl_PointSize
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
     sCheckGLError();
     
-    // Cleanup
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
-    
     m_count = 0;
 }
 
@@ -230,21 +161,25 @@ RenderPointsOpenGL::~RenderPointsOpenGL()
     if (m_vaoId)
     {
         //glDeleteVertexArrays(1, &m_vaoId);
-        //glDeleteBuffers(2, m_vboIds);
         m_vaoId = 0;
     }
+}
+
+bool RenderPointsOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(count))
+        return false;
     
-    if (m_programId)
-    {
-        //glDeleteProgram(m_programId);
-        m_programId = 0;
-    }
+    m_vertices.resize(GetBatchCapacity());
+    m_colors.resize(GetBatchCapacity());
+    m_sizes.resize(GetBatchCapacity());
+    return true;
 }
 
 void RenderPointsOpenGL::Draw(Point point, const glm::mat4x4& modelView, const glm::mat4x4& projection)
 {
-    if (m_count == maxVertices)
-        Flush(modelView, projection);
+    if (m_count == (int32)GetBatchCapacity() && !Grow(m_count + 1))
+        Flush(modelView, projection, FLUSH_FULL);
     
     m_vertices[m_count] = point.position;
     m_colors[m_count] = point.color;
@@ -253,50 +188,54 @@ void RenderPointsOpenGL::Draw(Point point, const glm::mat4x4& modelView, const g
     ++m_count;
 }
 
-void RenderPointsOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection)
+void RenderPointsOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
 {
     if (m_count == 0)
         return;
     
-    glUseProgram(m_programId);
+    CountFlush(reason, m_count);
     
-    glUniformMatrix4fv(m_modelViewUniform, 1, GL_FALSE, glm::value_ptr(modelView));
-    glUniformMatrix4fv(m_projectionUniform, 1, GL_FALSE, glm::value_ptr(projection));
+    m_state.UseProgram(m_programId);
     
-    glBindVertexArray(m_vaoId);
+    m_state.SetMatrices(modelView, projection);
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(Vec2F), m_vertices);
+    m_state.BindVertexArray(m_vaoId);
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(Color), m_colors);
+    std::size_t offset = m_vertexStream.Upload(m_vertices.data(), m_count * sizeof(Vec2F));
+    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[2]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(float32), m_sizes);
+    offset = m_vertexStream.Upload(m_colors.data(), m_count * sizeof(Color));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, m_colorNormalized, 0, BUFFER_OFFSET(offset));
     
-    glEnable(GL_PROGRAM_POINT_SIZE);
+    offset = m_vertexStream.Upload(m_sizes.data(), m_count * sizeof(float32));
+    glVertexAttribPointer(m_sizeAttribute, 1, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
+    
+    m_state.SetBlend(false);
     glDrawArrays(GL_POINTS, 0, m_count);
-    glDisable(GL_PROGRAM_POINT_SIZE);
     
     sCheckGLError();
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
-    
     m_count = 0;
 }
 
 //------------------------------------------------------------------------------------------------
 
-RenderLinesOpenGL::RenderLinesOpenGL(bool colorNormalized)
-    : m_colorNormalized(colorNormalized)
+RenderLinesOpenGL::RenderLinesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, bool colorNormalized, StreamBufferOpenGL& vertexStream)
+    : RenderBatch(initialVertices, DEFAULT_LIMIT, vertexStream.GetRegionSize() / sizeof(Vec2F))
+    , m_vertices(initialVertices)
+    , m_colors(initialVertices)
+    , m_state(state)
+    , m_vertexStream(vertexStream)
+    , m_colorNormalized(colorNormalized)
 {
     const char* vs = R"-(
         #version 330
     
-        uniform mat4 projectionMatrix;
-        uniform mat4 modelViewMatrix;
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
     
         layout(location = 0) in vec2 v_position;
         layout(location = 1) in vec4 v_color;
@@ -321,37 +260,20 @@ RenderLinesOpenGL::RenderLinesOpenGL(bool colorNormalized)
         }
     )-";
     
-    m_programId = sCreateShaderProgram(vs, fs);
-    m_projectionUniform = glGetUniformLocation(m_programId, "projectionMatrix");
-    m_modelViewUniform = glGetUniformLocation(m_programId, "modelViewMatrix");
+    m_programId = programs.GetProgram(vs, fs);
     m_vertexAttribute = 0;
     m_colorAttribute = 1;
     
     // Generate
     glGenVertexArrays(1, &m_vaoId);
-    glGenBuffers(2, m_vboIds);
     
-    glBindVertexArray(m_vaoId);
+    // attribute pointers are set on every flush, the data lives in the shared stream buffer
+    m_state.BindVertexArray(m_vaoId);
     glEnableVertexAttribArray(m_vertexAttribute);
     glEnableVertexAttribArray(m_colorAttribute);
     
-    // Vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices), m_vertices, GL_DYNAMIC_DRAW);
-    
-    // Color buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[1]);
-    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, m_colorNormalized, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_colors), m_colors, GL_DYNAMIC_DRAW);
-    
     sCheckGLError();
     
-    // Cleanup
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
-    
     m_count = 0;
 }
 
@@ -360,27 +282,30 @@ RenderLinesOpenGL::~RenderLinesOpenGL()
     if (m_vaoId)
     {
         glDeleteVertexArrays(1, &m_vaoId);
-        glDeleteBuffers(2, m_vboIds);
         m_vaoId = 0;
     }
+}
+
+bool RenderLinesOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(count))
+        return false;
     
-    if (m_programId)
-    {
-        glDeleteProgram(m_programId);
-        m_programId = 0;
-    }
+    m_vertices.resize(GetBatchCapacity());
+    m_colors.resize(GetBatchCapacity());
+    return true;
 }
 
 void RenderLinesOpenGL::Draw(const Line *lines, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection)
 {
-    if (m_count == maxVertices || m_count + count > maxVertices)
-        Flush(modelView, projection);
-    
     const Line *it = lines;
     const Line *end = lines + count;
     
     for (; it != end; ++it)
     {
+        if (m_count + 2 > (int32)GetBatchCapacity() && !Grow(m_count + 2 * (end - it)) && !Grow(m_count + 2))
+            Flush(modelView, projection, FLUSH_FULL);
+        
         m_vertices[m_count] = it->begin;
         m_colors[m_count] = it->color;
         
@@ -393,45 +318,51 @@ void RenderLinesOpenGL::Draw(const Line *lines, std::size_t count, const glm::ma
     }
 }
 
-void RenderLinesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection)
+void RenderLinesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
 {
     if (m_count == 0)
         return;
     
-    glUseProgram(m_programId);
+    CountFlush(reason, m_count);
     
-    glUniformMatrix4fv(m_modelViewUniform, 1, GL_FALSE, glm::value_ptr(modelView));
-    glUniformMatrix4fv(m_projectionUniform, 1, GL_FALSE, glm::value_ptr(projection));
+    m_state.UseProgram(m_programId);
     
-    glBindVertexArray(m_vaoId);
+    m_state.SetMatrices(modelView, projection);
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(Vec2F), m_vertices);
+    m_state.BindVertexArray(m_vaoId);
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_count * sizeof(Color), m_colors);
+    std::size_t offset = m_vertexStream.Upload(m_vertices.data(), m_count * sizeof(Vec2F));
+    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
     
+    offset = m_vertexStream.Upload(m_colors.data(), m_count * sizeof(Color));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, m_colorNormalized, 0, BUFFER_OFFSET(offset));
+    
+    m_state.SetBlend(false);
     glDrawArrays(GL_LINES, 0, m_count);
     
     sCheckGLError();
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
-    
     m_count = 0;
 }
 
 //------------------------------------------------------------------------------------------------
 
-RenderSolidTrianglesOpenGL::RenderSolidTrianglesOpenGL(bool colorNormalized)
-    : m_colorNormalized(colorNormalized)
+RenderSolidTrianglesOpenGL::RenderSolidTrianglesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, bool colorNormalized, StreamBufferOpenGL& vertexStream)
+    : RenderBatch(e_initialVertices, DEFAULT_LIMIT, vertexStream.GetRegionSize() / sizeof(Vec2F))
+    , m_vertices(e_initialVertices)
+    , m_colors(e_initialVertices)
+    , m_state(state)
+    , m_vertexStream(vertexStream)
+    , m_colorNormalized(colorNormalized)
 {
     const char* vs = R"-(
         #version 330
     
-        uniform mat4 projectionMatrix;
-        uniform mat4 modelViewMatrix;
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
     
         layout(location = 0) in vec2 v_position;
         layout(location = 1) in vec4 v_color;
@@ -455,38 +386,21 @@ RenderSolidTrianglesOpenGL::RenderSolidTrianglesOpenGL(bool colorNormalized)
         }
       )-";
 
-    m_programId = sCreateShaderProgram(vs, fs);
-    m_projectionUniform = glGetUniformLocation(m_programId, "projectionMatrix");
-    m_modelViewUniform = glGetUniformLocation(m_programId, "modelViewMatrix");
+    m_programId = programs.GetProgram(vs, fs);
     m_vertexAttribute = 0;
     m_colorAttribute = 1;
     
-    glUseProgram(m_programId);
+    m_state.UseProgram(m_programId);
 
     // Generate
     glGenVertexArrays(1, &m_vaoId);
-    glGenBuffers(2, m_vboIds);
 
-    glBindVertexArray(m_vaoId);
+    // attribute pointers are set on every flush, the data lives in the shared stream buffer
+    m_state.BindVertexArray(m_vaoId);
     glEnableVertexAttribArray(m_vertexAttribute);
     glEnableVertexAttribArray(m_colorAttribute);
-
-    // Vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices), m_vertices, GL_DYNAMIC_DRAW);
-
-    // Color buffer
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[1]);
-    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, m_colorNormalized, 0, BUFFER_OFFSET(0));
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_colors), m_colors, GL_DYNAMIC_DRAW);
     
     sCheckGLError();
-
-    // Cleanup
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
     
     m_vertexCount = 0;
 }
@@ -496,68 +410,78 @@ RenderSolidTrianglesOpenGL::~RenderSolidTrianglesOpenGL()
     if (m_vaoId)
     {
         glDeleteVertexArrays(1, &m_vaoId);
-        glDeleteBuffers(2, m_vboIds);
         m_vaoId = 0;
     }
+}
 
-    if (m_programId)
-    {
-        glDeleteProgram(m_programId);
-        m_programId = 0;
-    }
+bool RenderSolidTrianglesOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(count))
+        return false;
+    
+    m_vertices.resize(GetBatchCapacity());
+    m_colors.resize(GetBatchCapacity());
+    return true;
 }
 
 void RenderSolidTrianglesOpenGL::Vertex(const Vec2F& v, Color color, const glm::mat4x4& modelView, const glm::mat4x4& projection)
 {
-    if (m_vertexCount == e_maxVertices)
-        Flush(modelView, projection);
+    if (m_vertexCount == (int32)GetBatchCapacity() && !Grow(m_vertexCount + 1))
+        Flush(modelView, projection, FLUSH_FULL);
 
     m_vertices[m_vertexCount] = v;
     m_colors[m_vertexCount] = color;
     ++m_vertexCount;
 }
 
-void RenderSolidTrianglesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection)
+void RenderSolidTrianglesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
 {
     if (m_vertexCount == 0)
         return;
     
-    glUseProgram(m_programId);
+    CountFlush(reason, m_vertexCount);
+    
+    m_state.UseProgram(m_programId);
     
-    glUniformMatrix4fv(m_modelViewUniform, 1, GL_FALSE, glm::value_ptr(modelView));
-    glUniformMatrix4fv(m_projectionUniform, 1, GL_FALSE, glm::value_ptr(projection));
+    m_state.SetMatrices(modelView, projection);
     
-    glBindVertexArray(m_vaoId);
+    m_state.BindVertexArray(m_vaoId);
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertexCount * sizeof(Vec2F), m_vertices);
+    std::size_t offset = m_vertexStream.Upload(m_vertices.data(), m_vertexCount * sizeof(Vec2F));
+    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, 0, BUFFER_OFFSET(offset));
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertexCount * sizeof(Color), m_colors);
+    offset = m_vertexStream.Upload(m_colors.data(), m_vertexCount * sizeof(Color));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, m_colorNormalized, 0, BUFFER_OFFSET(offset));
     
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    m_state.SetBlend(true);
+    m_state.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glDrawArrays(GL_TRIANGLES, 0, m_vertexCount);
-    glDisable(GL_BLEND);
     
     sCheckGLError();
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    glUseProgram(0);
-    
     m_vertexCount = 0;
 }
 
 //------------------------------------------------------------------------------------------------
 
-RenderTexturedTrianglesOpenGL::RenderTexturedTrianglesOpenGL()
+RenderTexturedTrianglesOpenGL::RenderTexturedTrianglesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& vertexStream, StreamBufferOpenGL& indexStream)
+    // 6 indices for every 4 vertices
+    : RenderBatch(e_initialVertices, DEFAULT_LIMIT,
+        std::min(vertexStream.GetRegionSize() / sizeof(Vertex), indexStream.GetRegionSize() / (3 * sizeof(GLuint)) * 2))
+    , m_vertices(e_initialVertices)
+    , m_indices(e_initialVertices / 2 * 3)
+    , m_state(state)
+    , m_vertexStream(vertexStream)
+    , m_indexStream(indexStream)
 {
     const char* vs = R"-(
         #version 330 core
     
-        uniform mat4 projectionMatrix;
-        uniform mat4 modelViewMatrix;
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
     
         layout (location = 0) in vec2 v_position;
         layout (location = 1) in vec4 v_color;
@@ -590,43 +514,23 @@ RenderTexturedTrianglesOpenGL::RenderTexturedTrianglesOpenGL()
         }
     )-";
 
-    m_programId = sCreateShaderProgram(vs, fs);
-    m_projectionUniform = glGetUniformLocation(m_programId, "projectionMatrix");
-    m_modelViewUniform = glGetUniformLocation(m_programId, "modelViewMatrix");
+    m_programId = programs.GetProgram(vs, fs);
     m_vertexAttribute = 0;
     m_colorAttribute = 1;
     m_uvAttribute = 2;
         
-    glUseProgram(m_programId);
+    m_state.UseProgram(m_programId);
 
     // Generate
     glGenVertexArrays(1, &m_vaoId);
-    glGenBuffers(2, m_vboIds);
 
-    glBindVertexArray(m_vaoId);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices), m_vertices, GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_indices), m_indices, GL_DYNAMIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)OffsetOf(&Vertex::x));
+    // attribute pointers are set on every flush, the data lives in the shared stream buffers
+    m_state.BindVertexArray(m_vaoId);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexStream.GetId());
     glEnableVertexAttribArray(m_vertexAttribute);
-    // Color attribute
-    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLvoid*)OffsetOf(&Vertex::color));
     glEnableVertexAttribArray(m_colorAttribute);
-    // TexCoord attribute
-    glVertexAttribPointer(m_uvAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)OffsetOf(&Vertex::u));
     glEnableVertexAttribArray(m_uvAttribute);
 
-    sCheckGLError();
-
-    // Cleanup
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
     sCheckGLError();
     
     m_vertexCount = 0;
@@ -638,15 +542,8 @@ RenderTexturedTrianglesOpenGL::~RenderTexturedTrianglesOpenGL()
     if (m_vaoId)
     {
         glDeleteVertexArrays(1, &m_vaoId);
-        glDeleteBuffers(2, m_vboIds);
         m_vaoId = 0;
     }
-
-    if (m_programId)
-    {
-        glDeleteProgram(m_programId);
-        m_programId = 0;
-    }
 }
 
 void RenderTexturedTrianglesOpenGL::SetMode(RenderMode mode)
@@ -670,26 +567,27 @@ void RenderTexturedTrianglesOpenGL::SetMode(RenderMode mode)
     }
 }
 
+bool RenderTexturedTrianglesOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(count))
+        return false;
+    
+    m_vertices.resize(GetBatchCapacity());
+    m_indices.resize(GetBatchCapacity() / 2 * 3);
+    return true;
+}
+
 Vertex* RenderTexturedTrianglesOpenGL::GetVertices(GlTexture texture, const glm::mat4x4& modelView, const glm::mat4x4& projection)
 {
     GLuint& index = reinterpret_cast<GLuint&>(texture.index);
     if (m_texture != index)
     {
-        Flush(modelView, projection);
+        Flush(modelView, projection, FLUSH_TEXTURE);
         m_texture = index;
-        
-        //TODO:: do I need this
-        glActiveTexture(GL_TEXTURE0);
-        sCheckGLError();
-
-        glBindTexture(GL_TEXTURE_2D, m_texture);
     }
     
-    if (m_vertexCount > e_maxVertices - 4)
-        Flush(modelView, projection);
-
-    if (m_vertexCount == e_maxVertices)
-        Flush(modelView, projection);
+    if (m_vertexCount + 4 > (int32)GetBatchCapacity() && !Grow(m_vertexCount + 4))
+        Flush(modelView, projection, FLUSH_FULL);
     
     Vertex* result = &m_vertices[m_vertexCount];
     
@@ -706,39 +604,35 @@ Vertex* RenderTexturedTrianglesOpenGL::GetVertices(GlTexture texture, const glm:
     return result;
 }
 
-void RenderTexturedTrianglesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection)
+void RenderTexturedTrianglesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
 {
     sCheckGLError();
     
     if (m_vertexCount == 0)
         return;
         
-    glUseProgram(m_programId);
-
-    //TODO:: need this?
-    glActiveTexture(GL_TEXTURE0);
-    
-    glUniformMatrix4fv(m_projectionUniform, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(m_modelViewUniform, 1, GL_FALSE, glm::value_ptr(modelView));
+    CountFlush(reason, m_vertexCount);
     
-    glEnable(GL_BLEND);
-    glBlendFunc(m_blendSFactor, m_blendDFactor);
-    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_FALSE);
+    m_state.UseProgram(m_programId);
+
+    // the sprites part binds its own textures to the same unit
+    m_state.BindTexture(GL_TEXTURE_2D, m_texture);
     
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertexCount * sizeof (Vertex), m_vertices);
+    m_state.SetMatrices(modelView, projection);
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, m_indexCount * sizeof(GLuint), m_indices);
+    m_state.SetBlend(true);
+    m_state.BlendFunc(m_blendSFactor, m_blendDFactor);
+    m_state.ColorMask(true, true, true, false);
     
-    glBindVertexArray(m_vaoId);
-    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    m_state.BindVertexArray(m_vaoId);
     
-    glDisable(GL_BLEND);
+    const std::size_t vertexOffset = m_vertexStream.Upload(m_vertices.data(), m_vertexCount * sizeof(Vertex));
+    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(vertexOffset + OffsetOf(&Vertex::x)));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), BUFFER_OFFSET(vertexOffset + OffsetOf(&Vertex::color)));
+    glVertexAttribPointer(m_uvAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(vertexOffset + OffsetOf(&Vertex::u)));
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glUseProgram(0);
+    const std::size_t indexOffset = m_indexStream.Upload(m_indices.data(), m_indexCount * sizeof(GLuint));
+    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(indexOffset));
     
     m_vertexCount = 0;
     m_indexCount = 0;
@@ -746,15 +640,46 @@ void RenderTexturedTrianglesOpenGL::Flush(const glm::mat4x4& modelView, const gl
     sCheckGLError();
 }
 
+void RenderTexturedTrianglesOpenGL::DrawElements(GLuint vaoId, GLuint texture, std::size_t firstIndex, std::size_t indexCount, const glm::mat4x4& modelView, const glm::mat4x4& projection)
+{
+    Flush(modelView, projection, FLUSH_ORDER);
+    
+    m_state.UseProgram(m_programId);
+    
+    m_state.BindTexture(GL_TEXTURE_2D, texture);
+    
+    m_state.SetMatrices(modelView, projection);
+    
+    m_state.SetBlend(true);
+    m_state.BlendFunc(m_blendSFactor, m_blendDFactor);
+    m_state.ColorMask(true, true, true, false);
+    
+    m_state.BindVertexArray(vaoId);
+    glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(firstIndex * sizeof(GLuint)));
+    
+    sCheckGLError();
+}
+
 //------------------------------------------------------------------------------------------------
 
-RenderFanOpenGL::RenderFanOpenGL()
+RenderFanOpenGL::RenderFanOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& vertexStream, StreamBufferOpenGL& indexStream)
+    // 3 indices for every vertex
+    : RenderBatch(e_initialVertices, DEFAULT_LIMIT,
+        std::min(vertexStream.GetRegionSize() / sizeof(Vertex), indexStream.GetRegionSize() / (3 * sizeof(GLuint))))
+    , m_vertices(e_initialVertices)
+    , m_indices(e_initialVertices * 3)
+    , m_state(state)
+    , m_vertexStream(vertexStream)
+    , m_indexStream(indexStream)
 {
     const char* vs = R"-(
         #version 330 core
     
-        uniform mat4 projectionMatrix;
-        uniform mat4 modelViewMatrix;
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
     
         layout (location = 0) in vec2 v_position;
         layout (location = 1) in vec4 v_color;
@@ -780,36 +705,20 @@ RenderFanOpenGL::RenderFanOpenGL()
         }
     )-";
 
-    m_programId = sCreateShaderProgram(vs, fs);
-    m_projectionUniform = glGetUniformLocation(m_programId, "projectionMatrix");
-    m_modelViewUniform = glGetUniformLocation(m_programId, "modelViewMatrix");
+    m_programId = programs.GetProgram(vs, fs);
     m_vertexAttribute = 0;
     m_colorAttribute = 1;
         
-    glUseProgram(m_programId);
+    m_state.UseProgram(m_programId);
 
     // Generate
     glGenVertexArrays(1, &m_vaoId);
-    glGenBuffers(2, m_vboIds);
 
-    glBindVertexArray(m_vaoId);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(m_vertices), m_vertices, GL_DYNAMIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m_indices), m_indices, GL_DYNAMIC_DRAW);
-    
-    // Position attribute
-    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)OffsetOf(&Vertex::x));
+    // attribute pointers are set on every flush, the data lives in the shared stream buffers
+    m_state.BindVertexArray(m_vaoId);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexStream.GetId());
     glEnableVertexAttribArray(m_vertexAttribute);
-    // Color attribute
-    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (GLvoid*)OffsetOf(&Vertex::color));
     glEnableVertexAttribArray(m_colorAttribute);
-
-    // Cleanup
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
     
     sCheckGLError();
     
@@ -822,26 +731,26 @@ RenderFanOpenGL::~RenderFanOpenGL()
     if (m_vaoId)
     {
         glDeleteVertexArrays(1, &m_vaoId);
-        glDeleteBuffers(2, m_vboIds);
         m_vaoId = 0;
     }
+}
 
-    if (m_programId)
-    {
-        glDeleteProgram(m_programId);
-        m_programId = 0;
-    }
+bool RenderFanOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(count))
+        return false;
+    
+    m_vertices.resize(GetBatchCapacity());
+    m_indices.resize(GetBatchCapacity() * 3);
+    return true;
 }
 
 Vertex* RenderFanOpenGL::GetVertices(std::size_t nEdges, const glm::mat4x4& modelView, const glm::mat4x4& projection)
 {
-    assert(nEdges * 3 < e_maxVertices * 3);
+    assert(nEdges + 1 <= e_initialVertices);
 
-    if (m_vertexCount + nEdges + 1 > e_maxVertices ||
-        m_indexCount + nEdges * 3 > e_maxVertices * 3)
-    {
-        Flush(modelView, projection);
-    }
+    if (m_vertexCount + nEdges + 1 > GetBatchCapacity() && !Grow(m_vertexCount + nEdges + 1))
+        Flush(modelView, projection, FLUSH_FULL);
 
     Vertex *result = &m_vertices[m_vertexCount];
 
@@ -859,35 +768,30 @@ Vertex* RenderFanOpenGL::GetVertices(std::size_t nEdges, const glm::mat4x4& mode
     return result;
 }
 
-void RenderFanOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection)
+void RenderFanOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
 {
     sCheckGLError();
     
     if (m_vertexCount == 0)
         return;
             
-    glUseProgram(m_programId);
-    
-    glUniformMatrix4fv(m_projectionUniform, 1, GL_FALSE, glm::value_ptr(projection));
-    glUniformMatrix4fv(m_modelViewUniform, 1, GL_FALSE, glm::value_ptr(modelView));
+    CountFlush(reason, m_vertexCount);
     
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_vboIds[0]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertexCount * sizeof (Vertex), m_vertices);
+    m_state.UseProgram(m_programId);
     
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_vboIds[1]);
-    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, m_indexCount * sizeof(GLuint), m_indices);
+    m_state.SetMatrices(modelView, projection);
     
-    glBindVertexArray(m_vaoId);
-    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    m_state.SetBlend(true);
+    m_state.BlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+    m_state.BindVertexArray(m_vaoId);
     
-    glDisable(GL_BLEND);
+    const std::size_t vertexOffset = m_vertexStream.Upload(m_vertices.data(), m_vertexCount * sizeof(Vertex));
+    glVertexAttribPointer(m_vertexAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(vertexOffset + OffsetOf(&Vertex::x)));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), BUFFER_OFFSET(vertexOffset + OffsetOf(&Vertex::color)));
     
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glUseProgram(0);
+    const std::size_t indexOffset = m_indexStream.Upload(m_indices.data(), m_indexCount * sizeof(GLuint));
+    glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(indexOffset));
     
     m_vertexCount = 0;
     m_indexCount = 0;
@@ -895,4 +799,527 @@ void RenderFanOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& pro
     sCheckGLError();
 }
 
+void RenderFanOpenGL::DrawElements(GLuint vaoId, std::size_t firstIndex, std::size_t indexCount, const glm::mat4x4& modelView, const glm::mat4x4& projection)
+{
+    Flush(modelView, projection, FLUSH_ORDER);
+    
+    m_state.UseProgram(m_programId);
+    
+    m_state.SetMatrices(modelView, projection);
+    
+    m_state.SetBlend(true);
+    m_state.BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    
+    m_state.BindVertexArray(vaoId);
+    glDrawElements(GL_TRIANGLES, (GLsizei)indexCount, GL_UNSIGNED_INT, BUFFER_OFFSET(firstIndex * sizeof(GLuint)));
+    
+    sCheckGLError();
+}
+
+//------------------------------------------------------------------------------------------------
+
+RenderSpritesOpenGL::RenderSpritesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& instanceStream)
+    : RenderBatch(e_initialSprites, DEFAULT_LIMIT, instanceStream.GetRegionSize() / sizeof(SpriteInstance))
+    , m_sprites(e_initialSprites)
+    , m_state(state)
+    , m_instanceStream(instanceStream)
+{
+    // one instance per sprite, the quad corners come from gl_VertexID of a 4 vertex strip
+    // and the uv from the frames table, two texels per frame: uv rect, pivot
+    const char* vs = R"-(
+        #version 330 core
+    
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
+        uniform samplerBuffer Frames;
+    
+        layout (location = 0) in vec2 i_position;
+        layout (location = 1) in vec2 i_size;
+        layout (location = 2) in vec2 i_dir;
+        layout (location = 3) in uint i_frame;
+        layout (location = 4) in vec4 i_color;
+
+        out vec4 f_color;
+        out vec2 f_texCoord;
+
+        void main()
+        {
+            vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+            vec4 uv = texelFetch(Frames, int(i_frame) * 2);
+            vec2 pivot = texelFetch(Frames, int(i_frame) * 2 + 1).xy;
+
+            vec2 local = (corner - pivot) * i_size;
+            vec2 position = i_position + vec2(local.x * i_dir.x - local.y * i_dir.y, local.x * i_dir.y + local.y * i_dir.x);
+
+            gl_Position = projectionMatrix * modelViewMatrix * vec4(position, 0.0f, 1.0f);
+            f_color = i_color;
+            f_texCoord = mix(uv.xy, uv.zw, corner);
+        }
+    )-";
+        
+    const char* fs = R"-(
+        #version 330 core
+    
+        in vec4 f_color;
+        in vec2 f_texCoord;
+
+        out vec4 color;
+
+        uniform sampler2D Texture;
+
+        void main()
+        {
+           color = texture(Texture, f_texCoord) * f_color;
+        }
+    )-";
+
+    m_programId = programs.GetProgram(vs, fs);
+    m_positionAttribute = 0;
+    m_sizeAttribute = 1;
+    m_dirAttribute = 2;
+    m_frameAttribute = 3;
+    m_colorAttribute = 4;
+        
+    m_state.UseProgram(m_programId);
+    glUniform1i(glGetUniformLocation(m_programId, "Texture"), 0);
+    glUniform1i(glGetUniformLocation(m_programId, "Frames"), 1);
+
+    glGenBuffers(1, &m_framesBuffer);
+    glGenTextures(1, &m_framesTexture);
+
+    // Generate
+    glGenVertexArrays(1, &m_vaoId);
+
+    // attribute pointers are set on every flush, the data lives in the shared stream buffer
+    m_state.BindVertexArray(m_vaoId);
+    for (GLint attribute : { m_positionAttribute, m_sizeAttribute, m_dirAttribute, m_frameAttribute, m_colorAttribute })
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+
+    sCheckGLError();
+    
+    m_spriteCount = 0;
+}
+
+RenderSpritesOpenGL::~RenderSpritesOpenGL()
+{
+    if (m_vaoId)
+    {
+        glDeleteVertexArrays(1, &m_vaoId);
+        m_vaoId = 0;
+    }
+
+    if (m_framesTexture)
+    {
+        glDeleteTextures(1, &m_framesTexture);
+        m_framesTexture = 0;
+    }
+
+    if (m_framesBuffer)
+    {
+        glDeleteBuffers(1, &m_framesBuffer);
+        m_framesBuffer = 0;
+    }
+}
+
+void RenderSpritesOpenGL::SetMode(RenderMode mode)
+{
+    switch (mode)
+    {
+    case LIGHT:
+        break;
+
+    case WORLD:
+        m_blendSFactor = GL_DST_ALPHA;
+        m_blendDFactor = GL_ONE_MINUS_SRC_ALPHA;
+        break;
+
+    case INTERFACE:
+        m_blendSFactor = GL_ONE;
+        m_blendDFactor = GL_ONE_MINUS_SRC_ALPHA;
+        break;
+    default:
+        assert(false);
+    }
+}
+
+void RenderSpritesOpenGL::SetFrames(const SpriteFrame* frames, std::size_t count)
+{
+    assert(m_spriteCount == 0);
+
+    std::vector<GLfloat> texels;
+    texels.reserve(count * 8);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const SpriteFrame& frame = frames[i];
+        texels.insert(texels.end(), { frame.uv.left, frame.uv.top, frame.uv.right, frame.uv.bottom, frame.pivot.x, frame.pivot.y, 0, 0 });
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, m_framesBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(GLfloat), texels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    m_state.BindTexture(GL_TEXTURE_BUFFER, m_framesTexture, 1);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, m_framesBuffer);
+
+    sCheckGLError();
+}
+
+bool RenderSpritesOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(std::min(count, GetBatchLimit())) || GetBatchCapacity() == m_sprites.size())
+        return false;
+    
+    m_sprites.resize(GetBatchCapacity());
+    return true;
+}
+
+void RenderSpritesOpenGL::Draw(GlTexture texture, const SpriteInstance* sprites, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection)
+{
+    GLuint& index = reinterpret_cast<GLuint&>(texture.index);
+    if (m_texture != index)
+    {
+        Flush(modelView, projection, FLUSH_TEXTURE);
+        m_texture = index;
+    }
+
+    while (count)
+    {
+        if (m_spriteCount + count > GetBatchCapacity() && !Grow(m_spriteCount + count) && m_spriteCount == (int32)GetBatchCapacity())
+            Flush(modelView, projection, FLUSH_FULL);
+
+        const std::size_t chunk = std::min(count, GetBatchCapacity() - m_spriteCount);
+        memcpy(&m_sprites[m_spriteCount], sprites, chunk * sizeof(SpriteInstance));
+
+        m_spriteCount += (int32)chunk;
+        sprites += chunk;
+        count -= chunk;
+    }
+}
+
+void RenderSpritesOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
+{
+    sCheckGLError();
+    
+    if (m_spriteCount == 0)
+        return;
+        
+    CountFlush(reason, m_spriteCount);
+    
+    m_state.UseProgram(m_programId);
+
+    m_state.SetMatrices(modelView, projection);
+    
+    m_state.BindTexture(GL_TEXTURE_BUFFER, m_framesTexture, 1);
+    m_state.BindTexture(GL_TEXTURE_2D, m_texture, 0);
+    
+    m_state.SetBlend(true);
+    m_state.BlendFunc(m_blendSFactor, m_blendDFactor);
+    m_state.ColorMask(true, true, true, false);
+    
+    m_state.BindVertexArray(m_vaoId);
+    
+    const std::size_t offset = m_instanceStream.Upload(m_sprites.data(), m_spriteCount * sizeof(SpriteInstance));
+    glVertexAttribPointer(m_positionAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + OffsetOf(&SpriteInstance::x)));
+    glVertexAttribPointer(m_sizeAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + OffsetOf(&SpriteInstance::width)));
+    glVertexAttribPointer(m_dirAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + OffsetOf(&SpriteInstance::dirX)));
+    glVertexAttribIPointer(m_frameAttribute, 1, GL_UNSIGNED_INT, sizeof(SpriteInstance), BUFFER_OFFSET(offset + OffsetOf(&SpriteInstance::frame)));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteInstance), BUFFER_OFFSET(offset + OffsetOf(&SpriteInstance::color)));
+    
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_spriteCount);
+    
+    m_spriteCount = 0;
+    
+    sCheckGLError();
+}
+
+//------------------------------------------------------------------------------------------------
+
+RenderLightsOpenGL::RenderLightsOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& instanceStream)
+    : RenderBatch(e_initialLights, DEFAULT_LIMIT, instanceStream.GetRegionSize() / sizeof(LightInstance))
+    , m_lights(e_initialLights)
+    , m_state(state)
+    , m_instanceStream(instanceStream)
+{
+    // one instance per light drawn as the 32 triangles of a fan around the unit ring, the lights
+    // of fewer edges take every step-th ring vertex and collapse the triangles in between
+    const char* vs = R"-(
+        #version 330 core
+    
+        layout (std140) uniform Matrices
+        {
+            mat4 projectionMatrix;
+            mat4 modelViewMatrix;
+        };
+        uniform vec2 Ring[32];
+    
+        layout (location = 0) in vec2 i_position;
+        layout (location = 1) in vec2 i_dir;
+        layout (location = 2) in vec3 i_shape;
+        layout (location = 3) in uint i_edges;
+        layout (location = 4) in vec4 i_color;
+
+        out vec4 f_color;
+
+        void main()
+        {
+            int triangle = gl_VertexID / 3;
+            int corner = gl_VertexID - triangle * 3;
+            int step = 32 / int(i_edges);
+
+            vec2 position = i_position;
+            f_color = i_color;
+            if (corner != 0 && triangle % step == 0)
+            {
+                // radius, aspect and offset of the ring
+                vec2 ring = Ring[(triangle + (corner - 1) * step) & 31];
+                float x = i_shape.z + i_shape.x * ring.x;
+                float y = i_shape.x * ring.y * i_shape.y;
+                position += vec2(x * i_dir.x - y * i_dir.y, y * i_dir.x + x * i_dir.y);
+                f_color = vec4(0.0f);
+            }
+
+            gl_Position = projectionMatrix * modelViewMatrix * vec4(position, 0.0f, 1.0f);
+        }
+    )-";
+        
+    const char* fs = R"-(
+        #version 330 core
+    
+        in vec4 f_color;
+        out vec4 color;
+
+        void main()
+        {
+           color = f_color;
+        }
+    )-";
+
+    m_programId = programs.GetProgram(vs, fs);
+    m_positionAttribute = 0;
+    m_dirAttribute = 1;
+    m_shapeAttribute = 2;
+    m_edgesAttribute = 3;
+    m_colorAttribute = 4;
+    
+    // cos, sin of the ring vertices, the same table the fans of DrawingContext are made of
+    GLfloat ring[LIGHT_RING_SIZE * 2];
+    for (int i = 0; i < LIGHT_RING_SIZE; ++i)
+    {
+        ring[i * 2] = LightSinTable[(i + LIGHT_RING_SIZE / 4) % LIGHT_RING_SIZE];
+        ring[i * 2 + 1] = LightSinTable[i];
+    }
+        
+    m_state.UseProgram(m_programId);
+    glUniform2fv(glGetUniformLocation(m_programId, "Ring"), LIGHT_RING_SIZE, ring);
+
+    // Generate
+    glGenVertexArrays(1, &m_vaoId);
+
+    // attribute pointers are set on every flush, the data lives in the shared stream buffer
+    m_state.BindVertexArray(m_vaoId);
+    for (GLint attribute : { m_positionAttribute, m_dirAttribute, m_shapeAttribute, m_edgesAttribute, m_colorAttribute })
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribDivisor(attribute, 1);
+    }
+    
+    sCheckGLError();
+    
+    m_lightCount = 0;
+}
+
+RenderLightsOpenGL::~RenderLightsOpenGL()
+{
+    if (m_vaoId)
+    {
+        glDeleteVertexArrays(1, &m_vaoId);
+        m_vaoId = 0;
+    }
+}
+
+bool RenderLightsOpenGL::Grow(std::size_t count)
+{
+    if (!GrowBatch(std::min(count, GetBatchLimit())) || GetBatchCapacity() == m_lights.size())
+        return false;
+    
+    m_lights.resize(GetBatchCapacity());
+    return true;
+}
+
+void RenderLightsOpenGL::Draw(const LightInstance* lights, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection)
+{
+    while (count)
+    {
+        if (m_lightCount + count > GetBatchCapacity() && !Grow(m_lightCount + count) && m_lightCount == (int32)GetBatchCapacity())
+            Flush(modelView, projection, FLUSH_FULL);
+
+        const std::size_t chunk = std::min(count, GetBatchCapacity() - m_lightCount);
+        for (std::size_t i = 0; i < chunk; ++i)
+            assert(lights[i].edges && LIGHT_RING_SIZE % lights[i].edges == 0);
+        memcpy(&m_lights[m_lightCount], lights, chunk * sizeof(LightInstance));
+
+        m_lightCount += (int32)chunk;
+        lights += chunk;
+        count -= chunk;
+    }
+}
+
+void RenderLightsOpenGL::Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason)
+{
+    sCheckGLError();
+    
+    if (m_lightCount == 0)
+        return;
+        
+    CountFlush(reason, m_lightCount);
+    
+    m_state.UseProgram(m_programId);
+
+    m_state.SetMatrices(modelView, projection);
+    
+    // the blending of the fans
+    m_state.SetBlend(true);
+    m_state.BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    
+    m_state.BindVertexArray(m_vaoId);
+    
+    const std::size_t offset = m_instanceStream.Upload(m_lights.data(), m_lightCount * sizeof(LightInstance));
+    glVertexAttribPointer(m_positionAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(LightInstance), BUFFER_OFFSET(offset + OffsetOf(&LightInstance::x)));
+    glVertexAttribPointer(m_dirAttribute, 2, GL_FLOAT, GL_FALSE, sizeof(LightInstance), BUFFER_OFFSET(offset + OffsetOf(&LightInstance::dirX)));
+    glVertexAttribPointer(m_shapeAttribute, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance), BUFFER_OFFSET(offset + OffsetOf(&LightInstance::radius)));
+    glVertexAttribIPointer(m_edgesAttribute, 1, GL_UNSIGNED_INT, sizeof(LightInstance), BUFFER_OFFSET(offset + OffsetOf(&LightInstance::edges)));
+    glVertexAttribPointer(m_colorAttribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LightInstance), BUFFER_OFFSET(offset + OffsetOf(&LightInstance::color)));
+    
+    glDrawArraysInstanced(GL_TRIANGLES, 0, LIGHT_RING_SIZE * 3, m_lightCount);
+    
+    m_lightCount = 0;
+    
+    sCheckGLError();
+}
+
+//------------------------------------------------------------------------------------------------
+
+LightTargetOpenGL::LightTargetOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs)
+    : m_state(state)
+{
+    const char* vs = R"-(
+        #version 330 core
+
+        void main()
+        {
+            gl_Position = vec4(float((gl_VertexID & 1) * 4 - 1), float((gl_VertexID >> 1) * 4 - 1), 0.0f, 1.0f);
+        }
+    )-";
+        
+    // Offset and Scale map the window pixels to the texture, its top row is at the window's top
+    const char* fs = R"-(
+        #version 330 core
+    
+        uniform sampler2D Light;
+        uniform vec2 Offset;
+        uniform vec2 Scale;
+
+        out vec4 color;
+
+        void main()
+        {
+           color = vec4(0.0f, 0.0f, 0.0f, texture(Light, (gl_FragCoord.xy + Offset) * Scale).a);
+        }
+    )-";
+
+    m_programId = programs.GetProgram(vs, fs);
+    m_offsetUniform = glGetUniformLocation(m_programId, "Offset");
+    m_scaleUniform = glGetUniformLocation(m_programId, "Scale");
+    
+    m_state.UseProgram(m_programId);
+    glUniform1i(glGetUniformLocation(m_programId, "Light"), 0);
+    
+    glGenVertexArrays(1, &m_vaoId);
+    glGenFramebuffers(1, &m_framebuffer);
+    glGenTextures(1, &m_texture);
+    
+    m_state.BindTexture(GL_TEXTURE_2D, m_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    sCheckGLError();
+}
+
+LightTargetOpenGL::~LightTargetOpenGL()
+{
+    glDeleteFramebuffers(1, &m_framebuffer);
+    m_state.ForgetTexture(m_texture);
+    glDeleteTextures(1, &m_texture);
+    glDeleteVertexArrays(1, &m_vaoId);
+}
+
+void LightTargetOpenGL::Resize(int windowWidth, int windowHeight, int divisor)
+{
+    assert(divisor > 0);
+    
+    const int width = (windowWidth + divisor - 1) / divisor;
+    const int height = (windowHeight + divisor - 1) / divisor;
+    m_divisor = divisor;
+    if (width == m_width && height == m_height)
+        return;
+    
+    m_width = width;
+    m_height = height;
+    if (!width || !height)
+        return;
+    
+    m_state.BindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+    assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    sCheckGLError();
+}
+
+void LightTargetOpenGL::Bind(float ambient)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glViewport(0, 0, m_width, m_height);
+    
+    glDisable(GL_SCISSOR_TEST);
+    m_state.ColorMask(true, true, true, true);
+    glClearColor(0, 0, 0, ambient);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void LightTargetOpenGL::Composite(int windowWidth, int windowHeight)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    
+    glDisable(GL_SCISSOR_TEST);
+    m_state.SetBlend(false);
+    m_state.ColorMask(false, false, false, true);
+    
+    // the texture reaches below the window bottom by up to divisor - 1 pixels
+    m_state.UseProgram(m_programId);
+    glUniform2f(m_offsetUniform, 0.0f, (GLfloat)(m_height * m_divisor - windowHeight));
+    glUniform2f(m_scaleUniform, 1.0f / (m_width * m_divisor), 1.0f / (m_height * m_divisor));
+    
+    m_state.BindTexture(GL_TEXTURE_2D, m_texture);
+    
+    m_state.BindVertexArray(m_vaoId);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    
+    m_state.ColorMask(true, true, true, true);
+    
+    sCheckGLError();
+}
+
 //------------------------------------------------------------------------------------------------
@@ -9,34 +9,43 @@
 #include "Line.h"
 #include "Vertex.h"
 #include "ColoredVertex.h"
+#include "SpriteInstance.h"
+#include "LightInstance.h"
+#include "StreamBufferOpenGL.h"
+#include "StateCacheOpenGL.h"
+#include "ProgramCacheOpenGL.h"
+#include "RenderBatch.h"
 #include "math/Vect2D.h"
 
+#include <vector>
 
-class RenderPointsOpenGL : public IRenderPoints
+
+class RenderPointsOpenGL : public IRenderPoints, public RenderBatch
 {
 public:
-    RenderPointsOpenGL(bool colorNormalized);
+    RenderPointsOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, bool colorNormalized, StreamBufferOpenGL& vertexStream);
     ~RenderPointsOpenGL();
     
     void Draw(Point point, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
-    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
 private:
-    enum { maxVertices = 512 };
-    Vec2F m_vertices[maxVertices];
-    Color m_colors[maxVertices];
-    float32 m_sizes[maxVertices];
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
+    
+    enum { initialVertices = 512 };
+    std::vector<Vec2F> m_vertices;
+    std::vector<Color> m_colors;
+    std::vector<float32> m_sizes;
     
     int32 m_count = 0;
     
+    StateCacheOpenGL& m_state;
     GLuint m_vaoId = 0;
-    GLuint m_vboIds[3] { };
+    StreamBufferOpenGL& m_vertexStream;
     GLuint m_programId = 0;
     
     GLboolean m_colorNormalized = GL_FALSE;
     
-    GLint m_projectionUniform = 0;
-    GLint m_modelViewUniform = 0;
-    
     GLint m_vertexAttribute = 0;
     GLint m_colorAttribute = 0;
     GLint m_sizeAttribute = 0;
@@ -44,97 +53,103 @@ private:
 
 //------------------------------------------------------------------------------------------------
 
-class RenderLinesOpenGL : public IRenderLines
+class RenderLinesOpenGL : public IRenderLines, public RenderBatch
 {
 public:
-    RenderLinesOpenGL(bool colorNormalized);
+    RenderLinesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, bool colorNormalized, StreamBufferOpenGL& vertexStream);
     ~RenderLinesOpenGL();
     
     void Draw(const Line *lines, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
-    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
 private:
-    enum { maxVertices = 2 * 512 };
-    Vec2F m_vertices[maxVertices];
-    Color m_colors[maxVertices];
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
+    
+    enum { initialVertices = 2 * 512 };
+    std::vector<Vec2F> m_vertices;
+    std::vector<Color> m_colors;
     
     int32 m_count = 0;
     
+    StateCacheOpenGL& m_state;
     GLuint m_vaoId = 0;
-    GLuint m_vboIds[2] { };
+    StreamBufferOpenGL& m_vertexStream;
     GLuint m_programId = 0;
 
     GLboolean m_colorNormalized = GL_FALSE;
     
-    GLint m_projectionUniform = 0;
-    GLint m_modelViewUniform = 0;
-    
     GLint m_vertexAttribute = 0;
     GLint m_colorAttribute = 0;
 };
 
 //------------------------------------------------------------------------------------------------
 
-class RenderSolidTrianglesOpenGL : public IRenderSolidTriangles
+class RenderSolidTrianglesOpenGL : public IRenderSolidTriangles, public RenderBatch
 {
 public:
-    RenderSolidTrianglesOpenGL(bool colorNormalized);
+    RenderSolidTrianglesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, bool colorNormalized, StreamBufferOpenGL& vertexStream);
     ~RenderSolidTrianglesOpenGL();
     
     void Vertex(const Vec2F& v, Color color, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
-    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
 private:
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
     
-    enum { e_maxVertices = 3 * 512 };
-    Vec2F m_vertices[e_maxVertices];
-    Color m_colors[e_maxVertices];
+    enum { e_initialVertices = 3 * 512 };
+    std::vector<Vec2F> m_vertices;
+    std::vector<Color> m_colors;
 
     int32 m_vertexCount = 0;
 
+    StateCacheOpenGL& m_state;
     GLuint m_vaoId = 0;
-    GLuint m_vboIds[2] { };
+    StreamBufferOpenGL& m_vertexStream;
     GLuint m_programId = 0;
     
     GLboolean m_colorNormalized = GL_FALSE;
     
-    GLint m_projectionUniform = 0;
-    GLint m_modelViewUniform = 0;
-    
     GLint m_vertexAttribute = 0;
     GLint m_colorAttribute = 0;
 };
 
 //------------------------------------------------------------------------------------------------
 
-class RenderTexturedTrianglesOpenGL : public IRenderTexturedTriangles
+class RenderTexturedTrianglesOpenGL : public IRenderTexturedTriangles, public RenderBatch
 {
 public:
-    RenderTexturedTrianglesOpenGL();
+    RenderTexturedTrianglesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& vertexStream, StreamBufferOpenGL& indexStream);
     ~RenderTexturedTrianglesOpenGL();
     
     void SetMode(RenderMode mode) override;
     
     Vertex* GetFanVertices(std::size_t nEdges);
     Vertex* GetVertices(GlTexture texture, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
-    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
+    
+    // draws indices of a vertex array with the Vertex layout right away, after flushing own geometry
+    void DrawElements(GLuint vaoId, GLuint texture, std::size_t firstIndex, std::size_t indexCount, const glm::mat4x4& modelView, const glm::mat4x4& projection);
 private:
-    enum { e_maxVertices = 3 * 512 };
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
+    
+    enum { e_initialVertices = 3 * 512 };
     
     GLenum m_blendSFactor = GL_ONE;
     GLenum m_blendDFactor = GL_ZERO;
 
-    Vertex m_vertices[e_maxVertices];
-    GLuint m_indices[e_maxVertices * 3];
+    std::vector<Vertex> m_vertices;
+    std::vector<GLuint> m_indices;      // 6 for every 4 vertices
 
     int32 m_vertexCount = 0;
     int32 m_indexCount = 0;
 
+    StateCacheOpenGL& m_state;
     GLuint m_vaoId = 0;
-    GLuint m_vboIds[2] { };
+    StreamBufferOpenGL& m_vertexStream;
+    StreamBufferOpenGL& m_indexStream;
     GLuint m_programId = 0;
         
-    GLint m_projectionUniform = 0;
-    GLint m_modelViewUniform = 0;
-    
     GLint m_vertexAttribute = 0;
     GLint m_colorAttribute = 0;
     GLint m_uvAttribute = 0;
@@ -144,30 +159,148 @@ private:
 
 //------------------------------------------------------------------------------------------------
 
-class RenderFanOpenGL : public IRenderFan
+class RenderFanOpenGL : public IRenderFan, public RenderBatch
 {
 public:
-    RenderFanOpenGL();
+    RenderFanOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& vertexStream, StreamBufferOpenGL& indexStream);
     ~RenderFanOpenGL();
     
     Vertex* GetVertices(std::size_t nEdges, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
-    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
+    
+    void DrawElements(GLuint vaoId, std::size_t firstIndex, std::size_t indexCount, const glm::mat4x4& modelView, const glm::mat4x4& projection);
 private:
-    enum { e_maxVertices = 3 * 512 };
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
+    
+    enum { e_initialVertices = 3 * 512 };
 
-    Vertex m_vertices[e_maxVertices];
-    GLuint m_indices[e_maxVertices * 3];
+    std::vector<Vertex> m_vertices;
+    std::vector<GLuint> m_indices;      // 3 for every vertex, a fan has less
 
     int32 m_vertexCount = 0;
     int32 m_indexCount = 0;
 
+    StateCacheOpenGL& m_state;
     GLuint m_vaoId = 0;
-    GLuint m_vboIds[2] { };
+    StreamBufferOpenGL& m_vertexStream;
+    StreamBufferOpenGL& m_indexStream;
     GLuint m_programId = 0;
         
-    GLint m_projectionUniform = 0;
-    GLint m_modelViewUniform = 0;
-    
     GLint m_vertexAttribute = 0;
     GLint m_colorAttribute = 0;
 };
+
+//------------------------------------------------------------------------------------------------
+
+class RenderSpritesOpenGL : public IRenderSprites, public RenderBatch
+{
+public:
+    RenderSpritesOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& instanceStream);
+    ~RenderSpritesOpenGL();
+    
+    void SetMode(RenderMode mode) override;
+    
+    void SetFrames(const SpriteFrame* frames, std::size_t count) override;
+    void Draw(GlTexture texture, const SpriteInstance* sprites, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
+private:
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
+    
+    enum { e_initialSprites = 4096 };
+    
+    GLenum m_blendSFactor = GL_ONE;
+    GLenum m_blendDFactor = GL_ZERO;
+
+    std::vector<SpriteInstance> m_sprites;
+
+    int32 m_spriteCount = 0;
+
+    StateCacheOpenGL& m_state;
+    GLuint m_vaoId = 0;
+    StreamBufferOpenGL& m_instanceStream;
+    GLuint m_programId = 0;
+    
+    GLuint m_framesBuffer = 0;      // texture buffer with the sprite frames table
+    GLuint m_framesTexture = 0;
+        
+    GLint m_positionAttribute = 0;
+    GLint m_sizeAttribute = 0;
+    GLint m_dirAttribute = 0;
+    GLint m_frameAttribute = 0;
+    GLint m_colorAttribute = 0;
+    
+    GLuint m_texture = 0;
+};
+
+//------------------------------------------------------------------------------------------------
+
+class RenderLightsOpenGL : public IRenderLights, public RenderBatch
+{
+public:
+    RenderLightsOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs, StreamBufferOpenGL& instanceStream);
+    ~RenderLightsOpenGL();
+    
+    void Draw(const LightInstance* lights, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection) override;
+    void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) override;
+private:
+    // resizes the arrays to a capacity grown for 'count' elements, false at the limit
+    bool Grow(std::size_t count);
+    
+    enum { e_initialLights = 4096 };
+
+    std::vector<LightInstance> m_lights;
+
+    int32 m_lightCount = 0;
+
+    StateCacheOpenGL& m_state;
+    GLuint m_vaoId = 0;
+    StreamBufferOpenGL& m_instanceStream;
+    GLuint m_programId = 0;
+        
+    GLint m_positionAttribute = 0;
+    GLint m_dirAttribute = 0;
+    GLint m_shapeAttribute = 0;
+    GLint m_edgesAttribute = 0;
+    GLint m_colorAttribute = 0;
+};
+
+//------------------------------------------------------------------------------------------------
+
+// Offscreen buffer the LIGHT mode draws to at a fraction of the window resolution. It covers the
+// window from the left top corner, a texel is divisor x divisor pixels. The lights accumulate in
+// its alpha like they do in the window and Composite puts the result into the window's alpha.
+class LightTargetOpenGL
+{
+public:
+    LightTargetOpenGL(StateCacheOpenGL& state, ProgramCacheOpenGL& programs);
+    ~LightTargetOpenGL();
+    
+    void Resize(int windowWidth, int windowHeight, int divisor);
+    
+    int GetWidth() const { return m_width; }
+    int GetHeight() const { return m_height; }
+    int GetDivisor() const { return m_divisor; }
+    
+    // binds the buffer with the viewport on all of it and clears it to the ambient light
+    void Bind(float ambient);
+    
+    // binds the window back and replaces its alpha with the filtered light, the viewport
+    // and the scissor are left for the caller to restore
+    void Composite(int windowWidth, int windowHeight);
+private:
+    GLuint m_framebuffer = 0;
+    GLuint m_texture = 0;
+    
+    StateCacheOpenGL& m_state;
+    GLuint m_vaoId = 0;             // empty, the fullscreen triangle comes from gl_VertexID
+    GLuint m_programId = 0;
+    
+    GLint m_offsetUniform = 0;
+    GLint m_scaleUniform = 0;
+    
+    int m_width = 0;
+    int m_height = 0;
+    int m_divisor = 1;
+};
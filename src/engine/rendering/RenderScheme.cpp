@@ -1,6 +1,12 @@
 #include "RenderScheme.h"
 #include "IDrawable.h"
+#include "DrawingContext.h"
+#include "RenderCommandBuffer.h"
+#include "base/IRender.h"
+#include "threading/ThreadPool.h"
+#include "profiling/Profiler.h"
 
+#include <algorithm>
 #include <cassert>
 
 RenderScheme::RenderScheme(int firstLayer, int lastLayer)
@@ -9,32 +15,296 @@ RenderScheme::RenderScheme(int firstLayer, int lastLayer)
 {
 	assert(firstLayer < lastLayer);
 
-	m_drawables = new std::set<const IDrawable*>[lastLayer - firstLayer];
+	m_layers.resize(lastLayer - firstLayer);
 }
 
-RenderScheme::~RenderScheme()
+RenderScheme::~RenderScheme() = default;
+
+void RenderScheme::RegisterDrawable(const IDrawable* drawable)
 {
-	delete[] m_drawables;
+	const int index = drawable->GetOrder() - m_firstLayer;
+	assert(index >= 0 && index < (int)m_layers.size());
+
+	const uint64_t key = m_nextKey++;
+	bool inserted = m_keys.emplace(drawable, key).second;
+	assert(inserted);
+	(void)inserted;
+
+	m_pending.push_back(PendingChange{ drawable, index, key, true });
 }
 
-void RenderScheme::RegisterDrawable(const IDrawable* drawable)
+void RenderScheme::UnegisterDrawable(const IDrawable* drawable)
+{
+	auto found = m_keys.find(drawable);
+	assert(found != m_keys.end());
+
+	// the drawable may be gone by the time the change is applied, the layer is taken now
+	m_pending.push_back(PendingChange{ drawable, drawable->GetOrder() - m_firstLayer, found->second, false });
+	m_keys.erase(found);
+}
+
+void RenderScheme::UpdateBounds(const IDrawable* drawable)
+{
+	// not applied yet drawables read their bounds when they are
+	const int index = drawable->GetOrder() - m_firstLayer;
+	SpatialGrid& grid = m_layers[index].grid;
+	if (!grid.Contains(drawable))
+		return;
+
+	RectFloat bounds;
+	grid.Update(drawable, drawable->GetBounds(bounds) ? &bounds : nullptr);
+}
+
+void RenderScheme::ApplyPendingChanges()
 {
-	m_drawables[drawable->GetOrder() - m_firstLayer].insert(drawable);
+	for (const PendingChange& change : m_pending)
+	{
+		Layer& layer = m_layers[change.index];
+
+		if (change.add)
+		{
+			// unregistered again before this point, might be destroyed already
+			auto found = m_keys.find(change.drawable);
+			if (found == m_keys.end() || found->second != change.key)
+				continue;
+
+			// the keys grow, appending keeps the layer sorted
+			layer.drawables.push_back(change.drawable);
+			layer.keys.push_back(change.key);
+
+			RectFloat bounds;
+			layer.grid.Insert(change.drawable, change.key, change.drawable->GetBounds(bounds) ? &bounds : nullptr);
+		}
+		else
+		{
+			auto position = std::lower_bound(layer.keys.begin(), layer.keys.end(), change.key);
+			if (position == layer.keys.end() || *position != change.key)
+				continue; // the registration was skipped above
+
+			layer.drawables[position - layer.keys.begin()] = nullptr;
+			layer.hasRemoved = true;
+			layer.grid.Remove(change.drawable);
+		}
+
+		layer.valid = false;
+	}
+	m_pending.clear();
+
+	for (Layer& layer : m_layers)
+	{
+		if (!layer.hasRemoved)
+			continue;
+
+		size_t kept = 0;
+		for (size_t i = 0; i < layer.drawables.size(); ++i)
+		{
+			if (layer.drawables[i])
+			{
+				layer.drawables[kept] = layer.drawables[i];
+				layer.keys[kept] = layer.keys[i];
+				++kept;
+			}
+		}
+		layer.drawables.resize(kept);
+		layer.keys.resize(kept);
+		layer.hasRemoved = false;
+	}
 }
 
-void RenderScheme::Draw(DrawingContext& dc, float interpolation) const
+void RenderScheme::Draw(DrawingContext& dc, float interpolation)
 {
+	if (!m_pending.empty())
+		ApplyPendingChanges();
+
+	for (unsigned int batch : m_releasedBatches)
+		dc.FreeStaticBatch(batch);
+	m_releasedBatches.clear();
+
+	// the static batches keep the device textures they were recorded with
+	if (dc.GetTextureGeneration() != m_textureGeneration)
+	{
+		for (Layer& layer : m_layers)
+			layer.valid = false;
+		m_textureGeneration = dc.GetTextureGeneration();
+	}
+
 	for (int i = m_firstLayer; i < m_lastLayer; ++i)
 	{
+		PROFILE_SCOPE_INDEXED("layer", i);
+
 		int index = i - m_firstLayer;
+		Layer& layer = m_layers[index];
+
+		dc.SetSortLayer(i, layer.isOrderIndependent);
+
+		if (layer.isStatic && !layer.batch)
+			layer.batch = dc.CreateStaticBatch();
 
-		std::set<const IDrawable*> orderQueue = m_drawables[i];
-		for (const IDrawable* d : orderQueue)
+		if (layer.isStatic && layer.batch)
+		{
+			if (!layer.valid)
+			{
+				dc.BeginStaticBatch(layer.batch);
+				for (const IDrawable* d : layer.drawables)
+					d->Draw(dc, interpolation);
+				dc.EndStaticBatch();
+				layer.valid = true;
+			}
+
+			dc.DrawStaticBatch(layer.batch);
+			continue;
+		}
+
+		const std::vector<const IDrawable*>* drawables = &layer.drawables;
+
+		RectFloat cameraRegion;
+		if (dc.GetCameraRegion(cameraRegion))
+		{
+			m_visible.clear();
+			layer.grid.Query(cameraRegion, m_visible);
+
+			// the same order the whole layer is drawn in
+			std::sort(m_visible.begin(), m_visible.end(), [](const SpatialGrid::Hit& a, const SpatialGrid::Hit& b)
+			{
+				return a.key < b.key;
+			});
+
+			m_visibleDrawables.clear();
+			for (const SpatialGrid::Hit& hit : m_visible)
+				m_visibleDrawables.push_back(hit.item);
+			drawables = &m_visibleDrawables;
+		}
+
+		if (layer.isParallel && m_threadPool)
+		{
+			DrawParallel(dc, *drawables, interpolation);
+			continue;
+		}
+
+		for (const IDrawable* d : *drawables)
 			d->Draw(dc, interpolation);
 	}
+
+	dc.SetSortLayer(0);
 }
 
-void RenderScheme::UnegisterDrawable(const IDrawable* drawable)
+void RenderScheme::DrawParallel(DrawingContext& dc, const std::vector<const IDrawable*>& drawables, float interpolation)
+{
+	// smaller chunks cost more to hand over than to draw
+	const size_t MIN_CHUNK_SIZE = 64;
+
+	const size_t count = drawables.size();
+	const size_t chunks = std::min(m_threadPool->GetThreadsCount() + 1, count / MIN_CHUNK_SIZE);
+	if (chunks < 2)
+	{
+		for (const IDrawable* d : drawables)
+			d->Draw(dc, interpolation);
+		return;
+	}
+
+	while (m_workers.size() < chunks - 1)
+	{
+		Worker worker;
+		worker.buffer = std::make_unique<RenderCommandBuffer>();
+		worker.glyphRuns = std::make_unique<GlyphRunCache>();
+		worker.context = std::make_unique<DrawingContext>(dc, worker.buffer.get(), *worker.glyphRuns);
+		m_workers.push_back(std::move(worker));
+	}
+
+	// the worker contexts start from the state the layer starts with
+	for (size_t chunk = 1; chunk < chunks; ++chunk)
+	{
+		m_workers[chunk - 1].buffer->Clear();
+		m_workers[chunk - 1].context->ResetState(dc);
+	}
+
+	m_tasks.clear();
+	for (size_t chunk = 1; chunk < chunks; ++chunk)
+	{
+		DrawingContext* context = m_workers[chunk - 1].context.get();
+		const IDrawable* const* first = drawables.data() + count * chunk / chunks;
+		const IDrawable* const* last = drawables.data() + count * (chunk + 1) / chunks;
+		m_tasks.push_back(m_threadPool->Enqueue([context, first, last, interpolation]
+		{
+			for (const IDrawable* const* d = first; d != last; ++d)
+				(*d)->Draw(*context, interpolation);
+		}));
+	}
+
+	// the workers use the contexts and the drawables, nothing leaves before they are done
+	try
+	{
+		for (size_t i = 0; i < count / chunks; ++i)
+			drawables[i]->Draw(dc, interpolation);
+	}
+	catch (...)
+	{
+		for (std::future<void>& task : m_tasks)
+			task.wait();
+		throw;
+	}
+
+	for (std::future<void>& task : m_tasks)
+		task.wait();
+
+	for (size_t chunk = 1; chunk < chunks; ++chunk)
+	{
+		m_tasks[chunk - 1].get(); // rethrows what the worker has thrown
+		dc.DrawCommands(*m_workers[chunk - 1].buffer);
+	}
+}
+
+void RenderScheme::SetThreadPool(ThreadPool* pool)
+{
+	m_threadPool = pool;
+}
+
+void RenderScheme::SetLayerParallel(int layer, bool isParallel)
+{
+	assert(layer >= m_firstLayer && layer < m_lastLayer);
+	m_layers[layer - m_firstLayer].isParallel = isParallel;
+}
+
+void RenderScheme::SetLayerStatic(int layer, bool isStatic)
+{
+	assert(layer >= m_firstLayer && layer < m_lastLayer);
+	Layer& schemeLayer = m_layers[layer - m_firstLayer];
+	schemeLayer.isStatic = isStatic;
+	schemeLayer.valid = false;
+
+	// there is no render at hand here, the batch is freed by the next Draw
+	if (!isStatic && schemeLayer.batch)
+	{
+		m_releasedBatches.push_back(schemeLayer.batch);
+		schemeLayer.batch = 0;
+	}
+}
+
+void RenderScheme::SetLayerOrderIndependent(int layer, bool isOrderIndependent)
+{
+	assert(layer >= m_firstLayer && layer < m_lastLayer);
+	Layer& schemeLayer = m_layers[layer - m_firstLayer];
+	schemeLayer.isOrderIndependent = isOrderIndependent;
+	schemeLayer.valid = false;
+}
+
+void RenderScheme::InvalidateLayer(int layer)
 {
-	assert(m_drawables[drawable->GetOrder() - m_firstLayer].erase(drawable) == 1);
+	assert(layer >= m_firstLayer && layer < m_lastLayer);
+	m_layers[layer - m_firstLayer].valid = false;
+}
+
+void RenderScheme::ReleaseStaticBatches(IRender& render)
+{
+	for (unsigned int batch : m_releasedBatches)
+		render.FreeStaticBatch(batch);
+	m_releasedBatches.clear();
+
+	for (Layer& layer : m_layers)
+	{
+		if (layer.batch)
+			render.FreeStaticBatch(layer.batch);
+		layer.batch = 0;
+		layer.valid = false;
+	}
 }
@@ -1,9 +1,19 @@
 #pragma once
 
-#include <set>
+#include "SpatialGrid.h"
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 class DrawingContext;
+class GlyphRunCache;
+class RenderCommandBuffer;
+class ThreadPool;
 struct IDrawable;
+struct IRender;
 
 class RenderScheme
 {
@@ -12,10 +22,40 @@ public:
 
 	~RenderScheme();
 
+	// Registration takes effect at the beginning of the next Draw, so it is safe from inside
+	// IDrawable::Draw. A layer is drawn in the order of registration.
 	void RegisterDrawable(const IDrawable* drawable);
-	void Draw(DrawingContext& dc, float interpolation) const;
+	void Draw(DrawingContext& dc, float interpolation);
 	void UnegisterDrawable(const IDrawable* drawable);
 
+	// re-reads IDrawable::GetBounds of a registered drawable after it has moved
+	void UpdateBounds(const IDrawable* drawable);
+
+	// A static layer is recorded once into a batch kept by the render and redrawn from it
+	// until invalidated. Its drawables must not depend on the camera or the interpolation.
+	// Registering or unregistering a drawable of the layer invalidates it. A layer that stops
+	// being static frees its batch on the next Draw.
+	void SetLayerStatic(int layer, bool isStatic);
+	void InvalidateLayer(int layer);
+
+	// The drawables of a parallel layer are split into chunks, the first one is drawn on the
+	// calling thread and the rest are recorded on the pool into command buffers, which are
+	// then replayed in order. Such drawables must be safe to draw concurrently, must not touch
+	// the scheme from Draw and must leave the context state (clipping, transforms, mode) the
+	// way they found it.
+	// Without a pool every layer is drawn serially.
+	void SetThreadPool(ThreadPool* pool);
+	void SetLayerParallel(int layer, bool isParallel);
+
+	// The geometry of a layer is drawn in the order it was submitted. An order independent
+	// layer, opaque or never overlapping, lets the render regroup it by texture instead.
+	// Opt-in: the scheme does not know what its layers hold, the game marks the layers of
+	// e.g. the tiled background or the opaque terrain, a wrong mark reorders translucent quads.
+	void SetLayerOrderIndependent(int layer, bool isOrderIndependent);
+
+	// frees the batches of the static layers, before the render goes away
+	void ReleaseStaticBatches(IRender& render);
+
 	RenderScheme(const RenderScheme& rs) = delete;
 	RenderScheme(RenderScheme&& rs) = delete;
 
@@ -23,8 +63,57 @@ public:
 	RenderScheme& operator=(RenderScheme&& rs) = delete;
 
 private:
-    int m_firstLayer;
+	struct Layer
+	{
+		std::vector<const IDrawable*> drawables;
+		std::vector<uint64_t> keys;     // ascending, parallel to drawables
+		bool hasRemoved = false;        // nulls in drawables to compact
+
+		SpatialGrid grid;               // the drawables culled against the camera region
+
+		bool isStatic = false;
+		bool valid = false;
+		unsigned int batch = 0;
+
+		bool isParallel = false;
+		bool isOrderIndependent = false;
+	};
+
+	struct PendingChange
+	{
+		const IDrawable* drawable;
+		int index;
+		uint64_t key;
+		bool add;
+	};
+
+	void ApplyPendingChanges();
+	void DrawParallel(DrawingContext& dc, const std::vector<const IDrawable*>& drawables, float interpolation);
+
+	int m_firstLayer;
 	int m_lastLayer;
 
-	std::set<const IDrawable*>* m_drawables;
+	std::vector<Layer> m_layers;
+
+	std::unordered_map<const IDrawable*, uint64_t> m_keys;   // registered drawables
+	std::vector<PendingChange> m_pending;
+	uint64_t m_nextKey = 0;
+
+	unsigned int m_textureGeneration = 0;
+	std::vector<unsigned int> m_releasedBatches;    // of the layers no longer static, to free
+
+	std::vector<SpatialGrid::Hit> m_visible;
+	std::vector<const IDrawable*> m_visibleDrawables;
+
+	// one per worker chunk, reused every frame
+	struct Worker
+	{
+		std::unique_ptr<RenderCommandBuffer> buffer;
+		std::unique_ptr<GlyphRunCache> glyphRuns;
+		std::unique_ptr<DrawingContext> context;    // records into the buffer
+	};
+
+	ThreadPool* m_threadPool = nullptr;
+	std::vector<Worker> m_workers;
+	std::vector<std::future<void>> m_tasks;
 };
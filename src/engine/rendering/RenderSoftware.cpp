@@ -0,0 +1,792 @@
+#include "RenderSoftware.h"
+#include "GlTexture.h"
+#include "Line.h"
+#include "ColoredVertex.h"
+#include "base/IImage.h"
+#include "profiling/Profiler.h"
+#include "threading/ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <future>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RENDER_SOFTWARE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const int TILE_SIZE = 64;
+    const size_t MAX_VERTICES = 65536;  // collected before a forced flush
+
+    const uint32 ALPHA_MASK = 0xff000000;
+    const float INV_255 = 1.0f / 255.0f;
+
+    RectInt Intersect(const RectInt &a, const RectInt &b)
+    {
+        RectInt result;
+        result.left = std::max(a.left, b.left);
+        result.top = std::max(a.top, b.top);
+        result.right = std::min(a.right, b.right);
+        result.bottom = std::min(a.bottom, b.bottom);
+        return result;
+    }
+
+    bool IsEmpty(const RectInt &rect)
+    {
+        return rect.left >= rect.right || rect.top >= rect.bottom;
+    }
+
+    // the first pixel whose center is at 'edge' or after it
+    int FirstPixel(float edge, int min, int max)
+    {
+        edge = std::min(std::max(edge, (float)min), (float)max);
+        return (int)std::ceil(edge - 0.5f);
+    }
+
+    struct Texel
+    {
+        const uint32 *texels;
+        unsigned int width;
+        unsigned int height;
+
+        uint32 Sample(float u, float v) const
+        {
+            const float fu = u - std::floor(u);
+            const float fv = v - std::floor(v);
+            const unsigned int x = std::min((unsigned int)(fu * (float)width), width - 1);
+            const unsigned int y = std::min((unsigned int)(fv * (float)height), height - 1);
+            return texels[y * width + x];
+        }
+    };
+
+#ifdef RENDER_SOFTWARE_SSE2
+    inline __m128 Unpack(uint32 color)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_cvtsi32_si128((int)color);
+        v = _mm_unpacklo_epi8(v, zero);
+        v = _mm_unpacklo_epi16(v, zero);
+        return _mm_cvtepi32_ps(v);
+    }
+
+    inline uint32 Pack(__m128 color)
+    {
+        color = _mm_min_ps(_mm_max_ps(color, _mm_setzero_ps()), _mm_set1_ps(255.0f));
+        __m128i v = _mm_cvttps_epi32(_mm_add_ps(color, _mm_set1_ps(0.5f)));
+        v = _mm_packs_epi32(v, v);
+        v = _mm_packus_epi16(v, v);
+        return (uint32)_mm_cvtsi128_si32(v);
+    }
+
+    inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+
+    // the color channels are in 0..255, the same formulas as the scalar version below
+    uint64 ShadeSpan(uint32 *dst, int x0, int x1, float yc, const float *base, const float *dx, const float *dy,
+                     RenderMode mode, const Texel *texture)
+    {
+        const __m128 rowColor = _mm_add_ps(_mm_loadu_ps(base), _mm_mul_ps(_mm_loadu_ps(dy), _mm_set1_ps(yc)));
+        const __m128 stepColor = _mm_loadu_ps(dx);
+        const float rowU = base[4] + dy[4] * yc;
+        const float rowV = base[5] + dy[5] * yc;
+
+        const __m128 k = _mm_set1_ps(INV_255);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 alpha = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+
+        for (int x = x0; x < x1; ++x)
+        {
+            const float xc = (float)x + 0.5f;
+            __m128 src = _mm_add_ps(rowColor, _mm_mul_ps(stepColor, _mm_set1_ps(xc)));
+            if (texture)
+            {
+                const __m128 texel = Unpack(texture->Sample(rowU + dx[4] * xc, rowV + dx[5] * xc));
+                src = _mm_mul_ps(_mm_mul_ps(src, texel), k);
+            }
+
+            const __m128 d = Unpack(dst[x]);
+            const __m128 srcAlpha = _mm_shuffle_ps(src, src, _MM_SHUFFLE(3, 3, 3, 3));
+            __m128 result;
+            switch (mode)
+            {
+            case LIGHT:
+                result = Select(alpha, _mm_add_ps(_mm_mul_ps(_mm_mul_ps(src, srcAlpha), k), d), d);
+                break;
+            case WORLD:
+            {
+                const __m128 dstAlpha = _mm_shuffle_ps(d, d, _MM_SHUFFLE(3, 3, 3, 3));
+                const __m128 blended = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(src, dstAlpha), k),
+                                                  _mm_mul_ps(d, _mm_sub_ps(one, _mm_mul_ps(srcAlpha, k))));
+                result = Select(alpha, d, blended);
+                break;
+            }
+            case INTERFACE:
+                result = Select(alpha, d, _mm_add_ps(src, _mm_mul_ps(d, _mm_sub_ps(one, _mm_mul_ps(srcAlpha, k)))));
+                break;
+            default:
+                result = src;
+                break;
+            }
+            dst[x] = Pack(result);
+        }
+        return (uint64)(x1 - x0);
+    }
+#else
+    inline void Unpack(uint32 color, float *out)
+    {
+        for (int i = 0; i < 4; ++i)
+            out[i] = (float)((color >> (i * 8)) & 0xff);
+    }
+
+    inline uint32 Pack(const float *color)
+    {
+        uint32 result = 0;
+        for (int i = 0; i < 4; ++i)
+            result |= (uint32)(std::min(std::max(color[i], 0.0f), 255.0f) + 0.5f) << (i * 8);
+        return result;
+    }
+
+    uint64 ShadeSpan(uint32 *dst, int x0, int x1, float yc, const float *base, const float *dx, const float *dy,
+                     RenderMode mode, const Texel *texture)
+    {
+        float rowColor[4];
+        for (int i = 0; i < 4; ++i)
+            rowColor[i] = base[i] + dy[i] * yc;
+        const float rowU = base[4] + dy[4] * yc;
+        const float rowV = base[5] + dy[5] * yc;
+
+        for (int x = x0; x < x1; ++x)
+        {
+            const float xc = (float)x + 0.5f;
+            float src[4];
+            for (int i = 0; i < 4; ++i)
+                src[i] = rowColor[i] + dx[i] * xc;
+            if (texture)
+            {
+                float texel[4];
+                Unpack(texture->Sample(rowU + dx[4] * xc, rowV + dx[5] * xc), texel);
+                for (int i = 0; i < 4; ++i)
+                    src[i] = src[i] * texel[i] * INV_255;
+            }
+
+            float d[4];
+            Unpack(dst[x], d);
+            float result[4] = { d[0], d[1], d[2], d[3] };
+            switch (mode)
+            {
+            case LIGHT:
+                result[3] = src[3] * src[3] * INV_255 + d[3];
+                break;
+            case WORLD:
+                for (int i = 0; i < 3; ++i)
+                    result[i] = src[i] * d[3] * INV_255 + d[i] * (1.0f - src[3] * INV_255);
+                break;
+            case INTERFACE:
+                for (int i = 0; i < 3; ++i)
+                    result[i] = src[i] + d[i] * (1.0f - src[3] * INV_255);
+                break;
+            default:
+                std::copy(src, src + 4, result);
+                break;
+            }
+            dst[x] = Pack(result);
+        }
+        return (uint64)(x1 - x0);
+    }
+#endif
+}
+
+RenderSoftware::RenderSoftware()
+    : m_width(0)
+    , m_height(0)
+    , m_viewport()
+    , m_scissor()
+    , m_scissorEnabled(false)
+    , m_translateX(0)
+    , m_translateY(0)
+    , m_scale(1)
+    , m_ambient(0)
+    , m_state()
+    , m_stateChanged(true)
+    , m_tilesX(0)
+    , m_tilesY(0)
+    , m_threadPool(nullptr)
+    , m_stats()
+{
+    m_state.mode = UNDEFINED;
+    m_state.scale = 1;
+}
+
+RenderSoftware::~RenderSoftware() = default;
+
+void RenderSoftware::SetThreadPool(ThreadPool *pool)
+{
+    m_threadPool = pool;
+}
+
+bool RenderSoftware::Init()
+{
+    return true;
+}
+
+void RenderSoftware::OnResizeWnd(unsigned int width, unsigned int height)
+{
+    if (width != m_width || height != m_height)
+    {
+        Flush();
+        m_width = width;
+        m_height = height;
+        m_framebuffer.assign((size_t)width * height, 0);
+        m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        m_tiles.resize((size_t)m_tilesX * m_tilesY);
+    }
+    SetViewport(nullptr);
+    SetScissor(nullptr);
+}
+
+void RenderSoftware::SetScissor(const RectInt *rect)
+{
+    m_scissorEnabled = rect != nullptr;
+    if (rect)
+        m_scissor = *rect;
+    UpdateState();
+}
+
+void RenderSoftware::SetViewport(const RectInt *rect)
+{
+    if (rect)
+    {
+        m_viewport = *rect;
+    }
+    else
+    {
+        m_viewport.left = 0;
+        m_viewport.top = 0;
+        m_viewport.right = (int)m_width;
+        m_viewport.bottom = (int)m_height;
+    }
+    UpdateState();
+}
+
+void RenderSoftware::Camera(const RectInt *vp, float x, float y, float scale)
+{
+    SetViewport(vp);
+    SetScissor(vp);
+
+    // the same translation as RenderOpenGL, with the integer division
+    m_translateX = vp ? (float)(WIDTH(*vp) / 2) - x * scale : 0;
+    m_translateY = vp ? (float)(HEIGHT(*vp) / 2) - y * scale : 0;
+    m_scale = scale;
+    UpdateState();
+}
+
+void RenderSoftware::UpdateState()
+{
+    RectInt clip = Intersect(m_viewport, RectInt{ 0, 0, (int)m_width, (int)m_height });
+    if (m_scissorEnabled)
+        clip = Intersect(clip, m_scissor);
+
+    m_state.clip = clip;
+    m_state.offsetX = (float)m_viewport.left + m_translateX;
+    m_state.offsetY = (float)m_viewport.top + m_translateY;
+    m_state.scale = m_scale;
+    m_stateChanged = true;
+}
+
+uint32 RenderSoftware::CurrentState()
+{
+    if (m_stateChanged || m_states.empty())
+    {
+        m_states.push_back(m_state);
+        m_stateChanged = false;
+    }
+    return (uint32)m_states.size() - 1;
+}
+
+void RenderSoftware::SetTexture(unsigned int texture)
+{
+    if (m_state.texture != texture)
+    {
+        m_state.texture = texture;
+        m_stateChanged = true;
+    }
+}
+
+void RenderSoftware::SetAmbient(float ambient)
+{
+    m_ambient = ambient;
+}
+
+void RenderSoftware::SetMode(const RenderMode mode)
+{
+    switch (mode)
+    {
+    case LIGHT:
+        AddClear(Color(0, 0, 0, (uint8)(m_ambient * 255 + 0.5f)).color, ALPHA_MASK);
+        break;
+    case WORLD:
+        break;
+    case INTERFACE:
+        SetViewport(nullptr);
+        Camera(nullptr, 0, 0, 1);
+        break;
+    default:
+        assert(false);
+    }
+
+    m_state.mode = mode;
+    m_stateChanged = true;
+}
+
+void RenderSoftware::Begin()
+{
+    AddClear(Color(0, 0, 0, (uint8)(m_ambient * 255 + 0.5f)).color, 0xffffffff);
+}
+
+void RenderSoftware::End()
+{
+    Flush();
+}
+
+bool RenderSoftware::TexCreate(GlTexture &tex, const IImage &img, bool magFilter)
+{
+    const unsigned int bytesPerPixel = img.GetBitsPerPixel() / 8;
+    if (IsCompressedFormat(img.GetFormat()) || (bytesPerPixel != 3 && bytesPerPixel != 4))
+        return false;
+
+    Texture texture;
+    texture.width = img.GetWidth();
+    texture.height = img.GetHeight();
+    texture.texels.resize((size_t)texture.width * texture.height);
+
+    const uint8 *src = img.GetData();
+    for (uint32 &texel : texture.texels)
+    {
+        texel = Color(src[0], src[1], src[2], bytesPerPixel == 4 ? src[3] : 255).color;
+        src += bytesPerPixel;
+    }
+
+    auto freeSlot = std::find_if(m_textures.begin(), m_textures.end(), [](const Texture &t) { return t.texels.empty(); });
+    if (freeSlot == m_textures.end())
+        freeSlot = m_textures.insert(m_textures.end(), Texture());
+    *freeSlot = std::move(texture);
+
+    tex.ptr = nullptr;
+    tex.index = (unsigned int)(freeSlot - m_textures.begin()) + 1;
+    return true;
+}
+
+void RenderSoftware::TexFree(GlTexture tex)
+{
+    assert(tex.index > 0 && tex.index <= m_textures.size());
+
+    // the queued geometry may still use it
+    Flush();
+
+    std::vector<uint32>().swap(m_textures[tex.index - 1].texels);
+}
+
+Vertex* RenderSoftware::AddBatch(BatchKind kind, uint32 vertexCount)
+{
+    if (m_vertices.size() + vertexCount > MAX_VERTICES)
+        Flush();
+
+    const uint32 state = CurrentState();
+    if (kind == BATCH_QUADS && !m_batches.empty() && m_batches.back().kind == BATCH_QUADS && m_batches.back().state == state)
+        m_batches.back().count += vertexCount;
+    else
+        m_batches.push_back(Batch{ kind, state, (uint32)m_vertices.size(), vertexCount });
+
+    m_vertices.resize(m_vertices.size() + vertexCount);
+    return &m_vertices[m_vertices.size() - vertexCount];
+}
+
+void RenderSoftware::AddClear(uint32 color, uint32 mask)
+{
+    m_batches.push_back(Batch{ BATCH_CLEAR, CurrentState(), color, mask });
+}
+
+Vertex* RenderSoftware::DrawQuad(GlTexture tex)
+{
+    SetTexture(tex.index);
+    return AddBatch(BATCH_QUADS, 4);
+}
+
+Vertex* RenderSoftware::DrawQuads(GlTexture tex, unsigned int count)
+{
+    assert(count > 0 && count <= MAX_QUADS);
+    SetTexture(tex.index);
+    return AddBatch(BATCH_QUADS, count * 4);
+}
+
+Vertex* RenderSoftware::DrawFan(unsigned int nEdges)
+{
+    SetTexture(0);
+    return AddBatch(BATCH_FAN, nEdges + 1);
+}
+
+void RenderSoftware::SetSpriteFrames(const SpriteFrame *frames, size_t count)
+{
+    m_spriteFrames.assign(frames, frames + count);
+}
+
+void RenderSoftware::DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        assert(sprites[i].frame < m_spriteFrames.size());
+
+    while (count)
+    {
+        const unsigned int chunk = (unsigned int)std::min<size_t>(count, MAX_QUADS);
+        ExpandSprites(DrawQuads(tex, chunk), m_spriteFrames.data(), sprites, chunk);
+        sprites += chunk;
+        count -= chunk;
+    }
+}
+
+void RenderSoftware::DrawLights(const LightInstance *lights, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+        ExpandLight(DrawFan(lights[i].edges), lights[i]);
+}
+
+void RenderSoftware::DrawTriangles(const ColoredVertex* vertices, std::size_t count)
+{
+    if (count < 3)
+        return;
+
+    SetTexture(0);
+    Vertex *v = AddBatch(BATCH_POLYGON, (uint32)count);
+    for (std::size_t i = 0; i < count; ++i)
+        v[i] = Vertex{ vertices[i].position.x, vertices[i].position.y, 0, vertices[i].color, 0, 0 };
+}
+
+void RenderSoftware::DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize)
+{
+    SetTexture(0);
+
+    // squares of pointSize window pixels
+    const float half = pointSize * 0.5f / m_scale;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const Vec2F &p = points[i].position;
+        const Color color = points[i].color;
+        Vertex *v = AddBatch(BATCH_QUADS, 4);
+        v[0] = Vertex{ p.x - half, p.y - half, 0, color, 0, 0 };
+        v[1] = Vertex{ p.x + half, p.y - half, 0, color, 0, 0 };
+        v[2] = Vertex{ p.x + half, p.y + half, 0, color, 0, 0 };
+        v[3] = Vertex{ p.x - half, p.y + half, 0, color, 0, 0 };
+    }
+}
+
+void RenderSoftware::DrawLines(const Line *lines, size_t count)
+{
+    SetTexture(0);
+
+    // one window pixel wide quads
+    const float half = 0.5f / m_scale;
+    for (const Line *it = lines, *end = lines + count; it != end; ++it)
+    {
+        Vec2F dir = it->end - it->begin;
+        const float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+        dir = length > 0 ? Vec2F{ dir.x / length, dir.y / length } : Vec2F{ 1, 0 };
+        const Vec2F normal{ -dir.y * half, dir.x * half };
+
+        // the channels are swapped the same way RenderOpenGL passes them
+        const Color color(it->color.rgba[3], it->color.rgba[2], it->color.rgba[1], it->color.rgba[0]);
+
+        Vertex *v = AddBatch(BATCH_QUADS, 4);
+        v[0] = Vertex{ it->begin.x + normal.x, it->begin.y + normal.y, 0, color, 0, 0 };
+        v[1] = Vertex{ it->end.x + normal.x, it->end.y + normal.y, 0, color, 0, 0 };
+        v[2] = Vertex{ it->end.x - normal.x, it->end.y - normal.y, 0, color, 0, 0 };
+        v[3] = Vertex{ it->begin.x - normal.x, it->begin.y - normal.y, 0, color, 0, 0 };
+    }
+}
+
+void RenderSoftware::Flush()
+{
+    if (m_batches.empty())
+        return;
+
+    PROFILE_SCOPE("flush");
+
+    Setup();
+
+    const size_t tiles = m_tiles.size();
+    const size_t chunks = m_threadPool ? std::min(m_threadPool->GetThreadsCount() + 1, tiles) : 1;
+    if (chunks < 2)
+    {
+        RasterizeTiles(0, 1, m_stats.pixels);
+    }
+    else
+    {
+        // interleaved tiles, the busy parts of the screen are shared between the threads
+        std::vector<uint64> pixels(chunks, 0);
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(chunks - 1);
+        for (size_t chunk = 1; chunk < chunks; ++chunk)
+        {
+            uint64 *counter = &pixels[chunk];
+            tasks.push_back(m_threadPool->Enqueue([this, chunk, chunks, counter]
+            {
+                RasterizeTiles(chunk, chunks, *counter);
+            }));
+        }
+        RasterizeTiles(0, chunks, pixels[0]);
+
+        for (std::future<void> &task : tasks)
+            task.get();
+        for (uint64 count : pixels)
+            m_stats.pixels += count;
+    }
+
+    m_batches.clear();
+    m_vertices.clear();
+    m_states.clear();
+    m_stateChanged = true;
+    m_primitives.clear();
+    for (std::vector<uint32> &tile : m_tiles)
+        tile.clear();
+
+    ++m_stats.flushes;
+}
+
+void RenderSoftware::Setup()
+{
+    for (const Batch &batch : m_batches)
+    {
+        const State &state = m_states[batch.state];
+        const Vertex *v = m_vertices.data() + batch.first;
+
+        switch (batch.kind)
+        {
+        case BATCH_QUADS:
+            for (uint32 i = 0; i < batch.count; i += 4)
+            {
+                SetupTriangle(state, batch.state, v[i], v[i + 1], v[i + 2]);
+                SetupTriangle(state, batch.state, v[i], v[i + 2], v[i + 3]);
+            }
+            break;
+        case BATCH_FAN:
+            for (uint32 i = 1; i < batch.count; ++i)
+                SetupTriangle(state, batch.state, v[0], v[i], v[i + 1 < batch.count ? i + 1 : 1]);
+            break;
+        case BATCH_POLYGON:
+            for (uint32 i = 1; i + 1 < batch.count; ++i)
+                SetupTriangle(state, batch.state, v[0], v[i], v[i + 1]);
+            break;
+        case BATCH_CLEAR:
+        {
+            if (IsEmpty(state.clip))
+                break;
+            Primitive clear = {};
+            clear.state = batch.state;
+            clear.bounds = state.clip;
+            clear.clear = true;
+            clear.clearColor = batch.first;
+            clear.clearMask = batch.count;
+            m_primitives.push_back(clear);
+            break;
+        }
+        }
+    }
+
+    for (uint32 index = 0; index < (uint32)m_primitives.size(); ++index)
+    {
+        const RectInt &bounds = m_primitives[index].bounds;
+        for (int y = bounds.top / TILE_SIZE; y <= (bounds.bottom - 1) / TILE_SIZE; ++y)
+        {
+            for (int x = bounds.left / TILE_SIZE; x <= (bounds.right - 1) / TILE_SIZE; ++x)
+                m_tiles[y * m_tilesX + x].push_back(index);
+        }
+    }
+}
+
+void RenderSoftware::SetupTriangle(const State &state, uint32 stateIndex, const Vertex &a, const Vertex &b, const Vertex &c)
+{
+    const Vertex *v[3] = { &a, &b, &c };
+    float x[3];
+    float y[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        x[i] = state.offsetX + v[i]->x * state.scale;
+        y[i] = state.offsetY + v[i]->y * state.scale;
+    }
+
+    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0 || !std::isfinite(area))
+        return;
+
+    const RectInt &clip = state.clip;
+    RectInt bounds;
+    bounds.left = FirstPixel(std::min({ x[0], x[1], x[2] }), clip.left, clip.right);
+    bounds.right = FirstPixel(std::max({ x[0], x[1], x[2] }), clip.left, clip.right);
+    bounds.top = FirstPixel(std::min({ y[0], y[1], y[2] }), clip.top, clip.bottom);
+    bounds.bottom = FirstPixel(std::max({ y[0], y[1], y[2] }), clip.top, clip.bottom);
+    if (IsEmpty(bounds))
+        return;
+
+    Primitive triangle = {};
+    triangle.state = stateIndex;
+    triangle.bounds = bounds;
+
+    // The edges run from the vertex with the smaller y, so two triangles sharing an edge
+    // compute exactly the same crossings and neither overlap nor leave gaps.
+    for (int i = 0; i < 3; ++i)
+    {
+        const int j = (i + 1) % 3;
+        const bool down = y[i] < y[j] || (y[i] == y[j] && x[i] < x[j]);
+        const int top = down ? i : j;
+        const int bottom = down ? j : i;
+
+        Edge &edge = triangle.edges[i];
+        edge.topX = x[top];
+        edge.topY = y[top];
+        edge.bottomY = y[bottom];
+        edge.slope = y[bottom] != y[top] ? (x[bottom] - x[top]) / (y[bottom] - y[top]) : 0;
+    }
+
+    // the attributes are affine in the window space
+    const bool textured = state.texture != 0 && state.mode != LIGHT;
+    for (int i = 0; i < 6; ++i)
+    {
+        float f[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            if (i < 4)
+                f[k] = (float)v[k]->color.rgba[i];
+            else
+                f[k] = textured ? (i == 4 ? v[k]->u : v[k]->v) : 0;
+        }
+
+        const float dfdx = ((f[1] - f[0]) * (y[2] - y[0]) - (f[2] - f[0]) * (y[1] - y[0])) / area;
+        const float dfdy = ((f[2] - f[0]) * (x[1] - x[0]) - (f[1] - f[0]) * (x[2] - x[0])) / area;
+        triangle.dx[i] = dfdx;
+        triangle.dy[i] = dfdy;
+        triangle.base[i] = f[0] - dfdx * x[0] - dfdy * y[0];
+    }
+
+    m_primitives.push_back(triangle);
+    ++m_stats.triangles;
+}
+
+void RenderSoftware::RasterizeTiles(size_t firstTile, size_t step, uint64 &pixels) const
+{
+    for (size_t index = firstTile; index < m_tiles.size(); index += step)
+    {
+        if (m_tiles[index].empty())
+            continue;
+
+        const int x = (int)(index % m_tilesX) * TILE_SIZE;
+        const int y = (int)(index / m_tilesX) * TILE_SIZE;
+        const RectInt tile{ x, y, std::min(x + TILE_SIZE, (int)m_width), std::min(y + TILE_SIZE, (int)m_height) };
+        pixels += RasterizeTile(tile, m_tiles[index]);
+    }
+}
+
+uint64 RenderSoftware::RasterizeTile(const RectInt &tile, const std::vector<uint32> &primitives) const
+{
+    // the tile's part of the framebuffer is written by this thread only
+    uint32 *framebuffer = const_cast<uint32 *>(m_framebuffer.data());
+    uint64 pixels = 0;
+
+    for (uint32 index : primitives)
+    {
+        const Primitive &p = m_primitives[index];
+        const RectInt rect = Intersect(p.bounds, tile);
+
+        if (p.clear)
+        {
+            for (int y = rect.top; y < rect.bottom; ++y)
+            {
+                uint32 *row = framebuffer + (size_t)y * m_width;
+                for (int x = rect.left; x < rect.right; ++x)
+                    row[x] = (row[x] & ~p.clearMask) | (p.clearColor & p.clearMask);
+            }
+            continue;
+        }
+
+        const State &state = m_states[p.state];
+        Texel texel = {};
+        const Texel *texture = nullptr;
+        if (state.texture != 0 && state.mode != LIGHT && state.texture <= m_textures.size())
+        {
+            const Texture &t = m_textures[state.texture - 1];
+            if (!t.texels.empty())
+            {
+                texel = Texel{ t.texels.data(), t.width, t.height };
+                texture = &texel;
+            }
+        }
+
+        for (int y = rect.top; y < rect.bottom; ++y)
+        {
+            const float yc = (float)y + 0.5f;
+
+            float crossings[3];
+            int count = 0;
+            for (const Edge &edge : p.edges)
+            {
+                if (edge.topY <= yc && yc < edge.bottomY)
+                    crossings[count++] = edge.topX + (yc - edge.topY) * edge.slope;
+            }
+            if (count < 2)
+                continue;
+
+            const int x0 = FirstPixel(std::min(crossings[0], crossings[1]), rect.left, rect.right);
+            const int x1 = FirstPixel(std::max(crossings[0], crossings[1]), rect.left, rect.right);
+            if (x0 < x1)
+                pixels += ShadeSpan(framebuffer + (size_t)y * m_width, x0, x1, yc, p.base, p.dx, p.dy, state.mode, texture);
+        }
+    }
+
+    return pixels;
+}
+
+uint64 RenderSoftware::GetChecksum() const
+{
+    uint64 hash = 14695981039346656037ULL;
+    for (uint32 pixel : m_framebuffer)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            hash ^= (pixel >> (i * 8)) & 0xff;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+std::vector<uint8> RenderSoftware::EncodeTga() const
+{
+    std::vector<uint8> file(18 + m_framebuffer.size() * 4, 0);
+    file[2] = 2;                        // uncompressed true color
+    file[12] = (uint8)(m_width & 0xff);
+    file[13] = (uint8)(m_width >> 8);
+    file[14] = (uint8)(m_height & 0xff);
+    file[15] = (uint8)(m_height >> 8);
+    file[16] = 32;
+    file[17] = 0x28;                    // 8 alpha bits, the first row is the top one
+
+    uint8 *dst = &file[18];
+    for (uint32 pixel : m_framebuffer)
+    {
+        const Color color(pixel);
+        *dst++ = color.b;
+        *dst++ = color.g;
+        *dst++ = color.r;
+        *dst++ = color.a;
+    }
+    return file;
+}
+
+void RenderSoftware::ResetStats()
+{
+    m_stats = Stats();
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "base/IRender.h"
+#include "LightInstance.h"
+#include "SpriteInstance.h"
+#include "Vertex.h"
+#include "common/Types.h"
+
+#include <vector>
+
+class ThreadPool;
+
+// CPU rasterizer drawing into an RGBA framebuffer in memory, for rendering tests and benchmarks
+// on machines without a GPU. Follows RenderOpenGL: the alpha channel keeps the light, the blend
+// modes are the same, textures are sampled with the nearest filter and repeat.
+//
+// The geometry is collected until Flush (End flushes as well) and then rasterized tile by tile,
+// on the pool when one is set. The pixels do not depend on the tiling or the threads count.
+class RenderSoftware : public IRender
+{
+public:
+    struct Stats
+    {
+        uint64 triangles;
+        uint64 pixels;      // shaded by the triangles, clears not counted
+        uint64 flushes;
+    };
+
+    RenderSoftware();
+    ~RenderSoftware() override;
+
+    void SetThreadPool(ThreadPool *pool);
+    void Flush();
+
+    // Color values from the top row down, valid after Flush
+    const uint32* GetPixels() const { return m_framebuffer.data(); }
+    unsigned int GetWidth() const { return m_width; }
+    unsigned int GetHeight() const { return m_height; }
+
+    // FNV-1a of the pixels, to compare a frame with a golden one
+    uint64 GetChecksum() const;
+
+    // 32 bpp uncompressed TGA file of the framebuffer
+    std::vector<uint8> EncodeTga() const;
+
+    const Stats& GetStats() const { return m_stats; }
+    void ResetStats();
+
+    // IRender
+    bool Init() override;
+    void OnResizeWnd(unsigned int width, unsigned int height) override;
+
+    void SetScissor(const RectInt *rect) override;
+    void SetViewport(const RectInt *rect) override;
+    void Camera(const RectInt *vp, float x, float y, float scale) override;
+
+    void SetAmbient(float ambient) override;
+    void SetMode(const RenderMode mode) override;
+
+    void Begin() override;
+    void End() override;
+
+    bool TexCreate(GlTexture &tex, const IImage &img, bool magFilter) override;
+    void TexFree(GlTexture tex) override;
+
+    Vertex* DrawQuad(GlTexture tex) override;
+    Vertex* DrawQuads(GlTexture tex, unsigned int count) override;
+    Vertex* DrawFan(unsigned int nEdges) override;
+
+    void SetSpriteFrames(const SpriteFrame *frames, size_t count) override;
+    void DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count) override;
+    void DrawLights(const LightInstance *lights, size_t count) override;
+
+    void DrawTriangles(const ColoredVertex* vertices, std::size_t count) override;
+    void DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize) override;
+    void DrawLines(const Line *lines, size_t count) override;
+
+private:
+    struct Texture
+    {
+        unsigned int width;
+        unsigned int height;
+        std::vector<uint32> texels;     // RGBA
+    };
+
+    // everything the rasterization of a batch depends on
+    struct State
+    {
+        RenderMode mode;
+        unsigned int texture;           // 0 for the untextured primitives
+        RectInt clip;                   // viewport, scissor and framebuffer together
+        float offsetX;                  // vertex to window: offset + position * scale
+        float offsetY;
+        float scale;
+    };
+
+    enum BatchKind : uint8
+    {
+        BATCH_QUADS,
+        BATCH_FAN,                      // DrawFan, the last triangle closes on the first edge vertex
+        BATCH_POLYGON,                  // DrawTriangles, not closed
+        BATCH_CLEAR,
+    };
+
+    struct Batch
+    {
+        BatchKind kind;
+        uint32 state;
+        uint32 first;                   // vertex, the clear color for BATCH_CLEAR
+        uint32 count;                   // vertices, the written channels mask for BATCH_CLEAR
+    };
+
+    struct Edge
+    {
+        float topX;                     // the end with the smaller y
+        float topY;
+        float bottomY;
+        float slope;                    // dx / dy
+    };
+
+    // a triangle set up in the window space or a clear
+    struct Primitive
+    {
+        uint32 state;
+        RectInt bounds;                 // pixels, clipped
+        bool clear;
+        uint32 clearColor;
+        uint32 clearMask;
+        Edge edges[3];
+        float base[6];                  // r, g, b, a, u, v at the window origin
+        float dx[6];
+        float dy[6];
+    };
+
+    Vertex* AddBatch(BatchKind kind, uint32 vertexCount);
+    void AddClear(uint32 color, uint32 mask);
+    void UpdateState();
+    uint32 CurrentState();
+    void SetTexture(unsigned int texture);
+
+    void Setup();
+    void SetupTriangle(const State &state, uint32 stateIndex, const Vertex &a, const Vertex &b, const Vertex &c);
+    void RasterizeTiles(size_t firstTile, size_t step, uint64 &pixels) const;
+    uint64 RasterizeTile(const RectInt &tile, const std::vector<uint32> &primitives) const;
+
+    unsigned int m_width;
+    unsigned int m_height;
+    std::vector<uint32> m_framebuffer;
+
+    std::vector<Texture> m_textures;    // GlTexture::index is the index + 1, empty texels are free
+    std::vector<SpriteFrame> m_spriteFrames;
+
+    RectInt m_viewport;
+    RectInt m_scissor;
+    bool m_scissorEnabled;
+    float m_translateX;
+    float m_translateY;
+    float m_scale;
+    float m_ambient;
+
+    State m_state;
+    bool m_stateChanged;
+    std::vector<State> m_states;
+
+    std::vector<Batch> m_batches;
+    std::vector<Vertex> m_vertices;
+
+    std::vector<Primitive> m_primitives;
+    std::vector<std::vector<uint32>> m_tiles; // primitives of every tile, in order
+    unsigned int m_tilesX;
+    unsigned int m_tilesY;
+
+    ThreadPool *m_threadPool;
+    Stats m_stats;
+};
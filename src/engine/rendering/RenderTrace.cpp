@@ -0,0 +1,952 @@
+#include "RenderTrace.h"
+#include "GlTexture.h"
+#include "Vertex.h"
+#include "base/IImage.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    const uint32 TRACE_MAGIC = 0x43525452; // "RTRC"
+    const uint32 TRACE_VERSION = 2;
+
+    // Vertex without z
+    const size_t PACKED_VERTEX_SIZE = 20;
+
+    void PackVertex(uint8 *dst, const Vertex &v)
+    {
+        memcpy(dst, &v.x, 4);
+        memcpy(dst + 4, &v.y, 4);
+        memcpy(dst + 8, &v.color, 4);
+        memcpy(dst + 12, &v.u, 4);
+        memcpy(dst + 16, &v.v, 4);
+    }
+
+    void UnpackVertex(Vertex &v, const uint8 *src)
+    {
+        memcpy(&v.x, src, 4);
+        memcpy(&v.y, src + 4, 4);
+        memcpy(&v.color, src + 8, 4);
+        memcpy(&v.u, src + 12, 4);
+        memcpy(&v.v, src + 16, 4);
+        v.z = 0;
+    }
+
+    class Reader
+    {
+    public:
+        Reader(const std::vector<uint8> &data, size_t offset)
+            : m_data(data)
+            , m_offset(offset)
+        {
+        }
+
+        size_t GetOffset() const { return m_offset; }
+
+        const uint8* Bytes(size_t size)
+        {
+            if (size > m_data.size() - m_offset)
+                throw std::runtime_error("render trace is truncated");
+            const uint8 *bytes = m_data.data() + m_offset;
+            m_offset += size;
+            return bytes;
+        }
+
+        const uint8* Array(uint32 count, size_t itemSize)
+        {
+            if (count > (m_data.size() - m_offset) / itemSize)
+                throw std::runtime_error("render trace is truncated");
+            return Bytes(count * itemSize);
+        }
+
+        template <class T>
+        T Read()
+        {
+            T value;
+            memcpy(&value, Bytes(sizeof(T)), sizeof(T));
+            return value;
+        }
+
+        const RectInt* ReadRect(RectInt &rect)
+        {
+            if (!Read<uint8>())
+                return nullptr;
+            rect = Read<RectInt>();
+            return &rect;
+        }
+
+    private:
+        const std::vector<uint8> &m_data;
+        size_t m_offset;
+    };
+
+    // the pixels of a texture inside the trace
+    class TraceImage : public IImage
+    {
+    public:
+        TraceImage(const uint8 *data, uint32 width, uint32 height, uint8 bitsPerPixel)
+            : m_data(data)
+            , m_width(width)
+            , m_height(height)
+            , m_bitsPerPixel(bitsPerPixel)
+        {
+        }
+
+        // Image methods
+        const uint8* GetData() const override { return m_data; }
+        uint8 GetBitsPerPixel() const override { return m_bitsPerPixel; }
+        uint32 GetWidth() const override { return m_width; }
+        uint32 GetHeight() const override { return m_height; }
+
+    private:
+        const uint8 *m_data;
+        uint32 m_width;
+        uint32 m_height;
+        uint8 m_bitsPerPixel;
+    };
+}
+
+const char* RenderTrace::GetCallName(Call call)
+{
+    switch (call)
+    {
+    case CALL_RESIZE: return "OnResizeWnd";
+    case CALL_SCISSOR: return "SetScissor";
+    case CALL_VIEWPORT: return "SetViewport";
+    case CALL_CAMERA: return "Camera";
+    case CALL_AMBIENT: return "SetAmbient";
+    case CALL_MODE: return "SetMode";
+    case CALL_BEGIN: return "Begin";
+    case CALL_END: return "End";
+    case CALL_SORT_LAYER: return "SetSortLayer";
+    case CALL_TEX_CREATE: return "TexCreate";
+    case CALL_TEX_FREE: return "TexFree";
+    case CALL_QUAD: return "DrawQuad";
+    case CALL_FAN: return "DrawFan";
+    case CALL_CREATE_STATIC_BATCH: return "CreateStaticBatch";
+    case CALL_FREE_STATIC_BATCH: return "FreeStaticBatch";
+    case CALL_BEGIN_STATIC_BATCH: return "BeginStaticBatch";
+    case CALL_END_STATIC_BATCH: return "EndStaticBatch";
+    case CALL_DRAW_STATIC_BATCH: return "DrawStaticBatch";
+    case CALL_SPRITE_FRAMES: return "SetSpriteFrames";
+    case CALL_SPRITES: return "DrawSprites";
+    case CALL_TRIANGLES: return "DrawTriangles";
+    case CALL_POINTS: return "DrawPoints";
+    case CALL_LINES: return "DrawLines";
+    case CALL_QUADS: return "DrawQuads";
+    case CALL_LIGHTS: return "DrawLights";
+    default: return "unknown";
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RenderRecorder::RenderRecorder(IRender &target)
+    : m_target(target)
+    , m_recording(false)
+    , m_pendingVertices(nullptr)
+    , m_pendingCount(0)
+    , m_pendingOffset(0)
+    , m_width(0)
+    , m_height(0)
+    , m_ambient(0)
+    , m_nextTextureId(1)
+    , m_nextBatchId(1)
+{
+}
+
+RenderRecorder::~RenderRecorder() = default;
+
+void RenderRecorder::StartRecording()
+{
+    m_trace.clear();
+    m_pendingVertices = nullptr;
+    m_recording = true;
+
+    Write(TRACE_MAGIC);
+    Write(TRACE_VERSION);
+
+    // the state set before the recording started
+    Write(RenderTrace::CALL_RESIZE);
+    Write<uint32>(m_width);
+    Write<uint32>(m_height);
+    Write(RenderTrace::CALL_AMBIENT);
+    Write(m_ambient);
+
+    std::vector<const TextureCopy*> textures;
+    for (auto &item : m_textures)
+        textures.push_back(&item.second);
+    std::sort(textures.begin(), textures.end(), [](const TextureCopy *a, const TextureCopy *b)
+    {
+        return a->traceId < b->traceId;
+    });
+    for (const TextureCopy *texture : textures)
+        WriteTexture(*texture);
+
+    if (!m_spriteFrames.empty())
+    {
+        Write(RenderTrace::CALL_SPRITE_FRAMES);
+        Write((uint32)m_spriteFrames.size());
+        WriteBytes(m_spriteFrames.data(), m_spriteFrames.size() * sizeof(SpriteFrame));
+    }
+}
+
+std::vector<uint8> RenderRecorder::StopRecording()
+{
+    FlushVertices();
+    m_recording = false;
+
+    std::vector<uint8> trace;
+    trace.swap(m_trace);
+    return trace;
+}
+
+void RenderRecorder::FlushVertices()
+{
+    if (!m_pendingVertices)
+        return;
+
+    for (size_t i = 0; i < m_pendingCount; ++i)
+        PackVertex(&m_trace[m_pendingOffset + i * PACKED_VERTEX_SIZE], m_pendingVertices[i]);
+    m_pendingVertices = nullptr;
+}
+
+void RenderRecorder::Write(RenderTrace::Call call)
+{
+    FlushVertices();
+    m_trace.push_back(call);
+}
+
+template <class T>
+void RenderRecorder::Write(const T &value)
+{
+    WriteBytes(&value, sizeof(T));
+}
+
+void RenderRecorder::WriteBytes(const void *data, size_t size)
+{
+    const uint8 *bytes = static_cast<const uint8 *>(data);
+    m_trace.insert(m_trace.end(), bytes, bytes + size);
+}
+
+void RenderRecorder::WriteRect(const RectInt *rect)
+{
+    Write<uint8>(rect ? 1 : 0);
+    if (rect)
+        Write(*rect);
+}
+
+void RenderRecorder::WriteTexture(const TextureCopy &texture)
+{
+    Write(RenderTrace::CALL_TEX_CREATE);
+    Write(texture.traceId);
+    Write(texture.width);
+    Write(texture.height);
+    Write(texture.bitsPerPixel);
+    Write<uint8>(texture.magFilter ? 1 : 0);
+    WriteBytes(texture.pixels.data(), texture.pixels.size());
+}
+
+uint32 RenderRecorder::GetTraceTexture(GlTexture tex) const
+{
+    auto found = m_textures.find(tex.index);
+    return found != m_textures.end() ? found->second.traceId : 0;
+}
+
+bool RenderRecorder::Init()
+{
+    return m_target.Init();
+}
+
+void RenderRecorder::OnResizeWnd(unsigned int width, unsigned int height)
+{
+    m_width = width;
+    m_height = height;
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_RESIZE);
+        Write<uint32>(width);
+        Write<uint32>(height);
+    }
+    m_target.OnResizeWnd(width, height);
+}
+
+void RenderRecorder::SetScissor(const RectInt *rect)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_SCISSOR);
+        WriteRect(rect);
+    }
+    m_target.SetScissor(rect);
+}
+
+void RenderRecorder::SetViewport(const RectInt *rect)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_VIEWPORT);
+        WriteRect(rect);
+    }
+    m_target.SetViewport(rect);
+}
+
+void RenderRecorder::Camera(const RectInt *vp, float x, float y, float scale)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_CAMERA);
+        WriteRect(vp);
+        Write(x);
+        Write(y);
+        Write(scale);
+    }
+    m_target.Camera(vp, x, y, scale);
+}
+
+void RenderRecorder::SetAmbient(float ambient)
+{
+    m_ambient = ambient;
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_AMBIENT);
+        Write(ambient);
+    }
+    m_target.SetAmbient(ambient);
+}
+
+void RenderRecorder::SetMode(const RenderMode mode)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_MODE);
+        Write<int32>(mode);
+    }
+    m_target.SetMode(mode);
+}
+
+void RenderRecorder::Begin()
+{
+    if (m_recording)
+        Write(RenderTrace::CALL_BEGIN);
+    m_target.Begin();
+}
+
+void RenderRecorder::End()
+{
+    if (m_recording)
+        Write(RenderTrace::CALL_END);
+    m_target.End();
+}
+
+void RenderRecorder::SetSortLayer(int layer, bool orderIndependent)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_SORT_LAYER);
+        Write<int32>(layer);
+        Write<uint8>(orderIndependent);
+    }
+    m_target.SetSortLayer(layer, orderIndependent);
+}
+
+bool RenderRecorder::TexCreate(GlTexture &tex, const IImage &img, bool magFilter)
+{
+    FlushVertices();
+    if (!m_target.TexCreate(tex, img, magFilter))
+        return false;
+
+    TextureCopy &texture = m_textures[tex.index];
+    texture.traceId = m_nextTextureId++;
+    texture.width = img.GetWidth();
+    texture.height = img.GetHeight();
+    texture.bitsPerPixel = img.GetBitsPerPixel();
+    texture.magFilter = magFilter;
+    if (IsCompressedFormat(img.GetFormat()))
+    {
+        // the traces keep raw pixels, a compressed texture is replayed white
+        texture.bitsPerPixel = 32;
+        texture.pixels.assign((size_t)texture.width * texture.height * 4, 255);
+    }
+    else
+        texture.pixels.assign(img.GetData(), img.GetData() + (size_t)texture.width * texture.height * (texture.bitsPerPixel / 8));
+
+    if (m_recording)
+        WriteTexture(texture);
+    return true;
+}
+
+void RenderRecorder::TexFree(GlTexture tex)
+{
+    auto found = m_textures.find(tex.index);
+    if (found != m_textures.end())
+    {
+        if (m_recording)
+        {
+            Write(RenderTrace::CALL_TEX_FREE);
+            Write(found->second.traceId);
+        }
+        m_textures.erase(found);
+    }
+    m_target.TexFree(tex);
+}
+
+Vertex* RenderRecorder::DrawQuad(GlTexture tex)
+{
+    if (!m_recording)
+        return m_target.DrawQuad(tex);
+
+    Write(RenderTrace::CALL_QUAD);
+    Write(GetTraceTexture(tex));
+    m_pendingOffset = m_trace.size();
+    m_trace.resize(m_trace.size() + 4 * PACKED_VERTEX_SIZE);
+
+    Vertex *vertices = m_target.DrawQuad(tex);
+    m_pendingVertices = vertices;
+    m_pendingCount = 4;
+    return vertices;
+}
+
+Vertex* RenderRecorder::DrawQuads(GlTexture tex, unsigned int count)
+{
+    if (!m_recording)
+        return m_target.DrawQuads(tex, count);
+
+    Write(RenderTrace::CALL_QUADS);
+    Write(GetTraceTexture(tex));
+    Write<uint32>(count);
+    m_pendingOffset = m_trace.size();
+    m_trace.resize(m_trace.size() + count * 4 * PACKED_VERTEX_SIZE);
+
+    Vertex *vertices = m_target.DrawQuads(tex, count);
+    m_pendingVertices = vertices;
+    m_pendingCount = count * 4;
+    return vertices;
+}
+
+Vertex* RenderRecorder::DrawFan(unsigned int nEdges)
+{
+    if (!m_recording)
+        return m_target.DrawFan(nEdges);
+
+    Write(RenderTrace::CALL_FAN);
+    Write<uint32>(nEdges);
+    m_pendingOffset = m_trace.size();
+    m_trace.resize(m_trace.size() + (nEdges + 1) * PACKED_VERTEX_SIZE);
+
+    Vertex *vertices = m_target.DrawFan(nEdges);
+    m_pendingVertices = vertices;
+    m_pendingCount = nEdges + 1;
+    return vertices;
+}
+
+unsigned int RenderRecorder::CreateStaticBatch()
+{
+    FlushVertices();
+    const unsigned int batch = m_target.CreateStaticBatch();
+    if (batch)
+    {
+        const uint32 traceId = m_nextBatchId++;
+        m_batches[batch] = traceId;
+        if (m_recording)
+        {
+            Write(RenderTrace::CALL_CREATE_STATIC_BATCH);
+            Write(traceId);
+        }
+    }
+    return batch;
+}
+
+void RenderRecorder::FreeStaticBatch(unsigned int batch)
+{
+    auto found = m_batches.find(batch);
+    if (found != m_batches.end())
+    {
+        if (m_recording)
+        {
+            Write(RenderTrace::CALL_FREE_STATIC_BATCH);
+            Write(found->second);
+        }
+        m_batches.erase(found);
+    }
+    m_target.FreeStaticBatch(batch);
+}
+
+void RenderRecorder::BeginStaticBatch(unsigned int batch)
+{
+    if (m_recording)
+    {
+        auto found = m_batches.find(batch);
+        Write(RenderTrace::CALL_BEGIN_STATIC_BATCH);
+        Write<uint32>(found != m_batches.end() ? found->second : 0);
+    }
+    m_target.BeginStaticBatch(batch);
+}
+
+void RenderRecorder::EndStaticBatch()
+{
+    if (m_recording)
+        Write(RenderTrace::CALL_END_STATIC_BATCH);
+    m_target.EndStaticBatch();
+}
+
+void RenderRecorder::DrawStaticBatch(unsigned int batch)
+{
+    if (m_recording)
+    {
+        auto found = m_batches.find(batch);
+        Write(RenderTrace::CALL_DRAW_STATIC_BATCH);
+        Write<uint32>(found != m_batches.end() ? found->second : 0);
+    }
+    m_target.DrawStaticBatch(batch);
+}
+
+void RenderRecorder::SetSpriteFrames(const SpriteFrame *frames, size_t count)
+{
+    m_spriteFrames.assign(frames, frames + count);
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_SPRITE_FRAMES);
+        Write((uint32)count);
+        WriteBytes(frames, count * sizeof(SpriteFrame));
+    }
+    m_target.SetSpriteFrames(frames, count);
+}
+
+void RenderRecorder::DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_SPRITES);
+        Write(GetTraceTexture(tex));
+        Write((uint32)count);
+        WriteBytes(sprites, count * sizeof(SpriteInstance));
+    }
+    m_target.DrawSprites(tex, sprites, count);
+}
+
+void RenderRecorder::DrawLights(const LightInstance *lights, size_t count)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_LIGHTS);
+        Write((uint32)count);
+        WriteBytes(lights, count * sizeof(LightInstance));
+    }
+    m_target.DrawLights(lights, count);
+}
+
+void RenderRecorder::DrawTriangles(const ColoredVertex* vertices, std::size_t count)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_TRIANGLES);
+        Write((uint32)count);
+        WriteBytes(vertices, count * sizeof(ColoredVertex));
+    }
+    m_target.DrawTriangles(vertices, count);
+}
+
+void RenderRecorder::DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_POINTS);
+        Write((uint32)count);
+        Write(pointSize);
+        WriteBytes(points, count * sizeof(ColoredVertex));
+    }
+    m_target.DrawPoints(points, count, pointSize);
+}
+
+void RenderRecorder::DrawLines(const Line *lines, size_t count)
+{
+    if (m_recording)
+    {
+        Write(RenderTrace::CALL_LINES);
+        Write((uint32)count);
+        WriteBytes(lines, count * sizeof(Line));
+    }
+    m_target.DrawLines(lines, count);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+RenderTracePlayer::RenderTracePlayer(std::vector<uint8> trace)
+    : m_trace(std::move(trace))
+{
+    Reader header(m_trace, 0);
+    if (header.Read<uint32>() != TRACE_MAGIC || header.Read<uint32>() != TRACE_VERSION)
+        throw std::runtime_error("not a render trace or unsupported version");
+
+    // a frame takes everything since the previous End, the calls after the last End are dropped
+    size_t frameBegin = header.GetOffset();
+    for (size_t offset = frameBegin; offset < m_trace.size(); )
+    {
+        const RenderTrace::Call call = (RenderTrace::Call)m_trace[offset];
+        offset = Skip(offset);
+        if (call == RenderTrace::CALL_END)
+        {
+            m_frames.push_back(Frame{ frameBegin, offset });
+            frameBegin = offset;
+        }
+    }
+}
+
+size_t RenderTracePlayer::Skip(size_t offset) const
+{
+    using namespace RenderTrace;
+
+    Reader reader(m_trace, offset);
+    const Call call = (Call)reader.Read<uint8>();
+    RectInt rect;
+
+    switch (call)
+    {
+    case CALL_RESIZE:
+        reader.Bytes(8);
+        break;
+    case CALL_SCISSOR:
+    case CALL_VIEWPORT:
+        reader.ReadRect(rect);
+        break;
+    case CALL_CAMERA:
+        reader.ReadRect(rect);
+        reader.Bytes(12);
+        break;
+    case CALL_SORT_LAYER:
+        reader.Bytes(5);
+        break;
+    case CALL_AMBIENT:
+    case CALL_MODE:
+    case CALL_TEX_FREE:
+    case CALL_CREATE_STATIC_BATCH:
+    case CALL_FREE_STATIC_BATCH:
+    case CALL_BEGIN_STATIC_BATCH:
+    case CALL_DRAW_STATIC_BATCH:
+        reader.Bytes(4);
+        break;
+    case CALL_BEGIN:
+    case CALL_END:
+    case CALL_END_STATIC_BATCH:
+        break;
+    case CALL_TEX_CREATE:
+    {
+        reader.Bytes(4);
+        const uint32 width = reader.Read<uint32>();
+        const uint32 height = reader.Read<uint32>();
+        const uint8 bitsPerPixel = reader.Read<uint8>();
+        reader.Bytes(1);
+        if (bitsPerPixel != 24 && bitsPerPixel != 32)
+            throw std::runtime_error("render trace has a texture of unsupported format");
+        const uint64 size = (uint64)width * height * (bitsPerPixel / 8);
+        if (size > m_trace.size())
+            throw std::runtime_error("render trace is truncated");
+        reader.Bytes((size_t)size);
+        break;
+    }
+    case CALL_QUAD:
+        reader.Bytes(4 + 4 * PACKED_VERTEX_SIZE);
+        break;
+    case CALL_QUADS:
+    {
+        reader.Bytes(4);
+        const uint32 count = reader.Read<uint32>();
+        if (count == 0 || count > IRender::MAX_QUADS)
+            throw std::runtime_error("render trace is corrupted");
+        reader.Array(count * 4, PACKED_VERTEX_SIZE);
+        break;
+    }
+    case CALL_FAN:
+    {
+        const uint32 edges = reader.Read<uint32>();
+        if (edges == 0 || edges == UINT32_MAX)
+            throw std::runtime_error("render trace is corrupted");
+        reader.Array(edges + 1, PACKED_VERTEX_SIZE);
+        break;
+    }
+    case CALL_SPRITE_FRAMES:
+        reader.Array(reader.Read<uint32>(), sizeof(SpriteFrame));
+        break;
+    case CALL_SPRITES:
+        reader.Bytes(4);
+        reader.Array(reader.Read<uint32>(), sizeof(SpriteInstance));
+        break;
+    case CALL_TRIANGLES:
+        reader.Array(reader.Read<uint32>(), sizeof(ColoredVertex));
+        break;
+    case CALL_POINTS:
+    {
+        const uint32 count = reader.Read<uint32>();
+        reader.Bytes(4);
+        reader.Array(count, sizeof(ColoredVertex));
+        break;
+    }
+    case CALL_LINES:
+        reader.Array(reader.Read<uint32>(), sizeof(Line));
+        break;
+    case CALL_LIGHTS:
+    {
+        const uint32 count = reader.Read<uint32>();
+        const uint8 *src = reader.Array(count, sizeof(LightInstance));
+        for (uint32 i = 0; i < count; ++i)
+        {
+            LightInstance light;
+            memcpy(&light, src + i * sizeof(LightInstance), sizeof(light));
+            if (light.edges == 0 || LIGHT_RING_SIZE % light.edges != 0)
+                throw std::runtime_error("render trace is corrupted");
+        }
+        break;
+    }
+    default:
+        throw std::runtime_error("render trace has an unknown call");
+    }
+
+    return reader.GetOffset();
+}
+
+void RenderTracePlayer::Prepare(IRender &render)
+{
+    for (size_t offset = 8; offset < m_trace.size(); offset = Skip(offset))
+    {
+        if (m_trace[offset] != RenderTrace::CALL_TEX_CREATE)
+            continue;
+
+        Reader reader(m_trace, offset + 1);
+        const uint32 id = reader.Read<uint32>();
+        const uint32 width = reader.Read<uint32>();
+        const uint32 height = reader.Read<uint32>();
+        const uint8 bitsPerPixel = reader.Read<uint8>();
+        const bool magFilter = reader.Read<uint8>() != 0;
+        const TraceImage image(m_trace.data() + reader.GetOffset(), width, height, bitsPerPixel);
+
+        GlTexture tex;
+        tex.ptr = nullptr;
+        if (m_textures.find(id) == m_textures.end() && render.TexCreate(tex, image, magFilter))
+            m_textures[id] = tex;
+    }
+}
+
+void RenderTracePlayer::Release(IRender &render)
+{
+    for (auto &batch : m_batches)
+        render.FreeStaticBatch(batch.second);
+    m_batches.clear();
+
+    for (auto &texture : m_textures)
+        render.TexFree(texture.second);
+    m_textures.clear();
+}
+
+void RenderTracePlayer::PlayFrame(IRender &render, size_t frame, Timings *timings)
+{
+    assert(frame < m_frames.size());
+
+    using Clock = std::chrono::steady_clock;
+    for (size_t offset = m_frames[frame].begin; offset < m_frames[frame].end; )
+    {
+        const RenderTrace::Call call = (RenderTrace::Call)m_trace[offset];
+        if (!timings || call == RenderTrace::CALL_TEX_CREATE || call == RenderTrace::CALL_TEX_FREE)
+        {
+            offset = Play(render, offset);
+            continue;
+        }
+
+        const Clock::time_point start = Clock::now();
+        offset = Play(render, offset);
+        const Clock::time_point finish = Clock::now();
+
+        RenderTracePlayer::CallStats &stats = timings->calls[call];
+        ++stats.count;
+        stats.seconds += std::chrono::duration<double>(finish - start).count();
+    }
+}
+
+size_t RenderTracePlayer::Play(IRender &render, size_t offset)
+{
+    using namespace RenderTrace;
+
+    // validated by the constructor already
+    Reader reader(m_trace, offset);
+    const Call call = (Call)reader.Read<uint8>();
+    RectInt rect;
+
+    auto textureOf = [this](uint32 id)
+    {
+        auto found = m_textures.find(id);
+        GlTexture tex;
+        tex.ptr = nullptr;
+        return found != m_textures.end() ? found->second : tex;
+    };
+    auto batchOf = [this](uint32 id)
+    {
+        auto found = m_batches.find(id);
+        return found != m_batches.end() ? found->second : 0u;
+    };
+
+    switch (call)
+    {
+    case CALL_RESIZE:
+    {
+        const uint32 width = reader.Read<uint32>();
+        const uint32 height = reader.Read<uint32>();
+        render.OnResizeWnd(width, height);
+        break;
+    }
+    case CALL_SCISSOR:
+        render.SetScissor(reader.ReadRect(rect));
+        break;
+    case CALL_VIEWPORT:
+        render.SetViewport(reader.ReadRect(rect));
+        break;
+    case CALL_CAMERA:
+    {
+        const RectInt *vp = reader.ReadRect(rect);
+        const float x = reader.Read<float>();
+        const float y = reader.Read<float>();
+        const float scale = reader.Read<float>();
+        render.Camera(vp, x, y, scale);
+        break;
+    }
+    case CALL_AMBIENT:
+        render.SetAmbient(reader.Read<float>());
+        break;
+    case CALL_MODE:
+        render.SetMode((RenderMode)reader.Read<int32>());
+        break;
+    case CALL_BEGIN:
+        render.Begin();
+        break;
+    case CALL_END:
+        render.End();
+        break;
+    case CALL_SORT_LAYER:
+    {
+        const int32 layer = reader.Read<int32>();
+        render.SetSortLayer(layer, reader.Read<uint8>() != 0);
+        break;
+    }
+    case CALL_TEX_CREATE:
+    case CALL_TEX_FREE:
+        // Prepare and Release take care of the textures, the frames can be played again
+        return Skip(offset);
+    case CALL_QUAD:
+    {
+        const GlTexture tex = textureOf(reader.Read<uint32>());
+        const uint8 *src = reader.Bytes(4 * PACKED_VERTEX_SIZE);
+        Vertex *v = render.DrawQuad(tex);
+        for (int i = 0; i < 4; ++i)
+            UnpackVertex(v[i], src + i * PACKED_VERTEX_SIZE);
+        break;
+    }
+    case CALL_QUADS:
+    {
+        const GlTexture tex = textureOf(reader.Read<uint32>());
+        const uint32 count = reader.Read<uint32>();
+        const uint8 *src = reader.Array(count * 4, PACKED_VERTEX_SIZE);
+        Vertex *v = render.DrawQuads(tex, count);
+        for (uint32 i = 0; i < count * 4; ++i)
+            UnpackVertex(v[i], src + i * PACKED_VERTEX_SIZE);
+        break;
+    }
+    case CALL_FAN:
+    {
+        const uint32 edges = reader.Read<uint32>();
+        const uint8 *src = reader.Array(edges + 1, PACKED_VERTEX_SIZE);
+        Vertex *v = render.DrawFan(edges);
+        for (uint32 i = 0; i <= edges; ++i)
+            UnpackVertex(v[i], src + i * PACKED_VERTEX_SIZE);
+        break;
+    }
+    case CALL_CREATE_STATIC_BATCH:
+    {
+        // the same frame played again keeps the batch it has created the first time
+        const uint32 id = reader.Read<uint32>();
+        if (!m_batches.count(id))
+        {
+            if (unsigned int batch = render.CreateStaticBatch())
+                m_batches[id] = batch;
+        }
+        break;
+    }
+    case CALL_FREE_STATIC_BATCH:
+    {
+        const uint32 id = reader.Read<uint32>();
+        if (const unsigned int batch = batchOf(id))
+        {
+            render.FreeStaticBatch(batch);
+            m_batches.erase(id);
+        }
+        break;
+    }
+    case CALL_BEGIN_STATIC_BATCH:
+        render.BeginStaticBatch(batchOf(reader.Read<uint32>()));
+        break;
+    case CALL_END_STATIC_BATCH:
+        render.EndStaticBatch();
+        break;
+    case CALL_DRAW_STATIC_BATCH:
+        if (const unsigned int batch = batchOf(reader.Read<uint32>()))
+            render.DrawStaticBatch(batch);
+        break;
+    case CALL_SPRITE_FRAMES:
+    {
+        const uint32 count = reader.Read<uint32>();
+        m_spriteFrames.resize(count);
+        memcpy(static_cast<void *>(m_spriteFrames.data()), reader.Array(count, sizeof(SpriteFrame)), count * sizeof(SpriteFrame));
+        render.SetSpriteFrames(m_spriteFrames.data(), count);
+        break;
+    }
+    case CALL_SPRITES:
+    {
+        const GlTexture tex = textureOf(reader.Read<uint32>());
+        const uint32 count = reader.Read<uint32>();
+        m_sprites.resize(count);
+        memcpy(m_sprites.data(), reader.Array(count, sizeof(SpriteInstance)), count * sizeof(SpriteInstance));
+        render.DrawSprites(tex, m_sprites.data(), count);
+        break;
+    }
+    case CALL_TRIANGLES:
+    {
+        const uint32 count = reader.Read<uint32>();
+        m_coloredVertices.resize(count);
+        memcpy(static_cast<void *>(m_coloredVertices.data()), reader.Array(count, sizeof(ColoredVertex)), count * sizeof(ColoredVertex));
+        render.DrawTriangles(m_coloredVertices.data(), count);
+        break;
+    }
+    case CALL_POINTS:
+    {
+        const uint32 count = reader.Read<uint32>();
+        const float pointSize = reader.Read<float>();
+        m_coloredVertices.resize(count);
+        memcpy(static_cast<void *>(m_coloredVertices.data()), reader.Array(count, sizeof(ColoredVertex)), count * sizeof(ColoredVertex));
+        render.DrawPoints(m_coloredVertices.data(), count, pointSize);
+        break;
+    }
+    case CALL_LINES:
+    {
+        const uint32 count = reader.Read<uint32>();
+        m_lines.resize(count);
+        memcpy(static_cast<void *>(m_lines.data()), reader.Array(count, sizeof(Line)), count * sizeof(Line));
+        render.DrawLines(m_lines.data(), count);
+        break;
+    }
+    case CALL_LIGHTS:
+    {
+        const uint32 count = reader.Read<uint32>();
+        m_lights.resize(count);
+        memcpy(static_cast<void *>(m_lights.data()), reader.Array(count, sizeof(LightInstance)), count * sizeof(LightInstance));
+        render.DrawLights(m_lights.data(), count);
+        break;
+    }
+    default:
+        assert(false);
+        break;
+    }
+
+    return reader.GetOffset();
+}
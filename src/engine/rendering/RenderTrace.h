@@ -0,0 +1,195 @@
+#pragma once
+
+#include "base/IRender.h"
+#include "ColoredVertex.h"
+#include "GlTexture.h"
+#include "LightInstance.h"
+#include "Line.h"
+#include "SpriteInstance.h"
+#include "common/Types.h"
+
+#include <unordered_map>
+#include <vector>
+
+// Binary trace of the IRender calls: a header followed by records, each one an opcode byte and
+// its arguments. Texture and static batch ids are the trace's own, replay maps them to the ids
+// of the render it draws to. Multibyte values are stored in the byte order of the machine.
+namespace RenderTrace
+{
+    enum Call : uint8
+    {
+        CALL_RESIZE,
+        CALL_SCISSOR,
+        CALL_VIEWPORT,
+        CALL_CAMERA,
+        CALL_AMBIENT,
+        CALL_MODE,
+        CALL_BEGIN,
+        CALL_END,
+        CALL_SORT_LAYER,
+        CALL_TEX_CREATE,
+        CALL_TEX_FREE,
+        CALL_QUAD,
+        CALL_FAN,
+        CALL_CREATE_STATIC_BATCH,
+        CALL_FREE_STATIC_BATCH,
+        CALL_BEGIN_STATIC_BATCH,
+        CALL_END_STATIC_BATCH,
+        CALL_DRAW_STATIC_BATCH,
+        CALL_SPRITE_FRAMES,
+        CALL_SPRITES,
+        CALL_TRIANGLES,
+        CALL_POINTS,
+        CALL_LINES,
+        CALL_QUADS,
+        CALL_LIGHTS,
+
+        CALL_COUNT
+    };
+
+    const char* GetCallName(Call call);
+}
+
+// Forwards every call to the target render and, while recording, appends it to a trace.
+// It keeps a copy of the pixels of every live texture, so a recording started in the middle of
+// a game still carries all the textures it needs.
+class RenderRecorder : public IRender
+{
+public:
+    explicit RenderRecorder(IRender &target);
+    ~RenderRecorder() override;
+
+    // best started right before Begin, the frames of the trace are Begin to End
+    void StartRecording();
+    std::vector<uint8> StopRecording();
+    bool IsRecording() const { return m_recording; }
+
+    // IRender
+    bool Init() override;
+    void OnResizeWnd(unsigned int width, unsigned int height) override;
+
+    void SetScissor(const RectInt *rect) override;
+    void SetViewport(const RectInt *rect) override;
+    void Camera(const RectInt *vp, float x, float y, float scale) override;
+
+    void SetAmbient(float ambient) override;
+    void SetMode(const RenderMode mode) override;
+
+    void Begin() override;
+    void End() override;
+
+    void SetSortLayer(int layer, bool orderIndependent) override;
+
+    bool TexCreate(GlTexture &tex, const IImage &img, bool magFilter) override;
+    void TexFree(GlTexture tex) override;
+
+    Vertex* DrawQuad(GlTexture tex) override;
+    Vertex* DrawQuads(GlTexture tex, unsigned int count) override;
+    Vertex* DrawFan(unsigned int nEdges) override;
+
+    unsigned int CreateStaticBatch() override;
+    void FreeStaticBatch(unsigned int batch) override;
+    void BeginStaticBatch(unsigned int batch) override;
+    void EndStaticBatch() override;
+    void DrawStaticBatch(unsigned int batch) override;
+
+    void SetSpriteFrames(const SpriteFrame *frames, size_t count) override;
+    void DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count) override;
+    void DrawLights(const LightInstance *lights, size_t count) override;
+
+    void DrawTriangles(const ColoredVertex* vertices, std::size_t count) override;
+    void DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize) override;
+    void DrawLines(const Line *lines, size_t count) override;
+
+private:
+    struct TextureCopy
+    {
+        uint32 traceId;
+        uint32 width;
+        uint32 height;
+        uint8 bitsPerPixel;
+        bool magFilter;
+        std::vector<uint8> pixels;
+    };
+
+    // the vertices are filled by the caller after DrawQuad and DrawFan return
+    void FlushVertices();
+    void Write(RenderTrace::Call call);
+    template <class T> void Write(const T &value);
+    void WriteBytes(const void *data, size_t size);
+    void WriteRect(const RectInt *rect);
+    void WriteTexture(const TextureCopy &texture);
+    uint32 GetTraceTexture(GlTexture tex) const;
+
+    IRender &m_target;
+    bool m_recording;
+    std::vector<uint8> m_trace;
+
+    const Vertex *m_pendingVertices;
+    size_t m_pendingCount;
+    size_t m_pendingOffset;             // of the space reserved for them in m_trace
+
+    std::unordered_map<unsigned int, TextureCopy> m_textures;      // by the target's texture index
+    std::unordered_map<unsigned int, uint32> m_batches;            // target batch to trace batch
+
+    // the state written when a recording starts
+    unsigned int m_width;
+    unsigned int m_height;
+    float m_ambient;
+    std::vector<SpriteFrame> m_spriteFrames;
+
+    uint32 m_nextTextureId;
+    uint32 m_nextBatchId;
+};
+
+// Plays a trace back. Prepare creates all the textures of the trace, then the frames can be
+// played any number of times; Release frees what was created.
+class RenderTracePlayer
+{
+public:
+    struct CallStats
+    {
+        uint64 count;
+        double seconds;
+    };
+
+    struct Timings
+    {
+        CallStats calls[RenderTrace::CALL_COUNT];
+    };
+
+    // throws std::runtime_error when the trace is malformed
+    explicit RenderTracePlayer(std::vector<uint8> trace);
+
+    size_t GetFramesCount() const { return m_frames.size(); }
+
+    void Prepare(IRender &render);
+    void Release(IRender &render);
+
+    // plays the calls since the end of the previous frame up to the End of this one,
+    // the time spent in every call is added to 'timings' when given
+    void PlayFrame(IRender &render, size_t frame, Timings *timings = nullptr);
+
+private:
+    struct Frame
+    {
+        size_t begin;
+        size_t end;
+    };
+
+    size_t Play(IRender &render, size_t offset);
+    size_t Skip(size_t offset) const;
+
+    std::vector<uint8> m_trace;
+    std::vector<Frame> m_frames;
+
+    std::unordered_map<uint32, GlTexture> m_textures;
+    std::unordered_map<uint32, unsigned int> m_batches;
+
+    // the arrays copied out of the trace to have them aligned
+    std::vector<SpriteFrame> m_spriteFrames;
+    std::vector<SpriteInstance> m_sprites;
+    std::vector<LightInstance> m_lights;
+    std::vector<ColoredVertex> m_coloredVertices;
+    std::vector<Line> m_lines;
+};
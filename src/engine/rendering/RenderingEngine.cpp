@@ -3,10 +3,18 @@
 
 RenderingEngine::RenderingEngine(IRender* render, int layersCount, std::shared_ptr<IWindow> window)
 	: m_render(render)
+	, m_textureDecoder(2)
 	, m_textures(*render)
 	, m_scheme(0, layersCount)
 	, m_window(window)
+	, m_uploadTime(0)
 {
+	m_textures.SetAsyncUploads(&m_textureDecoder);
+}
+
+RenderingEngine::~RenderingEngine()
+{
+	m_scheme.ReleaseStaticBatches(*m_render);
 }
 
 void RenderingEngine::SetMode(RenderMode mode)
@@ -17,11 +25,15 @@ void RenderingEngine::SetMode(RenderMode mode)
 void RenderingEngine::PreRender()
 {
 	m_render->Begin();
+
+	const auto start = std::chrono::steady_clock::now();
+	m_textures.ProcessUploads();
+	m_uploadTime = std::chrono::steady_clock::now() - start;
 }
 
 void RenderingEngine::Render(float interpolation)
 {
-	DrawingContext dc(m_textures, m_render, GetPixelWidth(), GetPixelHeight());
+	DrawingContext dc(m_textures, m_render, GetPixelWidth(), GetPixelHeight(), m_glyphRuns);
 	m_scheme.Draw(dc, interpolation);
 }
 
@@ -2,8 +2,12 @@
 
 #include "TextureManager.h"
 #include "RenderScheme.h"
+#include "GlyphRunCache.h"
+#include "threading/ThreadPool.h"
 #include "Base/IWindow.h"
 
+#include <chrono>
+
 
 struct IRender;
 class DrawingContext;
@@ -12,6 +16,7 @@ class RenderingEngine
 {
 public:
 	explicit RenderingEngine(IRender* render, int layersCount, std::shared_ptr<IWindow> window);
+	~RenderingEngine();
 
 	TextureManager& GetTextureManager() { return m_textures; }
 	const TextureManager& GetTextureManager() const { return m_textures; }
@@ -21,12 +26,18 @@ public:
 		return m_scheme;
 	}
 
+	// the text laid out by the frames drawn so far, see DrawingContext::DrawBitmapText
+	const GlyphRunCache& GetGlyphRunCache() const { return m_glyphRuns; }
+
 	void SetMode(RenderMode mode);
 
 	void PreRender();
 	void Render(float interpolation);
 	void PostRender();
 
+	// time the texture uploads of the last PreRender took, for GameLoop::ReportTime(Subsystem::Uploads)
+	std::chrono::steady_clock::duration GetUploadTime() const { return m_uploadTime; }
+
 	unsigned int GetPixelWidth() const { return m_window->GetPixelWidth(); }
 	unsigned int GetPixelHeight() const { return m_window->GetPixelHeight(); }
 
@@ -36,6 +47,11 @@ private:
 
 	std::shared_ptr<IWindow> m_window;
 	IRender* m_render;
+	// decodes the textures, which are uploaded a few per frame by PreRender; before
+	// m_textures, which waits for its tasks when destroyed
+	ThreadPool m_textureDecoder;
 	TextureManager m_textures;
+	GlyphRunCache m_glyphRuns;
 	RenderScheme m_scheme;
+	std::chrono::steady_clock::duration m_uploadTime;
 };
@@ -0,0 +1,148 @@
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+// more cells than that and the item is tested on every query instead
+static const int MAX_ITEM_CELLS = 64;
+
+SpatialGrid::SpatialGrid(float cellSize)
+    : m_cellSize(cellSize)
+{
+    assert(cellSize > 0);
+}
+
+RectInt SpatialGrid::GetCells(const RectFloat& bounds) const
+{
+    return RectInt{
+        (int)std::floor(bounds.left / m_cellSize),
+        (int)std::floor(bounds.top / m_cellSize),
+        (int)std::floor(bounds.right / m_cellSize) + 1,
+        (int)std::floor(bounds.bottom / m_cellSize) + 1
+    };
+}
+
+void SpatialGrid::Insert(const IDrawable* item, uint64_t key, const RectFloat* bounds)
+{
+    const RectFloat itemBounds = bounds ? *bounds : RectFloat{};
+    const RectInt cells = bounds ? GetCells(*bounds) : RectInt{};
+    const bool oversized = !bounds || (int64_t)WIDTH(cells) * HEIGHT(cells) > MAX_ITEM_CELLS;
+
+    auto emplaced = m_items.emplace(item, Item{ item, key, itemBounds, cells, bounds != nullptr, oversized, m_queryStamp });
+    assert(emplaced.second);
+    const Item* entry = &emplaced.first->second;
+
+    if (oversized)
+    {
+        m_oversized.push_back(entry);
+        return;
+    }
+
+    for (int y = cells.top; y < cells.bottom; ++y)
+        for (int x = cells.left; x < cells.right; ++x)
+            m_cells[CellKey(x, y)].push_back(entry);
+}
+
+void SpatialGrid::Update(const IDrawable* item, const RectFloat* bounds)
+{
+    auto found = m_items.find(item);
+    assert(found != m_items.end());
+    Item& entry = found->second;
+
+    // moving inside the same cells is the common case
+    if (bounds && entry.bounded && !entry.oversized)
+    {
+        const RectInt cells = GetCells(*bounds);
+        if (cells.left == entry.cells.left && cells.top == entry.cells.top && cells.right == entry.cells.right && cells.bottom == entry.cells.bottom)
+        {
+            entry.bounds = *bounds;
+            return;
+        }
+    }
+
+    const uint64_t key = entry.key;
+    Remove(item);
+    Insert(item, key, bounds);
+}
+
+void SpatialGrid::Remove(const IDrawable* item)
+{
+    auto found = m_items.find(item);
+    assert(found != m_items.end());
+
+    const Item* entry = &found->second;
+    if (entry->oversized)
+    {
+        m_oversized.erase(std::find(m_oversized.begin(), m_oversized.end(), entry));
+    }
+    else
+    {
+        const RectInt& cells = found->second.cells;
+        for (int y = cells.top; y < cells.bottom; ++y)
+        {
+            for (int x = cells.left; x < cells.right; ++x)
+            {
+                auto cell = m_cells.find(CellKey(x, y));
+                assert(cell != m_cells.end());
+
+                std::vector<const Item*>& cellItems = cell->second;
+                cellItems.erase(std::find(cellItems.begin(), cellItems.end(), entry));
+                if (cellItems.empty())
+                    m_cells.erase(cell);
+            }
+        }
+    }
+
+    m_items.erase(found);
+}
+
+void SpatialGrid::Query(const RectFloat& region, std::vector<Hit>& result) const
+{
+    // an item in several cells is reported for the first of them only
+    ++m_queryStamp;
+
+    const RectInt cells = GetCells(region);
+    if ((int64_t)WIDTH(cells) * HEIGHT(cells) > (int64_t)m_cells.size())
+    {
+        // zoomed out, cheaper to look at the occupied cells than at the region ones
+        for (auto& cell : m_cells)
+        {
+            for (const Item* entry : cell.second)
+            {
+                if (entry->queryStamp != m_queryStamp && FRectsIntersect(entry->bounds, region))
+                {
+                    entry->queryStamp = m_queryStamp;
+                    result.push_back(Hit{ entry->key, entry->drawable });
+                }
+            }
+        }
+    }
+    else
+    {
+        for (int y = cells.top; y < cells.bottom; ++y)
+        {
+            for (int x = cells.left; x < cells.right; ++x)
+            {
+                auto cell = m_cells.find(CellKey(x, y));
+                if (cell == m_cells.end())
+                    continue;
+
+                for (const Item* entry : cell->second)
+                {
+                    if (entry->queryStamp != m_queryStamp && FRectsIntersect(entry->bounds, region))
+                    {
+                        entry->queryStamp = m_queryStamp;
+                        result.push_back(Hit{ entry->key, entry->drawable });
+                    }
+                }
+            }
+        }
+    }
+
+    for (const Item* entry : m_oversized)
+    {
+        if (!entry->bounded || FRectsIntersect(entry->bounds, region))
+            result.push_back(Hit{ entry->key, entry->drawable });
+    }
+}
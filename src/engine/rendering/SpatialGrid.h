@@ -0,0 +1,54 @@
+#pragma once
+
+#include "math/Rect.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct IDrawable;
+
+// Uniform grid of drawable bounds for culling. An item is kept in every cell its bounds touch,
+// items spanning too many cells are kept aside and tested one by one.
+class SpatialGrid
+{
+public:
+    struct Hit
+    {
+        uint64_t key;
+        const IDrawable* item;
+    };
+
+    explicit SpatialGrid(float cellSize = 256);
+
+    // the key comes back with the hits, unbounded items (no bounds) are hit by every query
+    void Insert(const IDrawable* item, uint64_t key, const RectFloat* bounds);
+    void Update(const IDrawable* item, const RectFloat* bounds);
+    void Remove(const IDrawable* item);
+
+    bool Contains(const IDrawable* item) const { return m_items.count(item) != 0; }
+
+    // appends the items overlapping the region, each once, in no particular order
+    void Query(const RectFloat& region, std::vector<Hit>& result) const;
+
+private:
+    struct Item
+    {
+        const IDrawable* drawable;
+        uint64_t key;
+        RectFloat bounds;
+        RectInt cells;
+        bool bounded;
+        bool oversized;
+        mutable uint32_t queryStamp;
+    };
+
+    RectInt GetCells(const RectFloat& bounds) const;
+    static uint64_t CellKey(int x, int y) { return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y; }
+
+    float m_cellSize;
+    std::unordered_map<uint64_t, std::vector<const Item*>> m_cells;
+    std::unordered_map<const IDrawable*, Item> m_items;   // the nodes do not move, the cells point to them
+    std::vector<const Item*> m_oversized;                   // and the unbounded ones
+    mutable uint32_t m_queryStamp = 0;
+};
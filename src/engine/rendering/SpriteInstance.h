@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Color.h"
+#include "Vertex.h"
+#include "VertexSimd.h"
+#include "math/Rect.h"
+
+#include <cstddef>
+
+// One sprite of an instanced batch, the renders expand it into a quad themselves
+struct SpriteInstance
+{                       // offset  size
+    float x, y;         //   0       8   pivot position
+    float width, height;//   8       8
+    float dirX, dirY;   //  16       8   rotation, (1, 0) is upright
+    uint32 frame;       //  24       4   index in the sprite frames table
+    Color color;        //  28       4
+};
+
+// Entry of the sprite frames table the render keeps, one per frame of every logical texture
+struct SpriteFrame
+{
+    RectFloat uv;
+    Vec2F pivot;        // fraction of the sprite size
+};
+
+// the same quad DrawingContext::DrawSprite produces
+inline void ExpandSprite(Vertex *v, const SpriteFrame &frame, const SpriteInstance &sprite)
+{
+    VertexSimd::WriteSpriteQuad(v, frame.uv, sprite.color, sprite.x, sprite.y,
+                                frame.pivot.x * sprite.width, frame.pivot.y * sprite.height,
+                                sprite.width, sprite.height, sprite.dirX, sprite.dirY);
+}
+
+// 'count' quads into v, frames indexes the sprite frames table
+inline void ExpandSprites(Vertex *v, const SpriteFrame *frames, const SpriteInstance *sprites, size_t count)
+{
+    for (size_t i = 0; i < count; ++i, v += 4)
+        ExpandSprite(v, frames[sprites[i].frame], sprites[i]);
+}
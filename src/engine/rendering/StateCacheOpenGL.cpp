@@ -0,0 +1,156 @@
+#include "StateCacheOpenGL.h"
+
+#include "glm/gtc/type_ptr.hpp" // glm::value_ptr
+
+#include <cassert>
+#include <cstring>
+
+// no object has this name, whatever is bound differs from it
+static const GLuint UNKNOWN = ~0u;
+
+StateCacheOpenGL::StateCacheOpenGL()
+    : m_matricesBuffer(0)
+    , m_matricesValid(false)
+{
+    Invalidate();
+
+    glGenBuffers(1, &m_matricesBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_matricesBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(m_matrices), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATRICES_BINDING, m_matricesBuffer);
+}
+
+StateCacheOpenGL::~StateCacheOpenGL()
+{
+    if (m_matricesBuffer)
+    {
+        glDeleteBuffers(1, &m_matricesBuffer);
+        m_matricesBuffer = 0;
+    }
+}
+
+bool StateCacheOpenGL::Changes(bool same)
+{
+    if (same)
+        ++m_frameStats.skipped;
+    else
+        ++m_frameStats.changes;
+    return !same;
+}
+
+void StateCacheOpenGL::UseProgram(GLuint program)
+{
+    if (Changes(m_program == program))
+    {
+        glUseProgram(program);
+        m_program = program;
+    }
+}
+
+void StateCacheOpenGL::BindVertexArray(GLuint vertexArray)
+{
+    if (Changes(m_vertexArray == vertexArray))
+    {
+        glBindVertexArray(vertexArray);
+        m_vertexArray = vertexArray;
+    }
+}
+
+void StateCacheOpenGL::BindTexture(GLenum target, GLuint texture, unsigned int unit)
+{
+    assert(unit < MAX_TEXTURE_UNITS);
+    assert(target == GL_TEXTURE_2D || target == GL_TEXTURE_BUFFER);
+
+    GLuint& bound = (target == GL_TEXTURE_2D ? m_textures2D : m_texturesBuffer)[unit];
+    if (Changes(bound == texture))
+    {
+        if (m_activeUnit != unit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            m_activeUnit = unit;
+        }
+        glBindTexture(target, texture);
+        bound = texture;
+    }
+}
+
+void StateCacheOpenGL::SetBlend(bool enabled)
+{
+    if (Changes(m_blend == (int)enabled))
+    {
+        if (enabled)
+            glEnable(GL_BLEND);
+        else
+            glDisable(GL_BLEND);
+        m_blend = enabled;
+    }
+}
+
+void StateCacheOpenGL::BlendFunc(GLenum sourceFactor, GLenum destFactor)
+{
+    if (Changes(m_blendFactors[0] == sourceFactor && m_blendFactors[1] == destFactor))
+    {
+        glBlendFunc(sourceFactor, destFactor);
+        m_blendFactors[0] = sourceFactor;
+        m_blendFactors[1] = destFactor;
+    }
+}
+
+void StateCacheOpenGL::ColorMask(bool red, bool green, bool blue, bool alpha)
+{
+    const int mask = (red ? 8 : 0) | (green ? 4 : 0) | (blue ? 2 : 0) | (alpha ? 1 : 0);
+    if (Changes(m_colorMask == mask))
+    {
+        glColorMask(red, green, blue, alpha);
+        m_colorMask = mask;
+    }
+}
+
+void StateCacheOpenGL::SetMatrices(const glm::mat4& modelView, const glm::mat4& projection)
+{
+    if (m_matricesValid && m_matrices[0] == projection && m_matrices[1] == modelView)
+        return;
+
+    m_matrices[0] = projection;
+    m_matrices[1] = modelView;
+    m_matricesValid = true;
+
+    // std140 lays the two matrices out back to back, column major like glm
+    glBindBuffer(GL_UNIFORM_BUFFER, m_matricesBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(m_matrices), glm::value_ptr(m_matrices[0]));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    ++m_frameStats.matrixUploads;
+}
+
+void StateCacheOpenGL::Invalidate()
+{
+    m_program = UNKNOWN;
+    m_vertexArray = UNKNOWN;
+    m_activeUnit = MAX_TEXTURE_UNITS;
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+    {
+        m_textures2D[unit] = UNKNOWN;
+        m_texturesBuffer[unit] = UNKNOWN;
+    }
+    m_blend = -1;
+    m_blendFactors[0] = m_blendFactors[1] = UNKNOWN;
+    m_colorMask = -1;
+}
+
+void StateCacheOpenGL::ForgetTexture(GLuint texture)
+{
+    for (int unit = 0; unit < MAX_TEXTURE_UNITS; ++unit)
+    {
+        if (m_textures2D[unit] == texture)
+            m_textures2D[unit] = 0;
+        if (m_texturesBuffer[unit] == texture)
+            m_texturesBuffer[unit] = 0;
+    }
+}
+
+void StateCacheOpenGL::EndFrame()
+{
+    m_lastFrameStats = m_frameStats;
+    m_frameStats = Stats();
+}
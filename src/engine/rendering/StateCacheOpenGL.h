@@ -0,0 +1,75 @@
+#pragma once
+
+#include "OpenGL.h"
+
+#include "glm/mat4x4.hpp"
+
+#include <cstdint>
+
+// The GL state RenderOpenGLv2 and its parts set, as last set through the cache. Calls which
+// would not change anything are skipped, so the parts set their whole state on every flush and
+// leave it bound. Code which changes this state with direct GL calls has to Invalidate it.
+class StateCacheOpenGL
+{
+public:
+    enum
+    {
+        MATRICES_BINDING = 0,       // uniform block binding point of the Matrices block
+        MAX_TEXTURE_UNITS = 4,
+    };
+
+    struct Stats
+    {
+        uint32_t changes = 0;
+        uint32_t skipped = 0;
+        uint32_t matrixUploads = 0;
+    };
+
+    StateCacheOpenGL();
+    ~StateCacheOpenGL();
+
+    StateCacheOpenGL(const StateCacheOpenGL&) = delete;
+    StateCacheOpenGL& operator=(const StateCacheOpenGL&) = delete;
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vertexArray);
+    // GL_TEXTURE_2D or GL_TEXTURE_BUFFER
+    void BindTexture(GLenum target, GLuint texture, unsigned int unit = 0);
+    void SetBlend(bool enabled);
+    void BlendFunc(GLenum sourceFactor, GLenum destFactor);
+    void ColorMask(bool red, bool green, bool blue, bool alpha);
+
+    // The matrices of the programs with the block
+    //     layout (std140) uniform Matrices { mat4 projectionMatrix; mat4 modelViewMatrix; };
+    // they are uploaded to the uniform buffer only when they differ from the last ones.
+    void SetMatrices(const glm::mat4& modelView, const glm::mat4& projection);
+
+    // the next calls go to GL whatever they set
+    void Invalidate();
+    // a deleted texture is unbound from every unit
+    void ForgetTexture(GLuint texture);
+
+    void EndFrame();
+
+    // counters of the last finished frame
+    const Stats& GetStats() const { return m_lastFrameStats; }
+
+private:
+    bool Changes(bool same);
+
+    GLuint m_program;
+    GLuint m_vertexArray;
+    unsigned int m_activeUnit;
+    GLuint m_textures2D[MAX_TEXTURE_UNITS];
+    GLuint m_texturesBuffer[MAX_TEXTURE_UNITS];
+    int m_blend;                // -1 unknown
+    GLenum m_blendFactors[2];
+    int m_colorMask;            // bits RGBA, -1 unknown
+
+    GLuint m_matricesBuffer;
+    glm::mat4 m_matrices[2];    // projection, model view
+    bool m_matricesValid;
+
+    Stats m_frameStats;
+    Stats m_lastFrameStats;
+};
@@ -0,0 +1,80 @@
+#include "StaticBatchOpenGL.h"
+
+#include <cassert>
+
+#define BUFFER_OFFSET(x)  ((const void*) (x))
+
+StaticBatchOpenGL::StaticBatchOpenGL(StateCacheOpenGL& state)
+    : m_state(state)
+{
+    glGenVertexArrays(1, &m_vaoId);
+    glGenBuffers(1, &m_vertexBuffer);
+    glGenBuffers(1, &m_indexBuffer);
+
+    // the same locations the textured and the fan programs have
+    m_state.BindVertexArray(m_vaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, x)));
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, color)));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), BUFFER_OFFSET(offsetof(Vertex, u)));
+
+    m_state.BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+StaticBatchOpenGL::~StaticBatchOpenGL()
+{
+    glDeleteVertexArrays(1, &m_vaoId);
+    glDeleteBuffers(1, &m_vertexBuffer);
+    glDeleteBuffers(1, &m_indexBuffer);
+}
+
+void StaticBatchOpenGL::Build(DrawCommandQueue& commands)
+{
+    std::vector<Vertex> vertices;
+    std::vector<GLuint> indices;
+    m_ranges.clear();
+
+    const DrawCommandQueue::Command* previous = nullptr;
+    for (const DrawCommandQueue::Command& command : commands.Sort())
+    {
+        const DrawCommandQueue::Program program = command.GetProgram();
+        assert(program != DrawCommandQueue::PROGRAM_SPRITES);
+
+        if (!previous || previous->GetLayer() != command.GetLayer() || previous->GetProgram() != program || previous->texture != command.texture)
+            m_ranges.push_back(Range{ program, command.GetTexture(), indices.size(), 0 });
+        previous = &command;
+
+        const GLuint first = (GLuint)vertices.size();
+        const Vertex* source = commands.GetVertices(command);
+        vertices.insert(vertices.end(), source, source + command.vertexCount);
+
+        if (program == DrawCommandQueue::PROGRAM_FAN)
+        {
+            const GLuint nEdges = command.vertexCount - 1;
+            for (GLuint i = 0; i < nEdges; ++i)
+                indices.insert(indices.end(), { first, first + i + 1, i + 1 < nEdges ? first + i + 2 : first + 1 });
+        }
+        else
+        {
+            for (GLuint quad = first; quad < first + command.vertexCount; quad += 4)
+                indices.insert(indices.end(), { quad, quad + 1, quad + 2, quad, quad + 2, quad + 3 });
+        }
+
+        m_ranges.back().indexCount = indices.size() - m_ranges.back().firstIndex;
+    }
+
+    // the index buffer binding belongs to the vertex array
+    m_state.BindVertexArray(m_vaoId);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+    m_state.BindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    commands.Clear();
+}
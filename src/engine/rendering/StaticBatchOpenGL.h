@@ -0,0 +1,43 @@
+#pragma once
+
+#include "OpenGL.h"
+#include "DrawCommandQueue.h"
+#include "StateCacheOpenGL.h"
+
+#include <cstddef>
+#include <vector>
+
+// Geometry of a static layer kept on the GPU. Built once from the recorded quads and fans
+// into its own GL_STATIC_DRAW buffers and drawn as a few ranges, one per program and texture.
+class StaticBatchOpenGL
+{
+public:
+    struct Range
+    {
+        DrawCommandQueue::Program program;
+        GLuint texture;
+        std::size_t firstIndex;
+        std::size_t indexCount;
+    };
+
+    explicit StaticBatchOpenGL(StateCacheOpenGL& state);
+    ~StaticBatchOpenGL();
+
+    StaticBatchOpenGL(const StaticBatchOpenGL&) = delete;
+    StaticBatchOpenGL& operator=(const StaticBatchOpenGL&) = delete;
+
+    // replaces the contents, the queue must hold no sprites
+    void Build(DrawCommandQueue& commands);
+
+    // the vertex array has the Vertex attributes at the locations the textured part uses
+    GLuint GetVertexArray() const { return m_vaoId; }
+    const std::vector<Range>& GetRanges() const { return m_ranges; }
+
+private:
+    StateCacheOpenGL& m_state;
+    GLuint m_vaoId = 0;
+    GLuint m_vertexBuffer = 0;
+    GLuint m_indexBuffer = 0;
+
+    std::vector<Range> m_ranges;
+};
@@ -0,0 +1,125 @@
+#include "StreamBufferOpenGL.h"
+
+#include <cassert>
+#include <cstring>
+
+static const GLuint64 WAIT_TIMEOUT_NS = 1000000000; // 1 sec
+
+StreamBufferOpenGL::StreamBufferOpenGL(GLenum target, std::size_t frameCapacity, int framesInFlight)
+    : m_target(target)
+    , m_id(0)
+    , m_regionSize(frameCapacity)
+    , m_regionsCount(framesInFlight)
+    , m_fences { }
+    , m_region(0)
+    , m_regionUsed(0)
+    , m_regionAcquired(false)
+{
+    assert(framesInFlight > 0 && framesInFlight <= (int)(sizeof(m_fences) / sizeof(m_fences[0])));
+
+    glGenBuffers(1, &m_id);
+    glBindBuffer(m_target, m_id);
+    glBufferData(m_target, m_regionSize * m_regionsCount, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(m_target, 0);
+}
+
+StreamBufferOpenGL::~StreamBufferOpenGL()
+{
+    for (GLsync& fence : m_fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (m_id)
+    {
+        glDeleteBuffers(1, &m_id);
+        m_id = 0;
+    }
+}
+
+std::size_t StreamBufferOpenGL::Upload(const void* data, std::size_t size, std::size_t alignment)
+{
+    assert(size <= m_regionSize);
+
+    if (!m_regionAcquired)
+        AcquireRegion();
+
+    std::size_t used = (m_regionUsed + alignment - 1) / alignment * alignment;
+    if (used + size > m_regionSize)
+    {
+        Orphan();
+        used = 0;
+    }
+
+    const std::size_t offset = m_region * m_regionSize + used;
+
+    glBindBuffer(m_target, m_id);
+    void* dst = glMapBufferRange(m_target, offset, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    assert(dst);
+    if (dst)
+    {
+        memcpy(dst, data, size);
+        glUnmapBuffer(m_target);
+    }
+
+    m_regionUsed = used + size;
+    m_frameStats.bytesStreamed += size;
+    ++m_frameStats.uploads;
+
+    return offset;
+}
+
+void StreamBufferOpenGL::EndFrame()
+{
+    if (m_regionAcquired)
+    {
+        assert(!m_fences[m_region]);
+        m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        m_region = (m_region + 1) % m_regionsCount;
+        m_regionUsed = 0;
+        m_regionAcquired = false;
+    }
+
+    m_lastFrameStats = m_frameStats;
+    m_frameStats = Stats();
+}
+
+void StreamBufferOpenGL::AcquireRegion()
+{
+    GLsync& fence = m_fences[m_region];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            ++m_frameStats.syncStalls;
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS);
+        }
+        assert(result != GL_WAIT_FAILED);
+
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    m_regionAcquired = true;
+}
+
+void StreamBufferOpenGL::Orphan()
+{
+    // fresh storage, the draws already queued keep reading the old one
+    glBindBuffer(m_target, m_id);
+    glBufferData(m_target, m_regionSize * m_regionsCount, nullptr, GL_STREAM_DRAW);
+
+    for (GLsync& fence : m_fences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    m_regionUsed = 0;
+    ++m_frameStats.orphans;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "OpenGL.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Ring of buffer memory for geometry regenerated every frame. The buffer is split into one
+// region per frame in flight. A frame writes only into its own region and fences it in
+// EndFrame, so the region is reused only after the GPU has finished reading it. Writes go
+// through unsynchronized mappings and never wait on draws of the current frame.
+class StreamBufferOpenGL
+{
+public:
+    struct Stats
+    {
+        std::size_t bytesStreamed = 0;
+        uint32_t uploads = 0;
+        uint32_t syncStalls = 0;    // the GPU still read the region the frame was about to write
+        uint32_t orphans = 0;       // the frame did not fit its region, the storage was reallocated
+    };
+
+    StreamBufferOpenGL(GLenum target, std::size_t frameCapacity, int framesInFlight = 3);
+    ~StreamBufferOpenGL();
+
+    StreamBufferOpenGL(const StreamBufferOpenGL&) = delete;
+    StreamBufferOpenGL& operator=(const StreamBufferOpenGL&) = delete;
+
+    GLuint GetId() const { return m_id; }
+
+    // the largest single upload, the batches drawn from the buffer are limited to it
+    std::size_t GetRegionSize() const { return m_regionSize; }
+
+    // Copies the data into the current frame region and returns its offset in the buffer.
+    // Leaves the buffer bound to its target, for GL_ELEMENT_ARRAY_BUFFER bind the VAO first.
+    std::size_t Upload(const void* data, std::size_t size, std::size_t alignment = 16);
+
+    void EndFrame();
+
+    // counters of the last finished frame
+    const Stats& GetStats() const { return m_lastFrameStats; }
+
+private:
+    void AcquireRegion();
+    void Orphan();
+
+    GLenum m_target;
+    GLuint m_id;
+
+    std::size_t m_regionSize;
+    int m_regionsCount;
+    GLsync m_fences[4];
+
+    int m_region;
+    std::size_t m_regionUsed;
+    bool m_regionAcquired;
+
+    Stats m_frameStats;
+    Stats m_lastFrameStats;
+};
@@ -0,0 +1,279 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+AtlasImage::AtlasImage(uint32 width, uint32 height)
+    : m_width(width)
+    , m_height(height)
+    , m_data(width * height * 4, 0)
+{
+}
+
+void AtlasImage::Blit(const IImage& image, uint32 x, uint32 y, uint32 extrude)
+{
+    const int srcWidth = (int)image.GetWidth();
+    const int srcHeight = (int)image.GetHeight();
+    const int srcPixelSize = image.GetBitsPerPixel() / 8;
+    const uint8* src = image.GetData();
+
+    assert(srcPixelSize == 3 || srcPixelSize == 4);
+    assert(x + srcWidth + 2 * extrude <= m_width && y + srcHeight + 2 * extrude <= m_height);
+
+    const int border = (int)extrude;
+    for (int row = -border; row < srcHeight + border; ++row)
+    {
+        const int srcRow = std::min(std::max(row, 0), srcHeight - 1);
+        const uint8* srcLine = src + srcRow * srcWidth * srcPixelSize;
+        uint8* dst = &m_data[((y + border + row) * m_width + x) * 4];
+
+        for (int col = -border; col < srcWidth + border; ++col, dst += 4)
+        {
+            const uint8* pixel = srcLine + std::min(std::max(col, 0), srcWidth - 1) * srcPixelSize;
+            dst[0] = pixel[0];
+            dst[1] = pixel[1];
+            dst[2] = pixel[2];
+            dst[3] = srcPixelSize == 4 ? pixel[3] : 255;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_usedHeight(0)
+    , m_skyline{ { 0, 0, width } }
+{
+}
+
+bool SkylinePacker::Insert(int width, int height, int& x, int& y)
+{
+    int bestBottom = m_height + 1;
+    int bestWidth = m_width + 1;
+    size_t bestIndex = m_skyline.size();
+
+    for (size_t i = 0; i < m_skyline.size(); ++i)
+    {
+        const int fitY = Fit(i, width, height);
+        if (fitY < 0)
+            continue;
+
+        // the lowest position, the narrowest segment for a tie
+        if (fitY + height < bestBottom || (fitY + height == bestBottom && m_skyline[i].width < bestWidth))
+        {
+            bestBottom = fitY + height;
+            bestWidth = m_skyline[i].width;
+            bestIndex = i;
+            y = fitY;
+        }
+    }
+
+    if (bestIndex == m_skyline.size())
+        return false;
+
+    x = m_skyline[bestIndex].x;
+    AddLevel(bestIndex, x, y, width, height);
+    m_usedHeight = std::max(m_usedHeight, y + height);
+    return true;
+}
+
+int SkylinePacker::Fit(size_t index, int width, int height) const
+{
+    if (m_skyline[index].x + width > m_width)
+        return -1;
+
+    int y = m_skyline[index].y;
+    for (int widthLeft = width; widthLeft > 0; ++index)
+    {
+        y = std::max(y, m_skyline[index].y);
+        if (y + height > m_height)
+            return -1;
+        widthLeft -= m_skyline[index].width;
+    }
+    return y;
+}
+
+void SkylinePacker::AddLevel(size_t index, int x, int y, int width, int height)
+{
+    m_skyline.insert(m_skyline.begin() + index, Segment{ x, y + height, width });
+
+    // cut the segments the new one covers
+    for (size_t i = index + 1; i < m_skyline.size(); )
+    {
+        const Segment& previous = m_skyline[i - 1];
+        Segment& segment = m_skyline[i];
+
+        const int overlap = previous.x + previous.width - segment.x;
+        if (overlap <= 0)
+            break;
+
+        segment.x += overlap;
+        segment.width -= overlap;
+        if (segment.width > 0)
+            break;
+
+        m_skyline.erase(m_skyline.begin() + i);
+    }
+
+    // merge the neighbours of the same height
+    for (size_t i = 0; i + 1 < m_skyline.size(); )
+    {
+        if (m_skyline[i].y == m_skyline[i + 1].y)
+        {
+            m_skyline[i].width += m_skyline[i + 1].width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    struct Placement
+    {
+        std::shared_ptr<AtlasImage> page;
+        int x;
+        int y;
+    };
+
+    // an image which fails to decode stays out, LoadPackage shows the checker for it
+    bool Decodes(const IImage& image)
+    {
+        try
+        {
+            return image.GetData() != nullptr;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+
+    int NextPowerOfTwo(int value)
+    {
+        int result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+}
+
+TextureDefinitions BuildAtlas(TextureDefinitions definitions, const AtlasOptions& options)
+{
+    const int padding = options.padding;
+
+    // images in the order of appearance; the first texture decides the filter like in LoadPackage
+    std::vector<std::shared_ptr<IImage>> images;
+    std::map<IImage*, bool> magFilters;
+    std::map<IImage*, bool> excluded;
+    for (auto& item : definitions)
+    {
+        const std::shared_ptr<IImage>& image = std::get<0>(item);
+        const TextureManager::LogicalTexture& tex = std::get<2>(item);
+
+        if (magFilters.emplace(image.get(), tex.magFilter).second)
+        {
+            images.push_back(image);
+            excluded[image.get()] = IsCompressedFormat(image->GetFormat()) || image->GetLevelsCount() > 1
+                || (image->GetBitsPerPixel() != 24 && image->GetBitsPerPixel() != 32)
+                || (int)image->GetWidth() + 2 * padding > options.pageSize
+                || (int)image->GetHeight() + 2 * padding > options.pageSize
+                || !Decodes(*image);
+        }
+
+        // tiled with uv outside of the frame, needs the whole texture for itself
+        if (tex.wrap)
+            excluded[image.get()] = true;
+    }
+
+    std::map<IImage*, Placement> placements;
+    for (bool magFilter : { false, true })
+    {
+        std::vector<std::shared_ptr<IImage>> group;
+        for (auto& image : images)
+        {
+            if (!excluded[image.get()] && magFilters[image.get()] == magFilter)
+                group.push_back(image);
+        }
+        if (group.size() < 2)
+            continue;
+
+        std::stable_sort(group.begin(), group.end(), [](const std::shared_ptr<IImage>& a, const std::shared_ptr<IImage>& b)
+        {
+            return a->GetHeight() != b->GetHeight() ? a->GetHeight() > b->GetHeight() : a->GetWidth() > b->GetWidth();
+        });
+
+        std::vector<SkylinePacker> packers;
+        std::vector<std::vector<std::pair<IImage*, Placement>>> pages;
+        for (auto& image : group)
+        {
+            const int width = (int)image->GetWidth() + 2 * padding;
+            const int height = (int)image->GetHeight() + 2 * padding;
+
+            Placement placement{ nullptr, 0, 0 };
+            size_t page = 0;
+            for (; page < packers.size(); ++page)
+            {
+                if (packers[page].Insert(width, height, placement.x, placement.y))
+                    break;
+            }
+            if (page == packers.size())
+            {
+                packers.emplace_back(options.pageSize, options.pageSize);
+                pages.emplace_back();
+                bool inserted = packers.back().Insert(width, height, placement.x, placement.y);
+                assert(inserted);
+                (void)inserted;
+            }
+            pages[page].emplace_back(image.get(), placement);
+        }
+
+        for (size_t page = 0; page < pages.size(); ++page)
+        {
+            auto atlas = std::make_shared<AtlasImage>(options.pageSize, NextPowerOfTwo(packers[page].GetUsedHeight()));
+            for (auto& placed : pages[page])
+            {
+                atlas->Blit(*placed.first, placed.second.x, placed.second.y, padding);
+                placed.second.page = atlas;
+                placements.emplace(placed.first, placed.second);
+            }
+        }
+    }
+
+    for (auto& item : definitions)
+    {
+        auto found = placements.find(std::get<0>(item).get());
+        if (found == placements.end())
+            continue;
+
+        const IImage& source = *std::get<0>(item);
+        const Placement& placement = found->second;
+
+        const float scaleX = (float)source.GetWidth() / (float)placement.page->GetWidth();
+        const float scaleY = (float)source.GetHeight() / (float)placement.page->GetHeight();
+        const float offsetX = (float)(placement.x + padding) / (float)placement.page->GetWidth();
+        const float offsetY = (float)(placement.y + padding) / (float)placement.page->GetHeight();
+
+        for (RectFloat& frame : std::get<2>(item).uvFrames)
+        {
+            frame.left = offsetX + frame.left * scaleX;
+            frame.right = offsetX + frame.right * scaleX;
+            frame.top = offsetY + frame.top * scaleY;
+            frame.bottom = offsetY + frame.bottom * scaleY;
+        }
+
+        std::get<0>(item) = placement.page;
+    }
+
+    return definitions;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "TextureManager.h"
+#include "base/IImage.h"
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// 32 bpp image the package images are copied into
+class AtlasImage : public IImage
+{
+public:
+    AtlasImage(uint32 width, uint32 height);
+
+    // Image methods
+    const uint8* GetData() const override { return m_data.data(); }
+    uint8 GetBitsPerPixel() const override { return 32; }
+    uint32 GetWidth() const override { return m_width; }
+    uint32 GetHeight() const override { return m_height; }
+
+    // copies a 24 or 32 bpp image and repeats its edge pixels 'extrude' times around it
+    void Blit(const IImage& image, uint32 x, uint32 y, uint32 extrude);
+
+private:
+    uint32 m_width;
+    uint32 m_height;
+    std::vector<uint8> m_data;
+};
+
+// Skyline bottom-left rectangle packer
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    bool Insert(int width, int height, int& x, int& y);
+    int GetUsedHeight() const { return m_usedHeight; }
+
+private:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    int Fit(size_t index, int width, int height) const;
+    void AddLevel(size_t index, int x, int y, int width, int height);
+
+    int m_width;
+    int m_height;
+    int m_usedHeight;
+    std::vector<Segment> m_skyline;
+};
+
+using TextureDefinitions = std::vector<std::tuple<std::shared_ptr<IImage>, std::string, TextureManager::LogicalTexture>>;
+
+// Packs the package images into a few atlas pages and rewrites the frames to point into them,
+// to be called between ParsePackage and LoadPackage. Images used by wrapping textures, images
+// bigger than a page, images with mipmaps and images with other pixel formats are left as
+// they are.
+TextureDefinitions BuildAtlas(TextureDefinitions definitions, const AtlasOptions& options = AtlasOptions());
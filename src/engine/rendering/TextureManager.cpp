@@ -4,14 +4,14 @@
 #define TRACE(...)
 
 #include "LuaDeleter.h"
+#include "SpriteInstance.h"
 #include "base/IImage.h"
 #include "filesystem/FileSystem.h"
-
-#if defined(SOIL_ENABLED)
-#include "SoilImage.h"
-#else
+#include "threading/ThreadPool.h"
+#include "EncodedImage.h"
+#include "KtxImage.h"
 #include "TGAImage.h"
-#endif
+#include "CookedPackage.h"
 
 extern "C"
 {
@@ -19,6 +19,8 @@ extern "C"
 	#include <lauxlib.h>
 }
 
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -48,8 +50,13 @@ const unsigned char CheckerImage::_bytes[] = {
 
 TextureManager::TextureManager(IRender& render)
     : _render(render)
+    , _generation(0)
+    , _atlasEnabled(false)
+    , _uploadPool(nullptr)
+    , _uploadBudget(DEFAULT_UPLOAD_BUDGET)
 {
     CreateChecker();
+    UpdateSpriteFrames();
 }
 
 TextureManager::~TextureManager()
@@ -57,14 +64,44 @@ TextureManager::~TextureManager()
     UnloadAllTextures();
 }
 
+void TextureManager::SetAsyncUploads(ThreadPool *pool, size_t bytesPerFrame)
+{
+    assert(bytesPerFrame > 0);
+
+    _uploadPool = pool;
+    _uploadBudget = bytesPerFrame;
+}
+
+void TextureManager::SetAtlas(bool enabled, const AtlasOptions &options)
+{
+    _atlasEnabled = enabled;
+    _atlasOptions = options;
+}
+
 void TextureManager::UnloadAllTextures()
 {
+    for (auto &upload: _pendingUploads)
+    {
+        // a running task still uses its image and the pool, which may go away with the manager
+        if (upload.decoded.valid())
+            upload.decoded.wait();
+        if (upload.allocated)
+            _render.TexFree(upload.tex);
+    }
+    _pendingUploads.clear();
+
     for (auto &t: _devTextures)
-        _render.TexFree(t.id);
+    {
+        if (!t.placeholder)
+            _render.TexFree(t.id);
+    }
     _devTextures.clear();
     _mapImage_to_TexDescIter.clear();
     _mapName_to_Index.clear();
     _logicalTextures.clear();
+    _firstSpriteFrames.clear();
+    _atlasSources.clear();
+    ++_generation;
 }
 
 std::list<TextureManager::TexDesc>::iterator TextureManager::LoadTexture(const std::shared_ptr<IImage> &image, bool magFilter)
@@ -77,22 +114,186 @@ std::list<TextureManager::TexDesc>::iterator TextureManager::LoadTexture(const s
     else
     {
         TexDesc td;
-        if( !_render.TexCreate(td.id, *image, magFilter) )
-        {
-            throw std::runtime_error("error in render device");
-        }
-
         td.width = image->GetWidth();
         td.height = image->GetHeight();
         td.refCount = 0;
+        td.memory = GetImageDeviceSize(*image);
+        td.placeholder = _uploadPool && !_logicalTextures.empty();
+
+        const bool decodeOnPool = td.placeholder;
+        if( !decodeOnPool )
+        {
+            try
+            {
+                image->GetData(); // an encoded image is decoded here
+            }
+            catch (const std::exception &e)
+            {
+                // stays the checker, as when decoding on the pool fails
+                TRACE("WARNING: could not decode texture - %s", e.what());
+                td.placeholder = true;
+            }
+        }
+
+        if( td.placeholder )
+        {
+            td.id = _logicalTextures[0].second->id;
+        }
+        else if( !_render.TexCreate(td.id, *image, magFilter) )
+        {
+            throw std::runtime_error("error in render device");
+        }
 
         _devTextures.push_front(td);
         auto it2 = _devTextures.begin();
         _mapImage_to_TexDescIter.emplace(image, it2);
+
+        if( decodeOnPool )
+        {
+            PendingUpload upload;
+            upload.texDesc = it2;
+            upload.image = image;
+            upload.decoded = _uploadPool->Enqueue([image] { image->GetData(); });
+            upload.allocated = false;
+            upload.uploadedRows = 0;
+            upload.magFilter = magFilter;
+            _pendingUploads.push_back(std::move(upload));
+        }
         return it2;
     }
 }
 
+void TextureManager::CancelUpload(std::list<TexDesc>::iterator texDesc)
+{
+    auto it = std::find_if(_pendingUploads.begin(), _pendingUploads.end(),
+                           [texDesc](const PendingUpload &upload) { return upload.texDesc == texDesc; });
+    if( _pendingUploads.end() != it )
+    {
+        if (it->allocated)
+            _render.TexFree(it->tex);
+        _pendingUploads.erase(it);
+    }
+}
+
+void TextureManager::UnpackRequestedWraps()
+{
+    bool unpacked = false;
+    for (auto it = _atlasSources.begin(); _atlasSources.end() != it; )
+    {
+        if (!_wrapRequests[it->first].load(std::memory_order_relaxed))
+        {
+            ++it;
+            continue;
+        }
+
+        // the same logical texture on its own image, the atlas page stays for the others
+        auto &lt = _logicalTextures[it->first];
+        std::list<TexDesc>::iterator texDescIter = LoadTexture(it->second.first, it->second.second.magFilter);
+        texDescIter->refCount++;
+        lt.second->refCount--;
+        lt.second = texDescIter;
+        lt.first = std::move(it->second.second);
+        lt.first.wrap = true;
+
+        TRACE("texture drawn tiled, taken out of its atlas");
+        it = _atlasSources.erase(it);
+        unpacked = true;
+    }
+
+    if (unpacked)
+    {
+        UnloadUnusedTextures();
+        UpdateSpriteFrames();
+    }
+}
+
+size_t TextureManager::ProcessUploads()
+{
+    UnpackRequestedWraps();
+
+    size_t completed = 0;
+    size_t budget = _uploadBudget;
+    bool uploaded = false; // the first upload of the frame may exceed the budget
+
+    for (auto it = _pendingUploads.begin(); _pendingUploads.end() != it; )
+    {
+        PendingUpload &upload = *it;
+        if (upload.decoded.valid())
+        {
+            if (upload.decoded.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+
+            try
+            {
+                upload.decoded.get();
+            }
+            catch (const std::exception &e)
+            {
+                // stays the checker
+                TRACE("WARNING: could not decode texture - %s", e.what());
+                it = _pendingUploads.erase(it);
+                continue;
+            }
+        }
+
+        const IImage &image = *upload.image;
+        const size_t rowSize = (size_t)image.GetWidth() * (image.GetBitsPerPixel() / 8);
+
+        if (!upload.allocated)
+        {
+            if (!_render.TexAllocate(upload.tex, image, upload.magFilter))
+            {
+                // the render takes only whole textures, or the image is compressed or has levels
+                size_t size = 0;
+                for (uint32 level = 0; level < image.GetLevelsCount(); ++level)
+                    size += GetImageLevelSize(image, level);
+                if (uploaded && size > budget)
+                    break;
+                if (!_render.TexCreate(upload.tex, image, upload.magFilter))
+                    throw std::runtime_error("error in render device");
+
+                upload.uploadedRows = image.GetHeight();
+                budget -= std::min(budget, size);
+                uploaded = true;
+            }
+            upload.allocated = true;
+        }
+
+        if (upload.uploadedRows < image.GetHeight())
+        {
+            unsigned int rows = (unsigned int)std::min<size_t>(image.GetHeight() - upload.uploadedRows, budget / rowSize);
+            if (!rows)
+            {
+                if (uploaded)
+                    break;
+                rows = 1;
+            }
+
+            _render.TexUploadRows(upload.tex, image, upload.uploadedRows, rows);
+            upload.uploadedRows += rows;
+            budget -= std::min(budget, rows * rowSize);
+            uploaded = true;
+
+            if (upload.uploadedRows < image.GetHeight())
+                break; // the rest in the next frames
+        }
+
+        upload.texDesc->id = upload.tex;
+        upload.texDesc->placeholder = false;
+        it = _pendingUploads.erase(it);
+        ++completed;
+    }
+
+    // the static batches recorded with the checker are built again
+    if (completed)
+        ++_generation;
+
+    return completed;
+}
+
 void TextureManager::CreateChecker()
 {
     assert(_logicalTextures.empty()); // to be sure that checker will get index 0
@@ -110,6 +311,8 @@ void TextureManager::CreateChecker()
     td.width = c.GetWidth();
     td.height = c.GetHeight();
     td.refCount = 0;
+    td.memory = GetImageDeviceSize(c);
+    td.placeholder = false;
 
     _devTextures.push_front(td);
 
@@ -122,11 +325,27 @@ void TextureManager::CreateChecker()
     tex.pxFrameHeight = (float) td.height * 8;
     tex.pxBorderSize = 0;
     tex.magFilter = false;
+    tex.wrap = true;
     tex.uvFrames = { { 0,0,2,2 } };
 
     _logicalTextures.emplace_back(tex, texDescIter);
 }
 
+void TextureManager::UpdateSpriteFrames()
+{
+    std::vector<SpriteFrame> frames;
+    _firstSpriteFrames.clear();
+    for (auto &lt: _logicalTextures)
+    {
+        _firstSpriteFrames.push_back(static_cast<unsigned int>(frames.size()));
+        for (const RectFloat &uv: lt.first.uvFrames)
+            frames.push_back(SpriteFrame{ uv, lt.first.uvPivot });
+    }
+    _render.SetSpriteFrames(frames.data(), frames.size());
+    _wrapRequests.reset(new std::atomic<bool>[_logicalTextures.size()]());
+    ++_generation;
+}
+
 static int getint(lua_State *L, int tblidx, const char *field, int def)
 {
     lua_getfield(L, tblidx, field);
@@ -189,6 +408,7 @@ static TextureManager::LogicalTexture getlt(lua_State *L, int idx, float pxWidth
 
     // filter
     tex.magFilter = getbool(L, idx, "magfilter", true);
+    tex.wrap = getbool(L, idx, "wrap", false);
 
     // frames
     tex.uvFrames.reserve(xframes * yframes);
@@ -246,12 +466,14 @@ ParsePackage(const std::string &packageName, std::shared_ptr<FileSystem::Memory>
             {
                 try
                 {
+                    // only the header is read here, the pixels are decoded by LoadPackage;
+                    // the KTX containers need no decoding
                     auto file = fs.Open(fileName)->AsMemory();
-#if defined(SOIL_ENABLED)
-                    cachedImage = std::make_shared<SoilImage>(file->GetData(), file->GetSize());
-#else
-                    cachedImage = std::make_shared<TgaImage>(file->GetData(), file->GetSize());
-#endif
+                    const bool ktx = fileName.size() > 4 && 0 == fileName.compare(fileName.size() - 4, 4, ".ktx");
+                    if (ktx)
+                        cachedImage = std::make_shared<KtxImage>(file);
+                    else
+                        cachedImage = std::make_shared<EncodedImage>(file);
                 }
                 catch (const std::exception &e)
                 {
@@ -288,6 +510,41 @@ ParsePackage(const std::string &packageName, std::shared_ptr<FileSystem::Memory>
 
 int TextureManager::LoadPackage(std::vector<std::tuple<std::shared_ptr<IImage>, std::string, TextureManager::LogicalTexture>> definitions)
 {
+    return LoadDefinitions(std::move(definitions), _atlasEnabled);
+}
+
+int TextureManager::LoadCookedPackage(std::shared_ptr<FileSystem::Memory> file)
+{
+    return LoadDefinitions(ParseCookedPackage(std::move(file)), false);
+}
+
+int TextureManager::LoadPackageFile(const std::string &packageName, const std::string &cookedName, FileSystem::IFileSystem &fs)
+{
+    std::shared_ptr<FileSystem::Memory> cooked = fs.Open(cookedName)->AsMemory();
+    if( cooked->GetSize() > 0 )
+    {
+        TRACE("Loading cooked texture package '%s'", cookedName.c_str());
+        return LoadCookedPackage(std::move(cooked));
+    }
+
+    return LoadPackage(ParsePackage(packageName, fs.Open(packageName)->AsMemory(), fs));
+}
+
+int TextureManager::LoadDefinitions(std::vector<std::tuple<std::shared_ptr<IImage>, std::string, TextureManager::LogicalTexture>> definitions, bool pack)
+{
+    // the textures packed into an atlas keep their image and frames, see RequestWrap
+    std::map<std::string, std::pair<std::shared_ptr<IImage>, LogicalTexture>> packed;
+    if( pack )
+    {
+        TextureDefinitions sources = definitions;
+        definitions = BuildAtlas(std::move(definitions), _atlasOptions);
+        for (size_t i = 0; i < definitions.size(); ++i)
+        {
+            if( std::get<0>(definitions[i]) != std::get<0>(sources[i]) )
+                packed[std::get<1>(sources[i])] = std::make_pair(std::get<0>(sources[i]), std::get<2>(sources[i]));
+        }
+    }
+
     for (auto &item: definitions)
     {
         TextureManager::LogicalTexture &tex = std::get<2>(item);
@@ -297,6 +554,13 @@ int TextureManager::LoadPackage(std::vector<std::tuple<std::shared_ptr<IImage>,
             texDescIter->refCount++;
 
             auto emplaced = _mapName_to_Index.emplace(std::get<1>(item), _logicalTextures.size());
+
+            auto source = packed.find(std::get<1>(item));
+            if( packed.end() != source )
+                _atlasSources[emplaced.first->second] = std::move(source->second);
+            else
+                _atlasSources.erase(emplaced.first->second);
+
             if( emplaced.second )
             {
                 // define new texture
@@ -314,15 +578,21 @@ int TextureManager::LoadPackage(std::vector<std::tuple<std::shared_ptr<IImage>,
         }
     }
 
+    UnloadUnusedTextures();
+    UpdateSpriteFrames();
 
-    //
-    // unload unused textures
-    //
+    TRACE("Total number of loaded textures: %d", _logicalTextures.size());
+    return _logicalTextures.size();
+}
 
+void TextureManager::UnloadUnusedTextures()
+{
     for (auto it = _mapImage_to_TexDescIter.begin(); _mapImage_to_TexDescIter.end() != it; )
     {
         if (0 == it->second->refCount)
         {
+            if (it->second->placeholder)
+                CancelUpload(it->second);
             _devTextures.erase(it->second);
             it = _mapImage_to_TexDescIter.erase(it);
         }
@@ -331,9 +601,6 @@ int TextureManager::LoadPackage(std::vector<std::tuple<std::shared_ptr<IImage>,
             ++it;
         }
     }
-
-    TRACE("Total number of loaded textures: %d", _logicalTextures.size());
-    return _logicalTextures.size();
 }
 
 std::vector<std::tuple<std::shared_ptr<IImage>, std::string, TextureManager::LogicalTexture>>
@@ -368,6 +635,7 @@ ParseDirectory(const std::string &dirName, const std::string &texPrefix, FileSys
         tex.pxFrameHeight = (float) image->GetHeight();
         tex.pxBorderSize = 0;
         tex.magFilter = true;
+        tex.wrap = false;
         tex.uvFrames = { { 0, 0, 1, 1 } };
 
         result.emplace_back(image, texName, tex);
@@ -408,6 +676,17 @@ float TextureManager::GetCharHeight(size_t fontTexture) const
     return GetSpriteInfo(fontTexture).pxFrameHeight;
 }
 
+size_t TextureManager::GetTotalTextureMemory() const
+{
+    size_t total = 0;
+    for (auto &t: _devTextures)
+    {
+        if (!t.placeholder)
+            total += t.memory;
+    }
+    return total;
+}
+
 
 /////////////////////////////////////////////////////////////////////////////////
 //
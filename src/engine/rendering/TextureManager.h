@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <future>
 #include <list>
 #include <map>
 #include <memory>
@@ -15,6 +18,14 @@ namespace FileSystem
     class Memory;
 }
 
+class ThreadPool;
+
+struct AtlasOptions
+{
+    int pageSize = 2048;
+    int padding = 2;    // edge pixels extruded around every image, keeps the filtering from bleeding
+};
+
 class TextureManager
 {
 public:
@@ -27,15 +38,43 @@ public:
         float pxBorderSize;
         
         bool magFilter;
+        bool wrap;          // drawn with uv outside of the frames (tiled), never packed into an atlas
 
         std::vector<RectFloat> uvFrames;
     };
     
+    enum { DEFAULT_UPLOAD_BUDGET = 4 * 1024 * 1024 };
+
     TextureManager(TextureManager&&) = default;
     explicit TextureManager(IRender& render);
     ~TextureManager();
 
+    // With a pool the images of LoadPackage are decoded on it and uploaded by ProcessUploads
+    // at most 'bytesPerFrame' per frame; the textures show the checker until they are ready.
+    // Without a pool, the default, LoadPackage decodes and uploads everything at once. A pool of
+    // its own keeps the decoding from delaying the parallel layers of RenderScheme.
+    void SetAsyncUploads(ThreadPool *pool, size_t bytesPerFrame = DEFAULT_UPLOAD_BUDGET);
+
+    // LoadPackage packs the images of a package into atlas pages (see BuildAtlas) before it loads
+    // them, fewer textures to switch between. Packing decodes the images at once. Off by default.
+    void SetAtlas(bool enabled, const AtlasOptions &options = AtlasOptions());
+
+    // A texture drawn tiled (DrawLine, DrawBackground) needs a device texture of its own. Drawing
+    // one which was packed into an atlas requests it and ProcessUploads loads its image again as
+    // a wrapping texture, so the packages need not mark every tiled texture 'wrap'. Thread safe.
+    void RequestWrap(size_t texIndex) const { _wrapRequests[texIndex].store(true, std::memory_order_relaxed); }
+
+    // once per frame, between IRender::Begin and End, also takes the requested wrapping textures
+    // out of their atlas; the number of textures completed
+    size_t ProcessUploads();
+    size_t GetPendingUploads() const { return _pendingUploads.size(); }
+
     int LoadPackage(std::vector<std::tuple<std::shared_ptr<IImage>, std::string, LogicalTexture>> definitions);
+    // a package written by texcook, see ParseCookedPackage; it is packed already, SetAtlas does not apply
+    int LoadCookedPackage(std::shared_ptr<FileSystem::Memory> file);
+    // At startup: the cooked package 'cookedName' when the file exists, which needs neither Lua nor
+    // image decoding, else the package script 'packageName'. Throws on a corrupted cooked package.
+    int LoadPackageFile(const std::string &packageName, const std::string &cookedName, FileSystem::IFileSystem &fs);
     void UnloadAllTextures();
 
     size_t FindSprite(const std::string &name) const;
@@ -46,10 +85,23 @@ public:
     float GetBorderSize(size_t texIndex) const { return _logicalTextures[texIndex].first.pxBorderSize; }
     unsigned int GetFrameCount(size_t texIndex) const { return static_cast<unsigned int>(_logicalTextures[texIndex].first.uvFrames.size()); }
 
+    // index of the frame in the sprite frames table given to the render, for SpriteInstance::frame
+    unsigned int GetSpriteFrame(size_t texIndex, unsigned int frameIdx) const { return _firstSpriteFrames[texIndex] + frameIdx; }
+
     void GetTextureNames(std::vector<std::string> &names, const char *prefix) const;
 
     float GetCharHeight(size_t fontTexture) const;
 
+    // Estimated video memory of the device texture of a logical texture, shared with the other
+    // logical textures of the same image, with the levels of the image in their format. The
+    // mipmaps a render generates itself add a third to the raw textures.
+    size_t GetTextureMemory(size_t texIndex) const { return _logicalTextures[texIndex].second->memory; }
+    size_t GetTotalTextureMemory() const;
+
+    // changes whenever the logical textures or their device textures do, for the caches of
+    // what was built from them
+    unsigned int GetGeneration() const { return _generation; }
+
 private:
     IRender& _render;
 
@@ -59,16 +111,47 @@ private:
         int width;          // The Width Of The Entire Image.
         int height;         // The Height Of The Entire Image.
         int refCount;       // number of logical textures
+        size_t memory;      // estimate, see GetTextureMemory
+        bool placeholder;   // the id is the checker's until the upload completes
     };
 
     std::list<TexDesc> _devTextures;
     std::map<std::shared_ptr<IImage>, std::list<TexDesc>::iterator> _mapImage_to_TexDescIter;
     std::map<std::string, size_t> _mapName_to_Index;// index in _logicalTextures
     std::vector<std::pair<LogicalTexture, std::list<TexDesc>::iterator>> _logicalTextures;
+    std::vector<unsigned int> _firstSpriteFrames; // per logical texture
+    unsigned int _generation;
+
+    bool _atlasEnabled;
+    AtlasOptions _atlasOptions;
+    // the image and frames before packing of the logical textures in an atlas, by index
+    std::map<size_t, std::pair<std::shared_ptr<IImage>, LogicalTexture>> _atlasSources;
+    std::unique_ptr<std::atomic<bool>[]> _wrapRequests; // per logical texture
+
+    // a texture showing the checker until its image is decoded and all its rows are uploaded
+    struct PendingUpload
+    {
+        std::list<TexDesc>::iterator texDesc;
+        std::shared_ptr<IImage> image;
+        std::future<void> decoded;
+        GlTexture tex;
+        bool allocated;
+        unsigned int uploadedRows;
+        bool magFilter;
+    };
+
+    ThreadPool *_uploadPool;
+    size_t _uploadBudget;
+    std::deque<PendingUpload> _pendingUploads;
 
     std::list<TexDesc>::iterator LoadTexture(const std::shared_ptr<IImage> &image, bool magFilter);
+    int LoadDefinitions(std::vector<std::tuple<std::shared_ptr<IImage>, std::string, LogicalTexture>> definitions, bool pack);
+    void CancelUpload(std::list<TexDesc>::iterator texDesc);
+    void UnloadUnusedTextures();
+    void UnpackRequestedWraps();
 
     void CreateChecker(); // Create checker texture without name and with index=0
+    void UpdateSpriteFrames();
 };
 
 std::vector<std::tuple<std::shared_ptr<IImage>, std::string, TextureManager::LogicalTexture>>
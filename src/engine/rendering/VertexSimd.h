@@ -0,0 +1,203 @@
+#pragma once
+
+#include "Color.h"
+#include "Vertex.h"
+#include "math/Rect.h"
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VERTEX_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VERTEX_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// Quad generation shared by DrawingContext and the renders. The corners are computed four at a
+// time and the vertices are stored as six 16-byte rows; z is zeroed. The scalar fallback does
+// the same arithmetic, so the vertices are the same with and without SIMD.
+namespace VertexSimd
+{
+    static_assert(sizeof(Vertex) == 24, "the rows below assume the 24-byte vertex");
+
+#if defined(VERTEX_SIMD_SSE2)
+    inline void StoreQuad(Vertex *v, __m128 x, __m128 y, __m128 u, __m128 t, Color color)
+    {
+        float c;
+        memcpy(&c, &color, sizeof(c));
+        const __m128 zc = _mm_setr_ps(0, c, 0, c);
+        const __m128 xy01 = _mm_unpacklo_ps(x, y);
+        const __m128 xy23 = _mm_unpackhi_ps(x, y);
+        const __m128 uv01 = _mm_unpacklo_ps(u, t);
+        const __m128 uv23 = _mm_unpackhi_ps(u, t);
+
+        float *out = reinterpret_cast<float *>(v);
+        _mm_storeu_ps(out + 0, _mm_movelh_ps(xy01, zc));                            // x0 y0 z0 c0
+        _mm_storeu_ps(out + 4, _mm_shuffle_ps(uv01, xy01, _MM_SHUFFLE(3, 2, 1, 0)));  // u0 v0 x1 y1
+        _mm_storeu_ps(out + 8, _mm_shuffle_ps(zc, uv01, _MM_SHUFFLE(3, 2, 1, 0)));    // z1 c1 u1 v1
+        _mm_storeu_ps(out + 12, _mm_movelh_ps(xy23, zc));
+        _mm_storeu_ps(out + 16, _mm_shuffle_ps(uv23, xy23, _MM_SHUFFLE(3, 2, 1, 0)));
+        _mm_storeu_ps(out + 20, _mm_shuffle_ps(zc, uv23, _MM_SHUFFLE(3, 2, 1, 0)));
+    }
+#elif defined(VERTEX_SIMD_NEON)
+    inline void StoreQuad(Vertex *v, float32x4_t x, float32x4_t y, float32x4_t u, float32x4_t t, Color color)
+    {
+        float c;
+        memcpy(&c, &color, sizeof(c));
+        const float zcLanes[2] = { 0, c };
+        const float32x2_t zc = vld1_f32(zcLanes);
+        const float32x4x2_t xy = vzipq_f32(x, y);
+        const float32x4x2_t uv = vzipq_f32(u, t);
+
+        float *out = reinterpret_cast<float *>(v);
+        vst1q_f32(out + 0, vcombine_f32(vget_low_f32(xy.val[0]), zc));
+        vst1q_f32(out + 4, vcombine_f32(vget_low_f32(uv.val[0]), vget_high_f32(xy.val[0])));
+        vst1q_f32(out + 8, vcombine_f32(zc, vget_high_f32(uv.val[0])));
+        vst1q_f32(out + 12, vcombine_f32(vget_low_f32(xy.val[1]), zc));
+        vst1q_f32(out + 16, vcombine_f32(vget_low_f32(uv.val[1]), vget_high_f32(xy.val[1])));
+        vst1q_f32(out + 20, vcombine_f32(zc, vget_high_f32(uv.val[1])));
+    }
+#endif
+
+    // the corners go clockwise from the left top one: (left, top), (right, top), (right, bottom), (left, bottom)
+    inline void WriteRectQuad(Vertex *v, const RectFloat &rect, const RectFloat &uv, Color color)
+    {
+#if defined(VERTEX_SIMD_SSE2)
+        StoreQuad(v,
+            _mm_setr_ps(rect.left, rect.right, rect.right, rect.left),
+            _mm_setr_ps(rect.top, rect.top, rect.bottom, rect.bottom),
+            _mm_setr_ps(uv.left, uv.right, uv.right, uv.left),
+            _mm_setr_ps(uv.top, uv.top, uv.bottom, uv.bottom),
+            color);
+#elif defined(VERTEX_SIMD_NEON)
+        const float lanes[4][4] = {
+            { rect.left, rect.right, rect.right, rect.left },
+            { rect.top, rect.top, rect.bottom, rect.bottom },
+            { uv.left, uv.right, uv.right, uv.left },
+            { uv.top, uv.top, uv.bottom, uv.bottom },
+        };
+        StoreQuad(v, vld1q_f32(lanes[0]), vld1q_f32(lanes[1]), vld1q_f32(lanes[2]), vld1q_f32(lanes[3]), color);
+#else
+        const float x[4] = { rect.left, rect.right, rect.right, rect.left };
+        const float y[4] = { rect.top, rect.top, rect.bottom, rect.bottom };
+        const float u[4] = { uv.left, uv.right, uv.right, uv.left };
+        const float t[4] = { uv.top, uv.top, uv.bottom, uv.bottom };
+        for (int i = 0; i < 4; ++i)
+        {
+            v[i].x = x[i];
+            v[i].y = y[i];
+            v[i].z = 0;
+            v[i].color = color;
+            v[i].u = u[i];
+            v[i].v = t[i];
+        }
+#endif
+    }
+
+    // A width x height quad with the pivot (px, py), in pixels from its left top corner, at (x, y)
+    // and rotated to the direction (dirX, dirY); (1, 0) is upright.
+    inline void WriteSpriteQuad(Vertex *v, const RectFloat &uv, Color color,
+                                float x, float y, float px, float py, float width, float height, float dirX, float dirY)
+    {
+        const float right = width - px;
+        const float bottom = height - py;
+#if defined(VERTEX_SIMD_SSE2)
+        // corner = pivot + a * dir + b * perpendicular(dir)
+        const __m128 a = _mm_setr_ps(-px, right, right, -px);
+        const __m128 b = _mm_setr_ps(-py, -py, bottom, bottom);
+        const __m128 dx = _mm_set1_ps(dirX);
+        const __m128 dy = _mm_set1_ps(dirY);
+        StoreQuad(v,
+            _mm_sub_ps(_mm_add_ps(_mm_set1_ps(x), _mm_mul_ps(a, dx)), _mm_mul_ps(b, dy)),
+            _mm_add_ps(_mm_add_ps(_mm_set1_ps(y), _mm_mul_ps(a, dy)), _mm_mul_ps(b, dx)),
+            _mm_setr_ps(uv.left, uv.right, uv.right, uv.left),
+            _mm_setr_ps(uv.top, uv.top, uv.bottom, uv.bottom),
+            color);
+#elif defined(VERTEX_SIMD_NEON)
+        const float lanes[4][4] = {
+            { -px, right, right, -px },
+            { -py, -py, bottom, bottom },
+            { uv.left, uv.right, uv.right, uv.left },
+            { uv.top, uv.top, uv.bottom, uv.bottom },
+        };
+        const float32x4_t a = vld1q_f32(lanes[0]);
+        const float32x4_t b = vld1q_f32(lanes[1]);
+        const float32x4_t dx = vdupq_n_f32(dirX);
+        const float32x4_t dy = vdupq_n_f32(dirY);
+        // no fused multiply-add, to round like the other paths
+        StoreQuad(v,
+            vsubq_f32(vaddq_f32(vdupq_n_f32(x), vmulq_f32(a, dx)), vmulq_f32(b, dy)),
+            vaddq_f32(vaddq_f32(vdupq_n_f32(y), vmulq_f32(a, dy)), vmulq_f32(b, dx)),
+            vld1q_f32(lanes[2]), vld1q_f32(lanes[3]), color);
+#else
+        const float a[4] = { -px, right, right, -px };
+        const float b[4] = { -py, -py, bottom, bottom };
+        const float u[4] = { uv.left, uv.right, uv.right, uv.left };
+        const float t[4] = { uv.top, uv.top, uv.bottom, uv.bottom };
+        for (int i = 0; i < 4; ++i)
+        {
+            v[i].x = x + a[i] * dirX - b[i] * dirY;
+            v[i].y = y + a[i] * dirY + b[i] * dirX;
+            v[i].z = 0;
+            v[i].color = color;
+            v[i].u = u[i];
+            v[i].v = t[i];
+        }
+#endif
+    }
+
+    // copies 'count' quads moved by (dx, dy) and recolored, the texture coordinates are kept
+    inline void CopyQuads(Vertex *dst, const Vertex *src, size_t count, float dx, float dy, Color color)
+    {
+#if defined(VERTEX_SIMD_SSE2)
+        const __m128 moveXY = _mm_setr_ps(dx, dy, 0, 0);        // rows x y z c
+        const __m128 moveUV = _mm_setr_ps(0, 0, dx, dy);        // rows u v x y
+        const __m128 keepXY = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+        const __m128 keepZC = _mm_castsi128_ps(_mm_setr_epi32(-1, 0, -1, -1));   // rows z c u v
+        const __m128 colorXY = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, (int)color.color));
+        const __m128 colorZC = _mm_castsi128_ps(_mm_setr_epi32(0, (int)color.color, 0, 0));
+
+        const float *in = reinterpret_cast<const float *>(src);
+        float *out = reinterpret_cast<float *>(dst);
+        for (size_t row = 0; row < count * 6; row += 3, in += 12, out += 12)
+        {
+            _mm_storeu_ps(out + 0, _mm_or_ps(_mm_and_ps(_mm_add_ps(_mm_loadu_ps(in + 0), moveXY), keepXY), colorXY));
+            _mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(in + 4), moveUV));
+            _mm_storeu_ps(out + 8, _mm_or_ps(_mm_and_ps(_mm_loadu_ps(in + 8), keepZC), colorZC));
+        }
+#elif defined(VERTEX_SIMD_NEON)
+        const float moveLanes[2][4] = { { dx, dy, 0, 0 }, { 0, 0, dx, dy } };
+        const uint32_t colorLanes[2][4] = { { 0, 0, 0, color.color }, { 0, color.color, 0, 0 } };
+        const uint32_t keepLanes[2][4] = { { ~0u, ~0u, ~0u, 0 }, { ~0u, 0, ~0u, ~0u } };
+        const float32x4_t moveXY = vld1q_f32(moveLanes[0]);
+        const float32x4_t moveUV = vld1q_f32(moveLanes[1]);
+        const uint32x4_t colorXY = vld1q_u32(colorLanes[0]);
+        const uint32x4_t colorZC = vld1q_u32(colorLanes[1]);
+        const uint32x4_t keepXY = vld1q_u32(keepLanes[0]);
+        const uint32x4_t keepZC = vld1q_u32(keepLanes[1]);
+
+        const float *in = reinterpret_cast<const float *>(src);
+        float *out = reinterpret_cast<float *>(dst);
+        for (size_t row = 0; row < count * 6; row += 3, in += 12, out += 12)
+        {
+            const uint32x4_t xy = vreinterpretq_u32_f32(vaddq_f32(vld1q_f32(in + 0), moveXY));
+            vst1q_f32(out + 0, vreinterpretq_f32_u32(vbslq_u32(keepXY, xy, colorXY)));
+            vst1q_f32(out + 4, vaddq_f32(vld1q_f32(in + 4), moveUV));
+            const uint32x4_t zc = vreinterpretq_u32_f32(vld1q_f32(in + 8));
+            vst1q_f32(out + 8, vreinterpretq_f32_u32(vbslq_u32(keepZC, zc, colorZC)));
+        }
+#else
+        for (size_t i = 0; i < count * 4; ++i)
+        {
+            dst[i].x = src[i].x + dx;
+            dst[i].y = src[i].y + dy;
+            dst[i].z = src[i].z;
+            dst[i].color = color;
+            dst[i].u = src[i].u;
+            dst[i].v = src[i].v;
+        }
+#endif
+    }
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "math/Rect.h"
+
 class DrawingContext;
 
 struct IDrawable
@@ -8,4 +10,9 @@ struct IDrawable
 
 	virtual int GetOrder() const = 0;
 	virtual void Draw(DrawingContext& dc, float interpolation) const = 0;
+
+	// World space rectangle the drawing stays in, used to skip the drawables out of the camera.
+	// Unbounded drawables return false and are always drawn. When the bounds change while the
+	// drawable is registered, RenderScheme::UpdateBounds must be called (see BoundedDrawable).
+	virtual bool GetBounds(RectFloat& /*bounds*/) const { return false; }
 };
@@ -2,6 +2,18 @@
 
 #include "common/Types.h"
 
+#include <algorithm>
+#include <cstddef>
+
+enum ImageFormat
+{
+	IMAGE_FORMAT_RAW,           // 24 or 32 bits per pixel, RGB or RGBA bytes
+	IMAGE_FORMAT_ETC2_RGB8,     // 4x4 blocks of 8 bytes
+	IMAGE_FORMAT_ETC2_RGBA8,    // 4x4 blocks of 16 bytes
+	IMAGE_FORMAT_BC1,           // 4x4 blocks of 8 bytes, DXT1 without alpha
+	IMAGE_FORMAT_BC3,           // 4x4 blocks of 16 bytes, DXT5
+};
+
 class IImage
 {
 public:
@@ -11,4 +23,45 @@ public:
 	virtual uint8 GetBitsPerPixel() const = 0;
 	virtual uint32 GetWidth() const = 0;
 	virtual uint32 GetHeight() const = 0;
+
+	// The compressed formats report their average bits per pixel, 4 or 8. The levels after the
+	// first are the mipmaps, each half the size of the previous one down to 1x1; an image with
+	// a single level leaves the mipmaps to the render.
+	virtual ImageFormat GetFormat() const { return IMAGE_FORMAT_RAW; }
+	virtual uint32 GetLevelsCount() const { return 1; }
+	virtual const uint8* GetLevelData(uint32 level) const { return GetData(); }
 };
+
+inline bool IsCompressedFormat(ImageFormat format)
+{
+	return format != IMAGE_FORMAT_RAW;
+}
+
+inline uint32 GetLevelDimension(uint32 size, uint32 level)
+{
+	return std::max<uint32>(1, size >> level);
+}
+
+// bytes of a level as it is stored in the image
+inline size_t GetImageLevelSize(const IImage &image, uint32 level)
+{
+	const size_t width = GetLevelDimension(image.GetWidth(), level);
+	const size_t height = GetLevelDimension(image.GetHeight(), level);
+	if (!IsCompressedFormat(image.GetFormat()))
+		return width * height * (image.GetBitsPerPixel() / 8);
+
+	const size_t blockSize = image.GetBitsPerPixel() == 4 ? 8 : 16;
+	return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+}
+
+// bytes of all the levels in the video memory, the raw images are stored as RGBA
+inline size_t GetImageDeviceSize(const IImage &image)
+{
+	size_t size = 0;
+	for (uint32 level = 0; level < image.GetLevelsCount(); ++level)
+	{
+		const size_t levelSize = GetImageLevelSize(image, level);
+		size += IsCompressedFormat(image.GetFormat()) ? levelSize : levelSize / (image.GetBitsPerPixel() / 8) * 4;
+	}
+	return size;
+}
@@ -1,14 +1,17 @@
 #pragma once
 
 #include "math/Rect.h"
+#include "rendering/GlTexture.h"
 
 class IImage;
-struct GlTexture;
 struct Line;
 struct Vertex;
 struct Point;
 struct Color;
 struct ColoredVertex;
+struct SpriteInstance;
+struct SpriteFrame;
+struct LightInstance;
 
 enum RenderMode
 {
@@ -20,6 +23,8 @@ enum RenderMode
 
 struct IRender
 {
+    enum { MAX_QUADS = 256 };
+
     virtual ~IRender() = default;
 
     virtual bool Init() = 0;
@@ -35,14 +40,45 @@ struct IRender
     virtual void Begin() = 0;
     virtual void End() = 0;
 
+    // Renders that reorder the geometry to merge batches keep the layers in this order.
+    // Layers are expected to be drawn in ascending order, the default is 0. Inside a layer the
+    // geometry keeps the order it was drawn in, unless the layer is order independent (opaque
+    // or never overlapping), then it may be regrouped by texture.
+    virtual void SetSortLayer(int layer, bool orderIndependent) { }
+
     // texture management
     virtual bool TexCreate(GlTexture &tex, const IImage &img, bool magFilter) = 0;
     virtual void TexFree(GlTexture tex) = 0;
 
+    // Textures filled over several frames: TexAllocate creates the storage of the size of the
+    // image without reading its pixels and TexUploadRows copies a band of rows into it without
+    // waiting for the GPU. TexAllocate returns false when the render has no support, the
+    // texture is then created by TexCreate at once.
+    virtual bool TexAllocate(GlTexture &tex, const IImage &img, bool magFilter) { return false; }
+    virtual void TexUploadRows(GlTexture tex, const IImage &img, unsigned int firstRow, unsigned int rows) { }
+
     // high level primitive drawing
     virtual Vertex* DrawQuad(GlTexture tex) = 0;
+    // 4 * count contiguous vertices of 'count' quads, count is 1 to MAX_QUADS
+    virtual Vertex* DrawQuads(GlTexture tex, unsigned int count) = 0;
     virtual Vertex* DrawFan(unsigned int nEdges) = 0;
 
+    // Retained geometry for layers which do not change. The quads, fans and sprites drawn between
+    // BeginStaticBatch and EndStaticBatch are kept by the render and DrawStaticBatch draws them
+    // again without sending them. CreateStaticBatch returns 0 when the render has no support.
+    virtual unsigned int CreateStaticBatch() { return 0; }
+    virtual void FreeStaticBatch(unsigned int batch) { }
+    virtual void BeginStaticBatch(unsigned int batch) { }
+    virtual void EndStaticBatch() { }
+    virtual void DrawStaticBatch(unsigned int batch) { }
+
+    // instanced sprites, SpriteInstance::frame indexes the table set by SetSpriteFrames
+    virtual void SetSpriteFrames(const SpriteFrame *frames, size_t count) = 0;
+    virtual void DrawSprites(GlTexture tex, const SpriteInstance *sprites, size_t count) = 0;
+
+    // point and spot lights, additive, so the renders may draw them in any order within the mode
+    virtual void DrawLights(const LightInstance *lights, size_t count) = 0;
+
     virtual void DrawTriangles(const ColoredVertex* vertices, std::size_t count) = 0;
     virtual void DrawPoints(const ColoredVertex* points, std::size_t count, float pointSize) = 0;
     virtual void DrawLines(const Line *lines, size_t count) = 0;
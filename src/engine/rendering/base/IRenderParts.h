@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IRender.h"
+#include "rendering/RenderBatch.h"
 #include <glm/mat4x4.hpp> // glm::mat4
 
 struct IRenderPart
@@ -8,7 +9,8 @@ struct IRenderPart
     virtual void Begin() { }
     virtual void SetMode(RenderMode mode) { }
     
-    virtual void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection) = 0;
+    // draws the batch, the reason only goes to the statistics
+    virtual void Flush(const glm::mat4x4& modelView, const glm::mat4x4& projection, FlushReason reason) = 0;
 };
 
 struct Point;
@@ -53,3 +55,21 @@ struct IRenderFan : public IRenderPart
     
     virtual Vertex* GetVertices(std::size_t nEdges, const glm::mat4x4& modelView, const glm::mat4x4& projection) = 0;
 };
+
+struct SpriteInstance;
+struct SpriteFrame;
+struct IRenderSprites : public IRenderPart
+{
+    virtual ~IRenderSprites() = default;
+    
+    virtual void SetFrames(const SpriteFrame* frames, std::size_t count) = 0;
+    virtual void Draw(GlTexture texture, const SpriteInstance* sprites, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection) = 0;
+};
+
+struct LightInstance;
+struct IRenderLights : public IRenderPart
+{
+    virtual ~IRenderLights() = default;
+    
+    virtual void Draw(const LightInstance* lights, std::size_t count, const glm::mat4x4& modelView, const glm::mat4x4& projection) = 0;
+};
@@ -0,0 +1,249 @@
+#include "BoundedDrawable.h"
+#include "DrawCommandQueue.h"
+#include "DrawingContext.h"
+#include "base/IDrawable.h"
+#include "base/IImage.h"
+#include "RenderBatch.h"
+#include "RenderingEngine.h"
+#include "RenderNull.h"
+#include "headless/NullWindow.h"
+#include "threading/ThreadPool.h"
+
+#include <cassert>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+void drawCommandQueueTest()
+{
+	DrawCommandQueue queue;
+
+	// overlapping translucent quads keep the order they were drawn in, whatever their textures
+	queue.SetLayer(0, false);
+	queue.AddQuad(7);
+	queue.AddFan(8);
+	queue.AddQuad(3);
+	{
+		const std::vector<DrawCommandQueue::Command>& commands = queue.Sort();
+		assert(commands.size() == 3);
+		assert(commands[0].GetTexture() == 7);
+		assert(commands[1].GetProgram() == DrawCommandQueue::PROGRAM_FAN);
+		assert(commands[2].GetTexture() == 3);
+	}
+	queue.Clear();
+
+	// an order independent layer is grouped by program and texture, the layers stay in order
+	queue.SetLayer(1, true);
+	queue.AddQuad(7);
+	queue.AddQuad(3);
+	queue.AddQuad(0x10007);
+	queue.SetLayer(0, true);
+	queue.AddQuad(5);
+	{
+		const std::vector<DrawCommandQueue::Command>& commands = queue.Sort();
+		assert(commands.size() == 4);
+		assert(commands[0].GetLayer() == 0 && commands[0].GetTexture() == 5);
+		assert(commands[1].GetTexture() == 3);
+		assert(commands[2].GetTexture() == 7);
+		assert(commands[3].GetTexture() == 0x10007); // the whole name, the key has its low bits
+	}
+	queue.Clear();
+}
+
+void renderBatchTest()
+{
+	// a region of 4096 bytes holds 256 vertices of 16 bytes
+	RenderBatch batch(64, RenderBatch::DEFAULT_LIMIT, 4096 / 16);
+	assert(batch.GetBatchLimit() == 256);
+
+	batch.SetBatchLimit(1024 * 1024);
+	assert(batch.GetBatchLimit() == 256);
+	assert(!batch.GrowBatch(257));
+	assert(batch.GrowBatch(200) && batch.GetBatchCapacity() == 256);
+
+	// never below the initial capacity, the largest single primitive
+	batch.SetBatchLimit(8);
+	assert(batch.GetBatchLimit() == 64 && batch.GetBatchCapacity() == 64);
+
+	// a region smaller than the initial capacity still takes the largest primitive
+	RenderBatch small(64, RenderBatch::DEFAULT_LIMIT, 16);
+	assert(small.GetBatchLimit() == 64);
+}
+
+void glyphRunCacheTest()
+{
+	struct FontImage : IImage
+	{
+		std::vector<uint8> pixels = std::vector<uint8>(16 * 16 * 4);
+
+		const uint8* GetData() const override { return pixels.data(); }
+		uint8 GetBitsPerPixel() const override { return 32; }
+		uint32 GetWidth() const override { return 16; }
+		uint32 GetHeight() const override { return 16; }
+	};
+
+	struct Label : IDrawable
+	{
+		size_t font = 0;
+
+		int GetOrder() const override { return 0; }
+		void Draw(DrawingContext& dc, float) const override
+		{
+			dc.DrawBitmapText(Vec2F{ 10, 10 }, 1, font, Color{ 0xffffffff }, "score 100");
+		}
+	};
+
+	TextureManager::LogicalTexture font = {};
+	font.pxFrameWidth = 8;
+	font.pxFrameHeight = 8;
+	font.uvFrames.resize(256 - 32, RectFloat{ 0, 0, 0.5f, 0.5f });
+
+	RenderNull render;
+	RenderingEngine engine(&render, 1, std::make_shared<NullWindow>("test", 64, 64));
+	engine.GetTextureManager().LoadPackage({ std::make_tuple(std::make_shared<FontImage>(), std::string("font"), font) });
+
+	// the font is decoded on the pool, it replaces the checker in one of the first frames
+	while (engine.GetTextureManager().GetPendingUploads())
+	{
+		engine.PreRender();
+		engine.PostRender();
+	}
+
+	Label label;
+	label.font = engine.GetTextureManager().FindSprite("font");
+	engine.GetScheme().RegisterDrawable(&label);
+
+	// the first frame lays the string out, the next one finds it
+	for (int frame = 0; frame < 2; ++frame)
+	{
+		engine.PreRender();
+		engine.Render(0);
+		engine.PostRender();
+	}
+
+	assert(engine.GetGlyphRunCache().GetStats().misses == 1);
+	assert(engine.GetGlyphRunCache().GetStats().hits == 1);
+
+	engine.GetScheme().UnegisterDrawable(&label);
+}
+
+void textureUploadTest()
+{
+	struct Image : IImage
+	{
+		bool corrupt = false;
+		std::vector<uint8> pixels = std::vector<uint8>(4 * 4 * 4);
+
+		const uint8* GetData() const override
+		{
+			if (corrupt)
+				throw std::runtime_error("corrupt image");
+			return pixels.data();
+		}
+		uint8 GetBitsPerPixel() const override { return 32; }
+		uint32 GetWidth() const override { return 4; }
+		uint32 GetHeight() const override { return 4; }
+	};
+
+	TextureManager::LogicalTexture tex = {};
+	tex.pxFrameWidth = 4;
+	tex.pxFrameHeight = 4;
+	tex.uvFrames = { RectFloat{ 0, 0, 1, 1 } };
+
+	auto good = std::make_shared<Image>();
+	auto corrupt = std::make_shared<Image>();
+	corrupt->corrupt = true;
+
+	RenderNull render;
+
+	// a corrupt image shows the checker and the rest of the package loads, decoded at once
+	{
+		TextureManager tm(render);
+		tm.LoadPackage({ std::make_tuple(corrupt, std::string("corrupt"), tex), std::make_tuple(good, std::string("good"), tex) });
+
+		assert(tm.GetDeviceTexture(tm.FindSprite("corrupt")) == tm.GetDeviceTexture(0));
+		assert(!(tm.GetDeviceTexture(tm.FindSprite("good")) == tm.GetDeviceTexture(0)));
+	}
+
+	// or on a pool, the textures show the checker until they are uploaded
+	{
+		ThreadPool pool(1);
+		TextureManager tm(render);
+		tm.SetAsyncUploads(&pool);
+		tm.LoadPackage({ std::make_tuple(corrupt, std::string("corrupt"), tex), std::make_tuple(good, std::string("good"), tex) });
+
+		assert(tm.GetDeviceTexture(tm.FindSprite("good")) == tm.GetDeviceTexture(0));
+		while (tm.GetPendingUploads())
+			tm.ProcessUploads();
+
+		assert(tm.GetDeviceTexture(tm.FindSprite("corrupt")) == tm.GetDeviceTexture(0));
+		assert(!(tm.GetDeviceTexture(tm.FindSprite("good")) == tm.GetDeviceTexture(0)));
+	}
+}
+
+void textureAtlasTest()
+{
+	struct Image : IImage
+	{
+		std::vector<uint8> pixels = std::vector<uint8>(8 * 8 * 4);
+
+		const uint8* GetData() const override { return pixels.data(); }
+		uint8 GetBitsPerPixel() const override { return 32; }
+		uint32 GetWidth() const override { return 8; }
+		uint32 GetHeight() const override { return 8; }
+	};
+
+	TextureManager::LogicalTexture tex = {};
+	tex.pxFrameWidth = 8;
+	tex.pxFrameHeight = 8;
+	tex.magFilter = true;
+	tex.uvFrames = { RectFloat{ 0, 0, 1, 1 } };
+
+	RenderNull render;
+	TextureManager tm(render);
+	tm.SetAtlas(true);
+	tm.LoadPackage({ std::make_tuple(std::make_shared<Image>(), std::string("ground"), tex), std::make_tuple(std::make_shared<Image>(), std::string("tank"), tex) });
+
+	const size_t ground = tm.FindSprite("ground");
+	const size_t tank = tm.FindSprite("tank");
+	assert(tm.GetDeviceTexture(ground) == tm.GetDeviceTexture(tank));
+
+	// drawn tiled, the texture leaves the atlas with its own frames
+	tm.RequestWrap(ground);
+	tm.ProcessUploads();
+	assert(!(tm.GetDeviceTexture(ground) == tm.GetDeviceTexture(tank)));
+	assert(tm.GetSpriteInfo(ground).wrap);
+	assert(tm.GetSpriteInfo(ground).uvFrames[0].right == 1);
+}
+
+void boundedDrawableTest()
+{
+	struct Box : BoundedDrawable
+	{
+		mutable int draws = 0;
+
+		explicit Box(const RectFloat& bounds) : BoundedDrawable(bounds) {}
+		int GetOrder() const override { return 0; }
+		void Draw(DrawingContext&, float) const override { ++draws; }
+	};
+
+	RenderNull render;
+	TextureManager tm(render);
+	GlyphRunCache glyphRuns;
+	RenderScheme scheme(0, 1);
+
+	Box box(RectFloat{ 0, 0, 10, 10 });
+	box.Register(scheme);
+
+	DrawingContext dc(tm, &render, 64, 64, glyphRuns);
+	dc.Camera(RectInt{ 0, 0, 64, 64 }, 0, 0, 1);
+	scheme.Draw(dc, 0);
+	assert(box.draws == 1);
+
+	// moved out of the camera, the scheme learns it from SetBounds
+	box.SetBounds(RectFloat{ 1000, 1000, 1010, 1010 });
+	scheme.Draw(dc, 0);
+	assert(box.draws == 1);
+
+	box.Unregister();
+}
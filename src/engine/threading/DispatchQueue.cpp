@@ -0,0 +1,44 @@
+#include "DispatchQueue.h"
+
+#include <thread>
+
+DispatchQueue::DispatchQueue(size_t capacity, size_t drainBatch)
+	: m_tasks(capacity)
+	, m_batch(drainBatch)
+{
+}
+
+void DispatchQueue::Post(Task task)
+{
+	while (!m_tasks.TryPush(std::move(task)))
+		std::this_thread::yield();
+}
+
+bool DispatchQueue::TryPost(Task task)
+{
+	return m_tasks.TryPush(std::move(task));
+}
+
+size_t DispatchQueue::Drain(size_t maxTasks)
+{
+	size_t executed = 0;
+	while (executed < maxTasks)
+	{
+		size_t count = maxTasks - executed;
+		if (count > m_batch.size())
+			count = m_batch.size();
+
+		const size_t popped = m_tasks.TryPopBatch(m_batch.data(), count);
+		for (size_t i = 0; i < popped; ++i)
+		{
+			m_batch[i]();
+			m_batch[i] = nullptr;
+		}
+
+		executed += popped;
+		if (popped < count)
+			break;
+	}
+
+	return executed;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "MpscQueue.h"
+
+#include <functional>
+#include <vector>
+
+// Hands work from any thread over to the thread which calls Drain(), e.g. loaded
+// textures or decoded audio coming back from ThreadPool workers to the main thread.
+class DispatchQueue final
+{
+public:
+	using Task = std::function<void()>;
+
+	explicit DispatchQueue(size_t capacity = 4096, size_t drainBatch = 64);
+
+	// never drops the task, spins while the queue is full
+	void Post(Task task);
+	bool TryPost(Task task);
+
+	// runs at most maxTasks posted tasks on the calling thread, returns the number of executed ones
+	size_t Drain(size_t maxTasks = static_cast<size_t>(-1));
+
+private:
+	MpscQueue<Task> m_tasks;
+	std::vector<Task> m_batch;
+};
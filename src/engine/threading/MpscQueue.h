@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free ring for any number of producer threads and one consumer thread.
+// Every cell carries a sequence number telling whether it is free for the current lap
+// or holds a published item, so producers only contend on the enqueue position.
+template<typename T>
+class MpscQueue final
+{
+public:
+	explicit MpscQueue(size_t capacity);
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	bool TryPush(const T& item);
+	bool TryPush(T&& item);
+	// pushes as many items as fit into one contiguous range, returns the number of pushed items
+	size_t TryPushBatch(const T* items, size_t count);
+
+	// consumer thread only
+	bool TryPop(T& item) { return TryPopBatch(&item, 1) == 1; }
+	size_t TryPopBatch(T* items, size_t maxCount);
+
+	size_t GetCapacity() const { return m_mask + 1; }
+
+private:
+	enum { CacheLineSize = 64 };
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	// returns the first reserved position and writes the number of reserved cells to count
+	bool Reserve(size_t& position, size_t& count);
+
+	std::unique_ptr<Cell[]> m_cells;
+	size_t m_mask;
+
+	alignas(CacheLineSize) std::atomic<size_t> m_enqueuePos { 0 };
+	alignas(CacheLineSize) size_t m_dequeuePos { 0 };
+};
+
+template<typename T>
+MpscQueue<T>::MpscQueue(size_t capacity)
+{
+	assert(capacity > 0);
+
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	m_cells.reset(new Cell[size]);
+	m_mask = size - 1;
+
+	for (size_t i = 0; i < size; ++i)
+		m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool MpscQueue<T>::Reserve(size_t& position, size_t& count)
+{
+	size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		// the consumer releases cells in order, so the free cells form a prefix starting at pos
+		size_t available = 0;
+		while (available < count && available <= m_mask)
+		{
+			const size_t seq = m_cells[(pos + available) & m_mask].sequence.load(std::memory_order_acquire);
+			if (seq != pos + available)
+				break;
+			++available;
+		}
+
+		if (available == 0)
+		{
+			const size_t seq = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+			if (static_cast<std::ptrdiff_t>(seq - pos) < 0)
+				return false; // full
+
+			// another producer took this position, retry with the fresh one
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+			continue;
+		}
+
+		if (m_enqueuePos.compare_exchange_weak(pos, pos + available, std::memory_order_relaxed))
+		{
+			position = pos;
+			count = available;
+			return true;
+		}
+	}
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPush(const T& item)
+{
+	return TryPushBatch(&item, 1) == 1;
+}
+
+template<typename T>
+bool MpscQueue<T>::TryPush(T&& item)
+{
+	size_t pos = 0;
+	size_t count = 1;
+	if (!Reserve(pos, count))
+		return false;
+
+	Cell& cell = m_cells[pos & m_mask];
+	cell.data = std::move(item);
+	cell.sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+size_t MpscQueue<T>::TryPushBatch(const T* items, size_t count)
+{
+	size_t pos = 0;
+	if (count == 0 || !Reserve(pos, count))
+		return 0;
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		Cell& cell = m_cells[(pos + i) & m_mask];
+		cell.data = items[i];
+		cell.sequence.store(pos + i + 1, std::memory_order_release);
+	}
+
+	return count;
+}
+
+template<typename T>
+size_t MpscQueue<T>::TryPopBatch(T* items, size_t maxCount)
+{
+	size_t popped = 0;
+	for (; popped < maxCount; ++popped)
+	{
+		Cell& cell = m_cells[m_dequeuePos & m_mask];
+		if (cell.sequence.load(std::memory_order_acquire) != m_dequeuePos + 1)
+			break; // empty or the producer has not published this cell yet
+
+		items[popped] = std::move(cell.data);
+		cell.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+		++m_dequeuePos;
+	}
+
+	return popped;
+}
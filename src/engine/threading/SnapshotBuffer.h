@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mutex>
+#include <utility>
+
+// Hands the last complete state from the update thread to the render thread. The writer fills
+// GetWriteSlot() and calls Publish(), the reader calls Acquire() and reads GetCurrent(). Each side
+// owns a slot of its own and the lock is held only to swap it with the shared one, so neither
+// waits for the other to finish its frame. A state published before the previous one was
+// acquired replaces it. The write slot keeps an old state after Publish, fill it completely.
+template<typename T>
+class SnapshotBuffer final
+{
+public:
+	SnapshotBuffer() = default;
+
+	SnapshotBuffer(const SnapshotBuffer&) = delete;
+	SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+	// writer side
+	T& GetWriteSlot() { return m_slots[m_write]; }
+	void Publish()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::swap(m_write, m_ready);
+		m_fresh = true;
+	}
+
+	// reader side, returns true when a new state became current
+	bool Acquire()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_fresh)
+			return false;
+
+		std::swap(m_current, m_ready);
+		m_fresh = false;
+		return true;
+	}
+
+	const T& GetCurrent() const { return m_slots[m_current]; }
+
+private:
+	T m_slots[3];
+
+	int m_write { 0 };
+	int m_ready { 1 };
+	int m_current { 2 };
+	bool m_fresh { false };
+	std::mutex m_mutex;
+};
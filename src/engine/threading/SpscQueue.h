@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free ring for exactly one producer thread and one consumer thread.
+template<typename T>
+class SpscQueue final
+{
+public:
+	explicit SpscQueue(size_t capacity);
+
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	bool TryPush(const T& item) { return TryPushBatch(&item, 1) == 1; }
+	bool TryPush(T&& item);
+	// pushes as many items as fit, returns the number of pushed items
+	size_t TryPushBatch(const T* items, size_t count);
+
+	bool TryPop(T& item) { return TryPopBatch(&item, 1) == 1; }
+	// pops up to maxCount items, returns the number of popped items
+	size_t TryPopBatch(T* items, size_t maxCount);
+
+	size_t GetCapacity() const { return m_mask + 1; }
+	bool IsEmpty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+
+private:
+	enum { CacheLineSize = 64 };
+
+	size_t Reserve(size_t count);
+
+	std::vector<T> m_buffer;
+	size_t m_mask;
+
+	// written by the consumer
+	alignas(CacheLineSize) std::atomic<size_t> m_head { 0 };
+	size_t m_cachedTail { 0 };
+
+	// written by the producer
+	alignas(CacheLineSize) std::atomic<size_t> m_tail { 0 };
+	size_t m_cachedHead { 0 };
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+{
+	assert(capacity > 0);
+
+	size_t size = 1;
+	while (size < capacity)
+		size <<= 1;
+
+	m_buffer.resize(size);
+	m_mask = size - 1;
+}
+
+template<typename T>
+size_t SpscQueue<T>::Reserve(size_t count)
+{
+	const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+	size_t available = GetCapacity() - (tail - m_cachedHead);
+	if (available < count)
+	{
+		// refresh the consumer position only when the cached one is not enough
+		m_cachedHead = m_head.load(std::memory_order_acquire);
+		available = GetCapacity() - (tail - m_cachedHead);
+	}
+
+	return available < count ? available : count;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPush(T&& item)
+{
+	if (Reserve(1) == 0)
+		return false;
+
+	const size_t tail = m_tail.load(std::memory_order_relaxed);
+	m_buffer[tail & m_mask] = std::move(item);
+	m_tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+template<typename T>
+size_t SpscQueue<T>::TryPushBatch(const T* items, size_t count)
+{
+	const size_t pushed = Reserve(count);
+	const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+	for (size_t i = 0; i < pushed; ++i)
+		m_buffer[(tail + i) & m_mask] = items[i];
+
+	m_tail.store(tail + pushed, std::memory_order_release);
+	return pushed;
+}
+
+template<typename T>
+size_t SpscQueue<T>::TryPopBatch(T* items, size_t maxCount)
+{
+	const size_t head = m_head.load(std::memory_order_relaxed);
+
+	size_t ready = m_cachedTail - head;
+	if (ready < maxCount)
+	{
+		m_cachedTail = m_tail.load(std::memory_order_acquire);
+		ready = m_cachedTail - head;
+	}
+
+	const size_t popped = ready < maxCount ? ready : maxCount;
+	for (size_t i = 0; i < popped; ++i)
+		items[i] = std::move(m_buffer[(head + i) & m_mask]);
+
+	m_head.store(head + popped, std::memory_order_release);
+	return popped;
+}
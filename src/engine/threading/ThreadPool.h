@@ -1,9 +1,13 @@
 #pragma once 
 
-#include <thread>
+#include <condition_variable>
+#include <functional>
 #include <future>
-#include <vector>
+#include <mutex>
 #include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 class ThreadPool final
 {
@@ -12,6 +16,8 @@ public:
 	explicit ThreadPool(size_t threadsCount);
 	~ThreadPool();
 
+	size_t GetThreadsCount() const { return m_workers.size(); }
+
 	template<class F, class... Args>
 	auto Enqueue(F&& f, Args&&... args)->std::future<typename std::result_of<F(Args...)>::type>;
 
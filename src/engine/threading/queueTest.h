@@ -0,0 +1,135 @@
+#include "SpscQueue.h"
+#include "MpscQueue.h"
+#include "DispatchQueue.h"
+
+#include <cassert>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// mutex + deque baseline the lock-free queues are measured against
+template<typename T>
+class LockedQueue
+{
+public:
+	bool TryPush(const T& item)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_items.push_back(item);
+		return true;
+	}
+
+	size_t TryPopBatch(T* items, size_t maxCount)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t popped = 0;
+		for (; popped < maxCount && !m_items.empty(); ++popped)
+		{
+			items[popped] = m_items.front();
+			m_items.pop_front();
+		}
+		return popped;
+	}
+
+private:
+	std::mutex m_mutex;
+	std::deque<T> m_items;
+};
+
+template<typename TQueue>
+double queueContentionRun(TQueue& queue, size_t producers, size_t itemsPerProducer)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < producers; ++p)
+	{
+		threads.emplace_back([&queue, p, itemsPerProducer]
+		{
+			for (size_t i = 0; i < itemsPerProducer; ++i)
+			{
+				while (!queue.TryPush(p * itemsPerProducer + i))
+					std::this_thread::yield();
+			}
+		});
+	}
+
+	size_t sum = 0;
+	size_t received = 0;
+	size_t batch[64];
+	while (received < producers * itemsPerProducer)
+	{
+		const size_t popped = queue.TryPopBatch(batch, 64);
+		for (size_t i = 0; i < popped; ++i)
+			sum += batch[i];
+		received += popped;
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	const size_t total = producers * itemsPerProducer;
+	assert(sum == total * (total - 1) / 2);
+	(void)sum;
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void queueTest()
+{
+	{
+		SpscQueue<int> queue(4);
+		int items[] = { 1, 2, 3, 4, 5 };
+		assert(queue.TryPushBatch(items, 5) == 4);
+
+		int out[8];
+		assert(queue.TryPopBatch(out, 8) == 4);
+		assert(out[0] == 1 && out[3] == 4);
+		assert(!queue.TryPop(out[0]));
+	}
+
+	{
+		MpscQueue<int> queue(4);
+		int items[] = { 1, 2, 3 };
+		assert(queue.TryPushBatch(items, 3) == 3);
+		assert(queue.TryPushBatch(items, 3) == 1);
+		assert(!queue.TryPush(7));
+
+		int out[8];
+		assert(queue.TryPopBatch(out, 8) == 4);
+		assert(out[0] == 1 && out[3] == 1);
+	}
+
+	{
+		DispatchQueue dispatch;
+		int counter = 0;
+		std::thread worker([&] { for (int i = 0; i < 100; ++i) dispatch.Post([&counter] { ++counter; }); });
+		worker.join();
+		assert(dispatch.Drain() == 100);
+		assert(counter == 100);
+	}
+}
+
+void queueBenchmark()
+{
+	const size_t itemsPerProducer = 200000;
+
+	for (size_t producers : { 1, 2, 4, 8 })
+	{
+		LockedQueue<size_t> locked;
+		MpscQueue<size_t> mpsc(1 << 14);
+
+		const double lockedMs = queueContentionRun(locked, producers, itemsPerProducer);
+		const double mpscMs = queueContentionRun(mpsc, producers, itemsPerProducer);
+
+		std::cout << "producers " << producers
+			<< ": mutex+deque " << lockedMs << " ms"
+			<< ", mpsc " << mpscMs << " ms" << std::endl;
+	}
+
+	SpscQueue<size_t> spsc(1 << 14);
+	std::cout << "spsc 1 producer: " << queueContentionRun(spsc, 1, itemsPerProducer) << " ms" << std::endl;
+}
@@ -149,3 +149,8 @@ void GlfwWindow::PollEvents()
 {
 	glfwPollEvents();
 }
+
+void GlfwWindow::MakeContextCurrent(bool current)
+{
+	glfwMakeContextCurrent(current ? m_glfwWindow : nullptr);
+}
@@ -24,6 +24,9 @@ public:
 	void SwapBuffers() override;
 
 	void PollEvents() override;
+
+	// binds the GL context to the calling thread, or releases it from the calling thread
+	void MakeContextCurrent(bool current);
     
     bool IsFocused() const override { return m_isFocused; }
     const std::string& GetName() const override { return m_name; }
@@ -69,17 +69,30 @@ struct TestUpdatable : public IUpdatable
 #include <rendering/SoilImage.h>
 #include <rendering/Line.h>
 
+#include <threading/SnapshotBuffer.h>
+
 struct TestRenderable : public IRenderable
 {
     TestRenderable(std::shared_ptr<IRender> render)
      : m_render(render)
+     , m_line{ {-0.5f, -0.5f}, {0.5, 0.5}, {255, 255, 255, 255} }
     {
     }
     
     std::shared_ptr<IRender> m_render;
+    Line m_line;
+    SnapshotBuffer<Line> m_snapshot;
+
+    void Capture() override
+    {
+        m_snapshot.GetWriteSlot() = m_line;
+        m_snapshot.Publish();
+    }
 
     void Render(float fixedDeltaTime) override
     {
+        m_snapshot.Acquire();
+        
         std::cout << "Render " << fixedDeltaTime << std::endl;
         
 //        glClearColor(0, 0.4, 0, 1);
@@ -91,10 +104,7 @@ struct TestRenderable : public IRenderable
         {
             // RectInt viewport{ 0, 0, (int)lc.GetPixelSize().x, (int)lc.GetPixelSize().y };
             
-            Line lines[] = {
-                { {-0.5f, -0.5f}, {0.5, 0.5}, {255, 255, 255, 255} }
-            };
-            m_render->DrawLines(lines, 1);
+            m_render->DrawLines(&m_snapshot.GetCurrent(), 1);
             //m_render->
         }
         m_render->End();
@@ -165,10 +175,120 @@ struct WindowListener : public IWindowListener
     }
 };
 
-int main(int, const char**)
+#include <headless/NullWindow.h>
+#include <headless/NullInput.h>
+#include <headless/HeadlessDriver.h>
+#include <rendering/RenderNull.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+struct CommandLine
+{
+    bool headless = false;          // --headless: no window, no renderer
+    bool unpaced = false;           // --unpaced: headless steps as fast as possible
+    bool renderThread = false;      // --render-thread: render on a thread of its own
+    uint64 ticks = 0;               // --ticks N: headless run length, 0 runs until closed
+    int tickRate = GameLoop::DEFAULT_TICK_RATE; // --tick-rate N, 1..MAX_TICK_RATE
+    bool valid = true;
+
+    static const int MAX_TICK_RATE = 1000;
+
+    CommandLine(int argc, const char** argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            if (!std::strcmp(argv[i], "--headless"))
+                headless = true;
+            else if (!std::strcmp(argv[i], "--unpaced"))
+                unpaced = true;
+            else if (!std::strcmp(argv[i], "--render-thread"))
+                renderThread = true;
+            else if (!std::strcmp(argv[i], "--ticks") && i + 1 < argc)
+            {
+                const char* value = argv[++i];
+                char* end = nullptr;
+                errno = 0;
+                const unsigned long long count = std::strtoull(value, &end, 10);
+                if (end == value || *end != '\0' || *value == '-' || errno == ERANGE)
+                {
+                    std::cerr << "invalid tick count " << value << std::endl;
+                    valid = false;
+                }
+                else
+                    ticks = count;
+            }
+            else if (!std::strcmp(argv[i], "--tick-rate") && i + 1 < argc)
+            {
+                const char* value = argv[++i];
+                char* end = nullptr;
+                const long rate = std::strtol(value, &end, 10);
+                if (end == value || *end != '\0' || rate <= 0 || rate > MAX_TICK_RATE)
+                {
+                    std::cerr << "invalid tick rate " << value << std::endl;
+                    valid = false;
+                }
+                else
+                    tickRate = static_cast<int>(rate);
+            }
+            else
+                std::cerr << "unknown option " << argv[i] << std::endl;
+        }
+    }
+
+    static void PrintUsage(const char* program)
+    {
+        std::cerr << "usage: " << program << " [--headless] [--unpaced] [--render-thread] [--ticks N] [--tick-rate 1.." << MAX_TICK_RATE << "]" << std::endl;
+    }
+};
+
+static int RunHeadless(const CommandLine& cmd)
+{
+    auto window = std::make_shared<NullWindow>("headless", 1024, 768);
+    auto input = std::make_shared<NullInput>();
+    auto clipboard = std::make_shared<NullClipboard>();
+
+    auto renderer = std::make_shared<RenderNull>();
+    renderer->Init();
+
+    auto engine = std::make_unique<Engine>(input, clipboard, window, renderer);
+
+    auto& gameLoop = engine->GetGameLoop();
+    gameLoop->SetTickRate(cmd.tickRate);
+
+    gameLoop->Add<FixedUpd>();
+    gameLoop->Add<TestUpdatable>(input);
+    gameLoop->Add<TestRenderable>(renderer);
+
+    HeadlessDriver driver(*gameLoop, *window, cmd.unpaced ? HeadlessDriver::Pacing::Unpaced : HeadlessDriver::Pacing::WallClock);
+    HeadlessDriver::Stats stats = driver.Run(cmd.ticks);
+
+    std::cout << stats.steps << " steps in " << stats.seconds << " s, "
+        << stats.GetStepsPerSecond() << " steps/s" << std::endl;
+
+    if (stats.stalled)
+    {
+        std::cerr << "stalled, no step simulated for " << HeadlessDriver::DEFAULT_STALL_TIMEOUT.count() << " s" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, const char** argv)
 {
+    CommandLine cmd(argc, argv);
+    if (!cmd.valid)
+    {
+        CommandLine::PrintUsage(argv[0]);
+        return 1;
+    }
+
     ECSTest();
     
+    if (cmd.headless)
+        return RunHeadless(cmd);
     
     auto window = std::make_shared<GlfwWindow>("test window", 1024, 768, false);
     auto input = std::make_shared<GlfwInput>(window.get());
@@ -186,6 +306,7 @@ int main(int, const char**)
     engine->GetWindow()->AddListener(&windowListener);
     
     auto& gameLoop = engine->GetGameLoop();
+    gameLoop->SetTickRate(cmd.tickRate);
     
     {
         gameLoop->Add<FixedUpd>();
@@ -195,6 +316,28 @@ int main(int, const char**)
         gameLoop->Start();
     }
     
+    if (cmd.renderThread)
+    {
+        // the context moves to the render thread, the loop thread keeps the window events
+        window->MakeContextCurrent(false);
+        gameLoop->StartRenderThread([window] { window->MakeContextCurrent(true); }, [window] { window->SwapBuffers(); });
+        
+        for (window->PollEvents(); !window->ShouldClose(); window->PollEvents())
+        {
+            input->Read();
+            
+            gameLoop->Tick();
+            
+            input->Clear();
+            
+            std::this_thread::sleep_for(gameLoop->GetTimeToNextStep());
+        }
+        
+        gameLoop->StopRenderThread();
+        window->MakeContextCurrent(true);
+        return 0;
+    }
+    
     std::string clS;
     for (window->PollEvents(); !window->ShouldClose(); window->SwapBuffers())
     {
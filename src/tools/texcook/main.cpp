@@ -0,0 +1,111 @@
+// Offline texture package cooker.
+//
+//   texcook <data directory> <package.lua> <output> [--page-size N] [--padding N] [--no-atlas]
+//           [--mipmaps] [--format raw|bc]
+//
+// Runs the package script once, packs the images into atlas pages and writes a binary
+// package ParseCookedPackage reads back at startup without Lua and image decoding. The data
+// directory is resolved by CreateOSFileSystem, the same way the game resolves it.
+//
+// --mipmaps stores the mipmaps of the images, a larger padding keeps the small levels of the
+// atlas pages from bleeding. --format bc compresses them to BC1, or BC3 with alpha. ETC2
+// images are not encoded here, the script may refer to .ktx files made by an ETC2 encoder
+// and they are stored as they are.
+
+#include <rendering/CookedPackage.h>
+#include <rendering/MipmapImage.h>
+#include <rendering/TextureAtlas.h>
+#include <rendering/TextureManager.h>
+#include <filesystem/FileSystem.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 4)
+    {
+        std::cerr << "usage: texcook <data directory> <package.lua> <output> [--page-size N] [--padding N] [--no-atlas]"
+            " [--mipmaps] [--format raw|bc]" << std::endl;
+        return 1;
+    }
+
+    AtlasOptions options;
+    bool atlas = true;
+    bool mipmaps = false;
+    bool compress = false;
+    for (int i = 4; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--page-size") && i + 1 < argc)
+            options.pageSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--padding") && i + 1 < argc)
+            options.padding = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-atlas"))
+            atlas = false;
+        else if (!strcmp(argv[i], "--mipmaps"))
+            mipmaps = true;
+        else if (!strcmp(argv[i], "--format") && i + 1 < argc && (!strcmp(argv[i + 1], "raw") || !strcmp(argv[i + 1], "bc")))
+            compress = !strcmp(argv[++i], "bc");
+        else
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        auto fs = FileSystem::CreateOSFileSystem(argv[1]);
+        TextureDefinitions definitions = ParsePackage(argv[2], fs->Open(argv[2])->AsMemory(), *fs);
+        if (atlas)
+            definitions = BuildAtlas(std::move(definitions), options);
+
+        // after the atlas, which takes only single level raw images
+        std::map<IImage*, std::shared_ptr<IImage>> cooked;
+        for (auto& item : definitions)
+        {
+            std::shared_ptr<IImage>& image = std::get<0>(item);
+            auto emplaced = cooked.emplace(image.get(), image);
+            if (emplaced.second && !IsCompressedFormat(image->GetFormat()))
+            {
+                if (mipmaps && image->GetLevelsCount() == 1)
+                    emplaced.first->second = GenerateMipmaps(*emplaced.first->second);
+                if (compress)
+                    emplaced.first->second = CompressBC(*emplaced.first->second);
+            }
+            image = emplaced.first->second;
+        }
+
+        std::vector<uint8> package = CookPackage(definitions);
+
+        std::ofstream out(argv[3], std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(package.data()), package.size());
+        if (!out)
+            throw std::runtime_error(std::string("could not write ") + argv[3]);
+
+        std::set<IImage*> images;
+        size_t memory = 0;
+        for (auto& item : definitions)
+        {
+            if (images.insert(std::get<0>(item).get()).second)
+                memory += GetImageDeviceSize(*std::get<0>(item));
+        }
+
+        std::cout << argv[2] << ": " << definitions.size() << " textures, " << images.size() << " images, "
+            << package.size() << " bytes, " << memory << " bytes of video memory" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "texcook: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
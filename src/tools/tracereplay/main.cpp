@@ -0,0 +1,166 @@
+// Render trace player for renderer benchmarks.
+//
+//   tracereplay <trace> [--render null|software] [--loops N] [--threads N] [--calls] [--tga output]
+//
+// Plays the frames of a trace recorded by RenderRecorder 'loops' times and prints the frame
+// times, with --calls also the time spent in every kind of IRender call. The software render
+// rasterizes on 'threads' pool threads and --tga saves its last frame.
+
+#include <rendering/RenderNull.h>
+#include <rendering/RenderSoftware.h>
+#include <rendering/RenderTrace.h>
+#include <threading/ThreadPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: tracereplay <trace> [--render null|software] [--loops N] [--threads N] [--calls] [--tga output]" << std::endl;
+        return 1;
+    }
+
+    std::string renderName = "software";
+    std::string tgaPath;
+    int loops = 10;
+    int threads = 0;
+    bool calls = false;
+    for (int i = 2; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--render") && i + 1 < argc)
+            renderName = argv[++i];
+        else if (!strcmp(argv[i], "--loops") && i + 1 < argc)
+            loops = std::max(1, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+            threads = std::max(0, atoi(argv[++i]));
+        else if (!strcmp(argv[i], "--calls"))
+            calls = true;
+        else if (!strcmp(argv[i], "--tga") && i + 1 < argc)
+            tgaPath = argv[++i];
+        else
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        std::ifstream in(argv[1], std::ios::in | std::ios::binary);
+        if (!in)
+            throw std::runtime_error(std::string("could not read ") + argv[1]);
+        std::vector<uint8> trace((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+        RenderTracePlayer player(std::move(trace));
+        if (player.GetFramesCount() == 0)
+            throw std::runtime_error("the trace has no complete frames");
+
+        std::unique_ptr<ThreadPool> pool;
+        std::unique_ptr<RenderSoftware> software;
+        std::unique_ptr<IRender> render;
+        if (renderName == "software")
+        {
+            software = std::make_unique<RenderSoftware>();
+            if (threads > 0)
+            {
+                pool = std::make_unique<ThreadPool>(threads);
+                software->SetThreadPool(pool.get());
+            }
+        }
+        else if (renderName == "null")
+        {
+            render = std::make_unique<RenderNull>();
+        }
+        else
+        {
+            throw std::runtime_error("unknown render " + renderName);
+        }
+
+        IRender& target = software ? *software : *render;
+        target.Init();
+        player.Prepare(target);
+
+        using Clock = std::chrono::steady_clock;
+        RenderTracePlayer::Timings timings = {};
+        std::vector<double> frameTimes;
+        frameTimes.reserve(loops * player.GetFramesCount());
+
+        for (int loop = 0; loop < loops; ++loop)
+        {
+            for (size_t frame = 0; frame < player.GetFramesCount(); ++frame)
+            {
+                const Clock::time_point start = Clock::now();
+                player.PlayFrame(target, frame, calls ? &timings : nullptr);
+                frameTimes.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+            }
+        }
+
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        double total = 0;
+        for (double time : frameTimes)
+            total += time;
+
+        std::cout << std::fixed << std::setprecision(3)
+            << argv[1] << ": " << player.GetFramesCount() << " frames x " << loops << " loops on " << renderName << std::endl
+            << "frame ms: min " << sorted.front() * 1000
+            << ", median " << sorted[sorted.size() / 2] * 1000
+            << ", mean " << total / frameTimes.size() * 1000
+            << ", p99 " << sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] * 1000
+            << ", max " << sorted.back() * 1000 << std::endl;
+
+        if (calls)
+        {
+            std::cout << std::left << std::setw(20) << "call" << std::right << std::setw(12) << "count"
+                << std::setw(12) << "total ms" << std::setw(12) << "ns/call" << std::endl;
+            for (int call = 0; call < RenderTrace::CALL_COUNT; ++call)
+            {
+                const RenderTracePlayer::CallStats& stats = timings.calls[call];
+                if (!stats.count)
+                    continue;
+                std::cout << std::left << std::setw(20) << RenderTrace::GetCallName((RenderTrace::Call)call) << std::right
+                    << std::setw(12) << stats.count
+                    << std::setw(12) << stats.seconds * 1000
+                    << std::setw(12) << stats.seconds * 1e9 / stats.count << std::endl;
+            }
+        }
+
+        if (software)
+        {
+            const RenderSoftware::Stats& stats = software->GetStats();
+            std::cout << "rasterized " << stats.triangles << " triangles, " << stats.pixels << " pixels, checksum "
+                << std::hex << software->GetChecksum() << std::dec << std::endl;
+
+            if (!tgaPath.empty())
+            {
+                std::vector<uint8> tga = software->EncodeTga();
+                std::ofstream out(tgaPath, std::ios::out | std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char*>(tga.data()), tga.size());
+                if (!out)
+                    throw std::runtime_error("could not write " + tgaPath);
+            }
+        }
+
+        player.Release(target);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "tracereplay: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}